@@ -18,6 +18,7 @@
 #include <QtNetwork/QNetworkRequest>
 #include <QtNetwork/QNetworkReply>
 
+#include <AudioInjectorScheduler.h>
 #include <AudioRingBuffer.h>
 #include <AvatarData.h>
 #include <NodeList.h>
@@ -146,7 +147,7 @@ void Agent::readPendingDatagrams() {
                     _voxelViewer.processDatagram(mutablePacket, sourceNode);
                 }
 
-            } else if (datagramPacketType == PacketTypeMixedAudio) {
+            } else if (datagramPacketType == PacketTypeMixedAudio || datagramPacketType == PacketTypeSilentAudioFrame) {
                 // parse the data and grab the average loudness
                 _receivedAudioBuffer.parseData(receivedPacket);
                 
@@ -258,3 +259,13 @@ void Agent::run() {
 void Agent::aboutToFinish() {
     _scriptEngine.stop();
 }
+
+void Agent::sendStatsPacket() {
+    QJsonObject statsObject;
+    
+    // the sounds this agent's script is playing all go out through the shared injector scheduler
+    AudioInjectorScheduler::getInstance().addStats(statsObject);
+    AudioInjectorScheduler::getInstance().resetStats();
+    
+    ThreadedAssignment::addPacketStatsAndSendStatsPacket(statsObject);
+}
@@ -59,6 +59,8 @@ public slots:
     void run();
     void readPendingDatagrams();
     void playAvatarSound(Sound* avatarSound) { _scriptEngine.setAvatarSound(avatarSound); }
+    
+    void sendStatsPacket();
 
 private:
     ScriptEngine _scriptEngine;
@@ -9,6 +9,7 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <QtCore/QDataStream>
 #include <QtCore/QProcess>
 #include <QtCore/QThread>
 #include <QtCore/QTimer>
@@ -23,6 +24,7 @@
 #include <SharedUtil.h>
 
 
+#include "AssignmentClientMonitor.h"
 #include "AssignmentFactory.h"
 #include "AssignmentThread.h"
 
@@ -37,7 +39,9 @@ int hifiSockAddrMeta = qRegisterMetaType<HifiSockAddr>("HifiSockAddr");
 
 AssignmentClient::AssignmentClient(int &argc, char **argv) :
     QCoreApplication(argc, argv),
-    _assignmentServerHostname(DEFAULT_ASSIGNMENT_SERVER_HOSTNAME)
+    _assignmentServerHostname(DEFAULT_ASSIGNMENT_SERVER_HOSTNAME),
+    _monitorPort(0),
+    _monitorSocket()
 {
     DTLSClientSession::globalInit();
     
@@ -91,6 +95,13 @@ AssignmentClient::AssignmentClient(int &argc, char **argv) :
         nodeList->setAssignmentServerSocket(customAssignmentSocket);
     }
     
+    // check if we are part of a monitor's pool, in which case we report when we take and finish assignments
+    argumentIndex = argumentList.indexOf(MONITOR_PORT_PARAMETER);
+    
+    if (argumentIndex != -1) {
+        _monitorPort = argumentList[argumentIndex + 1].toUShort();
+    }
+    
     // call a timer function every ASSIGNMENT_REQUEST_INTERVAL_MSECS to ask for assignment, if required
     qDebug() << "Waiting for assignment -" << _requestAssignment;
     
@@ -163,6 +174,8 @@ void AssignmentClient::readPendingDatagrams() {
                     
                     // Starts an event loop, and emits workerThread->started()
                     workerThread->start();
+                    
+                    sendStatusToMonitor(true);
                 } else {
                     qDebug() << "Received an assignment that could not be unpacked. Re-requesting.";
                 }
@@ -210,6 +223,8 @@ void AssignmentClient::assignmentCompleted() {
     disconnect(&nodeList->getNodeSocket(), 0, _currentAssignment.data(), 0);
     connect(&nodeList->getNodeSocket(), &QUdpSocket::readyRead, this, &AssignmentClient::readPendingDatagrams);
     
+    sendStatusToMonitor(false);
+    
     // clear our current assignment shared pointer now that we're done with it
     // if the assignment thread is still around it has its own shared pointer to the assignment
     _currentAssignment.clear();
@@ -219,3 +234,16 @@ void AssignmentClient::assignmentCompleted() {
     nodeList->reset();
     nodeList->resetNodeInterestSet();
 }
+
+void AssignmentClient::sendStatusToMonitor(bool isAssigned) {
+    if (_monitorPort == 0) {
+        return;
+    }
+    
+    QByteArray statusDatagram;
+    QDataStream statusStream(&statusDatagram, QIODevice::WriteOnly);
+    statusStream << applicationPid() << (quint8) (isAssigned ? ChildAssigned : ChildIdle)
+        << (quint8) (_currentAssignment ? _currentAssignment->getType() : Assignment::AllTypes);
+    
+    _monitorSocket.writeDatagram(statusDatagram, QHostAddress::LocalHost, _monitorPort);
+}
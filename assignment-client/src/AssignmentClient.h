@@ -13,6 +13,7 @@
 #define hifi_AssignmentClient_h
 
 #include <QtCore/QCoreApplication>
+#include <QtNetwork/QUdpSocket>
 
 #include "ThreadedAssignment.h"
 
@@ -29,9 +30,13 @@ private slots:
     void handleAuthenticationRequest();
 
 private:
+    void sendStatusToMonitor(bool isAssigned);
+    
     Assignment _requestAssignment;
     static SharedAssignmentPointer _currentAssignment;
     QString _assignmentServerHostname;
+    quint16 _monitorPort;
+    QUdpSocket _monitorSocket;
 };
 
 #endif // hifi_AssignmentClient_h
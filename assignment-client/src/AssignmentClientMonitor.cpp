@@ -9,16 +9,42 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QThread>
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#endif
+
 #include <Logging.h>
 
 #include "AssignmentClientMonitor.h"
 
 const char* NUM_FORKS_PARAMETER = "-n";
+const char* WARM_STANDBY_PARAMETER = "--warm";
+const char* PIN_CORES_PARAMETER = "--pin-cores";
+const char* MONITOR_PORT_PARAMETER = "--monitor-port";
 
 const QString ASSIGNMENT_CLIENT_MONITOR_TARGET_NAME = "assignment-client-monitor";
 
+AssignmentClientMonitor::ChildClient::ChildClient() :
+    pid(0),
+    isAssigned(false),
+    pinnedCore(-1)
+{
+    
+}
+
 AssignmentClientMonitor::AssignmentClientMonitor(int &argc, char **argv, int numAssignmentClientForks) :
-    QCoreApplication(argc, argv)
+    QCoreApplication(argc, argv),
+    _childArguments(),
+    _numAssignmentClientForks(numAssignmentClientForks),
+    _isWarmStandby(false),
+    _isPinningCores(false),
+    _statusSocket(),
+    _children(),
+    _pinnedCores()
 {
     // start the Logging class with the parent's target name
     Logging::setTargetName(ASSIGNMENT_CLIENT_MONITOR_TARGET_NAME);
@@ -32,6 +58,22 @@ AssignmentClientMonitor::AssignmentClientMonitor(int &argc, char **argv, int num
     _childArguments.removeAt(forksParameterIndex);
     _childArguments.removeAt(forksParameterIndex);
     
+    // the pool options are for the monitor only as well
+    _isWarmStandby = _childArguments.removeAll(WARM_STANDBY_PARAMETER) > 0;
+    _isPinningCores = _childArguments.removeAll(PIN_CORES_PARAMETER) > 0;
+    
+    if (_isWarmStandby || _isPinningCores) {
+        // children in a pool tell us over the loopback interface when they take an assignment and when they finish it
+        _statusSocket.bind(QHostAddress::LocalHost, 0);
+        connect(&_statusSocket, &QUdpSocket::readyRead, this, &AssignmentClientMonitor::readPendingStatusDatagrams);
+        
+        _childArguments << MONITOR_PORT_PARAMETER << QString::number(_statusSocket.localPort());
+        
+        if (_isWarmStandby) {
+            qDebug() << "Keeping" << _numAssignmentClientForks << "idle assignment clients on warm standby.";
+        }
+    }
+    
     // use QProcess to fork off a process for each of the child assignment clients
     for (int i = 0; i < numAssignmentClientForks; i++) {
         spawnChildClient();
@@ -50,10 +92,142 @@ void AssignmentClientMonitor::spawnChildClient() {
     connect(assignmentClient, SIGNAL(finished(int, QProcess::ExitStatus)), this,
             SLOT(childProcessFinished(int, QProcess::ExitStatus)));
     
+    ChildClient child;
+    child.pid = assignmentClient->pid();
+    _children.insert(assignmentClient, child);
+    
     qDebug() << "Spawned a child client with PID" << assignmentClient->pid();
 }
 
+void AssignmentClientMonitor::maintainStandbyPool() {
+    int numIdleChildren = 0;
+    foreach(const ChildClient& child, _children) {
+        if (!child.isAssigned) {
+            numIdleChildren++;
+        }
+    }
+    
+    // children that finish an assignment go back to waiting, so the pool only ever grows to the number of assignments
+    for (int i = numIdleChildren; i < _numAssignmentClientForks; i++) {
+        spawnChildClient();
+    }
+}
+
 void AssignmentClientMonitor::childProcessFinished(int exitCode, QProcess::ExitStatus exitStatus) {
-    qDebug("Replacing dead child assignment client with a new one");
-    spawnChildClient();
+    QProcess* assignmentClient = qobject_cast<QProcess*>(sender());
+    
+    if (assignmentClient) {
+        ChildClient child = _children.take(assignmentClient);
+        unpinChild(child);
+        assignmentClient->deleteLater();
+    }
+    
+    if (_isWarmStandby) {
+        qDebug("Child assignment client finished, topping up the standby pool");
+        maintainStandbyPool();
+    } else {
+        qDebug("Replacing dead child assignment client with a new one");
+        spawnChildClient();
+    }
+}
+
+void AssignmentClientMonitor::readPendingStatusDatagrams() {
+    while (_statusSocket.hasPendingDatagrams()) {
+        QByteArray statusDatagram(_statusSocket.pendingDatagramSize(), 0);
+        _statusSocket.readDatagram(statusDatagram.data(), statusDatagram.size());
+        
+        QDataStream statusStream(statusDatagram);
+        qint64 pid;
+        quint8 state, assignmentType;
+        statusStream >> pid >> state >> assignmentType;
+        
+        if (statusStream.status() != QDataStream::Ok) {
+            continue;
+        }
+        
+        for (QHash<QProcess*, ChildClient>::iterator it = _children.begin(); it != _children.end(); it++) {
+            ChildClient& child = it.value();
+            if (child.pid != pid) {
+                continue;
+            }
+            child.isAssigned = (state == ChildAssigned);
+            
+            if (child.isAssigned) {
+                // the mixers and octree servers get a core to themselves so they aren't descheduled behind the others
+                switch (assignmentType) {
+                    case Assignment::AudioMixerType:
+                    case Assignment::AvatarMixerType:
+                    case Assignment::VoxelServerType:
+                    case Assignment::ParticleServerType:
+                    case Assignment::ModelServerType:
+                        if (_isPinningCores) {
+                            pinChildToCore(child);
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            } else {
+                unpinChild(child);
+            }
+            break;
+        }
+        
+        if (_isWarmStandby) {
+            maintainStandbyPool();
+        }
+    }
+}
+
+#ifdef Q_OS_LINUX
+static void setAffinityForAllThreads(qint64 pid, const cpu_set_t& cpuSet) {
+    // threads created later inherit the affinity of their creator, but the ones already running need to be set one by one
+    QDir taskDirectory(QString("/proc/%1/task").arg(pid));
+    foreach(const QString& threadID, taskDirectory.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        sched_setaffinity(threadID.toInt(), sizeof(cpuSet), &cpuSet);
+    }
+}
+#endif
+
+void AssignmentClientMonitor::pinChildToCore(ChildClient& child) {
+#ifdef Q_OS_LINUX
+    if (child.pinnedCore != -1) {
+        return;
+    }
+    
+    // core zero is left for the monitor, the standbys and everything else on the machine
+    int numCores = QThread::idealThreadCount();
+    for (int core = 1; core < numCores; core++) {
+        if (!_pinnedCores.contains(core)) {
+            cpu_set_t cpuSet;
+            CPU_ZERO(&cpuSet);
+            CPU_SET(core, &cpuSet);
+            setAffinityForAllThreads(child.pid, cpuSet);
+            
+            _pinnedCores.insert(core);
+            child.pinnedCore = core;
+            
+            qDebug() << "Pinned child assignment client with PID" << child.pid << "to core" << core;
+            return;
+        }
+    }
+    qDebug() << "No free core to pin child assignment client with PID" << child.pid;
+#endif
+}
+
+void AssignmentClientMonitor::unpinChild(ChildClient& child) {
+    if (child.pinnedCore == -1) {
+        return;
+    }
+    _pinnedCores.remove(child.pinnedCore);
+    child.pinnedCore = -1;
+    
+#ifdef Q_OS_LINUX
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int core = 0; core < QThread::idealThreadCount(); core++) {
+        CPU_SET(core, &cpuSet);
+    }
+    setAffinityForAllThreads(child.pid, cpuSet);
+#endif
 }
@@ -13,11 +13,24 @@
 #define hifi_AssignmentClientMonitor_h
 
 #include <QtCore/QCoreApplication>
+#include <QtCore/QHash>
 #include <QtCore/QProcess>
+#include <QtCore/QSet>
+#include <QtNetwork/QUdpSocket>
 
 #include <Assignment.h>
 
 extern const char* NUM_FORKS_PARAMETER;
+extern const char* WARM_STANDBY_PARAMETER;
+extern const char* PIN_CORES_PARAMETER;
+extern const char* MONITOR_PORT_PARAMETER;
+
+/// The states a child in a warm standby pool reports to its monitor, as a datagram of the child's PID (qint64) followed
+/// by the state and the assignment type (each a quint8), sent to the monitor port on the loopback interface.
+enum AssignmentClientChildState {
+    ChildIdle = 0,
+    ChildAssigned
+};
 
 class AssignmentClientMonitor : public QCoreApplication {
     Q_OBJECT
@@ -25,10 +38,30 @@ public:
     AssignmentClientMonitor(int &argc, char **argv, int numAssignmentClientForks);
 private slots:
     void childProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void readPendingStatusDatagrams();
 private:
+    class ChildClient {
+    public:
+        ChildClient();
+        
+        qint64 pid;
+        bool isAssigned;
+        int pinnedCore;
+    };
+    
     void spawnChildClient();
+    void maintainStandbyPool();
+    
+    void pinChildToCore(ChildClient& child);
+    void unpinChild(ChildClient& child);
     
     QStringList _childArguments;
+    int _numAssignmentClientForks;
+    bool _isWarmStandby;
+    bool _isPinningCores;
+    QUdpSocket _statusSocket;
+    QHash<QProcess*, ChildClient> _children;
+    QSet<int> _pinnedCores;
 };
 
 #endif // hifi_AssignmentClientMonitor_h
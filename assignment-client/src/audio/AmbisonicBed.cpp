@@ -0,0 +1,87 @@
+//
+//  AmbisonicBed.cpp
+//  assignment-client/src/audio
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <SharedUtil.h>
+
+#include "AmbisonicBed.h"
+
+// each ear hears (1 - k) of the omni component and k of the figure of eight pointing out of it, which for k = 1/4 gives
+// the far ear half of the near ear for a source at 90 degrees, the same as the direct mix's weak channel
+const float DECODE_DIRECTIVITY = 0.25f;
+
+/// Returns the listener's right ear axis in world space.
+static glm::vec3 rightAxisForOrientation(const glm::quat& orientation) {
+    return orientation * glm::vec3(1.0f, 0.0f, 0.0f);
+}
+
+AmbisonicBed::AmbisonicBed() :
+    _center(),
+    _sources()
+{
+    reset(glm::vec3());
+}
+
+void AmbisonicBed::reset(const glm::vec3& center) {
+    _center = center;
+    _sources.resize(0);
+    memset(_w, 0, sizeof(_w));
+    memset(_x, 0, sizeof(_x));
+    memset(_y, 0, sizeof(_y));
+    memset(_z, 0, sizeof(_z));
+}
+
+int AmbisonicBed::addSource(const int16_t* samples, const glm::vec3& relativePosition, float gain) {
+    Source source;
+    source.samples = samples;
+    float distance = glm::length(relativePosition);
+    
+    // a source right at the center has no direction and is heard equally everywhere
+    source.direction = (distance < EPSILON) ? glm::vec3() : relativePosition / distance;
+    source.gain = gain;
+    _sources.append(source);
+    
+    glm::vec3 directionalGain = source.direction * gain;
+    for (int i = 0; i < NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL; i++) {
+        float sample = samples[i];
+        _w[i] += sample * gain;
+        _x[i] += sample * directionalGain.x;
+        _y[i] += sample * directionalGain.y;
+        _z[i] += sample * directionalGain.z;
+    }
+    return _sources.size() - 1;
+}
+
+void AmbisonicBed::decode(const glm::quat& orientation, float* stereoSamples) const {
+    glm::vec3 directionalGain = rightAxisForOrientation(orientation) * DECODE_DIRECTIVITY;
+    const float OMNI_GAIN = 1.0f - DECODE_DIRECTIVITY;
+    
+    for (int i = 0; i < NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL; i++) {
+        float omni = _w[i] * OMNI_GAIN;
+        float rightward = _x[i] * directionalGain.x + _y[i] * directionalGain.y + _z[i] * directionalGain.z;
+        stereoSamples[i * 2] = omni - rightward;
+        stereoSamples[i * 2 + 1] = omni + rightward;
+    }
+}
+
+void AmbisonicBed::subtractSource(int index, const glm::quat& orientation, float* stereoSamples) const {
+    const Source& source = _sources.at(index);
+    
+    // what the decode turns this one source into for each ear
+    float rightward = glm::dot(rightAxisForOrientation(orientation), source.direction) * DECODE_DIRECTIVITY;
+    float leftGain = source.gain * (1.0f - DECODE_DIRECTIVITY - rightward);
+    float rightGain = source.gain * (1.0f - DECODE_DIRECTIVITY + rightward);
+    
+    for (int i = 0; i < NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL; i++) {
+        stereoSamples[i * 2] -= source.samples[i] * leftGain;
+        stereoSamples[i * 2 + 1] -= source.samples[i] * rightGain;
+    }
+}
@@ -0,0 +1,65 @@
+//
+//  AmbisonicBed.h
+//  assignment-client/src/audio
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  First order ambisonic bed shared by the mixes of a group of listeners.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AmbisonicBed_h
+#define hifi_AmbisonicBed_h
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <QtCore/QVector>
+
+#include <AudioRingBuffer.h>
+
+/// A frame of first order B-format (W, X, Y, Z in world axes) that sources are encoded into once, as heard from the
+/// center of the bed, and that each listener decodes for their own orientation. Decoding costs the same however many
+/// sources went in, and a source that is too close to a listener for the bed to place it well can be taken back out of
+/// that listener's decode and mixed directly instead.
+class AmbisonicBed {
+public:
+    AmbisonicBed();
+    
+    /// Empties the bed and moves it to the given center.
+    void reset(const glm::vec3& center);
+    
+    const glm::vec3& getCenter() const { return _center; }
+    int getNumSources() const { return _sources.size(); }
+    
+    /// Encodes a frame of mono samples arriving from the given position (relative to the center) with the given gain.
+    /// \return the index of the source, for subtractSource
+    int addSource(const int16_t* samples, const glm::vec3& relativePosition, float gain);
+    
+    /// Decodes the bed to a frame of interleaved stereo for a listener with the given orientation, overwriting
+    /// stereoSamples.
+    void decode(const glm::quat& orientation, float* stereoSamples) const;
+    
+    /// Takes the source with the given index back out of a frame decoded for the given orientation.
+    void subtractSource(int index, const glm::quat& orientation, float* stereoSamples) const;
+    
+private:
+    class Source {
+    public:
+        const int16_t* samples;
+        glm::vec3 direction;
+        float gain;
+    };
+    
+    glm::vec3 _center;
+    QVector<Source> _sources;
+    
+    float _w[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+    float _x[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+    float _y[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+    float _z[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+};
+
+#endif // hifi_AmbisonicBed_h
@@ -10,6 +10,7 @@
 //
 
 #include <mmintrin.h>
+#include <algorithm>
 #include <errno.h>
 #include <fcntl.h>
 #include <fstream>
@@ -34,6 +35,7 @@
 
 #include <QtCore/QCoreApplication>
 #include <QtCore/QJsonObject>
+#include <QtCore/QStringList>
 #include <QtCore/QTimer>
 
 #include <Logging.h>
@@ -51,14 +53,29 @@
 
 #include "AudioMixer.h"
 
-const short JITTER_BUFFER_MSECS = 12;
-const short JITTER_BUFFER_SAMPLES = JITTER_BUFFER_MSECS * (SAMPLE_RATE / 1000.0);
-
 const float LOUDNESS_TO_DISTANCE_RATIO = 0.00001f;
 
+// a bed places a source from its center, so a listener away from the center hears the source from the wrong direction -
+// by at most the error budget when the source is at least 1 / sin(budget) times further from the listener than the
+// listener is from the center, and anything closer is mixed directly
+const float DEFAULT_AMBISONIC_ERROR_DEGREES = 15.0f;
+const float AMBISONIC_MIN_NEAR_FIELD_DISTANCE = 2.0f;
+
+const QString SPATIALIZATION_OPTION = "--spatialization";
+const QString AMBISONIC_SPATIALIZATION = "ambisonic";
+const QString AMBISONIC_ERROR_DEGREES_OPTION = "--ambisonic-error-degrees";
+const QString LISTENER_CLUSTER_RADIUS_OPTION = "--listener-cluster-radius";
+const QString CAPTURE_FILE_OPTION = "--capture-file";
+
 const QString AUDIO_MIXER_LOGGING_TARGET_NAME = "audio-mixer";
 
-void attachNewBufferToNode(Node *newNode) {
+/// returns the argument following the given option in an assignment payload, or an empty string if it isn't there
+static QString payloadOptionValue(const QStringList& payloadArguments, const QString& option) {
+    int optionIndex = payloadArguments.indexOf(option);
+    return (optionIndex == -1) ? QString() : payloadArguments.value(optionIndex + 1);
+}
+
+void AudioMixer::attachNewBufferToNode(Node *newNode) {
     if (!newNode->getLinkedData()) {
         newNode->setLinkedData(new AudioMixerClientData());
     }
@@ -69,11 +86,73 @@ AudioMixer::AudioMixer(const QByteArray& packet) :
     _trailingSleepRatio(1.0f),
     _minAudibilityThreshold(LOUDNESS_TO_DISTANCE_RATIO / 2.0f),
     _performanceThrottlingRatio(0.0f),
+    _useAmbisonicBed(false),
+    _listenerClusterRadius(0.0f),
+    _ambisonicNearFieldRatio(1.0f / sinf(glm::radians(DEFAULT_AMBISONIC_ERROR_DEGREES))),
+    _listenerClusters(),
+    _numListenerClusters(0),
+    _listenerClusterIndices(),
     _numStatFrames(0),
     _sumListeners(0),
-    _sumMixes(0)
+    _sumMixes(0),
+    _sumSilentMixes(0),
+    _sumAmbisonicBedSources(0),
+    _sumClusterBedSources(0),
+    _sumListenerClusters(0),
+    _sumMixesSaved(0),
+    _sumMixedAudioBytes(0),
+    _frameUsecs(),
+    _capture(),
+    _captureFilename()
 {
+    QStringList payloadArguments = QString(_payload).split(' ', QString::SkipEmptyParts);
+    _useAmbisonicBed = (payloadOptionValue(payloadArguments, SPATIALIZATION_OPTION) == AMBISONIC_SPATIALIZATION);
+    
+    QString errorDegrees = payloadOptionValue(payloadArguments, AMBISONIC_ERROR_DEGREES_OPTION);
+    if (!errorDegrees.isEmpty()) {
+        _ambisonicNearFieldRatio = 1.0f / sinf(glm::radians(glm::clamp(errorDegrees.toFloat(), 1.0f, 90.0f)));
+    }
+    
+    // clustering listeners only makes sense with a bed for each cluster to share
+    _listenerClusterRadius = payloadOptionValue(payloadArguments, LISTENER_CLUSTER_RADIUS_OPTION).toFloat();
+    if (_listenerClusterRadius > 0.0f) {
+        _useAmbisonicBed = true;
+    }
+    
+    if (_useAmbisonicBed) {
+        qDebug() << "Spatializing distant sources through shared ambisonic beds, cluster radius" << _listenerClusterRadius
+            << "near field ratio" << _ambisonicNearFieldRatio;
+    }
     
+    _captureFilename = payloadOptionValue(payloadArguments, CAPTURE_FILE_OPTION);
+}
+
+/// returns the attenuation for a source heard from the given position relative to it, from how far off the direction
+/// it's facing that position is
+static float offAxisCoefficient(PositionalAudioRingBuffer* source, const glm::vec3& relativePosition) {
+    // calculate the angle delivery for off-axis attenuation
+    glm::vec3 rotatedListenerPosition = glm::inverse(source->getOrientation()) * relativePosition;
+
+    float angleOfDelivery = glm::angle(glm::vec3(0.0f, 0.0f, -1.0f),
+                                       glm::normalize(rotatedListenerPosition));
+
+    const float MAX_OFF_AXIS_ATTENUATION = 0.2f;
+    const float OFF_AXIS_ATTENUATION_FORMULA_STEP = (1 - MAX_OFF_AXIS_ATTENUATION) / 2.0f;
+
+    return MAX_OFF_AXIS_ATTENUATION + (OFF_AXIS_ATTENUATION_FORMULA_STEP * (angleOfDelivery / PI_OVER_TWO));
+}
+
+/// returns the attenuation for a source at the given squared distance
+static float distanceCoefficient(float distanceSquareToSource) {
+    const float DISTANCE_SCALE = 2.5f;
+    const float GEOMETRIC_AMPLITUDE_SCALAR = 0.3f;
+    const float DISTANCE_LOG_BASE = 2.5f;
+    const float DISTANCE_SCALE_LOG = logf(DISTANCE_SCALE) / logf(DISTANCE_LOG_BASE);
+
+    // calculate the distance coefficient using the distance to this node
+    float coefficient = powf(GEOMETRIC_AMPLITUDE_SCALAR,
+                             DISTANCE_SCALE_LOG + (0.5f * logf(distanceSquareToSource) / logf(DISTANCE_LOG_BASE)) - 1);
+    return std::min(1.0f, coefficient);
 }
 
 void AudioMixer::addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuffer* bufferToAdd,
@@ -124,37 +203,14 @@ void AudioMixer::addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuf
                 distanceSquareToSource -= (radius * radius);
 
             } else {
-                // calculate the angle delivery for off-axis attenuation
-                glm::vec3 rotatedListenerPosition = glm::inverse(bufferToAdd->getOrientation()) * relativePosition;
-
-                float angleOfDelivery = glm::angle(glm::vec3(0.0f, 0.0f, -1.0f),
-                                                   glm::normalize(rotatedListenerPosition));
-
-                const float MAX_OFF_AXIS_ATTENUATION = 0.2f;
-                const float OFF_AXIS_ATTENUATION_FORMULA_STEP = (1 - MAX_OFF_AXIS_ATTENUATION) / 2.0f;
-
-                float offAxisCoefficient = MAX_OFF_AXIS_ATTENUATION +
-                    (OFF_AXIS_ATTENUATION_FORMULA_STEP * (angleOfDelivery / PI_OVER_TWO));
-
                 // multiply the current attenuation coefficient by the calculated off axis coefficient
-                attenuationCoefficient *= offAxisCoefficient;
+                attenuationCoefficient *= offAxisCoefficient(bufferToAdd, relativePosition);
             }
 
             glm::vec3 rotatedSourcePosition = inverseOrientation * relativePosition;
 
-            const float DISTANCE_SCALE = 2.5f;
-            const float GEOMETRIC_AMPLITUDE_SCALAR = 0.3f;
-            const float DISTANCE_LOG_BASE = 2.5f;
-            const float DISTANCE_SCALE_LOG = logf(DISTANCE_SCALE) / logf(DISTANCE_LOG_BASE);
-
-            // calculate the distance coefficient using the distance to this node
-            float distanceCoefficient = powf(GEOMETRIC_AMPLITUDE_SCALAR,
-                                             DISTANCE_SCALE_LOG +
-                                             (0.5f * logf(distanceSquareToSource) / logf(DISTANCE_LOG_BASE)) - 1);
-            distanceCoefficient = std::min(1.0f, distanceCoefficient);
-
             // multiply the current attenuation coefficient by the distance coefficient
-            attenuationCoefficient *= distanceCoefficient;
+            attenuationCoefficient *= distanceCoefficient(distanceSquareToSource);
 
             // project the rotated source position vector onto the XZ plane
             rotatedSourcePosition.y = 0.0f;
@@ -231,7 +287,8 @@ void AudioMixer::addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuf
         float attenuationAndWeakChannelRatio = attenuationCoefficient * weakChannelAmplitudeRatio;
         const int16_t* delayNextOutputStart = nextOutputStart - numSamplesDelay;
         if (delayNextOutputStart < bufferStart) {
-            delayNextOutputStart = bufferStart + ringBufferSampleCapacity - numSamplesDelay;
+            // the ring is lock-free, so reading on from the end runs into its mirrored start instead of wrapping
+            delayNextOutputStart += ringBufferSampleCapacity;
         }
         
         int i = 0;
@@ -305,11 +362,15 @@ void AudioMixer::addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuf
     }
 }
 
-void AudioMixer::prepareMixForListeningNode(Node* node) {
+bool AudioMixer::prepareMixForListeningNode(Node* node) {
     AvatarAudioRingBuffer* nodeRingBuffer = ((AudioMixerClientData*) node->getLinkedData())->getAvatarAudioRingBuffer();
+    int sumMixesBefore = _sumMixes;
 
     // zero out the client mix for this node
     memset(_clientSamples, 0, NETWORK_BUFFER_LENGTH_BYTES_STEREO);
+    
+    bool hasBedSources = _useAmbisonicBed && _listenerClusterIndices.contains(nodeRingBuffer)
+        && decodeAmbisonicBedForListeningNode(node);
 
     // loop through all other nodes that have sufficient audio to mix
     foreach (const SharedNodePointer& otherNode, NodeList::getInstance()->getNodeHash()) {
@@ -324,12 +385,164 @@ void AudioMixer::prepareMixForListeningNode(Node* node) {
                 if ((*otherNode != *node
                      || otherNodeBuffer->shouldLoopbackForNode())
                     && otherNodeBuffer->willBeAddedToMix()
-                    && otherNodeBuffer->getNextOutputTrailingLoudness() > 0) {
+                    && otherNodeBuffer->getNextOutputTrailingLoudness() > 0
+                    && !isHeardFromAmbisonicBed(otherNodeBuffer, nodeRingBuffer, *otherNode == *node)) {
                     addBufferToMixForListeningNodeWithBuffer(otherNodeBuffer, nodeRingBuffer);
                 }
             }
         }
     }
+    
+    return _sumMixes != sumMixesBefore || hasBedSources;
+}
+
+void AudioMixer::prepareListenerClusters() {
+    NodeList* nodeList = NodeList::getInstance();
+    
+    // greedily put each listener in the first cluster started close enough to it, or start a new one
+    _numListenerClusters = 0;
+    _listenerClusterIndices.clear();
+    foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+        if (node->getType() != NodeType::Agent || !node->getActiveSocket() || !node->getLinkedData()
+            || !((AudioMixerClientData*) node->getLinkedData())->getAvatarAudioRingBuffer()) {
+            continue;
+        }
+        AvatarAudioRingBuffer* listeningNodeBuffer = ((AudioMixerClientData*) node->getLinkedData())->getAvatarAudioRingBuffer();
+        const glm::vec3& position = listeningNodeBuffer->getPosition();
+        
+        int clusterIndex = 0;
+        while (clusterIndex < _numListenerClusters && _listenerClusterRadius > 0.0f
+               && glm::distance(position, _listenerClusters.at(clusterIndex).seedPosition) > _listenerClusterRadius) {
+            clusterIndex++;
+        }
+        if (clusterIndex == _numListenerClusters) {
+            if (_numListenerClusters == _listenerClusters.size()) {
+                _listenerClusters.append(ListenerCluster());
+            }
+            ListenerCluster& cluster = _listenerClusters[_numListenerClusters++];
+            cluster.seedPosition = position;
+            cluster.sumOfPositions = glm::vec3();
+            cluster.numListeners = 0;
+        }
+        ListenerCluster& cluster = _listenerClusters[clusterIndex];
+        cluster.sumOfPositions += position;
+        cluster.numListeners++;
+        _listenerClusterIndices.insert(listeningNodeBuffer, clusterIndex);
+    }
+    
+    // center each bed on its listeners, so that it places sources well for as many of them as possible
+    for (int i = 0; i < _numListenerClusters; i++) {
+        ListenerCluster& cluster = _listenerClusters[i];
+        cluster.bed.reset(cluster.sumOfPositions / (float) cluster.numListeners);
+        cluster.sourceIndices.clear();
+    }
+    
+    foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+        if (!node->getLinkedData()) {
+            continue;
+        }
+        AudioMixerClientData* nodeData = (AudioMixerClientData*) node->getLinkedData();
+        for (unsigned int i = 0; i < nodeData->getRingBuffers().size(); i++) {
+            PositionalAudioRingBuffer* buffer = nodeData->getRingBuffers()[i];
+            if (!buffer->willBeAddedToMix() || buffer->getNextOutputTrailingLoudness() == 0) {
+                continue;
+            }
+            float sourceAttenuationCoefficient = 1.0f;
+            if (buffer->getType() == PositionalAudioRingBuffer::Injector) {
+                InjectedAudioRingBuffer* injectedBuffer = (InjectedAudioRingBuffer*) buffer;
+                if (injectedBuffer->getRadius() > 0.0f) {
+                    // spherical sources sound the same from anywhere inside them, which a bed can't express
+                    continue;
+                }
+                sourceAttenuationCoefficient = injectedBuffer->getAttenuationRatio();
+            }
+            
+            bool isInBed = false;
+            for (int j = 0; j < _numListenerClusters; j++) {
+                ListenerCluster& cluster = _listenerClusters[j];
+                glm::vec3 relativePosition = buffer->getPosition() - cluster.bed.getCenter();
+                float distanceSquareToSource = glm::max(glm::dot(relativePosition, relativePosition), EPSILON * EPSILON);
+                
+                if (buffer->getNextOutputTrailingLoudness() / sqrtf(distanceSquareToSource) <= _minAudibilityThreshold) {
+                    // same performance cut as the direct mix, judged from the center
+                    continue;
+                }
+                float attenuationCoefficient = sourceAttenuationCoefficient * offAxisCoefficient(buffer, relativePosition)
+                    * distanceCoefficient(distanceSquareToSource);
+                
+                cluster.sourceIndices.insert(buffer, cluster.bed.addSource(buffer->getNextOutput(), relativePosition,
+                                                                           attenuationCoefficient));
+                ++_sumClusterBedSources;
+                isInBed = true;
+            }
+            if (isInBed) {
+                ++_sumAmbisonicBedSources;
+            }
+        }
+    }
+    _sumListenerClusters += _numListenerClusters;
+}
+
+bool AudioMixer::decodeAmbisonicBedForListeningNode(Node* node) {
+    AudioMixerClientData* nodeData = (AudioMixerClientData*) node->getLinkedData();
+    AvatarAudioRingBuffer* nodeRingBuffer = nodeData->getAvatarAudioRingBuffer();
+    const ListenerCluster& cluster = _listenerClusters.at(_listenerClusterIndices.value(nodeRingBuffer));
+    const glm::quat& orientation = nodeRingBuffer->getOrientation();
+    
+    cluster.bed.decode(orientation, _decodedBedSamples);
+    
+    // take back out what this listener shouldn't hear through the bed
+    int numSourcesHeard = cluster.bed.getNumSources();
+    const std::vector<PositionalAudioRingBuffer*> ownBuffers = nodeData->getRingBuffers();
+    for (QHash<PositionalAudioRingBuffer*, int>::const_iterator it = cluster.sourceIndices.constBegin();
+            it != cluster.sourceIndices.constEnd(); it++) {
+        bool isOwnSource = std::find(ownBuffers.begin(), ownBuffers.end(), it.key()) != ownBuffers.end();
+        
+        if (!isHeardFromAmbisonicBed(it.key(), nodeRingBuffer, isOwnSource)) {
+            cluster.bed.subtractSource(it.value(), orientation, _decodedBedSamples);
+            numSourcesHeard--;
+        }
+    }
+    
+    for (int i = 0; i < NETWORK_BUFFER_LENGTH_SAMPLES_STEREO; i++) {
+        _clientSamples[i] = glm::clamp((int) glm::round(_decodedBedSamples[i]), MIN_SAMPLE_VALUE, MAX_SAMPLE_VALUE);
+    }
+    
+    // each source heard through the bed is one this listener didn't have to mix on its own
+    _sumMixesSaved += numSourcesHeard;
+    return numSourcesHeard > 0;
+}
+
+bool AudioMixer::isHeardFromAmbisonicBed(PositionalAudioRingBuffer* source, AvatarAudioRingBuffer* listeningNodeBuffer,
+                                         bool isOwnSource) const {
+    if (!_useAmbisonicBed || (isOwnSource && !source->shouldLoopbackForNode())
+            || !_listenerClusterIndices.contains(listeningNodeBuffer)) {
+        return false;
+    }
+    const ListenerCluster& cluster = _listenerClusters.at(_listenerClusterIndices.value(listeningNodeBuffer));
+    if (!cluster.sourceIndices.contains(source)) {
+        return false;
+    }
+    float nearFieldDistance = glm::max(AMBISONIC_MIN_NEAR_FIELD_DISTANCE, _ambisonicNearFieldRatio
+        * glm::distance(listeningNodeBuffer->getPosition(), cluster.bed.getCenter()));
+    
+    return glm::distance(source->getPosition(), listeningNodeBuffer->getPosition()) >= nearFieldDistance;
+}
+
+// mixes whose peak stays below this (about -66 dBFS) are sent as silent frames and replaced by comfort noise
+const int NEAR_SILENT_MIX_PEAK = 16;
+
+bool AudioMixer::isClientMixNearSilent(int16_t& comfortNoiseLevel) const {
+    int sumOfMagnitudes = 0;
+    for (int i = 0; i < NETWORK_BUFFER_LENGTH_SAMPLES_STEREO; i++) {
+        int magnitude = abs(_clientSamples[i]);
+        if (magnitude > NEAR_SILENT_MIX_PEAK) {
+            return false;
+        }
+        sumOfMagnitudes += magnitude;
+    }
+    comfortNoiseLevel = sumOfMagnitudes / NETWORK_BUFFER_LENGTH_SAMPLES_STEREO;
+    return true;
 }
 
 
@@ -340,29 +553,38 @@ void AudioMixer::readPendingDatagrams() {
     
     while (readAvailableDatagram(receivedPacket, senderSockAddr)) {
         if (nodeList->packetVersionAndHashMatch(receivedPacket)) {
-            // pull any new audio data from nodes off of the network stack
-            PacketType mixerPacketType = packetTypeForPacket(receivedPacket);
-            if (mixerPacketType == PacketTypeMicrophoneAudioNoEcho
-                || mixerPacketType == PacketTypeMicrophoneAudioWithEcho
-                || mixerPacketType == PacketTypeInjectAudio
-                || mixerPacketType == PacketTypeSilentAudioFrame) {
-                
-                nodeList->findNodeAndUpdateWithDataFromPacket(receivedPacket);
-            } else if (mixerPacketType == PacketTypeMuteEnvironment) {
-                QByteArray packet = receivedPacket;
-                populatePacketHeader(packet, PacketTypeMuteEnvironment);
-                
-                foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
-                    if (node->getType() == NodeType::Agent && node->getActiveSocket() && node->getLinkedData() && node != nodeList->sendingNodeForPacket(receivedPacket)) {
-                        nodeList->writeDatagram(packet, packet.size(), node);
-                    }
-                }
+            processDatagram(receivedPacket, senderSockAddr);
+        }
+    }
+}
 
-            } else {
-                // let processNodeData handle it.
-                nodeList->processNodeData(senderSockAddr, receivedPacket);
+void AudioMixer::processDatagram(const QByteArray& receivedPacket, const HifiSockAddr& senderSockAddr) {
+    NodeList* nodeList = NodeList::getInstance();
+    
+    // pull any new audio data from nodes off of the network stack
+    PacketType mixerPacketType = packetTypeForPacket(receivedPacket);
+    if (mixerPacketType == PacketTypeMicrophoneAudioNoEcho
+        || mixerPacketType == PacketTypeMicrophoneAudioWithEcho
+        || mixerPacketType == PacketTypeInjectAudio
+        || mixerPacketType == PacketTypeSilentAudioFrame) {
+        
+        if (_capture.isOpen()) {
+            _capture.writePacket(receivedPacket);
+        }
+        nodeList->findNodeAndUpdateWithDataFromPacket(receivedPacket);
+    } else if (mixerPacketType == PacketTypeMuteEnvironment) {
+        QByteArray packet = receivedPacket;
+        populatePacketHeader(packet, PacketTypeMuteEnvironment);
+        
+        foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+            if (node->getType() == NodeType::Agent && node->getActiveSocket() && node->getLinkedData() && node != nodeList->sendingNodeForPacket(receivedPacket)) {
+                nodeList->writeDatagram(packet, packet.size(), node);
             }
         }
+
+    } else {
+        // let processNodeData handle it.
+        nodeList->processNodeData(senderSockAddr, receivedPacket);
     }
 }
 
@@ -379,13 +601,156 @@ void AudioMixer::sendStatsPacket() {
         statsObject["average_mixes_per_listener"] = 0.0;
     }
     
+    if (_sumListeners > 0) {
+        statsObject["average_mixed_audio_bytes_per_listener"] = (float) _sumMixedAudioBytes / (float) _sumListeners;
+    } else {
+        statsObject["average_mixed_audio_bytes_per_listener"] = 0.0;
+    }
+    
+    if (_useAmbisonicBed) {
+        statsObject["average_listener_clusters_per_frame"] = (float) _sumListenerClusters / (float) _numStatFrames;
+        statsObject["average_ambisonic_bed_sources_per_frame"] = (float) _sumAmbisonicBedSources / (float) _numStatFrames;
+        if (_sumListenerClusters > 0) {
+            statsObject["average_ambisonic_bed_sources_per_cluster"] =
+                (float) _sumClusterBedSources / (float) _sumListenerClusters;
+        } else {
+            statsObject["average_ambisonic_bed_sources_per_cluster"] = 0.0;
+        }
+        if (_sumListeners > 0) {
+            statsObject["average_mixes_saved_per_listener"] = (float) _sumMixesSaved / (float) _sumListeners;
+        } else {
+            statsObject["average_mixes_saved_per_listener"] = 0.0;
+        }
+    }
+    
+    if (_sumListeners > 0) {
+        statsObject["silent_mix_percentage"] = (float) _sumSilentMixes / (float) _sumListeners * 100.0f;
+    } else {
+        statsObject["silent_mix_percentage"] = 0.0;
+    }
+    
+    // each stream's jitter buffer, keyed by the node it comes from - clear out the streams from last time first since
+    // the stats object sticks around
+    const QString JITTER_BUFFER_STATS_PREFIX = "jitter_buffers.";
+    foreach (const QString& key, statsObject.keys()) {
+        if (key.startsWith(JITTER_BUFFER_STATS_PREFIX)) {
+            statsObject.remove(key);
+        }
+    }
+    foreach (const SharedNodePointer& node, NodeList::getInstance()->getNodeHash()) {
+        if (node->getLinkedData()) {
+            ((AudioMixerClientData*) node->getLinkedData())->addJitterBufferStats(statsObject,
+                JITTER_BUFFER_STATS_PREFIX + uuidStringWithoutCurlyBraces(node->getUUID()));
+        }
+    }
+    
+    _frameUsecs.addToJSONObject(statsObject, "frame_usecs");
+    for (int i = 0; i < NUM_FRAME_STAGES; i++) {
+        _frameStageUsecs[i].addToJSONObject(statsObject, QString("frame_stage_usecs.") + FRAME_STAGE_NAMES[i]);
+    }
+    resetFrameTimings();
+    
     ThreadedAssignment::addPacketStatsAndSendStatsPacket(statsObject);
     
+    _sumMixedAudioBytes = 0;
     _sumListeners = 0;
     _sumMixes = 0;
+    _sumSilentMixes = 0;
+    _sumAmbisonicBedSources = 0;
+    _sumClusterBedSources = 0;
+    _sumListenerClusters = 0;
+    _sumMixesSaved = 0;
     _numStatFrames = 0;
 }
 
+const char* AudioMixer::FRAME_STAGE_NAMES[NUM_FRAME_STAGES] = { "check_buffers", "mix", "send", "push" };
+
+void AudioMixer::processFrame() {
+    NodeList* nodeList = NodeList::getInstance();
+    
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+    
+    foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+        if (node->getLinkedData()) {
+            ((AudioMixerClientData*) node->getLinkedData())->checkBuffersBeforeFrameSend();
+        }
+    }
+    qint64 stageStartNsecs = frameTimer.nsecsElapsed();
+    _frameStageUsecs[CheckBuffersStage].record(stageStartNsecs / 1000);
+    
+    // mixing and sending alternate for each listener, so add up the time spent on each
+    qint64 mixNsecs = 0;
+    qint64 sendNsecs = 0;
+    
+    if (_useAmbisonicBed) {
+        prepareListenerClusters();
+    }
+    
+    foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+        if (node->getType() == NodeType::Agent && node->getActiveSocket() && node->getLinkedData()
+            && ((AudioMixerClientData*) node->getLinkedData())->getAvatarAudioRingBuffer()) {
+            bool hasSources = prepareMixForListeningNode(node.data());
+            int16_t comfortNoiseLevel = 0;
+            bool isSilent = !hasSources || isClientMixNearSilent(comfortNoiseLevel);
+            
+            qint64 mixedNsecs = frameTimer.nsecsElapsed();
+            mixNsecs += mixedNsecs - stageStartNsecs;
+            
+            AudioMixerClientData* nodeData = (AudioMixerClientData*) node->getLinkedData();
+            AudioCodecID_t codecID = nodeData->getAvatarAudioRingBuffer()->getCodecID();
+            
+            QByteArray mixPacket;
+            if (isSilent) {
+                // nothing worth hearing, just tell the listener how many samples to fill in
+                mixPacket = byteArrayWithPopulatedHeader(PacketTypeSilentAudioFrame);
+                nodeData->getMixedAudioEncoder().writeSilentFrameHeader(codecID, mixPacket);
+                
+                int16_t numSilentSamples = NETWORK_BUFFER_LENGTH_SAMPLES_STEREO;
+                mixPacket.append(reinterpret_cast<const char*>(&numSilentSamples), sizeof(int16_t));
+                mixPacket.append(reinterpret_cast<const char*>(&comfortNoiseLevel), sizeof(int16_t));
+                
+                ++_sumSilentMixes;
+            } else {
+                // encode the mix with the same codec the listener uses for its own stream
+                mixPacket = byteArrayWithPopulatedHeader(PacketTypeMixedAudio);
+                nodeData->getMixedAudioEncoder().encodeFrame(codecID, _clientSamples,
+                                                             NETWORK_BUFFER_LENGTH_SAMPLES_STEREO, 2, mixPacket);
+            }
+            nodeList->writeDatagram(mixPacket, node);
+            
+            _sumMixedAudioBytes += mixPacket.size();
+            ++_sumListeners;
+            
+            stageStartNsecs = frameTimer.nsecsElapsed();
+            sendNsecs += stageStartNsecs - mixedNsecs;
+        }
+    }
+    mixNsecs += frameTimer.nsecsElapsed() - stageStartNsecs;
+    _frameStageUsecs[MixStage].record(mixNsecs / 1000);
+    _frameStageUsecs[SendStage].record(sendNsecs / 1000);
+    stageStartNsecs = frameTimer.nsecsElapsed();
+
+    // push forward the next output pointers for any audio buffers we used
+    foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+        if (node->getLinkedData()) {
+            ((AudioMixerClientData*) node->getLinkedData())->pushBuffersAfterFrameSend();
+        }
+    }
+    qint64 frameNsecs = frameTimer.nsecsElapsed();
+    _frameStageUsecs[PushStage].record((frameNsecs - stageStartNsecs) / 1000);
+    _frameUsecs.record(frameNsecs / 1000);
+    
+    ++_numStatFrames;
+}
+
+void AudioMixer::resetFrameTimings() {
+    _frameUsecs.reset();
+    for (int i = 0; i < NUM_FRAME_STAGES; i++) {
+        _frameStageUsecs[i].reset();
+    }
+}
+
 void AudioMixer::run() {
 
     ThreadedAssignment::commonInit(AUDIO_MIXER_LOGGING_TARGET_NAME, NodeType::AudioMixer);
@@ -395,14 +760,15 @@ void AudioMixer::run() {
     nodeList->addNodeTypeToInterestSet(NodeType::Agent);
 
     nodeList->linkedDataCreateCallback = attachNewBufferToNode;
+    
+    if (!_captureFilename.isEmpty() && _capture.openForWriting(_captureFilename)) {
+        qDebug() << "Capturing inbound audio to" << _captureFilename;
+    }
 
     int nextFrame = 0;
     QElapsedTimer timer;
     timer.start();
     
-    char* clientMixBuffer = new char[NETWORK_BUFFER_LENGTH_BYTES_STEREO
-                                     + numBytesForPacketHeaderGivenPacketType(PacketTypeMixedAudio)];
-    
     int usecToSleep = BUFFER_SEND_INTERVAL_USECS;
     
     const int TRAILING_AVERAGE_FRAMES = 100;
@@ -410,12 +776,6 @@ void AudioMixer::run() {
 
     while (!_isFinished) {
         
-        foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
-            if (node->getLinkedData()) {
-                ((AudioMixerClientData*) node->getLinkedData())->checkBuffersBeforeFrameSend(JITTER_BUFFER_SAMPLES);
-            }
-        }
-        
         const float STRUGGLE_TRIGGER_SLEEP_PERCENTAGE_THRESHOLD = 0.10f;
         const float BACK_OFF_TRIGGER_SLEEP_PERCENTAGE_THRESHOLD = 0.20f;
         
@@ -468,28 +828,7 @@ void AudioMixer::run() {
             ++framesSinceCutoffEvent;
         }
         
-        foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
-            if (node->getType() == NodeType::Agent && node->getActiveSocket() && node->getLinkedData()
-                && ((AudioMixerClientData*) node->getLinkedData())->getAvatarAudioRingBuffer()) {
-                prepareMixForListeningNode(node.data());
-                
-                int numBytesPacketHeader = populatePacketHeader(clientMixBuffer, PacketTypeMixedAudio);
-
-                memcpy(clientMixBuffer + numBytesPacketHeader, _clientSamples, NETWORK_BUFFER_LENGTH_BYTES_STEREO);
-                nodeList->writeDatagram(clientMixBuffer, NETWORK_BUFFER_LENGTH_BYTES_STEREO + numBytesPacketHeader, node);
-                
-                ++_sumListeners;
-            }
-        }
-
-        // push forward the next output pointers for any audio buffers we used
-        foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
-            if (node->getLinkedData()) {
-                ((AudioMixerClientData*) node->getLinkedData())->pushBuffersAfterFrameSend();
-            }
-        }
-        
-        ++_numStatFrames;
+        processFrame();
         
         QCoreApplication::processEvents();
         
@@ -503,6 +842,4 @@ void AudioMixer::run() {
             usleep(usecToSleep);
         }
     }
-    
-    delete[] clientMixBuffer;
 }
@@ -12,10 +12,17 @@
 #ifndef hifi_AudioMixer_h
 #define hifi_AudioMixer_h
 
+#include <QtCore/QHash>
+#include <QtCore/QList>
+
 #include <AudioRingBuffer.h>
+#include <Histogram.h>
 
 #include <ThreadedAssignment.h>
 
+#include "AmbisonicBed.h"
+#include "AudioPacketCapture.h"
+
 class PositionalAudioRingBuffer;
 class AvatarAudioRingBuffer;
 
@@ -26,6 +33,30 @@ class AudioMixer : public ThreadedAssignment {
     Q_OBJECT
 public:
     AudioMixer(const QByteArray& packet);
+    
+    /// the parts of a frame whose time is reported in the stats
+    enum FrameStage {
+        CheckBuffersStage,
+        MixStage,
+        SendStage,
+        PushStage,
+        NUM_FRAME_STAGES
+    };
+    
+    /// gives a newly added node the linked data the mixer keeps for it
+    static void attachNewBufferToNode(Node* newNode);
+    
+    /// mixes and sends one frame to every listener from what's in the ring buffers
+    void processFrame();
+    
+    /// handles one packet that has already passed the version and hash check
+    void processDatagram(const QByteArray& receivedPacket, const HifiSockAddr& senderSockAddr);
+    
+    const Histogram& getFrameUsecs() const { return _frameUsecs; }
+    const Histogram& getFrameStageUsecs(FrameStage stage) const { return _frameStageUsecs[stage]; }
+    
+    static const char* FRAME_STAGE_NAMES[NUM_FRAME_STAGES];
+    
 public slots:
     /// threaded run of assignment
     void run();
@@ -39,7 +70,26 @@ private:
                                                   AvatarAudioRingBuffer* listeningNodeBuffer);
     
     /// prepares and sends a mix to one Node
-    void prepareMixForListeningNode(Node* node);
+    /// \return whether any source was added to the mix
+    bool prepareMixForListeningNode(Node* node);
+    
+    /// groups the listeners by position and encodes this frame of every audible source that can be shared into each
+    /// group's ambisonic bed
+    void prepareListenerClusters();
+    
+    /// decodes the ambisonic bed of a Node's cluster into _clientSamples, less the sources it should hear directly instead
+    /// \return whether any source was left in the decode
+    bool decodeAmbisonicBedForListeningNode(Node* node);
+    
+    /// checks whether the listener hears this source through the ambisonic bed rather than mixed directly
+    bool isHeardFromAmbisonicBed(PositionalAudioRingBuffer* source, AvatarAudioRingBuffer* listeningNodeBuffer,
+                                 bool isOwnSource) const;
+    
+    /// checks whether the mix in _clientSamples is quiet enough to be sent as a silent frame
+    /// \param comfortNoiseLevel filled with the mean absolute sample value the listener should fill the frame with
+    bool isClientMixNearSilent(int16_t& comfortNoiseLevel) const;
+    
+    void resetFrameTimings();
     
     // client samples capacity is larger than what will be sent to optimize mixing
     // we are MMX adding 4 samples at a time so we need client samples to have an extra 4
@@ -48,9 +98,40 @@ private:
     float _trailingSleepRatio;
     float _minAudibilityThreshold;
     float _performanceThrottlingRatio;
+    
+    /// listeners close enough together to share a far-field mix, in the form of an ambisonic bed centered on them
+    class ListenerCluster {
+    public:
+        glm::vec3 seedPosition;
+        glm::vec3 sumOfPositions;
+        int numListeners;
+        AmbisonicBed bed;
+        QHash<PositionalAudioRingBuffer*, int> sourceIndices;
+    };
+    
+    bool _useAmbisonicBed;
+    float _listenerClusterRadius; /// zero puts every listener in the one cluster
+    float _ambisonicNearFieldRatio;
+    QList<ListenerCluster> _listenerClusters; /// kept between frames for reuse, only the first few are in use
+    int _numListenerClusters;
+    QHash<AvatarAudioRingBuffer*, int> _listenerClusterIndices;
+    float _decodedBedSamples[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+    
     int _numStatFrames;
     int _sumListeners;
     int _sumMixes;
+    int _sumSilentMixes;
+    int _sumAmbisonicBedSources; /// each source counted once per frame, however many beds it went into
+    int _sumClusterBedSources; /// each source counted once for every bed it went into
+    int _sumListenerClusters;
+    int _sumMixesSaved;
+    qint64 _sumMixedAudioBytes;
+    
+    Histogram _frameUsecs;
+    Histogram _frameStageUsecs[NUM_FRAME_STAGES];
+    
+    AudioPacketCapture _capture; /// records inbound audio for offline replay, when given a capture file
+    QString _captureFilename;
 };
 
 #endif // hifi_AudioMixer_h
@@ -12,6 +12,7 @@
 #include <QDebug>
 
 #include <PacketHeaders.h>
+#include <SharedUtil.h>
 #include <UUID.h>
 
 #include "InjectedAudioRingBuffer.h"
@@ -19,7 +20,8 @@
 #include "AudioMixerClientData.h"
 
 AudioMixerClientData::AudioMixerClientData() :
-    _ringBuffers()
+    _ringBuffers(),
+    _mixedAudioEncoder()
 {
     
 }
@@ -86,13 +88,16 @@ int AudioMixerClientData::parseData(const QByteArray& packet) {
     return 0;
 }
 
-void AudioMixerClientData::checkBuffersBeforeFrameSend(int jitterBufferLengthSamples) {
+void AudioMixerClientData::checkBuffersBeforeFrameSend() {
     for (unsigned int i = 0; i < _ringBuffers.size(); i++) {
-        if (_ringBuffers[i]->shouldBeAddedToMix(jitterBufferLengthSamples)) {
+        if (_ringBuffers[i]->shouldBeAddedToMix()) {
             // this is a ring buffer that is ready to go
             // set its flag so we know to push its buffer when all is said and done
             _ringBuffers[i]->setWillBeAddedToMix(true);
             
+            // move the buffered depth towards what this stream's jitter calls for
+            _ringBuffers[i]->convergeOnDesiredJitterBufferSamples();
+            
             // calculate the average loudness for the next NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL
             // that would be mixed in
             _ringBuffers[i]->updateNextOutputTrailingLoudness();
@@ -117,3 +122,23 @@ void AudioMixerClientData::pushBuffersAfterFrameSend() {
         }
     }
 }
+
+void AudioMixerClientData::addJitterBufferStats(QJsonObject& statsObject, const QString& baseName) {
+    for (unsigned int i = 0; i < _ringBuffers.size(); i++) {
+        PositionalAudioRingBuffer* audioBuffer = _ringBuffers[i];
+        QString streamName = baseName + ".";
+        if (audioBuffer->getType() == PositionalAudioRingBuffer::Injector) {
+            streamName += uuidStringWithoutCurlyBraces(((InjectedAudioRingBuffer*) audioBuffer)->getStreamIdentifier());
+        } else {
+            streamName += "microphone";
+        }
+        statsObject[streamName + ".starves"] = audioBuffer->getNumStarves();
+        statsObject[streamName + ".stretches"] = audioBuffer->getNumStretches();
+        statsObject[streamName + ".average_buffered_samples"] = audioBuffer->getAverageBufferedSamples();
+        statsObject[streamName + ".jitter_usecs"] = audioBuffer->getInterArrivalJitterUsecs();
+        statsObject[streamName + ".added_latency_msecs"] =
+            audioBuffer->getDesiredJitterBufferSamples() * (float) MSECS_PER_SECOND / SAMPLE_RATE;
+        
+        audioBuffer->resetJitterBufferStats();
+    }
+}
@@ -14,6 +14,9 @@
 
 #include <vector>
 
+#include <QtCore/QJsonObject>
+
+#include <AudioCodec.h>
 #include <NodeData.h>
 #include <PositionalAudioRingBuffer.h>
 
@@ -28,10 +31,17 @@ public:
     AvatarAudioRingBuffer* getAvatarAudioRingBuffer() const;
     
     int parseData(const QByteArray& packet);
-    void checkBuffersBeforeFrameSend(int jitterBufferLengthSamples);
+    void checkBuffersBeforeFrameSend();
+    
+    /// Adds the jitter buffer stats of each stream to the stats object, under keys starting with the base name, and
+    /// resets them.
+    void addJitterBufferStats(QJsonObject& statsObject, const QString& baseName);
     void pushBuffersAfterFrameSend();
+    
+    AudioStreamEncoder& getMixedAudioEncoder() { return _mixedAudioEncoder; }
 private:
     std::vector<PositionalAudioRingBuffer*> _ringBuffers;
+    AudioStreamEncoder _mixedAudioEncoder;
 };
 
 #endif // hifi_AudioMixerClientData_h
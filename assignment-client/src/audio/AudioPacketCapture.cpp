@@ -0,0 +1,74 @@
+//
+//  AudioPacketCapture.cpp
+//  assignment-client/src/audio
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDebug>
+
+#include "AudioPacketCapture.h"
+
+const quint32 CAPTURE_SIGNATURE = 0x48464143; // "HFAC"
+const quint32 CAPTURE_VERSION = 1;
+
+AudioPacketCapture::AudioPacketCapture() :
+    _file(),
+    _stream(),
+    _timer()
+{
+    
+}
+
+bool AudioPacketCapture::openForWriting(const QString& filename) {
+    close();
+    _file.setFileName(filename);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Couldn't open audio capture file" << filename << "for writing:" << _file.errorString();
+        return false;
+    }
+    _stream.setDevice(&_file);
+    _stream << CAPTURE_SIGNATURE << CAPTURE_VERSION;
+    _timer.start();
+    return true;
+}
+
+bool AudioPacketCapture::openForReading(const QString& filename) {
+    close();
+    _file.setFileName(filename);
+    if (!_file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Couldn't open audio capture file" << filename << "for reading:" << _file.errorString();
+        return false;
+    }
+    _stream.setDevice(&_file);
+    
+    quint32 signature, version;
+    _stream >> signature >> version;
+    if (signature != CAPTURE_SIGNATURE || version != CAPTURE_VERSION) {
+        qDebug() << filename << "isn't an audio capture we can read.";
+        close();
+        return false;
+    }
+    return true;
+}
+
+void AudioPacketCapture::close() {
+    _stream.setDevice(NULL);
+    _stream.resetStatus();
+    _file.close();
+}
+
+void AudioPacketCapture::writePacket(const QByteArray& packet) {
+    _stream << (quint64)(_timer.nsecsElapsed() / 1000) << packet;
+}
+
+bool AudioPacketCapture::readPacket(quint64& usecs, QByteArray& packet) {
+    if (_stream.atEnd()) {
+        return false;
+    }
+    _stream >> usecs >> packet;
+    return _stream.status() == QDataStream::Ok;
+}
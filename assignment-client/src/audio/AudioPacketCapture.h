@@ -0,0 +1,47 @@
+//
+//  AudioPacketCapture.h
+//  assignment-client/src/audio
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Records the audio packets a mixer receives, so that they can be replayed through it offline.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioPacketCapture_h
+#define hifi_AudioPacketCapture_h
+
+#include <QtCore/QDataStream>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+
+/// A file of inbound audio packets, each stamped with the usecs since the capture started. The packets are kept whole,
+/// headers and all, so the node each came from can be read back from its header.
+class AudioPacketCapture {
+public:
+    AudioPacketCapture();
+    
+    /// Starts a new capture, replacing whatever is in the file.
+    bool openForWriting(const QString& filename);
+    
+    /// Opens an existing capture and checks that it is one.
+    bool openForReading(const QString& filename);
+    
+    bool isOpen() const { return _file.isOpen(); }
+    void close();
+    
+    void writePacket(const QByteArray& packet);
+    
+    /// Reads the next packet and the usecs into the capture it arrived at.
+    /// \return false once the capture has run out
+    bool readPacket(quint64& usecs, QByteArray& packet);
+    
+private:
+    QFile _file;
+    QDataStream _stream;
+    QElapsedTimer _timer;
+};
+
+#endif // hifi_AudioPacketCapture_h
@@ -0,0 +1,269 @@
+//
+//  MetavoxelPersister.cpp
+//  assignment-client/src/metavoxels
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QtAlgorithms>
+#include <QtDebug>
+
+#include <MetavoxelMessages.h>
+
+#include "MetavoxelPersister.h"
+
+const quint32 SNAPSHOT_SIGNATURE = 0x4846534E; // "HFSN"
+const quint32 JOURNAL_SIGNATURE = 0x48464A4E; // "HFJN"
+const quint32 PERSIST_FORMAT_VERSION = 1;
+
+const QString JOURNAL_SUFFIX = ".journal";
+
+/// Writes a snapshot on the global thread pool.  Nodes are never modified in place once the server has interned them, so
+/// the writer can read its copy of the data while the server goes on editing its own.
+class SnapshotWriter : public QRunnable {
+public:
+
+    SnapshotWriter(MetavoxelPersister* persister, const MetavoxelData& data, const QString& filename, int generation);
+
+    virtual void run();
+
+private:
+
+    MetavoxelPersister* _persister;
+    const MetavoxelData& _data;
+    QString _filename;
+    int _generation;
+};
+
+SnapshotWriter::SnapshotWriter(MetavoxelPersister* persister, const MetavoxelData& data,
+        const QString& filename, int generation) :
+    _persister(persister),
+    _data(data),
+    _filename(filename),
+    _generation(generation) {
+}
+
+void SnapshotWriter::run() {
+    QElapsedTimer timer;
+    timer.start();
+
+    // the save file only replaces the last snapshot once the new one is completely written
+    QSaveFile file(_filename);
+    bool success = false;
+    if (file.open(QIODevice::WriteOnly)) {
+        QDataStream stream(&file);
+        stream << SNAPSHOT_SIGNATURE << PERSIST_FORMAT_VERSION << (quint32)_generation;
+
+        // write the full metadata, so that the snapshot can still be read if the attribute classes change
+        Bitstream out(stream, Bitstream::FULL_METADATA);
+        out << _data;
+        out.flush();
+        success = (stream.status() == QDataStream::Ok && file.commit());
+    }
+    if (!success) {
+        qWarning() << "Failed to write metavoxel snapshot" << _filename << file.errorString();
+    }
+
+    // the persister releases the data on its own thread, so that any shared objects are deleted there
+    QMetaObject::invokeMethod(_persister, "finishSnapshot", Qt::QueuedConnection, Q_ARG(bool, success),
+        Q_ARG(int, timer.elapsed()));
+}
+
+MetavoxelPersister::MetavoxelPersister(const MetavoxelData& data, const QString& filename, QObject* parent) :
+    QObject(parent),
+    _data(data),
+    _filename(filename),
+    _generation(0),
+    _editsSinceSnapshot(0),
+    _snapshotInProgress(false),
+    _snapshotEdits(0),
+    _loadTime(0),
+    _lastSnapshotTime(-1) {
+
+    connect(&_snapshotTimer, SIGNAL(timeout()), SLOT(takeSnapshot()));
+}
+
+MetavoxelPersister::~MetavoxelPersister() {
+    // the writer refers to our copy of the data, so we can't go before it does
+    if (_snapshotInProgress) {
+        QThreadPool::globalInstance()->waitForDone();
+    }
+}
+
+void MetavoxelPersister::load(MetavoxelData& data) {
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(_filename);
+    if (file.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&file);
+        quint32 signature, version, generation;
+        stream >> signature >> version >> generation;
+        if (signature == SNAPSHOT_SIGNATURE && version == PERSIST_FORMAT_VERSION) {
+            Bitstream in(stream, Bitstream::FULL_METADATA);
+            in >> data;
+            _generation = generation;
+
+        } else {
+            qWarning() << _filename << "isn't a metavoxel snapshot we can read.";
+        }
+    }
+
+    // replay the edits made since the snapshot was taken, oldest first; the older journals are already in the snapshot
+    int edits = 0;
+    foreach (int generation, getJournalGenerations()) {
+        if (generation < _generation) {
+            QFile::remove(getJournalFilename(generation));
+            continue;
+        }
+        edits += replayJournal(generation, data);
+        _generation = generation;
+    }
+    _editsSinceSnapshot = edits;
+    _loadTime = timer.elapsed();
+
+    qDebug() << "Loaded metavoxel snapshot" << _filename << "and" << edits << "journaled edits in" << _loadTime << "ms.";
+
+    openJournal();
+}
+
+void MetavoxelPersister::start(int snapshotInterval) {
+    _snapshotTimer.start(snapshotInterval);
+}
+
+void MetavoxelPersister::journalEdit(const MetavoxelEditMessage& edit) {
+    // object IDs are reassigned when we restart, so removals by ID are journaled as removals of the object itself
+    MetavoxelEditMessage journaledEdit = edit;
+    if (edit.edit.userType() == RemoveSpannerEdit::Type) {
+        RemoveSpannerEdit remove = edit.edit.value<RemoveSpannerEdit>();
+        SharedObjectPointer spanner = SharedObject::getWeakHash().value(remove.id).data();
+        if (!spanner) {
+            return; // nothing to remove, so nothing to journal
+        }
+        journaledEdit.edit = QVariant::fromValue(RemoveEqualSpannerEdit(remove.attribute, spanner));
+    }
+
+    // each edit is written with a stream of its own, so that the journal can be appended to by whoever has it open
+    QByteArray record;
+    QDataStream recordStream(&record, QIODevice::WriteOnly);
+    Bitstream out(recordStream, Bitstream::FULL_METADATA);
+    out << journaledEdit;
+    out.flush();
+
+    _journalStream << record;
+    _journal.flush();
+    _editsSinceSnapshot++;
+}
+
+void MetavoxelPersister::takeSnapshot() {
+    if (_editsSinceSnapshot == 0 || _snapshotInProgress) {
+        return;
+    }
+    // the snapshot covers everything up to now; later edits go in the next generation's journal
+    _generation++;
+    openJournal();
+    _snapshotData = _data;
+    _snapshotInProgress = true;
+    _snapshotEdits = _editsSinceSnapshot;
+    _editsSinceSnapshot = 0;
+
+    QThreadPool::globalInstance()->start(new SnapshotWriter(this, _snapshotData, _filename, _generation));
+}
+
+void MetavoxelPersister::finishSnapshot(bool success, int time) {
+    _snapshotData = MetavoxelData();
+    _snapshotInProgress = false;
+    if (!success) {
+        // the journals still have the edits, so we'll just try again next time
+        _editsSinceSnapshot += _snapshotEdits;
+        return;
+    }
+    _lastSnapshotTime = time;
+
+    // the journals of the earlier generations are in the snapshot now
+    foreach (int generation, getJournalGenerations()) {
+        if (generation < _generation) {
+            QFile::remove(getJournalFilename(generation));
+        }
+    }
+}
+
+QString MetavoxelPersister::getJournalFilename(int generation) const {
+    return _filename + "." + QString::number(generation) + JOURNAL_SUFFIX;
+}
+
+QList<int> MetavoxelPersister::getJournalGenerations() const {
+    QFileInfo info(_filename);
+    QString prefix = info.fileName() + ".";
+    QList<int> generations;
+    foreach (const QString& name, info.absoluteDir().entryList(QStringList() << prefix + "*" + JOURNAL_SUFFIX,
+            QDir::Files)) {
+        bool ok;
+        int generation = name.mid(prefix.size(), name.size() - prefix.size() - JOURNAL_SUFFIX.size()).toInt(&ok);
+        if (ok) {
+            generations.append(generation);
+        }
+    }
+    qSort(generations);
+    return generations;
+}
+
+int MetavoxelPersister::replayJournal(int generation, MetavoxelData& data) {
+    QFile file(getJournalFilename(generation));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Couldn't open metavoxel journal" << file.fileName() << file.errorString();
+        return 0;
+    }
+    QDataStream stream(&file);
+    quint32 signature, version;
+    stream >> signature >> version;
+    if (signature != JOURNAL_SIGNATURE || version != PERSIST_FORMAT_VERSION) {
+        qWarning() << file.fileName() << "isn't a metavoxel journal we can read.";
+        return 0;
+    }
+    int edits = 0;
+    qint64 completeSize = file.pos();
+    while (!stream.atEnd()) {
+        QByteArray record;
+        stream >> record;
+
+        // a record cut short by a crash ends the journal
+        if (stream.status() != QDataStream::Ok) {
+            file.close();
+            QFile::resize(getJournalFilename(generation), completeSize);
+            break;
+        }
+        completeSize = file.pos();
+        QDataStream recordStream(record);
+        Bitstream in(recordStream, Bitstream::FULL_METADATA);
+        MetavoxelEditMessage edit;
+        in >> edit;
+        edit.apply(data, SharedObject::getWeakHash());
+        edits++;
+    }
+    return edits;
+}
+
+void MetavoxelPersister::openJournal() {
+    _journalStream.setDevice(NULL);
+    _journal.close();
+    _journal.setFileName(getJournalFilename(_generation));
+    if (!_journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Couldn't open metavoxel journal" << _journal.fileName() << _journal.errorString();
+        return;
+    }
+    _journalStream.setDevice(&_journal);
+    if (_journal.size() == 0) {
+        _journalStream << JOURNAL_SIGNATURE << PERSIST_FORMAT_VERSION;
+        _journal.flush();
+    }
+}
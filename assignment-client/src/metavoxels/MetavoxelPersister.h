@@ -0,0 +1,99 @@
+//
+//  MetavoxelPersister.h
+//  assignment-client/src/metavoxels
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_MetavoxelPersister_h
+#define hifi_MetavoxelPersister_h
+
+#include <QDataStream>
+#include <QFile>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+#include <MetavoxelData.h>
+
+class MetavoxelEditMessage;
+
+/// Keeps the metavoxel server's data on disk as a snapshot, written periodically in the background, plus a journal of the
+/// edits made since.  Each snapshot has a generation number, and so does each journal: the one in which the edits made
+/// after the snapshot of the same generation was taken are recorded.  A snapshot thus includes all the journals before
+/// its own generation, which may be discarded once it's safely written.
+class MetavoxelPersister : public QObject {
+    Q_OBJECT
+
+public:
+
+    static const int DEFAULT_SNAPSHOT_INTERVAL = 1000 * 30; // every 30 seconds
+
+    MetavoxelPersister(const MetavoxelData& data, const QString& filename, QObject* parent = NULL);
+    virtual ~MetavoxelPersister();
+
+    /// Loads the last snapshot into the provided data and replays the journaled edits made after it.  The snapshot is read
+    /// as it streams in from the file, rather than all at once.
+    void load(MetavoxelData& data);
+
+    /// Starts taking snapshots at the specified interval (in milliseconds).
+    void start(int snapshotInterval = DEFAULT_SNAPSHOT_INTERVAL);
+
+    /// Appends an edit to the journal.
+    void journalEdit(const MetavoxelEditMessage& edit);
+
+    /// Returns the time taken by the load in milliseconds.
+    int getLoadTime() const { return _loadTime; }
+
+    /// Returns the time taken by the last snapshot written in milliseconds, or -1 if none has been written.
+    int getLastSnapshotTime() const { return _lastSnapshotTime; }
+
+    /// Returns the number of edits made since the last snapshot was taken.
+    int getEditsSinceSnapshot() const { return _editsSinceSnapshot; }
+
+public slots:
+
+    /// Starts writing a snapshot of the data in the background, unless there's nothing new to write or we're still writing
+    /// the last one.
+    void takeSnapshot();
+
+private slots:
+
+    void finishSnapshot(bool success, int time);
+
+private:
+
+    QString getJournalFilename(int generation) const;
+
+    /// Returns the generations of the journals on disk, in ascending order.
+    QList<int> getJournalGenerations() const;
+
+    /// Applies the edits in the specified journal to the data, cutting off any partial record left by a crash so that the
+    /// journal may be appended to.
+    /// \return the number of edits applied
+    int replayJournal(int generation, MetavoxelData& data);
+
+    /// Opens the journal for the current generation, appending to it if it already exists.
+    void openJournal();
+
+    const MetavoxelData& _data;
+    QString _filename;
+    int _generation;
+
+    QFile _journal;
+    QDataStream _journalStream;
+    int _editsSinceSnapshot;
+
+    QTimer _snapshotTimer;
+    MetavoxelData _snapshotData; /// the data being written, held until the writer is done with it
+    bool _snapshotInProgress;
+    int _snapshotEdits;
+
+    int _loadTime;
+    int _lastSnapshotTime;
+};
+
+#endif // hifi_MetavoxelPersister_h
@@ -9,26 +9,99 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <cstring>
+
 #include <QDateTime>
+#include <QJsonObject>
+#include <QStringList>
 
 #include <PacketHeaders.h>
 
 #include <MetavoxelMessages.h>
 #include <MetavoxelUtil.h>
 
+#include "MetavoxelPersister.h"
 #include "MetavoxelServer.h"
 
 const int SEND_INTERVAL = 50;
 
+const QString PERSIST_FILE_OPTION = "--persist-file";
+const QString SNAPSHOT_INTERVAL_OPTION = "--snapshot-interval";
+
+/// returns the argument following the given option in an assignment payload, or an empty string if it isn't there
+static QString payloadOptionValue(const QStringList& payloadArguments, const QString& option) {
+    int optionIndex = payloadArguments.indexOf(option);
+    return (optionIndex == -1) ? QString() : payloadArguments.value(optionIndex + 1);
+}
+
+bool MetavoxelDeltaKey::operator==(const MetavoxelDeltaKey& other) const {
+    return referenceVersion == other.referenceVersion && referenceLOD == other.referenceLOD && lod == other.lod;
+}
+
+static uint hashFloat(float value) {
+    quint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static uint hashLOD(const MetavoxelLOD& lod) {
+    return hashFloat(lod.position.x) + 31 * (hashFloat(lod.position.y) +
+        31 * (hashFloat(lod.position.z) + 31 * hashFloat(lod.threshold)));
+}
+
+uint qHash(const MetavoxelDeltaKey& key, uint seed) {
+    return (key.referenceVersion + 31 * (hashLOD(key.referenceLOD) + 31 * hashLOD(key.lod))) ^ seed;
+}
+
 MetavoxelServer::MetavoxelServer(const QByteArray& packet) :
-    ThreadedAssignment(packet) {
+    ThreadedAssignment(packet),
+    _dataVersion(0),
+    _deltaRecorderStream(),
+    _deltaRecorder(_deltaRecorderStream),
+    _persister(NULL),
+    _snapshotInterval(MetavoxelPersister::DEFAULT_SNAPSHOT_INTERVAL) {
     
     _sendTimer.setSingleShot(true);
     connect(&_sendTimer, SIGNAL(timeout()), SLOT(sendDeltas()));
+    
+    QStringList payloadArguments = QString(_payload).split(' ', QString::SkipEmptyParts);
+    QString persistFilename = payloadOptionValue(payloadArguments, PERSIST_FILE_OPTION);
+    if (!persistFilename.isEmpty()) {
+        _persister = new MetavoxelPersister(_data, persistFilename, this);
+        
+        // the interval is given in seconds
+        QString snapshotInterval = payloadOptionValue(payloadArguments, SNAPSHOT_INTERVAL_OPTION);
+        if (!snapshotInterval.isEmpty()) {
+            _snapshotInterval = qMax(snapshotInterval.toInt(), 1) * 1000;
+        }
+    }
 }
 
 void MetavoxelServer::applyEdit(const MetavoxelEditMessage& edit) {
+    // journal the edit before applying it, so that nothing applied is missing from the journal
+    if (_persister) {
+        _persister->journalEdit(edit);
+    }
     edit.apply(_data, SharedObject::getWeakHash());
+    _data.intern();
+    _dataVersion++;
+    
+    // any deltas recorded were against the old data
+    _deltas.clear();
+}
+
+const BitstreamRecording& MetavoxelServer::getDelta(const MetavoxelData& reference, int referenceVersion,
+        const MetavoxelLOD& referenceLOD, const MetavoxelLOD& lod) {
+    MetavoxelDeltaKey key = { referenceVersion, referenceLOD, lod };
+    QHash<MetavoxelDeltaKey, BitstreamRecording>::iterator it = _deltas.find(key);
+    if (it == _deltas.end()) {
+        // the attributes and shared objects are kept out of the recording, so that it can be replayed through the mappings
+        // of any session's stream
+        _deltaRecorder.startRecording();
+        _data.writeDelta(reference, referenceLOD, _deltaRecorder, lod);
+        it = _deltas.insert(key, _deltaRecorder.stopRecording());
+    }
+    return *it;
 }
 
 const QString METAVOXEL_SERVER_LOGGING_NAME = "metavoxel-server";
@@ -41,6 +114,13 @@ void MetavoxelServer::run() {
     
     connect(nodeList, SIGNAL(nodeAdded(SharedNodePointer)), SLOT(maybeAttachSession(const SharedNodePointer&)));
     
+    // load what we persisted before sending anything out
+    if (_persister) {
+        _persister->load(_data);
+        _data.intern();
+        _persister->start(_snapshotInterval);
+    }
+    
     _lastSend = QDateTime::currentMSecsSinceEpoch();
     _sendTimer.start(SEND_INTERVAL);
 }
@@ -66,6 +146,16 @@ void MetavoxelServer::readPendingDatagrams() {
     }
 }
 
+void MetavoxelServer::sendStatsPacket() {
+    QJsonObject statsObject;
+    if (_persister) {
+        statsObject["load_time_msecs"] = _persister->getLoadTime();
+        statsObject["last_snapshot_time_msecs"] = _persister->getLastSnapshotTime();
+        statsObject["edits_since_snapshot"] = _persister->getEditsSinceSnapshot();
+    }
+    ThreadedAssignment::addPacketStatsAndSendStatsPacket(statsObject);
+}
+
 void MetavoxelServer::maybeAttachSession(const SharedNodePointer& node) {
     if (node->getType() == NodeType::Agent) {
         QMutexLocker locker(&node->getMutex());
@@ -74,13 +164,16 @@ void MetavoxelServer::maybeAttachSession(const SharedNodePointer& node) {
 }
 
 void MetavoxelServer::sendDeltas() {
-    // send deltas for all sessions
+    // send deltas for all sessions; those that share a reference and LOD share the encoding
     foreach (const SharedNodePointer& node, NodeList::getInstance()->getNodeHash()) {
         if (node->getType() == NodeType::Agent) {
             static_cast<MetavoxelSession*>(node->getLinkedData())->sendDelta();
         }
     }
     
+    // the next round will have different references and LODs, so don't hold on to this one's recordings
+    _deltas.clear();
+    
     // restart the send timer
     qint64 now = QDateTime::currentMSecsSinceEpoch();
     int elapsed = now - _lastSend;
@@ -101,8 +194,8 @@ MetavoxelSession::MetavoxelSession(MetavoxelServer* server, const SharedNodePoin
     connect(_sequencer.getReliableInputChannel(), SIGNAL(receivedMessage(const QVariant&)),
         SLOT(handleMessage(const QVariant&)));
     
-    // insert the baseline send record
-    SendRecord record = { 0 };
+    // insert the baseline send record, whose empty data has a version of its own
+    SendRecord record = { 0, MetavoxelData(), -1 };
     _sendRecords.append(record);
 }
 
@@ -122,11 +215,12 @@ void MetavoxelSession::sendDelta() {
     }
     Bitstream& out = _sequencer.startPacket();
     out << QVariant::fromValue(MetavoxelDeltaMessage());
-    _server->getData().writeDelta(_sendRecords.first().data, _sendRecords.first().lod, out, _lod);
+    const SendRecord& reference = _sendRecords.first();
+    out << _server->getDelta(reference.data, reference.dataVersion, reference.lod, _lod);
     _sequencer.endPacket();
     
     // record the send
-    SendRecord record = { _sequencer.getOutgoingPacketNumber(), _server->getData(), _lod };
+    SendRecord record = { _sequencer.getOutgoingPacketNumber(), _server->getData(), _server->getDataVersion(), _lod };
     _sendRecords.append(record);
 }
 
@@ -12,6 +12,7 @@
 #ifndef hifi_MetavoxelServer_h
 #define hifi_MetavoxelServer_h
 
+#include <QHash>
 #include <QList>
 #include <QTimer>
 
@@ -21,8 +22,21 @@
 #include <MetavoxelData.h>
 
 class MetavoxelEditMessage;
+class MetavoxelPersister;
 class MetavoxelSession;
 
+/// Identifies a delta by the version of the data it's relative to and the LODs it's written for.
+class MetavoxelDeltaKey {
+public:
+    int referenceVersion;
+    MetavoxelLOD referenceLOD;
+    MetavoxelLOD lod;
+    
+    bool operator==(const MetavoxelDeltaKey& other) const;
+};
+
+uint qHash(const MetavoxelDeltaKey& key, uint seed = 0);
+
 /// Maintains a shared metavoxel system, accepting change requests and broadcasting updates.
 class MetavoxelServer : public ThreadedAssignment {
     Q_OBJECT
@@ -35,10 +49,20 @@ public:
 
     const MetavoxelData& getData() const { return _data; }
 
+    /// Returns the version of the data, which changes with every edit.
+    int getDataVersion() const { return _dataVersion; }
+
+    /// Returns a recording of the delta between the data and the specified reference, encoding it only if no other session
+    /// has asked for the same delta since the last round of sends.
+    const BitstreamRecording& getDelta(const MetavoxelData& reference, int referenceVersion,
+        const MetavoxelLOD& referenceLOD, const MetavoxelLOD& lod);
+
     virtual void run();
     
     virtual void readPendingDatagrams();
     
+    virtual void sendStatsPacket();
+    
 private slots:
 
     void maybeAttachSession(const SharedNodePointer& node);
@@ -50,6 +74,14 @@ private:
     qint64 _lastSend;
     
     MetavoxelData _data;
+    int _dataVersion;
+    
+    QDataStream _deltaRecorderStream;
+    Bitstream _deltaRecorder;
+    QHash<MetavoxelDeltaKey, BitstreamRecording> _deltas;
+    
+    MetavoxelPersister* _persister; /// keeps the data on disk, when given a persist file
+    int _snapshotInterval;
 };
 
 /// Contains the state of a single client session.
@@ -81,6 +113,7 @@ private:
     public:
         int packetNumber;
         MetavoxelData data;
+        int dataVersion;
         MetavoxelLOD lod;
     };
     
@@ -360,9 +360,13 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
         int clientMaxPacketsPerInterval = std::max(1,(nodeData->getMaxOctreePacketsPerSecond() / INTERVALS_PER_SECOND));
         int maxPacketsPerInterval = std::min(clientMaxPacketsPerInterval, _myServer->getPacketsPerClientPerInterval());
 
+        // the node list's bandwidth shaper may hold octree packets back to leave room for this client's audio and avatars
+        BandwidthShaper& bandwidthShaper = NodeList::getInstance()->getBandwidthShaper();
+
         int extraPackingAttempts = 0;
         bool completedScene = false;
-        while (somethingToSend && packetsSentThisInterval < maxPacketsPerInterval && !nodeData->isShuttingDown()) {
+        while (somethingToSend && packetsSentThisInterval < maxPacketsPerInterval && !nodeData->isShuttingDown()
+                && bandwidthShaper.canSend(*_node, BandwidthShaper::OctreeClass, MAX_PACKET_SIZE)) {
             float lockWaitElapsedUsec = OctreeServer::SKIP_TIME;
             float encodeElapsedUsec = OctreeServer::SKIP_TIME;
             float compressAndWriteElapsedUsec = OctreeServer::SKIP_TIME;
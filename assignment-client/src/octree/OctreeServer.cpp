@@ -1016,6 +1016,16 @@ void OctreeServer::run() {
     qDebug("packetsPerSecondTotalMax=%s _packetsTotalPerInterval=%d", 
                     packetsPerSecondTotalMax, _packetsTotalPerInterval);
 
+    // Check to see if the user passed in a command line option for shaping the bandwidth used to each client
+    const char* BYTES_PER_SECOND_PER_CLIENT_MAX = "--bytesPerSecondPerClientMax";
+    const char* bytesPerSecondPerClientMax = getCmdOption(_argc, _argv, BYTES_PER_SECOND_PER_CLIENT_MAX);
+    if (bytesPerSecondPerClientMax) {
+        const char* BURST_BYTES_PER_CLIENT = "--burstBytesPerClient";
+        const char* burstBytesPerClient = getCmdOption(_argc, _argv, BURST_BYTES_PER_CLIENT);
+        nodeList->getBandwidthShaper().setNodeTypeLimits(NodeType::Agent, atoi(bytesPerSecondPerClientMax),
+                                                         burstBytesPerClient ? atoi(burstBytesPerClient) : 0);
+    }
+
     HifiSockAddr senderSockAddr;
 
     // set up our jurisdiction broadcaster...
@@ -12,10 +12,13 @@ $(document).ready(function(){
     
     var statsTableBody = "";
     
-    $.getJSON("/nodes/" + uuid + ".json", function(json){
+    // without a node UUID show the domain-server's own DTLS stats
+    var statsURL = uuid ? "/nodes/" + uuid + ".json" : "/dtls.json";
+    
+    $.getJSON(statsURL, function(json){
       
       // update the table header with the right node type
-      $('#stats-lead h3').html(json.node_type + " stats (" + uuid + ")");
+      $('#stats-lead h3').html(json.node_type + " stats" + (uuid ? " (" + uuid + ")" : ""));
       
       delete json.node_type;
       
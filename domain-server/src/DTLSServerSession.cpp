@@ -9,10 +9,42 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <cerrno>
+#include <cstring>
+
+#include <SharedUtil.h>
+
 #include "DTLSServerSession.h"
 
 DTLSServerSession::DTLSServerSession(QUdpSocket& dtlsSocket, HifiSockAddr& destinationSocket) :
-    DTLSSession(GNUTLS_SERVER, dtlsSocket, destinationSocket)
+    DTLSSession(GNUTLS_SERVER, dtlsSocket, destinationSocket),
+    _pendingDatagrams(),
+    _createdTimestamp(usecTimestampNow())
 {
+    gnutls_transport_set_ptr(_gnutlsSession, this);
+    gnutls_transport_set_push_function(_gnutlsSession, DummyDTLSSession::socketDescriptorPush);
+    gnutls_transport_set_pull_function(_gnutlsSession, socketPull);
+    gnutls_transport_set_pull_timeout_function(_gnutlsSession, socketPullTimeout);
+}
+
+int DTLSServerSession::socketPullTimeout(gnutls_transport_ptr_t ptr, unsigned int ms) {
+    DTLSServerSession* session = static_cast<DTLSServerSession*>(ptr);
+    
+    // we never block, either the worker has handed us data for this session or it hasn't
+    return session->_pendingDatagrams.isEmpty() ? 0 : 1;
+}
+
+ssize_t DTLSServerSession::socketPull(gnutls_transport_ptr_t ptr, void* buffer, size_t size) {
+    DTLSServerSession* session = static_cast<DTLSServerSession*>(ptr);
+    
+    if (session->_pendingDatagrams.isEmpty()) {
+        gnutls_transport_set_errno(session->_gnutlsSession, EAGAIN);
+        return -1;
+    }
+    
+    QByteArray datagram = session->_pendingDatagrams.dequeue();
+    size_t bytesPulled = qMin(size, (size_t) datagram.size());
+    memcpy(buffer, datagram.constData(), bytesPulled);
     
-}
\ No newline at end of file
+    return bytesPulled;
+}
@@ -12,13 +12,27 @@
 #ifndef hifi_DTLSServerSession_h
 #define hifi_DTLSServerSession_h
 
+#include <QtCore/QQueue>
+
 #include <gnutls/dtls.h>
 
 #include <DTLSSession.h>
 
+/// A DTLS session with a single node, driven by a DTLSServerWorker. The worker hands it the datagrams the domain-server
+/// read from the DTLS socket, since it may not be on the socket's thread it never reads from the socket itself.
 class DTLSServerSession : public DTLSSession {
 public:
     DTLSServerSession(QUdpSocket& dtlsSocket, HifiSockAddr& destinationSocket);
+    
+    static int socketPullTimeout(gnutls_transport_ptr_t ptr, unsigned int ms);
+    static ssize_t socketPull(gnutls_transport_ptr_t ptr, void* buffer, size_t size);
+    
+    void queueDatagram(const QByteArray& datagram) { _pendingDatagrams.enqueue(datagram); }
+    
+    quint64 getCreatedTimestamp() const { return _createdTimestamp; }
+private:
+    QQueue<QByteArray> _pendingDatagrams;
+    quint64 _createdTimestamp;
 };
 
 #endif // hifi_DTLSServerSession_h
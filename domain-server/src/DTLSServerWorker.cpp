@@ -0,0 +1,139 @@
+//
+//  DTLSServerWorker.cpp
+//  domain-server/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QtCore/QDebug>
+
+#include <DummyDTLSSession.h>
+#include <SharedUtil.h>
+
+#include "DTLSServerWorker.h"
+
+static int hifiSockAddrMetaTypeId = qRegisterMetaType<HifiSockAddr>();
+
+// the client data used to generate and verify DTLS cookies
+class DTLSCookieClientData {
+public:
+    DTLSCookieClientData(const HifiSockAddr& sockAddr) {
+        memset(this, 0, sizeof(*this));
+        address = sockAddr.getAddress().toIPv4Address();
+        port = sockAddr.getPort();
+    }
+    
+    quint32 address;
+    quint16 port;
+};
+
+DTLSServerWorker::DTLSServerWorker(QUdpSocket& dtlsSocket, gnutls_certificate_credentials_t* x509Credentials,
+                                   gnutls_priority_t* priorityCache, gnutls_datum_t* cookieKey) :
+    _dtlsSocket(dtlsSocket),
+    _x509Credentials(x509Credentials),
+    _priorityCache(priorityCache),
+    _cookieKey(cookieKey),
+    _sessions(),
+    _handshakeHistogram(),
+    _recordHistogram()
+{
+    
+}
+
+DTLSServerWorker::~DTLSServerWorker() {
+    foreach(DTLSServerSession* session, _sessions) {
+        delete session;
+    }
+}
+
+void DTLSServerWorker::processDatagram(const QByteArray& datagram, const HifiSockAddr& senderSockAddr) {
+    DTLSServerSession* existingSession = _sessions.value(senderSockAddr);
+    
+    if (existingSession) {
+        existingSession->queueDatagram(datagram);
+        
+        if (!existingSession->completedHandshake()) {
+            // check if we have completed handshake with this user
+            int handshakeReturn = gnutls_handshake(*existingSession->getGnuTLSSession());
+            
+            if (handshakeReturn == 0) {
+                existingSession->setCompletedHandshake(true);
+                _handshakeHistogram.record(usecTimestampNow() - existingSession->getCreatedTimestamp());
+                
+                emit completedHandshake(senderSockAddr,
+                                        (int) gnutls_dtls_get_data_mtu(*existingSession->getGnuTLSSession()));
+            } else if (gnutls_error_is_fatal(handshakeReturn)) {
+                // this was a fatal error handshaking, so remove this session
+                qDebug() << "Fatal error -" << gnutls_strerror(handshakeReturn) << "- during DTLS handshake with"
+                    << senderSockAddr;
+                delete _sessions.take(senderSockAddr);
+            }
+        } else {
+            // pull the data from this user off the stack and hand it back to be processed
+            QByteArray plaintextDatagram(datagram.size(), 0);
+            
+            quint64 recordStart = usecTimestampNow();
+            int receivedBytes = gnutls_record_recv(*existingSession->getGnuTLSSession(),
+                                                   plaintextDatagram.data(), plaintextDatagram.size());
+            _recordHistogram.record(usecTimestampNow() - recordStart);
+            
+            if (receivedBytes > 0) {
+                plaintextDatagram.resize(receivedBytes);
+                emit receivedDatagram(plaintextDatagram, senderSockAddr);
+            } else if (gnutls_error_is_fatal(receivedBytes)) {
+                qDebug() << "Fatal error -" << gnutls_strerror(receivedBytes) << "- receiving DTLS record from"
+                    << senderSockAddr;
+            }
+        }
+    } else {
+        // first we verify the cookie
+        // see http://gnutls.org/manual/html_node/DTLS-sessions.html for why this is required
+        DTLSCookieClientData cookieClientData(senderSockAddr);
+        gnutls_dtls_prestate_st prestate;
+        memset(&prestate, 0, sizeof(prestate));
+        int cookieValid = gnutls_dtls_cookie_verify(_cookieKey, &cookieClientData, sizeof(cookieClientData),
+                                                    const_cast<char*>(datagram.constData()), datagram.size(), &prestate);
+        
+        if (cookieValid < 0) {
+            // the cookie sent by the client was not valid
+            // send a valid one
+            DummyDTLSSession tempServerSession(_dtlsSocket, senderSockAddr);
+            
+            gnutls_dtls_cookie_send(_cookieKey, &cookieClientData, sizeof(cookieClientData), &prestate,
+                                    &tempServerSession, DummyDTLSSession::socketDescriptorPush);
+        } else {
+            // cookie valid but no existing session - set up a new session now
+            HifiSockAddr sessionSockAddr = senderSockAddr;
+            DTLSServerSession* newServerSession = new DTLSServerSession(_dtlsSocket, sessionSockAddr);
+            gnutls_session_t* gnutlsSession = newServerSession->getGnuTLSSession();
+            
+            gnutls_priority_set(*gnutlsSession, *_priorityCache);
+            gnutls_credentials_set(*gnutlsSession, GNUTLS_CRD_CERTIFICATE, *_x509Credentials);
+            gnutls_dtls_prestate_set(*gnutlsSession, &prestate);
+            
+            // handshake to begin the session, starting with the client hello that carried the cookie
+            newServerSession->queueDatagram(datagram);
+            gnutls_handshake(*gnutlsSession);
+            
+            qDebug() << "Beginning DTLS session with node at" << senderSockAddr;
+            _sessions.insert(senderSockAddr, newServerSession);
+        }
+    }
+}
+
+void DTLSServerWorker::writeDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr) {
+    DTLSServerSession* session = _sessions.value(destinationSockAddr);
+    
+    if (session && session->completedHandshake()) {
+        session->writeDatagram(datagram);
+    }
+}
+
+void DTLSServerWorker::removeSession(const HifiSockAddr& sockAddr) {
+    delete _sessions.take(sockAddr);
+}
@@ -0,0 +1,58 @@
+//
+//  DTLSServerWorker.h
+//  domain-server/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_DTLSServerWorker_h
+#define hifi_DTLSServerWorker_h
+
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+
+#include <gnutls/dtls.h>
+
+#include <HifiSockAddr.h>
+#include <Histogram.h>
+
+#include "DTLSServerSession.h"
+
+/// Runs the GnuTLS handshakes and record processing for a shard of the domain-server's DTLS sessions on its own thread.
+/// The domain-server reads datagrams off the DTLS socket and hands each one to the worker that owns its sender, decrypted
+/// packets come back through the receivedDatagram signal.
+class DTLSServerWorker : public QObject {
+    Q_OBJECT
+public:
+    DTLSServerWorker(QUdpSocket& dtlsSocket, gnutls_certificate_credentials_t* x509Credentials,
+                     gnutls_priority_t* priorityCache, gnutls_datum_t* cookieKey);
+    ~DTLSServerWorker();
+    
+    const Histogram& getHandshakeHistogram() const { return _handshakeHistogram; }
+    const Histogram& getRecordHistogram() const { return _recordHistogram; }
+    
+public slots:
+    void processDatagram(const QByteArray& datagram, const HifiSockAddr& senderSockAddr);
+    void writeDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr);
+    void removeSession(const HifiSockAddr& sockAddr);
+    
+signals:
+    void completedHandshake(const HifiSockAddr& sockAddr, int dataMTU);
+    void receivedDatagram(const QByteArray& datagram, const HifiSockAddr& senderSockAddr);
+    
+private:
+    QUdpSocket& _dtlsSocket;
+    gnutls_certificate_credentials_t* _x509Credentials;
+    gnutls_priority_t* _priorityCache;
+    gnutls_datum_t* _cookieKey;
+    
+    QHash<HifiSockAddr, DTLSServerSession*> _sessions;
+    
+    Histogram _handshakeHistogram;
+    Histogram _recordHistogram;
+};
+
+#endif // hifi_DTLSServerWorker_h
@@ -9,6 +9,7 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <QtCore/QDateTime>
 #include <QtCore/QDir>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
@@ -22,6 +23,7 @@
 
 #include <AccountManager.h>
 #include <HifiConfigVariantMap.h>
+#include <Histogram.h>
 #include <HTTPConnection.h>
 #include <PacketHeaders.h>
 #include <SharedUtil.h>
@@ -42,12 +44,17 @@ DomainServer::DomainServer(int argc, char* argv[]) :
     _x509Credentials(NULL),
     _dhParams(NULL),
     _priorityCache(NULL),
-    _dtlsSessions(),
+    _dtlsWorkers(),
+    _dtlsWorkerThreads(),
+    _dtlsSessionDataMTUs(),
     _oauthProviderURL(),
     _oauthClientID(),
     _hostname(),
     _networkReplyUUIDMap(),
-    _sessionAuthenticationHash()
+    _sessionAuthenticationHash(),
+    _domainListVersion(QDateTime::currentMSecsSinceEpoch() / MSECS_PER_SECOND),
+    _domainListChangesStartVersion(_domainListVersion),
+    _domainListChanges()
 {
     gnutls_global_init();
     
@@ -67,6 +74,8 @@ DomainServer::DomainServer(int argc, char* argv[]) :
         if (_isUsingDTLS) {
             LimitedNodeList* nodeList = LimitedNodeList::getInstance();
             
+            setupDTLSWorkers();
+            
             // connect our socket to read datagrams received on the DTLS socket
             connect(&nodeList->getDTLSSocket(), &QUdpSocket::readyRead, this, &DomainServer::readAvailableDTLSDatagrams);
         }
@@ -76,6 +85,13 @@ DomainServer::DomainServer(int argc, char* argv[]) :
 }
 
 DomainServer::~DomainServer() {
+    // stop the DTLS workers before the credentials they use go away
+    foreach(QThread* workerThread, _dtlsWorkerThreads) {
+        workerThread->quit();
+        workerThread->wait();
+    }
+    qDeleteAll(_dtlsWorkers);
+    
     if (_x509Credentials) {
         gnutls_certificate_free_credentials(*_x509Credentials);
         gnutls_priority_deinit(*_priorityCache);
@@ -209,6 +225,40 @@ bool DomainServer::optionallySetupDTLS() {
     return true;
 }
 
+void DomainServer::setupDTLSWorkers() {
+    // DTLS sessions are sharded by sender across a pool of workers so that handshakes don't hold up check-ins
+    const QString DTLS_WORKERS_OPTION = "dtls-workers";
+    int numWorkers = _argumentVariantMap.contains(DTLS_WORKERS_OPTION)
+        ? _argumentVariantMap.value(DTLS_WORKERS_OPTION).toInt() : QThread::idealThreadCount();
+    numWorkers = qMax(numWorkers, 1);
+    
+    QUdpSocket& dtlsSocket = LimitedNodeList::getInstance()->getDTLSSocket();
+    
+    for (int i = 0; i < numWorkers; i++) {
+        DTLSServerWorker* worker = new DTLSServerWorker(dtlsSocket, _x509Credentials, _priorityCache, _cookieKey);
+        QThread* workerThread = new QThread(this);
+        worker->moveToThread(workerThread);
+        
+        connect(worker, &DTLSServerWorker::receivedDatagram, this, &DomainServer::processDatagram);
+        connect(worker, &DTLSServerWorker::completedHandshake, this, &DomainServer::completedDTLSHandshake);
+        
+        workerThread->start();
+        
+        _dtlsWorkers.append(worker);
+        _dtlsWorkerThreads.append(workerThread);
+    }
+    
+    qDebug() << "Processing DTLS sessions on" << numWorkers << "worker threads.";
+}
+
+DTLSServerWorker* DomainServer::dtlsWorkerForSockAddr(const HifiSockAddr& sockAddr) {
+    return _dtlsWorkers.at(qHash(sockAddr, 0) % _dtlsWorkers.size());
+}
+
+void DomainServer::completedDTLSHandshake(const HifiSockAddr& sockAddr, int dataMTU) {
+    _dtlsSessionDataMTUs.insert(sockAddr, dataMTU);
+}
+
 void DomainServer::setupNodeListAndAssignments(const QUuid& sessionUUID) {
     
     const QString CUSTOM_PORT_OPTION = "port";
@@ -535,16 +585,50 @@ NodeSet DomainServer::nodeInterestListFromPacket(const QByteArray& packet, int n
     return nodeInterestSet;
 }
 
-void DomainServer::sendDomainListToNode(const SharedNodePointer& node, const HifiSockAddr &senderSockAddr,
-                                        const NodeSet& nodeInterestList) {
+quint32 DomainServer::domainListVersionFromPacket(const QByteArray& packet, int numPreceedingBytes) {
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numPreceedingBytes);
     
-    QByteArray broadcastPacket = byteArrayWithPopulatedHeader(PacketTypeDomainList);
+    // skip over the node interest list, each type is a single byte
+    quint8 numInterestTypes = 0;
+    packetStream >> numInterestTypes;
+    packetStream.skipRawData(numInterestTypes);
+    
+    quint32 lastDomainListVersion = 0;
+    packetStream >> lastDomainListVersion;
     
-    // always send the node their own UUID back
-    QDataStream broadcastDataStream(&broadcastPacket, QIODevice::Append);
-    broadcastDataStream << node->getUUID();
+    return lastDomainListVersion;
+}
+
+QByteArray DomainServer::domainListEntryForNode(const SharedNodePointer& node, const SharedNodePointer& otherNode) {
+    QByteArray nodeByteArray;
+    QDataStream nodeDataStream(&nodeByteArray, QIODevice::Append);
     
-    int numBroadcastPacketLeadBytes = broadcastDataStream.device()->pos();
+    nodeDataStream << DomainListEntryType::Added << *otherNode.data();
+    
+    // pack the secret that these two nodes will use to communicate with each other
+    DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
+    QUuid secretUUID = nodeData->getSessionSecretHash().value(otherNode->getUUID());
+    if (secretUUID.isNull()) {
+        // generate a new secret UUID these two nodes can use
+        secretUUID = QUuid::createUuid();
+        
+        // set that on the current Node's sessionSecretHash
+        nodeData->getSessionSecretHash().insert(otherNode->getUUID(), secretUUID);
+        
+        // set it on the other Node's sessionSecretHash
+        reinterpret_cast<DomainServerNodeData*>(otherNode->getLinkedData())
+        ->getSessionSecretHash().insert(node->getUUID(), secretUUID);
+        
+    }
+    
+    nodeDataStream << secretUUID;
+    
+    return nodeByteArray;
+}
+
+void DomainServer::sendDomainListToNode(const SharedNodePointer& node, const HifiSockAddr &senderSockAddr,
+                                        const NodeSet& nodeInterestList, quint32 lastDomainListVersion) {
     
     DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
     
@@ -552,66 +636,96 @@ void DomainServer::sendDomainListToNode(const SharedNodePointer& node, const Hif
     
     if (nodeInterestList.size() > 0) {
         
-        DTLSServerSession* dtlsSession = _isUsingDTLS ? _dtlsSessions[senderSockAddr] : NULL;
-        int dataMTU = dtlsSession ? (int)gnutls_dtls_get_data_mtu(*dtlsSession->getGnuTLSSession()) : MAX_PACKET_SIZE;
+        DTLSServerWorker* dtlsWorker = _isUsingDTLS && _dtlsSessionDataMTUs.contains(senderSockAddr)
+            ? dtlsWorkerForSockAddr(senderSockAddr) : NULL;
+        int dataMTU = dtlsWorker ? _dtlsSessionDataMTUs.value(senderSockAddr) : MAX_PACKET_SIZE;
+        
+        // an unauthenticated node gets no entries and no list version, so that it asks for everything once it is allowed in
+        QList<QByteArray> listEntries;
+        quint32 listVersion = 0;
         
         if (nodeData->isAuthenticated()) {
-            // if this authenticated node has any interest types, send back those nodes as well
-            foreach (const SharedNodePointer& otherNode, nodeList->getNodeHash()) {
-                
-                // reset our nodeByteArray and nodeDataStream
-                QByteArray nodeByteArray;
-                QDataStream nodeDataStream(&nodeByteArray, QIODevice::Append);
-                
-                if (otherNode->getUUID() != node->getUUID() && nodeInterestList.contains(otherNode->getType())) {
+            listVersion = _domainListVersion;
+            
+            // if the node has a version we still have the changes for, only send it what changed since then
+            bool canSendChanges = lastDomainListVersion >= _domainListChangesStartVersion
+                && lastDomainListVersion <= _domainListVersion
+                && nodeInterestList == nodeData->getLastInterestList();
+            
+            if (canSendChanges) {
+                // walk back through the changes it hasn't seen, only the latest change to each node matters
+                QSet<QUuid> changedNodes;
+                for (int i = _domainListChanges.size() - 1;
+                     i >= 0 && _domainListChanges.at(i).version > lastDomainListVersion; i--) {
+                    const DomainListChange& change = _domainListChanges.at(i);
                     
-                    // don't send avatar nodes to other avatars, that will come from avatar mixer
-                    nodeDataStream << *otherNode.data();
-                    
-                    // pack the secret that these two nodes will use to communicate with each other
-                    QUuid secretUUID = nodeData->getSessionSecretHash().value(otherNode->getUUID());
-                    if (secretUUID.isNull()) {
-                        // generate a new secret UUID these two nodes can use
-                        secretUUID = QUuid::createUuid();
-                        
-                        // set that on the current Node's sessionSecretHash
-                        nodeData->getSessionSecretHash().insert(otherNode->getUUID(), secretUUID);
-                        
-                        // set it on the other Node's sessionSecretHash
-                        reinterpret_cast<DomainServerNodeData*>(otherNode->getLinkedData())
-                        ->getSessionSecretHash().insert(node->getUUID(), secretUUID);
-                        
+                    if (change.nodeUUID == node->getUUID() || !nodeInterestList.contains(change.nodeType)
+                        || changedNodes.contains(change.nodeUUID)) {
+                        continue;
                     }
+                    changedNodes.insert(change.nodeUUID);
                     
-                    nodeDataStream << secretUUID;
-                    
-                    if (broadcastPacket.size() +  nodeByteArray.size() > dataMTU) {
-                        // we need to break here and start a new packet
-                        // so send the current one
-                        
-                        if (!dtlsSession) {
-                            nodeList->writeDatagram(broadcastPacket, node, senderSockAddr);
-                        } else {
-                            dtlsSession->writeDatagram(broadcastPacket);
-                        }
-                        
-                        // reset the broadcastPacket structure
-                        broadcastPacket.resize(numBroadcastPacketLeadBytes);
-                        broadcastDataStream.device()->seek(numBroadcastPacketLeadBytes);
+                    SharedNodePointer otherNode = change.wasRemoved ? SharedNodePointer() : nodeList->nodeWithUUID(change.nodeUUID);
+                    if (otherNode) {
+                        listEntries.append(domainListEntryForNode(node, otherNode));
+                    } else {
+                        QByteArray removedByteArray;
+                        QDataStream removedDataStream(&removedByteArray, QIODevice::Append);
+                        removedDataStream << DomainListEntryType::Removed << change.nodeUUID;
+                        listEntries.append(removedByteArray);
+                    }
+                }
+            } else {
+                // send back every node this node is interested in
+                foreach (const SharedNodePointer& otherNode, nodeList->getNodeHash()) {
+                    if (otherNode->getUUID() != node->getUUID() && nodeInterestList.contains(otherNode->getType())) {
+                        listEntries.append(domainListEntryForNode(node, otherNode));
                     }
-                    
-                    // append the nodeByteArray to the current state of broadcastDataStream
-                    broadcastPacket.append(nodeByteArray);
                 }
             }
+            
+            nodeData->setLastInterestList(nodeInterestList);
         }
         
-        // always write the last broadcastPacket
-        if (!dtlsSession) {
-            nodeList->writeDatagram(broadcastPacket, node, senderSockAddr);
-        } else {
-            dtlsSession->writeDatagram(broadcastPacket);
-        }
+        // split the entries across as many packets as required, each one says where its entries fall in the list
+        // so that the node knows when it has the whole list and can move up to its version
+        int numEntriesSent = 0;
+        
+        do {
+            QByteArray broadcastPacket = byteArrayWithPopulatedHeader(PacketTypeDomainList);
+            
+            // always send the node their own UUID back
+            QDataStream broadcastDataStream(&broadcastPacket, QIODevice::Append);
+            broadcastDataStream << node->getUUID() << listVersion
+                << (quint16) listEntries.size() << (quint16) numEntriesSent;
+            
+            int numEntriesInPacket = 0;
+            while (numEntriesSent < listEntries.size()
+                   && (numEntriesInPacket == 0 || broadcastPacket.size() + listEntries.at(numEntriesSent).size() <= dataMTU)) {
+                broadcastPacket.append(listEntries.at(numEntriesSent++));
+                numEntriesInPacket++;
+            }
+            
+            if (!dtlsWorker) {
+                nodeList->writeDatagram(broadcastPacket, node, senderSockAddr);
+            } else {
+                // the session lives on its worker's thread, so it does the encryption and send
+                QMetaObject::invokeMethod(dtlsWorker, "writeDatagram", Qt::QueuedConnection,
+                                          Q_ARG(const QByteArray&, broadcastPacket),
+                                          Q_ARG(const HifiSockAddr&, senderSockAddr));
+            }
+        } while (numEntriesSent < listEntries.size());
+    }
+}
+
+void DomainServer::recordDomainListChange(const SharedNodePointer& node, bool wasRemoved) {
+    DomainListChange change = { ++_domainListVersion, node->getUUID(), (NodeType_t) node->getType(), wasRemoved };
+    _domainListChanges.enqueue(change);
+    
+    // only keep a bounded history, nodes that are further behind than that get a full list
+    const int MAX_DOMAIN_LIST_CHANGES = 1024;
+    while (_domainListChanges.size() > MAX_DOMAIN_LIST_CHANGES) {
+        _domainListChangesStartVersion = _domainListChanges.dequeue().version;
     }
 }
 
@@ -694,78 +808,17 @@ void DomainServer::readAvailableDTLSDatagrams() {
     
     QUdpSocket& dtlsSocket = nodeList->getDTLSSocket();
     
-    static sockaddr senderSockAddr;
-    static socklen_t sockAddrSize = sizeof(senderSockAddr);
+    HifiSockAddr senderSockAddr;
     
     while (dtlsSocket.hasPendingDatagrams()) {
-        // check if we have an active DTLS session for this sender
-        QByteArray peekDatagram(dtlsSocket.pendingDatagramSize(), 0);
-       
-        recvfrom(dtlsSocket.socketDescriptor(), peekDatagram.data(), dtlsSocket.pendingDatagramSize(),
-                 MSG_PEEK, &senderSockAddr, &sockAddrSize);
-        
-        HifiSockAddr senderHifiSockAddr(&senderSockAddr);
-        DTLSServerSession* existingSession = _dtlsSessions.value(senderHifiSockAddr);
+        QByteArray receivedDatagram(dtlsSocket.pendingDatagramSize(), 0);
+        dtlsSocket.readDatagram(receivedDatagram.data(), receivedDatagram.size(),
+                                senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
         
-        if (existingSession) {
-            if (!existingSession->completedHandshake()) {
-                // check if we have completed handshake with this user
-                int handshakeReturn = gnutls_handshake(*existingSession->getGnuTLSSession());
-                
-                if (handshakeReturn == 0) {
-                    existingSession->setCompletedHandshake(true);
-                } else if (gnutls_error_is_fatal(handshakeReturn)) {
-                    // this was a fatal error handshaking, so remove this session
-                    qDebug() << "Fatal error -" << gnutls_strerror(handshakeReturn) << "- during DTLS handshake with"
-                        << senderHifiSockAddr;
-                    _dtlsSessions.remove(senderHifiSockAddr);
-                }
-            } else {
-                // pull the data from this user off the stack and process it
-                int receivedBytes = gnutls_record_recv(*existingSession->getGnuTLSSession(),
-                                                       peekDatagram.data(), peekDatagram.size());
-                if (receivedBytes > 0) {
-                    processDatagram(peekDatagram.left(receivedBytes), senderHifiSockAddr);
-                } else if (gnutls_error_is_fatal(receivedBytes)) {
-                    qDebug() << "Fatal error -" << gnutls_strerror(receivedBytes) << "- during DTLS handshake with"
-                        << senderHifiSockAddr;
-                }
-            }
-        } else {
-            // first we verify the cookie
-            // see http://gnutls.org/manual/html_node/DTLS-sessions.html for why this is required
-            gnutls_dtls_prestate_st prestate;
-            memset(&prestate, 0, sizeof(prestate));
-            int cookieValid = gnutls_dtls_cookie_verify(_cookieKey, &senderSockAddr, sizeof(senderSockAddr),
-                                                        peekDatagram.data(), peekDatagram.size(), &prestate);
-            
-            if (cookieValid < 0) {
-                // the cookie sent by the client was not valid
-                // send a valid one
-                DummyDTLSSession tempServerSession(LimitedNodeList::getInstance()->getDTLSSocket(), senderHifiSockAddr);
-                
-                gnutls_dtls_cookie_send(_cookieKey, &senderSockAddr, sizeof(senderSockAddr), &prestate,
-                                        &tempServerSession, DTLSSession::socketPush);
-                
-                // acutally pull the peeked data off the network stack so that it gets discarded
-                dtlsSocket.readDatagram(peekDatagram.data(), peekDatagram.size());
-            } else {
-                // cookie valid but no existing session - set up a new session now
-                DTLSServerSession* newServerSession = new DTLSServerSession(LimitedNodeList::getInstance()->getDTLSSocket(),
-                                                                            senderHifiSockAddr);
-                gnutls_session_t* gnutlsSession = newServerSession->getGnuTLSSession();
-                
-                gnutls_priority_set(*gnutlsSession, *_priorityCache);
-                gnutls_credentials_set(*gnutlsSession, GNUTLS_CRD_CERTIFICATE, *_x509Credentials);
-                gnutls_dtls_prestate_set(*gnutlsSession, &prestate);
-                
-                // handshake to begin the session
-                gnutls_handshake(*gnutlsSession);
-                
-                qDebug() << "Beginning DTLS session with node at" << senderHifiSockAddr;
-                _dtlsSessions[senderHifiSockAddr] = newServerSession;
-            }
-        }
+        // hand the datagram to the worker that owns this sender's session, decrypted packets come back to processDatagram
+        QMetaObject::invokeMethod(dtlsWorkerForSockAddr(senderSockAddr), "processDatagram", Qt::QueuedConnection,
+                                  Q_ARG(const QByteArray&, receivedDatagram),
+                                  Q_ARG(const HifiSockAddr&, senderSockAddr));
     }
 }
 
@@ -779,21 +832,27 @@ void DomainServer::processDatagram(const QByteArray& receivedPacket, const HifiS
             handleConnectRequest(receivedPacket, senderSockAddr);
         } else if (requestType == PacketTypeDomainListRequest) {
             QUuid nodeUUID = uuidFromPacketHeader(receivedPacket);
+            SharedNodePointer checkInNode = nodeUUID.isNull() ? SharedNodePointer() : nodeList->nodeWithUUID(nodeUUID);
             
-            if (!nodeUUID.isNull() && nodeList->nodeWithUUID(nodeUUID)) {
+            if (checkInNode) {
                 NodeType_t throwawayNodeType;
                 HifiSockAddr nodePublicAddress, nodeLocalAddress;
                 
                 int numNodeInfoBytes = parseNodeDataFromByteArray(throwawayNodeType, nodePublicAddress, nodeLocalAddress,
                                                                   receivedPacket, senderSockAddr);
                 
-                SharedNodePointer checkInNode = nodeList->updateSocketsForNode(nodeUUID, nodePublicAddress, nodeLocalAddress);
+                // a socket change has to reach the other nodes like any other change to the list
+                if (nodePublicAddress != checkInNode->getPublicSocket() || nodeLocalAddress != checkInNode->getLocalSocket()) {
+                    nodeList->updateSocketsForNode(nodeUUID, nodePublicAddress, nodeLocalAddress);
+                    recordDomainListChange(checkInNode, false);
+                }
                 
                 // update last receive to now
                 quint64 timeNow = usecTimestampNow();
                 checkInNode->setLastHeardMicrostamp(timeNow);
             
-                sendDomainListToNode(checkInNode, senderSockAddr, nodeInterestListFromPacket(receivedPacket, numNodeInfoBytes));
+                sendDomainListToNode(checkInNode, senderSockAddr, nodeInterestListFromPacket(receivedPacket, numNodeInfoBytes),
+                                     domainListVersionFromPacket(receivedPacket, numNodeInfoBytes));
             }
         } else if (requestType == PacketTypeNodeJsonStats) {
             SharedNodePointer matchingNode = nodeList->sendingNodeForPacket(receivedPacket);
@@ -937,6 +996,42 @@ bool DomainServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
             // send the response
             connection->respond(HTTPConnection::StatusCode200, nodesDocument.toJson(), qPrintable(JSON_MIME_TYPE));
             
+            return true;
+        } else if (url.path() == "/timing.json") {
+            // packet timing percentiles for what the domain-server itself has received, since the last request
+            QJsonObject statsObject;
+            statsObject["node_type"] = QString("domain-server");
+            
+            LimitedNodeList* nodeList = LimitedNodeList::getInstance();
+            nodeList->addPacketTimingStats(statsObject);
+            nodeList->resetPacketTimingStats();
+            
+            QJsonDocument statsDocument(statsObject);
+            
+            connection->respond(HTTPConnection::StatusCode200, statsDocument.toJson(), qPrintable(JSON_MIME_TYPE));
+            
+            return true;
+        } else if (url.path() == "/dtls.json") {
+            // sum the handshake and record timings from each of the DTLS workers
+            Histogram handshakeHistogram;
+            Histogram recordHistogram;
+            
+            foreach(DTLSServerWorker* worker, _dtlsWorkers) {
+                handshakeHistogram.add(worker->getHandshakeHistogram());
+                recordHistogram.add(worker->getRecordHistogram());
+            }
+            
+            QJsonObject statsObject;
+            statsObject["node_type"] = QString("domain-server-dtls");
+            statsObject["dtls.workers"] = _dtlsWorkers.size();
+            statsObject["dtls.sessions"] = _dtlsSessionDataMTUs.size();
+            handshakeHistogram.addToJSONObject(statsObject, "dtls.handshake_usecs");
+            recordHistogram.addToJSONObject(statsObject, "dtls.record_usecs");
+            
+            QJsonDocument statsDocument(statsObject);
+            
+            connection->respond(HTTPConnection::StatusCode200, statsDocument.toJson(), qPrintable(JSON_MIME_TYPE));
+            
             return true;
         } else {
             const QString NODE_JSON_REGEX_STRING = QString("\\%1\\/(%2).json\\/?$").arg(URI_NODES).arg(UUID_REGEX_STRING);
@@ -1187,10 +1282,14 @@ void DomainServer::refreshStaticAssignmentAndAddToQueue(SharedAssignmentPointer&
 void DomainServer::nodeAdded(SharedNodePointer node) {
     // we don't use updateNodeWithData, so add the DomainServerNodeData to the node here
     node->setLinkedData(new DomainServerNodeData());
+    
+    recordDomainListChange(node, false);
 }
 
 void DomainServer::nodeKilled(SharedNodePointer node) {
     
+    recordDomainListChange(node, true);
+    
     DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
     
     if (nodeData) {
@@ -1212,11 +1311,10 @@ void DomainServer::nodeKilled(SharedNodePointer node) {
         }
         
         if (_isUsingDTLS) {
-            // check if we need to remove a DTLS session from our in-memory hash
-            DTLSServerSession* existingSession = _dtlsSessions.take(nodeData->getSendingSockAddr());
-            if (existingSession) {
-                delete existingSession;
-            }
+            // remove the DTLS session for this node from its worker
+            _dtlsSessionDataMTUs.remove(nodeData->getSendingSockAddr());
+            QMetaObject::invokeMethod(dtlsWorkerForSockAddr(nodeData->getSendingSockAddr()), "removeSession",
+                                      Qt::QueuedConnection, Q_ARG(const HifiSockAddr&, nodeData->getSendingSockAddr()));
         }
     }
 }
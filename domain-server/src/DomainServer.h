@@ -18,6 +18,7 @@
 #include <QtCore/QQueue>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QStringList>
+#include <QtCore/QThread>
 #include <QtCore/QUrl>
 
 #include <gnutls/gnutls.h>
@@ -26,10 +27,20 @@
 #include <HTTPSConnection.h>
 #include <LimitedNodeList.h>
 
-#include "DTLSServerSession.h"
+#include "DTLSServerWorker.h"
 
 typedef QSharedPointer<Assignment> SharedAssignmentPointer;
 
+/// An addition, socket update or removal of a node in the versioned domain list, replayed to nodes that check in with
+/// an older version of the list instead of sending them the full list again
+class DomainListChange {
+public:
+    quint32 version;
+    QUuid nodeUUID;
+    NodeType_t nodeType;
+    bool wasRemoved;
+};
+
 class DomainServer : public QCoreApplication, public HTTPSRequestHandler {
     Q_OBJECT
 public:
@@ -51,10 +62,13 @@ private slots:
     
     void readAvailableDatagrams();
     void readAvailableDTLSDatagrams();
+    void completedDTLSHandshake(const HifiSockAddr& sockAddr, int dataMTU);
 private:
     void setupNodeListAndAssignments(const QUuid& sessionUUID = QUuid::createUuid());
     bool optionallySetupOAuth();
     bool optionallySetupDTLS();
+    void setupDTLSWorkers();
+    DTLSServerWorker* dtlsWorkerForSockAddr(const HifiSockAddr& sockAddr);
     bool optionallyReadX509KeyAndCertificate();
     
     void processDatagram(const QByteArray& receivedPacket, const HifiSockAddr& senderSockAddr);
@@ -63,8 +77,11 @@ private:
     int parseNodeDataFromByteArray(NodeType_t& nodeType, HifiSockAddr& publicSockAddr,
                                     HifiSockAddr& localSockAddr, const QByteArray& packet, const HifiSockAddr& senderSockAddr);
     NodeSet nodeInterestListFromPacket(const QByteArray& packet, int numPreceedingBytes);
+    quint32 domainListVersionFromPacket(const QByteArray& packet, int numPreceedingBytes);
     void sendDomainListToNode(const SharedNodePointer& node, const HifiSockAddr& senderSockAddr,
-                              const NodeSet& nodeInterestList);
+                              const NodeSet& nodeInterestList, quint32 lastDomainListVersion = 0);
+    QByteArray domainListEntryForNode(const SharedNodePointer& node, const SharedNodePointer& otherNode);
+    void recordDomainListChange(const SharedNodePointer& node, bool wasRemoved);
     
     void parseAssignmentConfigs(QSet<Assignment::Type>& excludedTypes);
     void addStaticAssignmentToAssignmentHash(Assignment* newAssignment);
@@ -101,7 +118,9 @@ private:
     gnutls_datum_t* _cookieKey;
     gnutls_priority_t* _priorityCache;
     
-    QHash<HifiSockAddr, DTLSServerSession*> _dtlsSessions;
+    QList<DTLSServerWorker*> _dtlsWorkers;
+    QList<QThread*> _dtlsWorkerThreads;
+    QHash<HifiSockAddr, int> _dtlsSessionDataMTUs;
     
     QNetworkAccessManager* _networkAccessManager;
     
@@ -111,6 +130,10 @@ private:
     QString _hostname;
     QMap<QNetworkReply*, QUuid> _networkReplyUUIDMap;
     QHash<QUuid, bool> _sessionAuthenticationHash;
+    
+    quint32 _domainListVersion;
+    quint32 _domainListChangesStartVersion;
+    QQueue<DomainListChange> _domainListChanges;
 };
 
 #endif // hifi_DomainServer_h
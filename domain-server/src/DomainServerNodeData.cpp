@@ -22,7 +22,8 @@ DomainServerNodeData::DomainServerNodeData() :
     _assignmentUUID(),
     _statsJSONObject(),
     _sendingSockAddr(),
-    _isAuthenticated(true)
+    _isAuthenticated(true),
+    _lastInterestList()
 {
     
 }
@@ -16,6 +16,7 @@
 #include <QtCore/QUuid>
 
 #include <HifiSockAddr.h>
+#include <LimitedNodeList.h>
 #include <NodeData.h>
 
 class DomainServerNodeData : public NodeData {
@@ -37,6 +38,9 @@ public:
     bool isAuthenticated() const { return _isAuthenticated; }
     
     QHash<QUuid, QUuid>& getSessionSecretHash() { return _sessionSecretHash; }
+    
+    void setLastInterestList(const NodeSet& lastInterestList) { _lastInterestList = lastInterestList; }
+    const NodeSet& getLastInterestList() const { return _lastInterestList; }
 private:
     QJsonObject mergeJSONStatsFromNewObject(const QJsonObject& newObject, QJsonObject destinationObject);
     
@@ -45,6 +49,7 @@ private:
     QJsonObject _statsJSONObject;
     HifiSockAddr _sendingSockAddr;
     bool _isAuthenticated;
+    NodeSet _lastInterestList;
 };
 
 #endif // hifi_DomainServerNodeData_h
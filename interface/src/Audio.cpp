@@ -68,6 +68,12 @@ Audio::Audio(int16_t initialJitterBufferSamples, QObject* parent) :
     _proceduralOutputDevice(NULL),
     _inputRingBuffer(0),
     _ringBuffer(NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL),
+    _inputStreamEncoder(),
+    _audioCodecID(AudioCodecID::NearLossless),
+    _inputResampler(),
+    _outputResampler(),
+    _loopbackResampler(),
+    _proceduralResampler(),
     _averagedLatency(0.0),
     _measuredJitter(0),
     _jitterBufferSamples(initialJitterBufferSamples),
@@ -248,14 +254,18 @@ bool adjustedFormatForAudioDevice(const QAudioDeviceInfo& audioDevice,
             }
         }
 
-        if (audioDevice.supportedSampleRates().contains(SAMPLE_RATE * 2)) {
-            // use 48, which is a sample downsample, upsample
-            adjustedAudioFormat = desiredAudioFormat;
-            adjustedAudioFormat.setSampleRate(SAMPLE_RATE * 2);
+        // fall back to the common device rates, preferring 48 since it's the simplest ratio to resample
+        const int FALLBACK_SAMPLE_RATES[] = { SAMPLE_RATE * 2, 44100, SAMPLE_RATE * 4 };
+        const int NUM_FALLBACK_SAMPLE_RATES = sizeof(FALLBACK_SAMPLE_RATES) / sizeof(int);
+        for (int i = 0; i < NUM_FALLBACK_SAMPLE_RATES; i++) {
+            if (audioDevice.supportedSampleRates().contains(FALLBACK_SAMPLE_RATES[i])) {
+                adjustedAudioFormat = desiredAudioFormat;
+                adjustedAudioFormat.setSampleRate(FALLBACK_SAMPLE_RATES[i]);
 
-            // return the nearest in case it needs 2 channels
-            adjustedAudioFormat = audioDevice.nearestFormat(adjustedAudioFormat);
-            return true;
+                // return the nearest in case it needs 2 channels
+                adjustedAudioFormat = audioDevice.nearestFormat(adjustedAudioFormat);
+                return true;
+            }
         }
 
         return false;
@@ -266,77 +276,66 @@ bool adjustedFormatForAudioDevice(const QAudioDeviceInfo& audioDevice,
     }
 }
 
-void linearResampling(int16_t* sourceSamples, int16_t* destinationSamples,
-                      unsigned int numSourceSamples, unsigned int numDestinationSamples,
-                      const QAudioFormat& sourceAudioFormat, const QAudioFormat& destinationAudioFormat) {
-    if (sourceAudioFormat == destinationAudioFormat) {
-        memcpy(destinationSamples, sourceSamples, numSourceSamples * sizeof(int16_t));
-    } else {
-        float sourceToDestinationFactor = (sourceAudioFormat.sampleRate() / (float) destinationAudioFormat.sampleRate())
-            * (sourceAudioFormat.channelCount() / (float) destinationAudioFormat.channelCount());
-
-        // take into account the number of channels in source and destination
-        // accomodate for the case where have an output with > 2 channels
-        // this is the case with our HDMI capture
-
-        if (sourceToDestinationFactor >= 2) {
-            // we need to downsample from 48 to 24
-            // for now this only supports a mono output - this would be the case for audio input
-
-            for (unsigned int i = sourceAudioFormat.channelCount(); i < numSourceSamples; i += 2 * sourceAudioFormat.channelCount()) {
-                if (i + (sourceAudioFormat.channelCount()) >= numSourceSamples) {
-                    destinationSamples[(i - sourceAudioFormat.channelCount()) / (int) sourceToDestinationFactor] =
-                        (sourceSamples[i - sourceAudioFormat.channelCount()] / 2)
-                        + (sourceSamples[i] / 2);
+static void remapChannels(const int16_t* sourceSamples, int numFrames, int numSourceChannels,
+                          int16_t* destinationSamples, int numDestinationChannels) {
+    for (int i = 0; i < numFrames; i++) {
+        if (numDestinationChannels == 1) {
+            // average down to mono
+            *destinationSamples++ = (numSourceChannels == 1) ? sourceSamples[0] :
+                (sourceSamples[0] + sourceSamples[1]) / 2;
+        } else {
+            for (int channel = 0; channel < numDestinationChannels; channel++) {
+                if (channel < numSourceChannels) {
+                    *destinationSamples++ = sourceSamples[channel];
+                } else if (channel == 1) {
+                    // mono to stereo
+                    *destinationSamples++ = sourceSamples[0];
                 } else {
-                    destinationSamples[(i - sourceAudioFormat.channelCount()) / (int) sourceToDestinationFactor] =
-                        (sourceSamples[i - sourceAudioFormat.channelCount()] / 4)
-                        + (sourceSamples[i] / 2)
-                        + (sourceSamples[i + sourceAudioFormat.channelCount()] / 4);
+                    // channels above 2, fill with silence
+                    *destinationSamples++ = 0;
                 }
             }
+        }
+        sourceSamples += numSourceChannels;
+    }
+}
 
-        } else {
-            if (sourceAudioFormat.sampleRate() == destinationAudioFormat.sampleRate()) {
-                // mono to stereo, same sample rate
-                if (!(sourceAudioFormat.channelCount() == 1 && destinationAudioFormat.channelCount() == 2)) {
-                    qWarning() << "Unsupported format conversion" << sourceAudioFormat << destinationAudioFormat;
-                    return;
-                }
-                for (const int16_t* sourceEnd = sourceSamples + numSourceSamples; sourceSamples != sourceEnd;
-                        sourceSamples++) {
-                    *destinationSamples++ = *sourceSamples;
-                    *destinationSamples++ = *sourceSamples;
-                }
-                return;
-            }
+/// Converts samples from one format to another through the given resampler, (re)creating it when the formats don't
+/// match the ones it was made for. Channels are remapped on whichever side has fewer of them, so that we resample as
+/// few as possible.
+static void resampleAudio(QScopedPointer<AudioResampler>& resampler, const int16_t* sourceSamples,
+                          int numSourceSamples, const QAudioFormat& sourceAudioFormat,
+                          const QAudioFormat& destinationAudioFormat, QByteArray& destination) {
+    int numSourceChannels = sourceAudioFormat.channelCount();
+    int numDestinationChannels = destinationAudioFormat.channelCount();
+    int numResamplerChannels = qMin(numSourceChannels, numDestinationChannels);
+    if (!resampler || resampler->getInputSampleRate() != sourceAudioFormat.sampleRate()
+            || resampler->getOutputSampleRate() != destinationAudioFormat.sampleRate()
+            || resampler->getNumChannels() != numResamplerChannels) {
+        resampler.reset(new AudioResampler(sourceAudioFormat.sampleRate(), destinationAudioFormat.sampleRate(),
+                                           numResamplerChannels));
+    }
+    int numSourceFrames = numSourceSamples / numSourceChannels;
+    int maxDestinationFrames = resampler->getMaxOutputFrames(numSourceFrames);
+    destination.resize(maxDestinationFrames * numDestinationChannels * sizeof(int16_t));
+    int16_t* destinationSamples = reinterpret_cast<int16_t*>(destination.data());
+    
+    int numDestinationFrames;
+    if (numSourceChannels > numDestinationChannels) {
+        QVector<int16_t> remappedSamples(numSourceFrames * numDestinationChannels);
+        remapChannels(sourceSamples, numSourceFrames, numSourceChannels, remappedSamples.data(),
+                      numDestinationChannels);
+        numDestinationFrames = resampler->resample(remappedSamples.constData(), numSourceFrames, destinationSamples);
         
-            // upsample from 24 to 48
-            // for now this only supports a stereo to stereo conversion - this is our case for network audio to output
-            int sourceIndex = 0;
-            int dtsSampleRateFactor = (destinationAudioFormat.sampleRate() / sourceAudioFormat.sampleRate());
-            int sampleShift = destinationAudioFormat.channelCount() * dtsSampleRateFactor;
-            int destinationToSourceFactor = (1 / sourceToDestinationFactor);
-
-            for (unsigned int i = 0; i < numDestinationSamples; i += sampleShift) {
-                sourceIndex = (i / destinationToSourceFactor);
-
-                // fill the L/R channels and make the rest silent
-                for (unsigned int j = i; j < i + sampleShift; j++) {
-                    if (j % destinationAudioFormat.channelCount() == 0) {
-                        // left channel
-                        destinationSamples[j] = sourceSamples[sourceIndex];
-                    } else if (j % destinationAudioFormat.channelCount() == 1) {
-                         // right channel
-                        destinationSamples[j] = sourceSamples[sourceIndex + (sourceAudioFormat.channelCount() > 1 ? 1 : 0)];
-                    } else {
-                        // channels above 2, fill with silence
-                        destinationSamples[j] = 0;
-                    }
-                }
-            }
-        }
+    } else if (numSourceChannels < numDestinationChannels) {
+        QVector<int16_t> resampledSamples(maxDestinationFrames * numSourceChannels);
+        numDestinationFrames = resampler->resample(sourceSamples, numSourceFrames, resampledSamples.data());
+        remapChannels(resampledSamples.constData(), numDestinationFrames, numSourceChannels, destinationSamples,
+                      numDestinationChannels);
+    } else {
+        numDestinationFrames = resampler->resample(sourceSamples, numSourceFrames, destinationSamples);
     }
+    destination.resize(numDestinationFrames * numDestinationChannels * sizeof(int16_t));
 }
 
 void Audio::start() {
@@ -352,6 +351,9 @@ void Audio::start() {
     _desiredOutputFormat = _desiredInputFormat;
     _desiredOutputFormat.setChannelCount(2);
 
+    // have the filters ready for whatever rates the devices end up with
+    AudioResampler::precomputeCommonFilterBanks();
+
     QAudioDeviceInfo inputDeviceInfo = defaultAudioDeviceForMode(QAudio::AudioInput);
     qDebug() << "The default audio input device is" << inputDeviceInfo.deviceName();
     bool inputFormatSupported = switchInputToAudioDevice(inputDeviceInfo);
@@ -398,16 +400,8 @@ bool Audio::switchOutputToAudioDevice(const QString& outputDeviceName) {
 }
 
 void Audio::handleAudioInput() {
-    static char monoAudioDataPacket[MAX_PACKET_SIZE];
-
-    static int numBytesPacketHeader = numBytesForPacketHeaderGivenPacketType(PacketTypeMicrophoneAudioNoEcho);
-    static int leadingBytes = numBytesPacketHeader + sizeof(glm::vec3) + sizeof(glm::quat);
-
-    static int16_t* monoAudioSamples = (int16_t*) (monoAudioDataPacket + leadingBytes);
-
-    float inputToNetworkInputRatio = calculateDeviceToNetworkInputRatio(_numInputCallbackBytes);
-
-    unsigned int inputSamplesRequired = NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL * inputToNetworkInputRatio;
+    // each frame is encoded into a packet of its own once it's been cleaned up, so the samples just need somewhere to sit
+    int16_t monoAudioSamples[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
 
     QByteArray inputByteArray = _inputDevice->readAll();
     
@@ -424,14 +418,9 @@ void Audio::handleAudioInput() {
                 _loopbackOutputDevice->write(inputByteArray);
             }
         } else {
-            float loopbackOutputToInputRatio = (_outputFormat.sampleRate() / (float) _inputFormat.sampleRate())
-                * (_outputFormat.channelCount() / _inputFormat.channelCount());
-
-            QByteArray loopBackByteArray(inputByteArray.size() * loopbackOutputToInputRatio, 0);
-
-            linearResampling((int16_t*) inputByteArray.data(), (int16_t*) loopBackByteArray.data(),
-                             inputByteArray.size() / sizeof(int16_t),
-                             loopBackByteArray.size() / sizeof(int16_t), _inputFormat, _outputFormat);
+            QByteArray loopBackByteArray;
+            resampleAudio(_loopbackResampler, reinterpret_cast<const int16_t*>(inputByteArray.constData()),
+                          inputByteArray.size() / sizeof(int16_t), _inputFormat, _outputFormat, loopBackByteArray);
 
             if (_loopbackOutputDevice) {
                 _loopbackOutputDevice->write(loopBackByteArray);
@@ -439,24 +428,18 @@ void Audio::handleAudioInput() {
         }
     }
 
-    _inputRingBuffer.writeData(inputByteArray.data(), inputByteArray.size());
-
-    while (_inputRingBuffer.samplesAvailable() > inputSamplesRequired) {
+    // bring everything the device gave us to the network format as it arrives, so that the resampler sees one
+    // continuous stream, and buffer it until we have a full frame
+    QByteArray networkInputByteArray;
+    resampleAudio(_inputResampler, reinterpret_cast<const int16_t*>(inputByteArray.constData()),
+                  inputByteArray.size() / sizeof(int16_t), _inputFormat, _desiredInputFormat, networkInputByteArray);
+    _inputRingBuffer.writeData(networkInputByteArray.constData(), networkInputByteArray.size());
 
-        int16_t* inputAudioSamples = new int16_t[inputSamplesRequired];
-        _inputRingBuffer.readSamples(inputAudioSamples, inputSamplesRequired);
+    while (_inputRingBuffer.samplesAvailable() >= (unsigned int) NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL) {
 
-        // zero out the monoAudioSamples array and the locally injected audio
-        memset(monoAudioSamples, 0, NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL);
+        _inputRingBuffer.readSamples(monoAudioSamples, NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
 
         if (!_muted) {
-            // we aren't muted, downsample the input audio
-            linearResampling((int16_t*) inputAudioSamples,
-                             monoAudioSamples,
-                             inputSamplesRequired,
-                             NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL,
-                             _inputFormat, _desiredInputFormat);
-            
             //
             //  Impose Noise Gate
             //
@@ -567,7 +550,8 @@ void Audio::handleAudioInput() {
                 }
             }
         } else {
-            // our input loudness is 0, since we're muted
+            // zero out the monoAudioSamples array, our input loudness is 0 since we're muted
+            memset(monoAudioSamples, 0, NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL);
             _lastInputLoudness = 0;
         }
         
@@ -598,45 +582,38 @@ void Audio::handleAudioInput() {
             glm::vec3 headPosition = interfaceAvatar->getHead()->getPosition();
             glm::quat headOrientation = interfaceAvatar->getHead()->getFinalOrientation();
 
-            // we need the amount of bytes in the buffer + 1 for type
-            // + 12 for 3 floats for position + float for bearing + 1 attenuation byte
-            
-            int numAudioBytes = 0;
-            
             PacketType packetType;
             if (_lastInputLoudness == 0) {
                 packetType = PacketTypeSilentAudioFrame;
-                
-                // we need to indicate how many silent samples this is to the audio mixer
-                monoAudioSamples[0] = NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
-                numAudioBytes = sizeof(int16_t);
-                
+            } else if (Menu::getInstance()->isOptionChecked(MenuOption::EchoServerAudio)) {
+                packetType = PacketTypeMicrophoneAudioWithEcho;
             } else {
-                numAudioBytes = NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL;
-                
-                if (Menu::getInstance()->isOptionChecked(MenuOption::EchoServerAudio)) {
-                    packetType = PacketTypeMicrophoneAudioWithEcho;
-                } else {
-                    packetType = PacketTypeMicrophoneAudioNoEcho;
-                }
+                packetType = PacketTypeMicrophoneAudioNoEcho;
             }
 
-            char* currentPacketPtr = monoAudioDataPacket + populatePacketHeader(monoAudioDataPacket, packetType);
+            QByteArray audioPacket = byteArrayWithPopulatedHeader(packetType);
 
-            // memcpy the three float positions
-            memcpy(currentPacketPtr, &headPosition, sizeof(headPosition));
-            currentPacketPtr += (sizeof(headPosition));
+            // append our position and orientation
+            audioPacket.append(reinterpret_cast<const char*>(&headPosition), sizeof(headPosition));
+            audioPacket.append(reinterpret_cast<const char*>(&headOrientation), sizeof(headOrientation));
 
-            // memcpy our orientation
-            memcpy(currentPacketPtr, &headOrientation, sizeof(headOrientation));
-            currentPacketPtr += sizeof(headOrientation);
-            
-            nodeList->writeDatagram(monoAudioDataPacket, numAudioBytes + leadingBytes, audioMixer);
+            // the codec we send with is also the one the mixer will use for the mix it sends us
+            if (packetType == PacketTypeSilentAudioFrame) {
+                _inputStreamEncoder.writeSilentFrameHeader(_audioCodecID, audioPacket);
+
+                // we need to indicate how many silent samples this is to the audio mixer
+                int16_t numSilentSamples = NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+                audioPacket.append(reinterpret_cast<const char*>(&numSilentSamples), sizeof(numSilentSamples));
+            } else {
+                _inputStreamEncoder.encodeFrame(_audioCodecID, monoAudioSamples, NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL,
+                                                1, audioPacket);
+            }
+
+            nodeList->writeDatagram(audioPacket, audioMixer);
 
             Application::getInstance()->getBandwidthMeter()->outputStream(BandwidthMeter::AUDIO)
-                .updateValue(numAudioBytes + leadingBytes);
+                .updateValue(audioPacket.size());
         }
-        delete[] inputAudioSamples;
     }
 }
 
@@ -757,9 +734,6 @@ void Audio::toggleAudioNoiseReduction() {
 void Audio::processReceivedAudio(const QByteArray& audioByteArray) {
     _ringBuffer.parseData(audioByteArray);
     
-    float networkOutputToOutputRatio = (_desiredOutputFormat.sampleRate() / (float) _outputFormat.sampleRate())
-        * (_desiredOutputFormat.channelCount() / (float) _outputFormat.channelCount());
-    
     if (!_ringBuffer.isStarved() && _audioOutput && _audioOutput->bytesFree() == _audioOutput->bufferSize()) {
         // we don't have any audio data left in the output buffer
         // we just starved
@@ -772,10 +746,6 @@ void Audio::processReceivedAudio(const QByteArray& audioByteArray) {
     if (_ringBuffer.samplesAvailable() > 0) {
         
         int numNetworkOutputSamples = _ringBuffer.samplesAvailable();
-        int numDeviceOutputSamples = numNetworkOutputSamples / networkOutputToOutputRatio;
-        
-        QByteArray outputBuffer;
-        outputBuffer.resize(numDeviceOutputSamples * sizeof(int16_t));
         
         int numSamplesNeededToStartPlayback = NETWORK_BUFFER_LENGTH_SAMPLES_STEREO + (_jitterBufferSamples * 2);
         
@@ -816,11 +786,9 @@ void Audio::processReceivedAudio(const QByteArray& audioByteArray) {
             }
 
             // copy the packet from the RB to the output
-            linearResampling(ringBufferSamples,
-                             (int16_t*) outputBuffer.data(),
-                             numNetworkOutputSamples,
-                             numDeviceOutputSamples,
-                             _desiredOutputFormat, _outputFormat);
+            QByteArray outputBuffer;
+            resampleAudio(_outputResampler, ringBufferSamples, numNetworkOutputSamples, _desiredOutputFormat,
+                          _outputFormat, outputBuffer);
 
             if (_outputDevice) {
                 _outputDevice->write(outputBuffer);
@@ -868,15 +836,8 @@ void Audio::processProceduralAudio(int16_t* monoInput, int numSamples) {
         
     // send whatever procedural sounds we want to locally loop back to the _proceduralOutputDevice
     QByteArray proceduralOutput;
-    proceduralOutput.resize(NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL * _outputFormat.sampleRate() *
-        _outputFormat.channelCount() * sizeof(int16_t) / (_desiredInputFormat.sampleRate() *
-            _desiredInputFormat.channelCount()));
-        
-    linearResampling(_localProceduralSamples,
-        reinterpret_cast<int16_t*>(proceduralOutput.data()),
-        NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL,
-        proceduralOutput.size() / sizeof(int16_t),
-        _desiredInputFormat, _outputFormat);
+    resampleAudio(_proceduralResampler, _localProceduralSamples, NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL,
+                  _desiredInputFormat, _outputFormat, proceduralOutput);
         
     if (_proceduralOutputDevice) {
         _proceduralOutputDevice->write(proceduralOutput);
@@ -1303,14 +1264,6 @@ int Audio::calculateNumberOfInputCallbackBytes(const QAudioFormat& format) {
     return numInputCallbackBytes;
 }
 
-float Audio::calculateDeviceToNetworkInputRatio(int numBytes) {
-    float inputToNetworkInputRatio = (int)((_numInputCallbackBytes 
-        * CALLBACK_ACCELERATOR_RATIO
-        / NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL) + 0.5f);
-
-    return inputToNetworkInputRatio;
-}
-
 int Audio::calculateNumberOfFrameSamples(int numBytes) {
     int frameSamples = (int)(numBytes * CALLBACK_ACCELERATOR_RATIO + 0.5f) / sizeof(int16_t);
     return frameSamples;
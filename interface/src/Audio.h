@@ -22,12 +22,15 @@
 #include <QElapsedTimer>
 #include <QGLWidget>
 #include <QtCore/QObject>
+#include <QtCore/QScopedPointer>
 #include <QtCore/QVector>
 #include <QtMultimedia/QAudioFormat>
 #include <QVector>
 #include <QByteArray>
 
 #include <AbstractAudioInterface.h>
+#include <AudioCodec.h>
+#include <AudioResampler.h>
 #include <AudioRingBuffer.h>
 #include <StdDev.h>
 
@@ -52,6 +55,10 @@ public:
     void setJitterBufferSamples(int samples) { _jitterBufferSamples = samples; }
     int getJitterBufferSamples() { return _jitterBufferSamples; }
     
+    /// Sets the codec we encode our microphone audio with, the audio-mixer encodes what it sends us the same way
+    void setAudioCodecID(AudioCodecID_t audioCodecID) { _audioCodecID = audioCodecID; }
+    AudioCodecID_t getAudioCodecID() const { return _audioCodecID; }
+    
     virtual void startCollisionSound(float magnitude, float frequency, float noise, float duration, bool flashScreen);
     virtual void startDrumSound(float volume, float frequency, float duration, float decay);
     
@@ -124,6 +131,12 @@ private:
     QIODevice* _proceduralOutputDevice;
     AudioRingBuffer _inputRingBuffer;
     AudioRingBuffer _ringBuffer;
+    AudioStreamEncoder _inputStreamEncoder;
+    AudioCodecID_t _audioCodecID;
+    QScopedPointer<AudioResampler> _inputResampler;
+    QScopedPointer<AudioResampler> _outputResampler;
+    QScopedPointer<AudioResampler> _loopbackResampler;
+    QScopedPointer<AudioResampler> _proceduralResampler;
 
     QString _inputAudioDeviceName;
     QString _outputAudioDeviceName;
@@ -195,7 +208,6 @@ private:
     static const float CALLBACK_ACCELERATOR_RATIO;
     int calculateNumberOfInputCallbackBytes(const QAudioFormat& format);
     int calculateNumberOfFrameSamples(int numBytes);
-    float calculateDeviceToNetworkInputRatio(int numBytes);
 
     // Audio scope methods for data acquisition
     void addBufferToScope(
@@ -7,6 +7,8 @@
 //
 
 #include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include "AudioReflector.h"
 #include "Menu.h"
@@ -123,54 +125,58 @@ float AudioReflector::getDelayFromDistance(float distance) {
 }
 
 // attenuation = from the Audio Mixer
-float AudioReflector::getDistanceAttenuationCoefficient(float distance) {
-
+static float distanceAttenuationCoefficient(float distance, bool originalFormula, float scalingFactor) {
+    float distanceCoefficient = 1.0f;
+    
+    if (originalFormula) {
+        const float DISTANCE_SCALE = 2.5f;
+        const float GEOMETRIC_AMPLITUDE_SCALAR = 0.3f;
+        const float DISTANCE_LOG_BASE = 2.5f;
+        const float DISTANCE_SCALE_LOG = logf(DISTANCE_SCALE) / logf(DISTANCE_LOG_BASE);
+
+        float distanceSquareToSource = distance * distance;
+
+        // calculate the distance coefficient using the distance to this node
+        distanceCoefficient = powf(GEOMETRIC_AMPLITUDE_SCALAR,
+                                         DISTANCE_SCALE_LOG +
+                                         (0.5f * logf(distanceSquareToSource) / logf(DISTANCE_LOG_BASE)) - 1);
+        distanceCoefficient = std::min(1.0f, distanceCoefficient * scalingFactor);
+    } else {
+    
+        // From Fred: If we wanted something that would produce a tail that could go up to 5 seconds in a 
+        // really big room, that would suggest the sound still has to be in the audible after traveling about 
+        // 1500 meters.  If it’s a sound of average volume, we probably have about 30 db, or 5 base2 orders 
+        // of magnitude we can drop down before the sound becomes inaudible. (That’s approximate headroom 
+        // based on a few sloppy assumptions.) So we could try a factor like 1 / (2^(D/300)) for starters.
+        // 1 / (2^(D/300))
+        const float DISTANCE_BASE = 2.0f;
+        const float DISTANCE_DENOMINATOR = 300.0f;
+        const float DISTANCE_NUMERATOR = 300.0f;
+        distanceCoefficient = DISTANCE_NUMERATOR / powf(DISTANCE_BASE, (distance / DISTANCE_DENOMINATOR ));
+        distanceCoefficient = std::min(1.0f, distanceCoefficient * scalingFactor);
+    }
+    
+    return distanceCoefficient;
+}
 
+float AudioReflector::getDistanceAttenuationCoefficient(float distance) {
     bool doDistanceAttenuation = !Menu::getInstance()->isOptionChecked(
                                             MenuOption::AudioSpatialProcessingDontDistanceAttenuate);
 
     bool originalFormula = !Menu::getInstance()->isOptionChecked(
                                             MenuOption::AudioSpatialProcessingAlternateDistanceAttenuate);
     
-    
-    float distanceCoefficient = 1.0f;
-    
-    if (doDistanceAttenuation) {
-    
-        if (originalFormula) {
-            const float DISTANCE_SCALE = 2.5f;
-            const float GEOMETRIC_AMPLITUDE_SCALAR = 0.3f;
-            const float DISTANCE_LOG_BASE = 2.5f;
-            const float DISTANCE_SCALE_LOG = logf(DISTANCE_SCALE) / logf(DISTANCE_LOG_BASE);
-    
-            float distanceSquareToSource = distance * distance;
+    return doDistanceAttenuation ?
+        distanceAttenuationCoefficient(distance, originalFormula, getDistanceAttenuationScalingFactor()) : 1.0f;
+}
 
-            // calculate the distance coefficient using the distance to this node
-            distanceCoefficient = powf(GEOMETRIC_AMPLITUDE_SCALAR,
-                                             DISTANCE_SCALE_LOG +
-                                             (0.5f * logf(distanceSquareToSource) / logf(DISTANCE_LOG_BASE)) - 1);
-            distanceCoefficient = std::min(1.0f, distanceCoefficient * getDistanceAttenuationScalingFactor());
-        } else {
-        
-            // From Fred: If we wanted something that would produce a tail that could go up to 5 seconds in a 
-            // really big room, that would suggest the sound still has to be in the audible after traveling about 
-            // 1500 meters.  If it’s a sound of average volume, we probably have about 30 db, or 5 base2 orders 
-            // of magnitude we can drop down before the sound becomes inaudible. (That’s approximate headroom 
-            // based on a few sloppy assumptions.) So we could try a factor like 1 / (2^(D/300)) for starters.
-            // 1 / (2^(D/300))
-            const float DISTANCE_BASE = 2.0f;
-            const float DISTANCE_DENOMINATOR = 300.0f;
-            const float DISTANCE_NUMERATOR = 300.0f;
-            distanceCoefficient = DISTANCE_NUMERATOR / powf(DISTANCE_BASE, (distance / DISTANCE_DENOMINATOR ));
-            distanceCoefficient = std::min(1.0f, distanceCoefficient * getDistanceAttenuationScalingFactor());
-        }
-    }
-    
-    return distanceCoefficient;
+float ReflectionSettings::getDistanceAttenuationCoefficient(float distance) const {
+    return distanceAttenuate ?
+        distanceAttenuationCoefficient(distance, !alternateDistanceAttenuate, distanceAttenuationScalingFactor) : 1.0f;
 }
 
-glm::vec3 AudioReflector::getFaceNormal(BoxFace face) {
-    bool wantSlightRandomness = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingSlightlyRandomSurfaces);
+glm::vec3 ReflectionTrace::getFaceNormal(BoxFace face) {
+    bool wantSlightRandomness = settings.slightlyRandomSurfaces;
     glm::vec3 faceNormal;
     const float MIN_RANDOM_LENGTH = 0.99f;
     const float MAX_RANDOM_LENGTH = 1.0f;
@@ -361,14 +367,17 @@ void AudioReflector::echoAudio(AudioSource source, unsigned int sampleTime, cons
     _totalAttenuation = 0.0f;
     _attenuationCount = 0;
 
-    // depending on if we're processing local or external audio, pick the correct points vector
-    QVector<AudiblePoint>& audiblePoints = source == INBOUND_AUDIO ? _inboundAudiblePoints : _localAudiblePoints;
-
     int injectCalls = 0;
     _injectedEchoes = 0;
-    foreach(const AudiblePoint& audiblePoint, audiblePoints) {
-        injectCalls++;
-        injectAudiblePoint(source, audiblePoint, samples, sampleTime, format.sampleRate());
+    if (_currentTrace) {
+        // depending on if we're processing local or external audio, pick the correct points vector
+        const QVector<AudiblePoint>& audiblePoints = source == INBOUND_AUDIO ?
+            _currentTrace->inboundAudiblePoints : _currentTrace->localAudiblePoints;
+        
+        foreach(const AudiblePoint& audiblePoint, audiblePoints) {
+            injectCalls++;
+            injectAudiblePoint(source, audiblePoint, samples, sampleTime, format.sampleRate());
+        }
     }
     
     /*
@@ -431,13 +440,32 @@ AudioPath::AudioPath(AudioSource source, const glm::vec3& origin, const glm::vec
 {
 }
 
-void AudioReflector::addAudioPath(AudioSource source, const glm::vec3& origin, const glm::vec3& initialDirection, 
+ReflectionTrace::ReflectionTrace(const ReflectionSettings& settings) :
+    settings(settings),
+    inboundAudioPaths(),
+    inboundAudiblePoints(),
+    localAudioPaths(),
+    localAudiblePoints(),
+    finished(0)
+{
+}
+
+ReflectionTrace::~ReflectionTrace() {
+    foreach(AudioPath* const& path, inboundAudioPaths) {
+        delete path;
+    }
+    foreach(AudioPath* const& path, localAudioPaths) {
+        delete path;
+    }
+}
+
+void ReflectionTrace::addAudioPath(AudioSource source, const glm::vec3& origin, const glm::vec3& initialDirection, 
                                         float initialAttenuation, float initialDelay, float initialDistance, bool isDiffusion) {
                                         
     AudioPath* path = new AudioPath(source, origin, initialDirection, initialAttenuation, initialDelay,
                                         initialDistance, isDiffusion, 0);
 
-    QVector<AudioPath*>& audioPaths = source == INBOUND_AUDIO ? _inboundAudioPaths : _localAudioPaths;
+    QVector<AudioPath*>& audioPaths = source == INBOUND_AUDIO ? inboundAudioPaths : localAudioPaths;
 
     audioPaths.push_back(path);
 }
@@ -455,32 +483,91 @@ void AudioReflector::identifyAudioSources() {
     }
 }
 
+/// traces a set of reflections on the thread pool, flagging the trace once it's finished
+class ReflectionTracer : public QRunnable {
+public:
+    
+    ReflectionTracer(const QSharedPointer<ReflectionTrace>& trace, VoxelTree* voxels);
+    
+    virtual void run();
+
+private:
+    
+    QSharedPointer<ReflectionTrace> _trace;
+    VoxelTree* _voxels;
+};
+
+ReflectionTracer::ReflectionTracer(const QSharedPointer<ReflectionTrace>& trace, VoxelTree* voxels) :
+    _trace(trace),
+    _voxels(voxels) {
+}
+
+void ReflectionTracer::run() {
+    quint64 start = usecTimestampNow();
+    _trace->analyzePaths(_voxels); // actually does the work
+    quint64 end = usecTimestampNow();
+    const bool wantDebugging = false;
+    if (wantDebugging) {
+        qDebug() << "ReflectionTracer::run() elapsed=" << (end - start);
+    }
+    _trace->finished.storeRelease(1);
+}
+
 void AudioReflector::calculateAllReflections() {
-    // only recalculate when we've moved, or if the attributes have changed
+    // swap in the trace we started earlier, once it's done
+    if (_pendingTrace && _pendingTrace->finished.loadAcquire()) {
+        QMutexLocker locker(&_mutex);
+        _currentTrace = _pendingTrace;
+        _pendingTrace.clear();
+        _reflections = _currentTrace->inboundAudiblePoints.size() + _currentTrace->localAudiblePoints.size();
+        _diffusionPathCount = _currentTrace->countDiffusionPaths();
+    }
+    
+    // only one trace runs at a time, the audio keeps using the last one in the meantime
+    if (_pendingTrace) {
+        return;
+    }
+    
+    // only recalculate when we've moved, or if the attributes have changed; an empty result is still a result, so once we
+    // have one we don't keep tracing the same empty scene every frame
     // TODO: what about case where new voxels are added in front of us???
     bool wantHeadOrientation = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingHeadOriented);
     glm::quat orientation = wantHeadOrientation ? _myAvatar->getHead()->getFinalOrientation() : _myAvatar->getOrientation();
     glm::vec3 origin = _myAvatar->getHead()->getPosition();
     glm::vec3 listenerPosition = _myAvatar->getHead()->getPosition();
 
-    bool shouldRecalc = _reflections == 0
+    bool shouldRecalc = !_currentTrace
                             || !isSimilarPosition(origin, _origin) 
                             || !isSimilarOrientation(orientation, _orientation) 
                             || !isSimilarPosition(listenerPosition, _listenerPosition)
                             || haveAttributesChanged();
 
     if (shouldRecalc) {
-        QMutexLocker locker(&_mutex);
-        quint64 start = usecTimestampNow();        
         _origin = origin;
         _orientation = orientation;
         _listenerPosition = listenerPosition;
-        analyzePaths(); // actually does the work
-        quint64 end = usecTimestampNow();
-        const bool wantDebugging = false;
-        if (wantDebugging) {
-            qDebug() << "newCalculateAllReflections() elapsed=" << (end - start);
-        }
+        
+        ReflectionSettings settings;
+        settings.origin = origin;
+        settings.orientation = orientation;
+        settings.listenerPosition = listenerPosition;
+        settings.preDelay = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingPreDelay) ?
+            _preDelay : 0.0f;
+        settings.soundMsPerMeter = _soundMsPerMeter;
+        settings.withDiffusion = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingWithDiffusions);
+        settings.diffusionFanout = _diffusionFanout;
+        SurfaceCharacteristics surface = { getReflectiveRatio(), _absorptionRatio, _diffusionRatio };
+        settings.surface = surface;
+        settings.slightlyRandomSurfaces = Menu::getInstance()->isOptionChecked(
+            MenuOption::AudioSpatialProcessingSlightlyRandomSurfaces);
+        settings.distanceAttenuate = !Menu::getInstance()->isOptionChecked(
+            MenuOption::AudioSpatialProcessingDontDistanceAttenuate);
+        settings.alternateDistanceAttenuate = Menu::getInstance()->isOptionChecked(
+            MenuOption::AudioSpatialProcessingAlternateDistanceAttenuate);
+        settings.distanceAttenuationScalingFactor = _distanceAttenuationScalingFactor;
+        
+        _pendingTrace = QSharedPointer<ReflectionTrace>(new ReflectionTrace(settings));
+        QThreadPool::globalInstance()->start(new ReflectionTracer(_pendingTrace, _voxels));
     }
 }    
 
@@ -493,9 +580,13 @@ void AudioReflector::drawRays() {
     int diffusionNumber = 0;
     
     QMutexLocker locker(&_mutex);
+    
+    if (!_currentTrace) {
+        return;
+    }
 
     // draw the paths for inbound audio
-    foreach(AudioPath* const& path, _inboundAudioPaths) {
+    foreach(AudioPath* const& path, _currentTrace->inboundAudioPaths) {
         // if this is an original reflection, draw it in RED
         if (path->isDiffusion) {
             diffusionNumber++;
@@ -507,7 +598,7 @@ void AudioReflector::drawRays() {
 
     if (Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingProcessLocalAudio)) {
         // draw the paths for local audio
-        foreach(AudioPath* const& path, _localAudioPaths) {
+        foreach(AudioPath* const& path, _currentTrace->localAudioPaths) {
             // if this is an original reflection, draw it in RED
             if (path->isDiffusion) {
                 diffusionNumber++;
@@ -531,22 +622,6 @@ void AudioReflector::drawPath(AudioPath* path, const glm::vec3& originalColor) {
     }
 }
 
-void AudioReflector::clearPaths() {
-    // clear our inbound audio paths
-    foreach(AudioPath* const& path, _inboundAudioPaths) {
-        delete path;
-    }
-    _inboundAudioPaths.clear();
-    _inboundAudiblePoints.clear(); // clear our inbound audible points
-
-    // clear our local audio paths
-    foreach(AudioPath* const& path, _localAudioPaths) {
-        delete path;
-    }
-    _localAudioPaths.clear();
-    _localAudiblePoints.clear(); // clear our local audible points
-}
-
 // Here's how this works: we have an array of AudioPaths, we loop on all of our currently calculating audio 
 // paths, and calculate one ray per path. If that ray doesn't reflect, or reaches a max distance/attenuation, then it
 // is considered finalized.
@@ -554,13 +629,11 @@ void AudioReflector::clearPaths() {
 // attenuation, path length, and delay for the primary path. For surfaces that have diffusion, it will also create
 // fanout number of new paths, those new paths will have an origin of the reflection point, and an initial attenuation
 // of their diffusion ratio. Those new paths will be added to the active audio paths, and be analyzed for the next loop.
-void AudioReflector::analyzePaths() {
-    clearPaths();
-    
+void ReflectionTrace::analyzePaths(VoxelTree* voxels) {
     // add our initial paths
-    glm::vec3 right = glm::normalize(_orientation * IDENTITY_RIGHT);
-    glm::vec3 up = glm::normalize(_orientation * IDENTITY_UP);
-    glm::vec3 front = glm::normalize(_orientation * IDENTITY_FRONT);
+    glm::vec3 right = glm::normalize(settings.orientation * IDENTITY_RIGHT);
+    glm::vec3 up = glm::normalize(settings.orientation * IDENTITY_UP);
+    glm::vec3 front = glm::normalize(settings.orientation * IDENTITY_FRONT);
     glm::vec3 left = -right;
     glm::vec3 down = -up;
     glm::vec3 back = -front;
@@ -575,54 +648,53 @@ void AudioReflector::analyzePaths() {
 
     float initialAttenuation = 1.0f;    
 
-    float preDelay = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingPreDelay) ? _preDelay : 0.0f;
+    float preDelay = settings.preDelay;
+    const glm::vec3& origin = settings.origin;
 
     // NOTE: we're still calculating our initial paths based on the listeners position. But the analysis code has been
     // updated to support individual sound sources (which is how we support diffusion), we can use this new paradigm to
     // add support for individual sound sources, and more directional sound sources    
 
-    addAudioPath(INBOUND_AUDIO, _origin, front, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, right, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, up, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, down, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, back, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, left, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, frontRightUp, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, frontLeftUp, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, backRightUp, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, backLeftUp, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, frontRightDown, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, frontLeftDown, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, backRightDown, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, backLeftDown, initialAttenuation, preDelay);
+    addAudioPath(INBOUND_AUDIO, origin, front, initialAttenuation, preDelay);
+    addAudioPath(INBOUND_AUDIO, origin, right, initialAttenuation, preDelay);
+    addAudioPath(INBOUND_AUDIO, origin, up, initialAttenuation, preDelay);
+    addAudioPath(INBOUND_AUDIO, origin, down, initialAttenuation, preDelay);
+    addAudioPath(INBOUND_AUDIO, origin, back, initialAttenuation, preDelay);
+    addAudioPath(INBOUND_AUDIO, origin, left, initialAttenuation, preDelay);
+    addAudioPath(INBOUND_AUDIO, origin, frontRightUp, initialAttenuation, preDelay);
+    addAudioPath(INBOUND_AUDIO, origin, frontLeftUp, initialAttenuation, preDelay);
+    addAudioPath(INBOUND_AUDIO, origin, backRightUp, initialAttenuation, preDelay);
+    addAudioPath(INBOUND_AUDIO, origin, backLeftUp, initialAttenuation, preDelay);
+    addAudioPath(INBOUND_AUDIO, origin, frontRightDown, initialAttenuation, preDelay);
+    addAudioPath(INBOUND_AUDIO, origin, frontLeftDown, initialAttenuation, preDelay);
+    addAudioPath(INBOUND_AUDIO, origin, backRightDown, initialAttenuation, preDelay);
+    addAudioPath(INBOUND_AUDIO, origin, backLeftDown, initialAttenuation, preDelay);
     
     // the original paths for the local audio are directional to the front of the origin
-    addAudioPath(LOCAL_AUDIO, _origin, front, initialAttenuation, preDelay);
-    addAudioPath(LOCAL_AUDIO, _origin, frontRightUp, initialAttenuation, preDelay);
-    addAudioPath(LOCAL_AUDIO, _origin, frontLeftUp, initialAttenuation, preDelay);
-    addAudioPath(LOCAL_AUDIO, _origin, frontRightDown, initialAttenuation, preDelay);
-    addAudioPath(LOCAL_AUDIO, _origin, frontLeftDown, initialAttenuation, preDelay);
+    addAudioPath(LOCAL_AUDIO, origin, front, initialAttenuation, preDelay);
+    addAudioPath(LOCAL_AUDIO, origin, frontRightUp, initialAttenuation, preDelay);
+    addAudioPath(LOCAL_AUDIO, origin, frontLeftUp, initialAttenuation, preDelay);
+    addAudioPath(LOCAL_AUDIO, origin, frontRightDown, initialAttenuation, preDelay);
+    addAudioPath(LOCAL_AUDIO, origin, frontLeftDown, initialAttenuation, preDelay);
 
     // loop through all our audio paths and keep analyzing them until they complete
     int steps = 0;
-    int acitvePaths = _inboundAudioPaths.size() + _localAudioPaths.size(); // when we start, all paths are active
+    int acitvePaths = inboundAudioPaths.size() + localAudioPaths.size(); // when we start, all paths are active
     while(acitvePaths > 0) {
-        acitvePaths = analyzePathsSingleStep();
+        acitvePaths = analyzePathsSingleStep(voxels);
         steps++;
     }
-    _reflections = _inboundAudiblePoints.size() + _localAudiblePoints.size();
-    _diffusionPathCount = countDiffusionPaths();
 }
 
-int AudioReflector::countDiffusionPaths() {
+int ReflectionTrace::countDiffusionPaths() const {
     int diffusionCount = 0;
     
-    foreach(AudioPath* const& path, _inboundAudioPaths) {
+    foreach(AudioPath* const& path, inboundAudioPaths) {
         if (path->isDiffusion) {
             diffusionCount++;
         }
     }
-    foreach(AudioPath* const& path, _localAudioPaths) {
+    foreach(AudioPath* const& path, localAudioPaths) {
         if (path->isDiffusion) {
             diffusionCount++;
         }
@@ -630,55 +702,66 @@ int AudioReflector::countDiffusionPaths() {
     return diffusionCount;
 }
 
-int AudioReflector::analyzePathsSingleStep() {
-    // iterate all the active sound paths, calculate one step per active path
-    int activePaths = 0;
+int ReflectionTrace::analyzePathsSingleStep(VoxelTree* voxels) {
+    // gather up all the active sound paths, so that the next step of each can be cast together
+    QVector<AudioPath*> activePaths;
 
-    QVector<AudioPath*>* pathsLists[] = { &_inboundAudioPaths, &_localAudioPaths };
+    QVector<AudioPath*>* pathsLists[] = { &inboundAudioPaths, &localAudioPaths };
 
     for(unsigned int i = 0; i < sizeof(pathsLists) / sizeof(pathsLists[0]); i++) {
 
         QVector<AudioPath*>& pathList = *pathsLists[i];
 
         foreach(AudioPath* const& path, pathList) {
+            if (path->finalized) {
+                continue;
+            }
+            if (path->bounceCount > ABSOLUTE_MAXIMUM_BOUNCE_COUNT) {
+                path->finalized = true;
+            } else {
+                activePaths.append(path);
+            }
+        }
+    }
+    
+    int numPaths = activePaths.size();
+    QVector<glm::vec3> starts(numPaths);
+    QVector<glm::vec3> directions(numPaths);
+    for (int i = 0; i < numPaths; i++) {
+        starts[i] = activePaths.at(i)->lastPoint;
+        directions[i] = activePaths.at(i)->lastDirection;
+    }
+    QVector<OctreeElement*> elementsHit(numPaths); // outputs from findRayIntersections
+    QVector<float> distances(numPaths);
+    QVector<BoxFace> faces(numPaths);
+    QVector<bool> hits(numPaths);
     
-            glm::vec3 start = path->lastPoint;
-            glm::vec3 direction = path->lastDirection;
-            OctreeElement* elementHit; // output from findRayIntersection
-            float distance; // output from findRayIntersection
-            BoxFace face; // output from findRayIntersection
+    // we're off the main thread, so we can afford to wait for the lock and get an accurate picture
+    voxels->findRayIntersections(starts.constData(), directions.constData(), numPaths, elementsHit.data(),
+                                 distances.data(), faces.data(), hits.data(), Octree::Lock);
 
-            if (!path->finalized) {
-                activePaths++;
-            
-                if (path->bounceCount > ABSOLUTE_MAXIMUM_BOUNCE_COUNT) {
-                    path->finalized = true;
-                } else if (_voxels->findRayIntersection(start, direction, elementHit, distance, face)) {
-                    // TODO: we need to decide how we want to handle locking on the ray intersection, if we force lock,
-                    // we get an accurate picture, but it could prevent rendering of the voxels. If we trylock (default), 
-                    // we might not get ray intersections where they may exist, but we can't really detect that case...
-                    // add last parameter of Octree::Lock to force locking
-                    handlePathPoint(path, distance, elementHit, face);
-
-                } else {
-                    // If we didn't intersect, but this was a diffusion ray, then we will go ahead and cast a short ray out
-                    // from our last known point, in the last known direction, and leave that sound source hanging there
-                    if (path->isDiffusion) {
-                        const float MINIMUM_RANDOM_DISTANCE = 0.25f;
-                        const float MAXIMUM_RANDOM_DISTANCE = 0.5f;
-                        float distance = randFloatInRange(MINIMUM_RANDOM_DISTANCE, MAXIMUM_RANDOM_DISTANCE);
-                        handlePathPoint(path, distance, NULL, UNKNOWN_FACE);
-                    } else {
-                        path->finalized = true; // if it doesn't intersect, then it is finished
-                    }
-                }
+    for (int i = 0; i < numPaths; i++) {
+        AudioPath* path = activePaths.at(i);
+        if (hits.at(i)) {
+            handlePathPoint(path, distances.at(i), elementsHit.at(i), faces.at(i));
+
+        } else {
+            // If we didn't intersect, but this was a diffusion ray, then we will go ahead and cast a short ray out
+            // from our last known point, in the last known direction, and leave that sound source hanging there
+            if (path->isDiffusion) {
+                const float MINIMUM_RANDOM_DISTANCE = 0.25f;
+                const float MAXIMUM_RANDOM_DISTANCE = 0.5f;
+                float distance = randFloatInRange(MINIMUM_RANDOM_DISTANCE, MAXIMUM_RANDOM_DISTANCE);
+                handlePathPoint(path, distance, NULL, UNKNOWN_FACE);
+            } else {
+                path->finalized = true; // if it doesn't intersect, then it is finished
             }
         }
     }
-    return activePaths;
+    return numPaths;
 }
 
-void AudioReflector::handlePathPoint(AudioPath* path, float distance, OctreeElement* elementHit, BoxFace face) {
+void ReflectionTrace::handlePathPoint(AudioPath* path, float distance, OctreeElement* elementHit, BoxFace face) {
     glm::vec3 start = path->lastPoint;
     glm::vec3 direction = path->lastDirection;
     glm::vec3 end = start + (direction * (distance * SLIGHTLY_SHORT));
@@ -689,10 +772,10 @@ void AudioReflector::handlePathPoint(AudioPath* path, float distance, OctreeElem
 
     pathDistance += glm::distance(start, end);
 
-    float toListenerDistance = glm::distance(end, _listenerPosition);
+    float toListenerDistance = glm::distance(end, settings.listenerPosition);
 
     // adjust our current delay by just the delay from the most recent ray
-    currentDelay += getDelayFromDistance(distance);
+    currentDelay += settings.getDelayFromDistance(distance);
 
     // now we know the current attenuation for the "perfect" reflection case, but we now incorporate
     // our surface materials to determine how much of this ray is absorbed, reflected, and diffused
@@ -701,14 +784,13 @@ void AudioReflector::handlePathPoint(AudioPath* path, float distance, OctreeElem
     float reflectiveAttenuation = currentReflectiveAttenuation * material.reflectiveRatio;
     float totalDiffusionAttenuation = currentReflectiveAttenuation * material.diffusionRatio;
     
-    bool wantDiffusions = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingWithDiffusions);
-    int fanout = wantDiffusions ? _diffusionFanout : 0;
+    int fanout = settings.withDiffusion ? settings.diffusionFanout : 0;
 
     float partialDiffusionAttenuation = fanout < 1 ? 0.0f : totalDiffusionAttenuation / (float)fanout;
 
     // total delay includes the bounce back to listener
-    float totalDelay = currentDelay + getDelayFromDistance(toListenerDistance);
-    float toListenerAttenuation = getDistanceAttenuationCoefficient(toListenerDistance + pathDistance);
+    float totalDelay = currentDelay + settings.getDelayFromDistance(toListenerDistance);
+    float toListenerAttenuation = settings.getDistanceAttenuationCoefficient(toListenerDistance + pathDistance);
 
     // if our resulting partial diffusion attenuation, is still above our minimum attenuation
     // then we add new paths for each diffusion point
@@ -781,7 +863,7 @@ void AudioReflector::handlePathPoint(AudioPath* path, float distance, OctreeElem
         // audio so that it can be adjusted to ear position
         AudiblePoint point = {end, currentDelay, (reflectiveAttenuation + totalDiffusionAttenuation), pathDistance};
 
-        QVector<AudiblePoint>& audiblePoints = path->source == INBOUND_AUDIO ? _inboundAudiblePoints : _localAudiblePoints;
+        QVector<AudiblePoint>& audiblePoints = path->source == INBOUND_AUDIO ? inboundAudiblePoints : localAudiblePoints;
 
         audiblePoints.push_back(point);
     
@@ -823,9 +905,8 @@ void AudioReflector::handlePathPoint(AudioPath* path, float distance, OctreeElem
 // TODO: eventually we will add support for different surface characteristics based on the element
 // that is hit, which is why we pass in the elementHit to this helper function. But for now, all
 // surfaces have the same characteristics
-SurfaceCharacteristics AudioReflector::getSurfaceCharacteristics(OctreeElement* elementHit) {
-    SurfaceCharacteristics result = { getReflectiveRatio(), _absorptionRatio, _diffusionRatio };
-    return result;
+SurfaceCharacteristics ReflectionTrace::getSurfaceCharacteristics(OctreeElement* elementHit) {
+    return settings.surface;
 }
 
 void AudioReflector::setReflectiveRatio(float ratio) { 
@@ -12,7 +12,9 @@
 #ifndef interface_AudioReflector_h
 #define interface_AudioReflector_h
 
+#include <QAtomicInt>
 #include <QMutex>
+#include <QSharedPointer>
 
 #include <VoxelTree.h>
 
@@ -64,6 +66,65 @@ public:
     float diffusionRatio;
 };
 
+/// Everything a trace of the audio paths depends on, gathered up front on the main thread, since the trace itself runs
+/// on the thread pool where the menu and avatar can't be touched.
+class ReflectionSettings {
+public:
+    glm::vec3 origin;
+    glm::quat orientation;
+    glm::vec3 listenerPosition;
+    float preDelay; /// zero unless pre-delay is turned on
+    float soundMsPerMeter;
+    bool withDiffusion;
+    int diffusionFanout;
+    SurfaceCharacteristics surface;
+    bool slightlyRandomSurfaces;
+    bool distanceAttenuate;
+    bool alternateDistanceAttenuate;
+    float distanceAttenuationScalingFactor;
+
+    float getDelayFromDistance(float distance) const { return soundMsPerMeter * distance + preDelay; }
+    float getDistanceAttenuationCoefficient(float distance) const;
+};
+
+/// The audio paths and audible points traced out from one listener position. Once finished, a trace is never modified,
+/// so the audio thread can keep injecting from it while the next one is traced. Listener movement between traces is
+/// already accounted for, since the final leg from each audible point to the ears is worked out at injection.
+class ReflectionTrace {
+public:
+    ReflectionTrace(const ReflectionSettings& settings);
+    ~ReflectionTrace();
+
+    /// follows all of the paths until they die out, casting the next ray of every active path together as one batch
+    void analyzePaths(VoxelTree* voxels);
+
+    int countDiffusionPaths() const;
+
+    ReflectionSettings settings;
+    QVector<AudioPath*> inboundAudioPaths; /// audio paths we're processing for inbound audio
+    QVector<AudiblePoint> inboundAudiblePoints; /// the audible points that have been calculated from the inbound audio paths
+    QVector<AudioPath*> localAudioPaths; /// audio paths we're processing for local audio
+    QVector<AudiblePoint> localAudiblePoints; /// the audible points that have been calculated from the local audio paths
+    QAtomicInt finished; /// set by the thread pool once the trace is complete
+
+private:
+    // disallow copying, the paths are owned
+    ReflectionTrace(const ReflectionTrace& other);
+    ReflectionTrace& operator=(const ReflectionTrace& other);
+
+    // adds a sound source to begin an audio path trace, these can be the initial sound sources with their directional
+    // properties, as well as diffusion sound sources
+    void addAudioPath(AudioSource source, const glm::vec3& origin, const glm::vec3& initialDirection,
+                      float initialAttenuation, float initialDelay, float initialDistance = 0.0f, bool isDiffusion = false);
+
+    int analyzePathsSingleStep(VoxelTree* voxels);
+    void handlePathPoint(AudioPath* path, float distance, OctreeElement* elementHit, BoxFace face);
+    glm::vec3 getFaceNormal(BoxFace face);
+
+    // return the surface characteristics of the element we hit
+    SurfaceCharacteristics getSurfaceCharacteristics(OctreeElement* elementHit = NULL);
+};
+
 class AudioReflector : public QObject {
     Q_OBJECT
 public:
@@ -177,44 +238,29 @@ private:
     glm::vec3 _origin;
     glm::quat _orientation;
     
-    QVector<AudioPath*> _inboundAudioPaths; /// audio paths we're processing for inbound audio
-    QVector<AudiblePoint> _inboundAudiblePoints; /// the audible points that have been calculated from the inbound audio paths
+    QSharedPointer<ReflectionTrace> _currentTrace; /// the latest finished trace, whose audible points we inject
+    QSharedPointer<ReflectionTrace> _pendingTrace; /// the trace running on the thread pool, if any
+
     QMap<float, float> _inboundAudioDelays; /// delay times for currently injected audio points
     QVector<float> _inboundEchoesSuppressed; /// delay times for currently injected audio points
     int _inboundEchoesCount;
     int _inboundEchoesSuppressedCount;
 
-    QVector<AudioPath*> _localAudioPaths; /// audio paths we're processing for local audio
-    QVector<AudiblePoint> _localAudiblePoints; /// the audible points that have been calculated from the local audio paths
     QMap<float, float> _localAudioDelays; /// delay times for currently injected audio points
     QVector<float> _localEchoesSuppressed; /// delay times for currently injected audio points
     int _localEchoesCount;
     int _localEchoesSuppressedCount;
 
-    // adds a sound source to begin an audio path trace, these can be the initial sound sources with their directional properties,
-    // as well as diffusion sound sources
-    void addAudioPath(AudioSource source, const glm::vec3& origin, const glm::vec3& initialDirection, float initialAttenuation, 
-                            float initialDelay, float initialDistance = 0.0f, bool isDiffusion = false);
-    
-    // helper that handles audioPath analysis
-    int analyzePathsSingleStep();
-    void handlePathPoint(AudioPath* path, float distance, OctreeElement* elementHit, BoxFace face);
-    void clearPaths();
-    void analyzePaths();
     void drawRays();
     void drawPath(AudioPath* path, const glm::vec3& originalColor);
+    
+    // picks up a finished trace, and starts a new one on the thread pool when we've moved or the attributes have changed
     void calculateAllReflections();
-    int countDiffusionPaths();
-    glm::vec3 getFaceNormal(BoxFace face);
     void identifyAudioSources();
 
     void injectAudiblePoint(AudioSource source, const AudiblePoint& audiblePoint, const QByteArray& samples, unsigned int sampleTime, int sampleRate);
     void echoAudio(AudioSource source, unsigned int sampleTime, const QByteArray& samples, const QAudioFormat& format);
     
-    // return the surface characteristics of the element we hit
-    SurfaceCharacteristics getSurfaceCharacteristics(OctreeElement* elementHit = NULL);
-    
-    
     QMutex _mutex;
 
     float _preDelay;
@@ -262,7 +262,12 @@ MetavoxelClient::~MetavoxelClient() {
 
 static MetavoxelLOD getLOD() {
     const float FIXED_LOD_THRESHOLD = 0.01f;
-    return MetavoxelLOD(Application::getInstance()->getCamera()->getPosition(), FIXED_LOD_THRESHOLD);
+    
+    // snap the position to a grid, so that the server can share the encoding of our deltas with viewers close by
+    const float LOD_POSITION_QUANTUM = 0.5f;
+    glm::vec3 position = glm::floor(Application::getInstance()->getCamera()->getPosition() / LOD_POSITION_QUANTUM +
+        glm::vec3(0.5f, 0.5f, 0.5f)) * LOD_POSITION_QUANTUM;
+    return MetavoxelLOD(position, FIXED_LOD_THRESHOLD);
 }
 
 void MetavoxelClient::guide(MetavoxelVisitor& visitor) {
@@ -0,0 +1,405 @@
+//
+//  AudioCodec.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+#include <limits>
+
+#include "AudioCodec.h"
+
+const int NEAR_LOSSLESS_QUANTIZATION_BITS = 2;
+
+// Rice frames start with a byte holding the PCM fallback flag and the channel count, then the sample count
+const quint8 RICE_FRAME_PCM_FALLBACK_FLAG = 1;
+const int NUM_BYTES_RICE_FRAME_HEADER = sizeof(quint8) + sizeof(quint16);
+
+const int NUM_RICE_PARAMETER_BITS = 5;
+const int MAX_RICE_PARAMETER = 18;
+
+// quotients this large are written as an escape followed by the raw residual, second order residuals of 16-bit samples
+// zigzag to fewer than 18 bits
+const int RICE_ESCAPE_QUOTIENT = 32;
+const int NUM_RAW_RESIDUAL_BITS = 18;
+
+const int MAX_CONCEALED_FRAMES = 4;
+const float CONCEALMENT_FADE_RATIO = 0.5f;
+
+AudioCodec* AudioCodec::create(AudioCodecID_t codecID) {
+    switch (codecID) {
+        case AudioCodecID::PCM:
+            return new PCMAudioCodec();
+        case AudioCodecID::Lossless:
+            return new RiceAudioCodec(codecID, 0);
+        case AudioCodecID::NearLossless:
+            return new RiceAudioCodec(codecID, NEAR_LOSSLESS_QUANTIZATION_BITS);
+        default:
+            return NULL;
+    }
+}
+
+AudioCodec::~AudioCodec() {
+}
+
+void PCMAudioCodec::encodeFrame(const int16_t* samples, int numSamples, int numChannels, QByteArray& destination) {
+    destination.append(reinterpret_cast<const char*>(samples), numSamples * sizeof(int16_t));
+}
+
+int PCMAudioCodec::decodeFrame(const char* data, int size, QVector<int16_t>& destination) {
+    // a PCM frame is the rest of the packet
+    int numSamples = size / sizeof(int16_t);
+    int offset = destination.size();
+    destination.resize(offset + numSamples);
+    memcpy(destination.data() + offset, data, numSamples * sizeof(int16_t));
+    return numSamples * sizeof(int16_t);
+}
+
+namespace {
+
+class BitWriter {
+public:
+    BitWriter(QByteArray& destination) : _destination(destination), _bits(0), _numBits(0) { }
+
+    void write(quint32 value, int numBits) {
+        _bits = (_bits << numBits) | (value & ((1ULL << numBits) - 1));
+        _numBits += numBits;
+        while (_numBits >= 8) {
+            _numBits -= 8;
+            _destination.append((char)(_bits >> _numBits));
+        }
+    }
+
+    void writeOnes(int count) {
+        for (; count > 16; count -= 16) {
+            write(0xFFFF, 16);
+        }
+        write((1U << count) - 1, count);
+    }
+
+    void flush() {
+        if (_numBits > 0) {
+            _destination.append((char)(_bits << (8 - _numBits)));
+            _numBits = 0;
+        }
+    }
+
+private:
+    QByteArray& _destination;
+    quint64 _bits;
+    int _numBits;
+};
+
+class BitReader {
+public:
+    BitReader(const char* data, int size) :
+        _data(reinterpret_cast<const uchar*>(data)), _size(size), _offset(0), _bits(0), _numBits(0) { }
+
+    bool read(int numBits, quint32& value) {
+        while (_numBits < numBits) {
+            if (_offset == _size) {
+                return false;
+            }
+            _bits = (_bits << 8) | _data[_offset++];
+            _numBits += 8;
+        }
+        _numBits -= numBits;
+        value = (quint32)(_bits >> _numBits) & (quint32)((1ULL << numBits) - 1);
+        return true;
+    }
+
+    int getBytesRead() const { return _offset; }
+
+private:
+    const uchar* _data;
+    int _size;
+    int _offset;
+    quint64 _bits;
+    int _numBits;
+};
+
+}
+
+RiceAudioCodec::RiceAudioCodec(AudioCodecID_t codecID, int quantizationBits) :
+    _codecID(codecID),
+    _quantizationBits(quantizationBits),
+    _residuals()
+{
+}
+
+void RiceAudioCodec::encodeFrame(const int16_t* samples, int numSamples, int numChannels, QByteArray& destination) {
+    if (numChannels < 1 || numChannels > std::numeric_limits<qint8>::max() || numSamples % numChannels != 0) {
+        numChannels = 1;
+    }
+    int numChannelSamples = numSamples / numChannels;
+    int headerOffset = destination.size();
+
+    quint16 numSamplesHeader = numSamples;
+    destination.append((char)(numChannels << 1));
+    destination.append(reinterpret_cast<const char*>(&numSamplesHeader), sizeof(numSamplesHeader));
+
+    // compute the zigzagged prediction residuals of each channel, one channel after the other
+    _residuals.resize(numSamples);
+    int roundingOffset = _quantizationBits > 0 ? (1 << (_quantizationBits - 1)) : 0;
+    for (int channel = 0; channel < numChannels; channel++) {
+        quint32* residuals = _residuals.data() + channel * numChannelSamples;
+        int previous = 0, secondPrevious = 0;
+        for (int i = 0; i < numChannelSamples; i++) {
+            int quantized = (samples[i * numChannels + channel] + roundingOffset) >> _quantizationBits;
+            int prediction = (i == 0) ? 0 : (i == 1 ? previous : 2 * previous - secondPrevious);
+            int residual = quantized - prediction;
+            residuals[i] = residual >= 0 ? (quint32)residual << 1 : ((quint32)(-residual) << 1) - 1;
+            secondPrevious = previous;
+            previous = quantized;
+        }
+    }
+
+    BitWriter writer(destination);
+    for (int channel = 0; channel < numChannels; channel++) {
+        const quint32* residuals = _residuals.constData() + channel * numChannelSamples;
+
+        // pick the Rice parameter closest to the mean residual
+        quint64 residualSum = 0;
+        for (int i = 0; i < numChannelSamples; i++) {
+            residualSum += residuals[i];
+        }
+        quint64 meanResidual = numChannelSamples > 0 ? residualSum / numChannelSamples : 0;
+        int riceParameter = 0;
+        while (riceParameter < MAX_RICE_PARAMETER && (2ULL << riceParameter) <= meanResidual) {
+            riceParameter++;
+        }
+        writer.write(riceParameter, NUM_RICE_PARAMETER_BITS);
+
+        for (int i = 0; i < numChannelSamples; i++) {
+            quint32 quotient = residuals[i] >> riceParameter;
+            if (quotient < (quint32)RICE_ESCAPE_QUOTIENT) {
+                writer.writeOnes(quotient);
+                writer.write(0, 1);
+                if (riceParameter > 0) {
+                    writer.write(residuals[i], riceParameter);
+                }
+            } else {
+                writer.writeOnes(RICE_ESCAPE_QUOTIENT);
+                writer.write(residuals[i], NUM_RAW_RESIDUAL_BITS);
+            }
+        }
+    }
+    writer.flush();
+
+    if (destination.size() - headerOffset - NUM_BYTES_RICE_FRAME_HEADER > numSamples * (int)sizeof(int16_t)) {
+        // this one didn't compress, send it as PCM
+        destination.resize(headerOffset + NUM_BYTES_RICE_FRAME_HEADER);
+        destination[headerOffset] = (char)((numChannels << 1) | RICE_FRAME_PCM_FALLBACK_FLAG);
+        destination.append(reinterpret_cast<const char*>(samples), numSamples * sizeof(int16_t));
+    }
+}
+
+int RiceAudioCodec::decodeFrame(const char* data, int size, QVector<int16_t>& destination) {
+    if (size < NUM_BYTES_RICE_FRAME_HEADER) {
+        return -1;
+    }
+    quint8 flags = data[0];
+    int numChannels = flags >> 1;
+    quint16 numSamples;
+    memcpy(&numSamples, data + sizeof(quint8), sizeof(numSamples));
+    data += NUM_BYTES_RICE_FRAME_HEADER;
+    size -= NUM_BYTES_RICE_FRAME_HEADER;
+
+    if (numChannels == 0 || numSamples % numChannels != 0) {
+        return -1;
+    }
+    int offset = destination.size();
+
+    if (flags & RICE_FRAME_PCM_FALLBACK_FLAG) {
+        if (size < (int)(numSamples * sizeof(int16_t))) {
+            return -1;
+        }
+        destination.resize(offset + numSamples);
+        memcpy(destination.data() + offset, data, numSamples * sizeof(int16_t));
+        return NUM_BYTES_RICE_FRAME_HEADER + numSamples * sizeof(int16_t);
+    }
+
+    destination.resize(offset + numSamples);
+    int16_t* samples = destination.data() + offset;
+    int numChannelSamples = numSamples / numChannels;
+
+    BitReader reader(data, size);
+    for (int channel = 0; channel < numChannels; channel++) {
+        quint32 riceParameter;
+        if (!reader.read(NUM_RICE_PARAMETER_BITS, riceParameter) || riceParameter > (quint32)MAX_RICE_PARAMETER) {
+            destination.resize(offset);
+            return -1;
+        }
+        int previous = 0, secondPrevious = 0;
+        for (int i = 0; i < numChannelSamples; i++) {
+            quint32 quotient = 0, bit = 1, residual = 0;
+            while (quotient < (quint32)RICE_ESCAPE_QUOTIENT) {
+                if (!reader.read(1, bit)) {
+                    destination.resize(offset);
+                    return -1;
+                }
+                if (bit == 0) {
+                    break;
+                }
+                quotient++;
+            }
+            bool isComplete;
+            if (quotient == (quint32)RICE_ESCAPE_QUOTIENT) {
+                isComplete = reader.read(NUM_RAW_RESIDUAL_BITS, residual);
+            } else {
+                quint32 remainder = 0;
+                isComplete = riceParameter == 0 || reader.read(riceParameter, remainder);
+                residual = (quotient << riceParameter) | remainder;
+            }
+            if (!isComplete) {
+                destination.resize(offset);
+                return -1;
+            }
+            int signedResidual = (residual & 1) ? -(int)((residual + 1) >> 1) : (int)(residual >> 1);
+            int prediction = (i == 0) ? 0 : (i == 1 ? previous : 2 * previous - secondPrevious);
+            int quantized = prediction + signedResidual;
+
+            int sample = quantized << _quantizationBits;
+            samples[i * numChannels + channel] = (int16_t)qBound((int)std::numeric_limits<int16_t>::min(), sample,
+                                                                 (int)std::numeric_limits<int16_t>::max());
+            secondPrevious = previous;
+            previous = quantized;
+        }
+    }
+    return NUM_BYTES_RICE_FRAME_HEADER + reader.getBytesRead();
+}
+
+AudioStreamEncoder::AudioStreamEncoder() :
+    _sequence(0)
+{
+    for (int i = 0; i < AudioCodecID::NUM_CODECS; i++) {
+        _codecs[i] = NULL;
+    }
+}
+
+AudioStreamEncoder::~AudioStreamEncoder() {
+    for (int i = 0; i < AudioCodecID::NUM_CODECS; i++) {
+        delete _codecs[i];
+    }
+}
+
+void AudioStreamEncoder::writeStreamHeader(AudioCodecID_t codecID, QByteArray& destination) {
+    destination.append((char)codecID);
+    destination.append(reinterpret_cast<const char*>(&_sequence), sizeof(_sequence));
+    _sequence++;
+}
+
+void AudioStreamEncoder::encodeFrame(AudioCodecID_t codecID, const int16_t* samples, int numSamples, int numChannels,
+                                     QByteArray& destination) {
+    if (codecID >= AudioCodecID::NUM_CODECS) {
+        codecID = AudioCodecID::PCM;
+    }
+    if (!_codecs[codecID]) {
+        _codecs[codecID] = AudioCodec::create(codecID);
+    }
+    writeStreamHeader(codecID, destination);
+    _codecs[codecID]->encodeFrame(samples, numSamples, numChannels, destination);
+}
+
+void AudioStreamEncoder::writeSilentFrameHeader(AudioCodecID_t codecID, QByteArray& destination) {
+    writeStreamHeader(codecID, destination);
+}
+
+AudioStreamDecoder::AudioStreamDecoder() :
+    _lastCodecID(AudioCodecID::PCM),
+    _hasSequence(false),
+    _expectedSequence(0),
+    _lastFrame(),
+    _numConcealedFrames(0)
+{
+    for (int i = 0; i < AudioCodecID::NUM_CODECS; i++) {
+        _codecs[i] = NULL;
+    }
+}
+
+AudioStreamDecoder::~AudioStreamDecoder() {
+    for (int i = 0; i < AudioCodecID::NUM_CODECS; i++) {
+        delete _codecs[i];
+    }
+}
+
+void AudioStreamDecoder::reset() {
+    _hasSequence = false;
+    _lastFrame.clear();
+}
+
+int AudioStreamDecoder::readStreamHeader(const char* data, AudioCodecID_t& codecID) {
+    codecID = data[0];
+    quint16 sequence;
+    memcpy(&sequence, data + sizeof(AudioCodecID_t), sizeof(sequence));
+
+    int numLostFrames = 0;
+    if (_hasSequence) {
+        quint16 sequenceGap = sequence - _expectedSequence;
+        if (sequenceGap > std::numeric_limits<quint16>::max() / 2) {
+            // this is older than the last frame we read
+            return -1;
+        }
+        numLostFrames = sequenceGap;
+    }
+    _hasSequence = true;
+    _expectedSequence = sequence + 1;
+    _lastCodecID = codecID;
+    return numLostFrames;
+}
+
+int AudioStreamDecoder::decodeFrame(const char* data, int size, QVector<int16_t>& destination) {
+    if (size < AudioStreamEncoder::NUM_BYTES_STREAM_HEADER) {
+        return -1;
+    }
+    AudioCodecID_t codecID;
+    int numLostFrames = readStreamHeader(data, codecID);
+    if (numLostFrames < 0) {
+        // drop the late frame, the slot it was meant for has already been played or concealed
+        return size;
+    }
+    if (codecID >= AudioCodecID::NUM_CODECS) {
+        return -1;
+    }
+    if (!_codecs[codecID]) {
+        _codecs[codecID] = AudioCodec::create(codecID);
+    }
+
+    // fill in for a short run of lost frames with fading copies of the last one, longer gaps are left to starve
+    if (numLostFrames <= MAX_CONCEALED_FRAMES && !_lastFrame.isEmpty()) {
+        float gain = 1.0f;
+        for (int i = 0; i < numLostFrames; i++) {
+            gain *= CONCEALMENT_FADE_RATIO;
+            for (int s = 0; s < _lastFrame.size(); s++) {
+                destination.append((int16_t)(_lastFrame[s] * gain));
+            }
+            _numConcealedFrames++;
+        }
+    }
+
+    int offset = destination.size();
+    int bytesRead = _codecs[codecID]->decodeFrame(data + AudioStreamEncoder::NUM_BYTES_STREAM_HEADER,
+                                                  size - AudioStreamEncoder::NUM_BYTES_STREAM_HEADER, destination);
+    if (bytesRead < 0) {
+        _lastFrame.clear();
+        return -1;
+    }
+    _lastFrame = destination.mid(offset);
+    return AudioStreamEncoder::NUM_BYTES_STREAM_HEADER + bytesRead;
+}
+
+int AudioStreamDecoder::readSilentFrameHeader(const char* data, int size) {
+    if (size < AudioStreamEncoder::NUM_BYTES_STREAM_HEADER) {
+        return -1;
+    }
+    AudioCodecID_t codecID;
+    readStreamHeader(data, codecID);
+
+    // there is nothing to repeat after silence
+    _lastFrame.clear();
+    return AudioStreamEncoder::NUM_BYTES_STREAM_HEADER;
+}
@@ -0,0 +1,131 @@
+//
+//  AudioCodec.h
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Frame codecs for the audio carried between clients and the audio-mixer.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioCodec_h
+#define hifi_AudioCodec_h
+
+#include <stdint.h>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+
+typedef quint8 AudioCodecID_t;
+namespace AudioCodecID {
+    const AudioCodecID_t PCM = 0;
+    const AudioCodecID_t Lossless = 1;
+    const AudioCodecID_t NearLossless = 2;
+    const AudioCodecID_t NUM_CODECS = 3;
+}
+
+/// Encodes and decodes single frames of interleaved 16-bit audio. Every frame is self-contained, so that a lost packet
+/// never affects the decoding of the ones after it.
+class AudioCodec {
+public:
+    /// Returns a new instance of the codec with the given ID, or NULL if we don't know it.
+    static AudioCodec* create(AudioCodecID_t codecID);
+
+    virtual ~AudioCodec();
+
+    virtual AudioCodecID_t getID() const = 0;
+
+    /// Appends one encoded frame of interleaved samples to the destination.
+    virtual void encodeFrame(const int16_t* samples, int numSamples, int numChannels, QByteArray& destination) = 0;
+
+    /// Decodes one frame, appending the samples to the destination.
+    /// \return the number of bytes read, or -1 if the frame is corrupt
+    virtual int decodeFrame(const char* data, int size, QVector<int16_t>& destination) = 0;
+};
+
+/// Raw 16-bit PCM, what every client and the mixer sent before there were codecs.
+class PCMAudioCodec : public AudioCodec {
+public:
+    AudioCodecID_t getID() const { return AudioCodecID::PCM; }
+
+    void encodeFrame(const int16_t* samples, int numSamples, int numChannels, QByteArray& destination);
+    int decodeFrame(const char* data, int size, QVector<int16_t>& destination);
+};
+
+/// Second order fixed prediction of each channel with Rice coded residuals, in the manner of Shorten and FLAC. Frames
+/// that would code larger than PCM (white noise) fall back to PCM. With quantization bits the low bits of each sample are
+/// rounded away before prediction, trading a small rise in the noise floor for a good deal fewer bits.
+class RiceAudioCodec : public AudioCodec {
+public:
+    RiceAudioCodec(AudioCodecID_t codecID, int quantizationBits);
+
+    AudioCodecID_t getID() const { return _codecID; }
+
+    void encodeFrame(const int16_t* samples, int numSamples, int numChannels, QByteArray& destination);
+    int decodeFrame(const char* data, int size, QVector<int16_t>& destination);
+
+private:
+    AudioCodecID_t _codecID;
+    int _quantizationBits;
+    QVector<quint32> _residuals;
+};
+
+/// Writes the codec and sequence header in front of each frame a client or the mixer sends.
+class AudioStreamEncoder {
+public:
+    static const int NUM_BYTES_STREAM_HEADER = sizeof(AudioCodecID_t) + sizeof(quint16);
+
+    AudioStreamEncoder();
+    ~AudioStreamEncoder();
+
+    /// Appends the stream header and an encoded frame to the destination.
+    void encodeFrame(AudioCodecID_t codecID, const int16_t* samples, int numSamples, int numChannels,
+                     QByteArray& destination);
+
+    /// Appends the stream header for a frame of silence, which takes a sequence number like any other.
+    void writeSilentFrameHeader(AudioCodecID_t codecID, QByteArray& destination);
+
+private:
+    void writeStreamHeader(AudioCodecID_t codecID, QByteArray& destination);
+
+    AudioCodec* _codecs[AudioCodecID::NUM_CODECS];
+    quint16 _sequence;
+};
+
+/// Reads the frames written by an AudioStreamEncoder, concealing frames lost along the way by repeating the last one we
+/// decoded with a fade out.
+class AudioStreamDecoder {
+public:
+    AudioStreamDecoder();
+    ~AudioStreamDecoder();
+
+    void reset();
+
+    /// Decodes the frame following the stream header, preceded by any concealment frames, into the destination.
+    /// \return the number of bytes read, or -1 if the frame is corrupt or uses a codec we don't have
+    int decodeFrame(const char* data, int size, QVector<int16_t>& destination);
+
+    /// Reads the stream header of a silent frame.
+    /// \return the number of bytes read, or -1 if there was no header
+    int readSilentFrameHeader(const char* data, int size);
+
+    /// Returns the codec used by the last frame we read, which is the one the sender would like to receive in.
+    AudioCodecID_t getLastCodecID() const { return _lastCodecID; }
+
+    int getNumConcealedFrames() const { return _numConcealedFrames; }
+
+private:
+    /// Returns the number of frames lost before this one, or -1 if this frame is late and should be dropped.
+    int readStreamHeader(const char* data, AudioCodecID_t& codecID);
+
+    AudioCodec* _codecs[AudioCodecID::NUM_CODECS];
+    AudioCodecID_t _lastCodecID;
+    bool _hasSequence;
+    quint16 _expectedSequence;
+    QVector<int16_t> _lastFrame;
+    int _numConcealedFrames;
+};
+
+#endif // hifi_AudioCodec_h
@@ -17,19 +17,23 @@
 #include <UUID.h>
 
 #include "AbstractAudioInterface.h"
-#include "AudioRingBuffer.h"
+#include "AudioInjectorScheduler.h"
 
 #include "AudioInjector.h"
 
 AudioInjector::AudioInjector(QObject* parent) :
-    QObject(parent)
+    QObject(parent),
+    _sound(NULL),
+    _options(),
+    _shouldStop(false)
 {
     
 }
 
 AudioInjector::AudioInjector(Sound* sound, const AudioInjectorOptions& injectorOptions) :
     _sound(sound),
-    _options(injectorOptions)
+    _options(injectorOptions),
+    _shouldStop(false)
 {
     
 }
@@ -51,8 +55,6 @@ void AudioInjector::injectAudio() {
             
         }
         
-        NodeList* nodeList = NodeList::getInstance();
-        
         // setup the packet for injected audio
         QByteArray injectAudioPacket = byteArrayWithPopulatedHeader(PacketTypeInjectAudio);
         QDataStream packetStream(&injectAudioPacket, QIODevice::Append);
@@ -77,46 +79,9 @@ void AudioInjector::injectAudio() {
         quint8 volume = MAX_INJECTOR_VOLUME * _options.getVolume();
         packetStream << volume;
         
-        QElapsedTimer timer;
-        timer.start();
-        int nextFrame = 0;
-        
-        int currentSendPosition = 0;
-        
-        int numPreAudioDataBytes = injectAudioPacket.size();
-        
-        // loop to send off our audio in NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL byte chunks
-        while (currentSendPosition < soundByteArray.size() && !_shouldStop) {
-            
-            int bytesToCopy = std::min(NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL,
-                                       soundByteArray.size() - currentSendPosition);
-            
-            // resize the QByteArray to the right size
-            injectAudioPacket.resize(numPreAudioDataBytes + bytesToCopy);
-            
-            // copy the next NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL bytes to the packet
-            memcpy(injectAudioPacket.data() + numPreAudioDataBytes, soundByteArray.data() + currentSendPosition, bytesToCopy);
-            
-            // grab our audio mixer from the NodeList, if it exists
-            SharedNodePointer audioMixer = nodeList->soloNodeOfType(NodeType::AudioMixer);
-            
-            // send off this audio packet
-            nodeList->writeDatagram(injectAudioPacket, audioMixer);
-            
-            currentSendPosition += bytesToCopy;
-            
-            // send two packets before the first sleep so the mixer can start playback right away
-            
-            if (currentSendPosition != bytesToCopy && currentSendPosition < soundByteArray.size()) {
-                // not the first packet and not done
-                // sleep for the appropriate time
-                int usecToSleep = (++nextFrame * BUFFER_SEND_INTERVAL_USECS) - timer.nsecsElapsed() / 1000;
-                
-                if (usecToSleep > 0) {
-                    usleep(usecToSleep);
-                }
-            }
-        }
+        // the scheduler sends the frames from here on, and lets us know when it's done
+        AudioInjectorScheduler::getInstance().addInjection(this, injectAudioPacket, soundByteArray);
+        return;
     }
     
     emit finished();
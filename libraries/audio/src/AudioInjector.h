@@ -13,7 +13,6 @@
 #define hifi_AudioInjector_h
 
 #include <QtCore/QObject>
-#include <QtCore/QThread>
 
 #include <glm/glm.hpp>
 #include <glm/gtx/quaternion.hpp>
@@ -26,7 +25,10 @@ class AudioInjector : public QObject {
 public:
     AudioInjector(QObject* parent);
     AudioInjector(Sound* sound, const AudioInjectorOptions& injectorOptions);
+    
+    bool isStopped() const { return _shouldStop; }
 public slots:
+    /// Hands the sound to the AudioInjectorScheduler, which sends it to the audio-mixer and emits finished when done.
     void injectAudio();
     void stop() { _shouldStop = true; }
 signals:
@@ -34,7 +36,7 @@ signals:
 private:
     Sound* _sound;
     AudioInjectorOptions _options;
-    bool _shouldStop;
+    volatile bool _shouldStop;
 };
 
 Q_DECLARE_METATYPE(AudioInjector*)
@@ -0,0 +1,141 @@
+//
+//  AudioInjectorScheduler.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QMutexLocker>
+
+#include <NodeList.h>
+#include <SharedUtil.h>
+
+#include "AudioInjector.h"
+#include "AudioRingBuffer.h"
+
+#include "AudioInjectorScheduler.h"
+
+AudioInjectorScheduler& AudioInjectorScheduler::getInstance() {
+    static AudioInjectorScheduler sharedInstance;
+    return sharedInstance;
+}
+
+AudioInjectorScheduler::AudioInjectorScheduler() :
+    _thread(),
+    _timer(NULL),
+    _pendingInjectionsMutex(),
+    _pendingInjections(),
+    _injections(),
+    _numActiveInjections(0),
+    _timeline(),
+    _nextFrameUsecs(0),
+    _sleepJitter()
+{
+    _timer = new QTimer(this);
+    _timer->setSingleShot(true);
+    _timer->setTimerType(Qt::PreciseTimer);
+    connect(_timer, &QTimer::timeout, this, &AudioInjectorScheduler::sendFrames);
+
+    moveToThread(&_thread);
+    _thread.start();
+
+    _timeline.start();
+}
+
+AudioInjectorScheduler::~AudioInjectorScheduler() {
+    _thread.quit();
+    _thread.wait();
+}
+
+void AudioInjectorScheduler::addInjection(AudioInjector* injector, const QByteArray& packetHeader,
+                                          const QByteArray& sound) {
+    Injection injection;
+    injection.injector = injector;
+    injection.packet = packetHeader;
+    injection.numPreAudioDataBytes = packetHeader.size();
+    injection.sound = sound;
+    injection.sendPosition = 0;
+
+    {
+        QMutexLocker locker(&_pendingInjectionsMutex);
+        _pendingInjections.append(injection);
+    }
+    _numActiveInjections.fetchAndAddRelaxed(1);
+
+    QMetaObject::invokeMethod(this, "startSending", Qt::QueuedConnection);
+}
+
+void AudioInjectorScheduler::addStats(QJsonObject& statsObject) const {
+    statsObject["active_injections"] = getNumActiveInjections();
+    _sleepJitter.addToJSONObject(statsObject, "injector_sleep_jitter_usecs");
+}
+
+void AudioInjectorScheduler::startSending() {
+    if (!_timer->isActive()) {
+        // nothing was playing, start a fresh timeline now
+        _nextFrameUsecs = _timeline.nsecsElapsed() / 1000;
+        sendFrames();
+    }
+    // otherwise the new injections are picked up on the next frame
+}
+
+void AudioInjectorScheduler::sendFrames() {
+    {
+        QMutexLocker locker(&_pendingInjectionsMutex);
+        _injections.append(_pendingInjections);
+        _pendingInjections.clear();
+    }
+    if (_injections.isEmpty()) {
+        return;
+    }
+
+    qint64 now = _timeline.nsecsElapsed() / 1000;
+    qint64 usecsLate = qMax(now - _nextFrameUsecs, (qint64)0);
+    _sleepJitter.record(usecsLate);
+
+    // if we woke more than a frame late, send the frames we missed along with this one
+    int numFramesDue = 1 + usecsLate / BUFFER_SEND_INTERVAL_USECS;
+
+    NodeList* nodeList = NodeList::getInstance();
+    SharedNodePointer audioMixer = nodeList->soloNodeOfType(NodeType::AudioMixer);
+
+    for (int i = 0; i < _injections.size(); ) {
+        Injection& injection = _injections[i];
+
+        // send two packets up front so the mixer can start playback right away
+        int numFramesToSend = (injection.sendPosition == 0) ? numFramesDue + 1 : numFramesDue;
+
+        for (int frame = 0; frame < numFramesToSend && injection.sendPosition < injection.sound.size()
+                && !injection.injector->isStopped(); frame++) {
+            int bytesToCopy = std::min(NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL,
+                                       injection.sound.size() - injection.sendPosition);
+
+            injection.packet.resize(injection.numPreAudioDataBytes + bytesToCopy);
+            memcpy(injection.packet.data() + injection.numPreAudioDataBytes,
+                   injection.sound.constData() + injection.sendPosition, bytesToCopy);
+
+            nodeList->writeDatagram(injection.packet, audioMixer);
+
+            injection.sendPosition += bytesToCopy;
+        }
+
+        if (injection.sendPosition >= injection.sound.size() || injection.injector->isStopped()) {
+            emit injection.injector->finished();
+            _injections.removeAt(i);
+            _numActiveInjections.fetchAndAddRelaxed(-1);
+        } else {
+            i++;
+        }
+    }
+
+    _nextFrameUsecs += numFramesDue * BUFFER_SEND_INTERVAL_USECS;
+
+    if (!_injections.isEmpty()) {
+        // round up so that we never wake before the frame is due
+        qint64 usecsToNextFrame = qMax(_nextFrameUsecs - _timeline.nsecsElapsed() / 1000, (qint64)0);
+        _timer->start((int)((usecsToNextFrame + USECS_PER_MSEC - 1) / USECS_PER_MSEC));
+    }
+}
@@ -0,0 +1,80 @@
+//
+//  AudioInjectorScheduler.h
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Sends the frames of every active AudioInjector on one shared timeline.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioInjectorScheduler_h
+#define hifi_AudioInjectorScheduler_h
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonObject>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+
+#include <Histogram.h>
+
+class AudioInjector;
+
+/// Owns all active injections and sends one frame of each per BUFFER_SEND_INTERVAL_USECS from a single thread, instead
+/// of each injector sleeping on a thread of its own. Frames missed because the thread woke late are caught up in the
+/// same pass, so injections never drift from each other or from the timeline.
+class AudioInjectorScheduler : public QObject {
+    Q_OBJECT
+public:
+    static AudioInjectorScheduler& getInstance();
+
+    ~AudioInjectorScheduler();
+
+    /// Starts sending the sound in frames, each following the given packet header. The injector's finished signal is
+    /// emitted from the scheduler thread once the last frame is out or the injector is stopped. Thread-safe.
+    void addInjection(AudioInjector* injector, const QByteArray& packetHeader, const QByteArray& sound);
+
+    /// Returns the thread injections are sent from, which has an event loop that injectors can live in.
+    QThread* getThread() { return &_thread; }
+
+    int getNumActiveInjections() const { return _numActiveInjections.load(); }
+
+    /// Adds the number of active injections and how late (in usecs) the thread woke for each frame to the stats object.
+    void addStats(QJsonObject& statsObject) const;
+    void resetStats() { _sleepJitter.reset(); }
+
+private slots:
+    void startSending();
+    void sendFrames();
+
+private:
+    AudioInjectorScheduler();
+
+    class Injection {
+    public:
+        AudioInjector* injector;
+        QByteArray packet;
+        int numPreAudioDataBytes;
+        QByteArray sound;
+        int sendPosition;
+    };
+
+    QThread _thread;
+    QTimer* _timer;
+
+    QMutex _pendingInjectionsMutex;
+    QList<Injection> _pendingInjections;
+    QList<Injection> _injections;
+    QAtomicInt _numActiveInjections;
+
+    QElapsedTimer _timeline;
+    qint64 _nextFrameUsecs;
+    Histogram _sleepJitter;
+};
+
+#endif // hifi_AudioInjectorScheduler_h
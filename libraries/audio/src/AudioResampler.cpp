@@ -0,0 +1,213 @@
+//
+//  AudioResampler.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+#include <limits>
+#include <math.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define HIFI_RESAMPLER_SSE
+#endif
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QPair>
+
+#include "AudioResampler.h"
+
+// filter length, in input samples, when the output rate is at least the input rate; downsampling stretches it by
+// the decimation ratio so that the filter spans the same time at the lower cutoff
+const int BASE_NUM_TAPS = 32;
+
+// fraction of the lower Nyquist frequency that the passband extends to
+const float CUTOFF_ROLLOFF = 0.9f;
+
+const float PI = 3.14159265358979f;
+
+static int greatestCommonDivisor(int a, int b) {
+    while (b != 0) {
+        int remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+    return a;
+}
+
+static inline float dotProduct(const float* first, const float* second, int length) {
+    int i = 0;
+    float result = 0.0f;
+#ifdef HIFI_RESAMPLER_SSE
+    __m128 sums = _mm_setzero_ps();
+    for (; i + 4 <= length; i += 4) {
+        sums = _mm_add_ps(sums, _mm_mul_ps(_mm_loadu_ps(first + i), _mm_loadu_ps(second + i)));
+    }
+    float partialSums[4];
+    _mm_storeu_ps(partialSums, sums);
+    result = (partialSums[0] + partialSums[1]) + (partialSums[2] + partialSums[3]);
+#endif
+    for (; i < length; i++) {
+        result += first[i] * second[i];
+    }
+    return result;
+}
+
+AudioResampler::AudioResampler(int inputSampleRate, int outputSampleRate, int numChannels) :
+    _inputSampleRate(inputSampleRate),
+    _outputSampleRate(outputSampleRate),
+    _numChannels(numChannels),
+    _filterBank(getFilterBank(inputSampleRate, outputSampleRate)),
+    _history(),
+    _samples(),
+    _phase(0),
+    _inputIndex(0)
+{
+    reset();
+}
+
+int AudioResampler::getMaxOutputFrames(int numInputFrames) const {
+    return (int)((qint64)numInputFrames * _filterBank->numPhases / _filterBank->decimation) + 1;
+}
+
+int AudioResampler::resample(const int16_t* source, int numSourceFrames, int16_t* destination) {
+    if (_inputSampleRate == _outputSampleRate) {
+        memcpy(destination, source, numSourceFrames * _numChannels * sizeof(int16_t));
+        return numSourceFrames;
+    }
+    const FilterBank& filterBank = *_filterBank;
+    int numHistoryFrames = filterBank.numTaps - 1;
+
+    // lay each channel out contiguously behind the history we kept from last time, so that every output sample is a
+    // single dot product
+    int channelStride = numHistoryFrames + numSourceFrames;
+    _samples.resize(_numChannels * channelStride);
+    float* samples = _samples.data();
+    for (int channel = 0; channel < _numChannels; channel++) {
+        float* channelSamples = samples + channel * channelStride;
+        memcpy(channelSamples, _history.constData() + channel * numHistoryFrames, numHistoryFrames * sizeof(float));
+        channelSamples += numHistoryFrames;
+        const int16_t* channelSource = source + channel;
+        for (int i = 0; i < numSourceFrames; i++) {
+            channelSamples[i] = channelSource[i * _numChannels];
+        }
+    }
+
+    // _inputIndex is the newest input frame the next output frame depends on, _phase where between it and the next
+    // one the output falls
+    int numOutputFrames = 0;
+    const float MIN_SAMPLE = std::numeric_limits<int16_t>::min();
+    const float MAX_SAMPLE = std::numeric_limits<int16_t>::max();
+    while (_inputIndex < numSourceFrames) {
+        const float* coefficients = filterBank.coefficients.constData() + _phase * filterBank.numTaps;
+        for (int channel = 0; channel < _numChannels; channel++) {
+            float value = dotProduct(samples + channel * channelStride + _inputIndex, coefficients, filterBank.numTaps);
+            value = qMin(qMax(value, MIN_SAMPLE), MAX_SAMPLE);
+            *destination++ = (int16_t)(value < 0.0f ? value - 0.5f : value + 0.5f);
+        }
+        numOutputFrames++;
+
+        _phase += filterBank.decimation;
+        _inputIndex += _phase / filterBank.numPhases;
+        _phase %= filterBank.numPhases;
+    }
+    _inputIndex -= numSourceFrames;
+
+    // keep the last frames around for the start of the next call
+    for (int channel = 0; channel < _numChannels; channel++) {
+        memcpy(_history.data() + channel * numHistoryFrames, samples + channel * channelStride + numSourceFrames,
+               numHistoryFrames * sizeof(float));
+    }
+    return numOutputFrames;
+}
+
+int AudioResampler::getMaxFlushFrames() const {
+    return getMaxOutputFrames(_filterBank->numTaps - 1);
+}
+
+int AudioResampler::flush(int16_t* destination) {
+    int numSilentFrames = _filterBank->numTaps - 1;
+    QVector<int16_t> silence(numSilentFrames * _numChannels, 0);
+    return resample(silence.constData(), numSilentFrames, destination);
+}
+
+void AudioResampler::reset() {
+    _history.fill(0.0f, _numChannels * (_filterBank->numTaps - 1));
+    _phase = 0;
+    _inputIndex = 0;
+}
+
+void AudioResampler::precomputeCommonFilterBanks() {
+    const int NETWORK_SAMPLE_RATE = 24000;
+    const int COMMON_DEVICE_SAMPLE_RATES[] = { 44100, 48000, 96000 };
+    const int NUM_COMMON_DEVICE_SAMPLE_RATES = sizeof(COMMON_DEVICE_SAMPLE_RATES) / sizeof(int);
+    for (int i = 0; i < NUM_COMMON_DEVICE_SAMPLE_RATES; i++) {
+        getFilterBank(COMMON_DEVICE_SAMPLE_RATES[i], NETWORK_SAMPLE_RATE);
+        getFilterBank(NETWORK_SAMPLE_RATE, COMMON_DEVICE_SAMPLE_RATES[i]);
+    }
+}
+
+QSharedPointer<const AudioResampler::FilterBank> AudioResampler::getFilterBank(int inputSampleRate,
+                                                                               int outputSampleRate) {
+    static QMutex filterBanksMutex;
+    static QHash<QPair<int, int>, QSharedPointer<const FilterBank> > filterBanks;
+
+    QMutexLocker locker(&filterBanksMutex);
+    QSharedPointer<const FilterBank>& filterBank = filterBanks[qMakePair(inputSampleRate, outputSampleRate)];
+    if (!filterBank) {
+        filterBank = QSharedPointer<const FilterBank>(createFilterBank(inputSampleRate, outputSampleRate));
+    }
+    return filterBank;
+}
+
+AudioResampler::FilterBank* AudioResampler::createFilterBank(int inputSampleRate, int outputSampleRate) {
+    FilterBank* filterBank = new FilterBank();
+    int divisor = greatestCommonDivisor(inputSampleRate, outputSampleRate);
+    filterBank->numPhases = outputSampleRate / divisor;
+    filterBank->decimation = inputSampleRate / divisor;
+
+    if (filterBank->numPhases == filterBank->decimation) {
+        // same rate, a single tap passes the samples through
+        filterBank->numTaps = 1;
+        filterBank->coefficients.fill(1.0f, 1);
+        return filterBank;
+    }
+    filterBank->numTaps = (int)ceilf(BASE_NUM_TAPS * qMax(1.0f,
+        filterBank->decimation / (float)filterBank->numPhases));
+
+    // the prototype lowpass runs at the input rate times the number of phases, cut off below the lower of the two
+    // Nyquist frequencies
+    int prototypeLength = filterBank->numPhases * filterBank->numTaps;
+    float cutoff = CUTOFF_ROLLOFF * 0.5f / qMax(filterBank->numPhases, filterBank->decimation);
+    float center = (prototypeLength - 1) / 2.0f;
+    QVector<float> prototype(prototypeLength);
+    for (int i = 0; i < prototypeLength; i++) {
+        float x = 2.0f * cutoff * (i - center);
+        float sinc = (fabsf(x) < 1e-6f) ? 1.0f : sinf(PI * x) / (PI * x);
+        float window = 0.42f - 0.5f * cosf(2.0f * PI * i / (prototypeLength - 1))
+            + 0.08f * cosf(4.0f * PI * i / (prototypeLength - 1));
+        prototype[i] = sinc * window;
+    }
+
+    // split the prototype into phases, each normalized to unity gain at DC
+    filterBank->coefficients.resize(prototypeLength);
+    for (int phase = 0; phase < filterBank->numPhases; phase++) {
+        float* coefficients = filterBank->coefficients.data() + phase * filterBank->numTaps;
+        float sum = 0.0f;
+        for (int tap = 0; tap < filterBank->numTaps; tap++) {
+            coefficients[tap] = prototype[(filterBank->numTaps - 1 - tap) * filterBank->numPhases + phase];
+            sum += coefficients[tap];
+        }
+        for (int tap = 0; tap < filterBank->numTaps; tap++) {
+            coefficients[tap] /= sum;
+        }
+    }
+    return filterBank;
+}
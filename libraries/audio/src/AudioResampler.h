@@ -0,0 +1,81 @@
+//
+//  AudioResampler.h
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Polyphase sample rate conversion between device rates and the network rate.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioResampler_h
+#define hifi_AudioResampler_h
+
+#include <stdint.h>
+
+#include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
+
+/// Converts interleaved 16-bit audio from one sample rate to another by the rational ratio between them, filtering
+/// with a Blackman windowed sinc split into one phase per output position. The filter banks are computed once per pair
+/// of rates and shared between resamplers. State carries over between calls, so a stream can be fed one device
+/// callback at a time without clicks at the seams.
+class AudioResampler {
+public:
+    AudioResampler(int inputSampleRate, int outputSampleRate, int numChannels);
+
+    int getInputSampleRate() const { return _inputSampleRate; }
+    int getOutputSampleRate() const { return _outputSampleRate; }
+    int getNumChannels() const { return _numChannels; }
+
+    /// Returns the most frames a call to resample with the given number of input frames can write.
+    int getMaxOutputFrames(int numInputFrames) const;
+
+    /// Resamples the interleaved source frames into the destination, which must have room for getMaxOutputFrames.
+    /// \return the number of frames written
+    int resample(const int16_t* source, int numSourceFrames, int16_t* destination);
+
+    /// Returns the most frames a call to flush can write.
+    int getMaxFlushFrames() const;
+
+    /// Feeds the filter silence until the last of the input has passed all the way through it, so that the end of a
+    /// finite sound isn't left behind in the history. The destination must have room for getMaxFlushFrames.
+    /// \return the number of frames written
+    int flush(int16_t* destination);
+
+    /// Forgets the samples and phase carried over from previous calls.
+    void reset();
+
+    /// Computes (and caches) the filter banks for the device rates we commonly see, so that opening a device doesn't
+    /// have to.
+    static void precomputeCommonFilterBanks();
+
+private:
+    class FilterBank {
+    public:
+        int numPhases;
+        int decimation;
+        int numTaps;
+
+        /// numPhases runs of numTaps coefficients, each reversed so that it lines up with the input samples it's
+        /// applied to.
+        QVector<float> coefficients;
+    };
+
+    static QSharedPointer<const FilterBank> getFilterBank(int inputSampleRate, int outputSampleRate);
+    static FilterBank* createFilterBank(int inputSampleRate, int outputSampleRate);
+
+    int _inputSampleRate;
+    int _outputSampleRate;
+    int _numChannels;
+    QSharedPointer<const FilterBank> _filterBank;
+
+    QVector<float> _history;
+    QVector<float> _samples;
+    int _phase;
+    int _inputIndex;
+};
+
+#endif // hifi_AudioResampler_h
@@ -15,28 +15,27 @@
 #include <QtCore/QDebug>
 
 #include "PacketHeaders.h"
+#include "SharedUtil.h"
 
 #include "AudioRingBuffer.h"
 
-AudioRingBuffer::AudioRingBuffer(int numFrameSamples, bool randomAccessMode) :
+AudioRingBuffer::AudioRingBuffer(int numFrameSamples, bool randomAccessMode, bool lockFreeMode) :
     NodeData(),
-    _sampleCapacity(numFrameSamples * RING_BUFFER_LENGTH_FRAMES),
+    _sampleCapacity(0),
     _numFrameSamples(numFrameSamples),
+    _numMirroredSamples(0),
+    _nextOutput(0),
+    _endOfLastWrite(0),
+    _buffer(NULL),
     _isStarved(true),
     _hasStarted(false),
-    _randomAccessMode(randomAccessMode)
+    _randomAccessMode(randomAccessMode),
+    _lockFreeMode(lockFreeMode),
+    _streamDecoder(),
+    _decodedSamples()
 {
     if (numFrameSamples) {
-        _buffer = new int16_t[_sampleCapacity];
-        if (_randomAccessMode) {
-            memset(_buffer, 0, _sampleCapacity * sizeof(int16_t));
-        }
-        _nextOutput = _buffer;
-        _endOfLastWrite = _buffer;
-    } else {
-        _buffer = NULL;
-        _nextOutput = NULL;
-        _endOfLastWrite = NULL;
+        allocateBuffer(numFrameSamples);
     }
 };
 
@@ -45,25 +44,53 @@ AudioRingBuffer::~AudioRingBuffer() {
 }
 
 void AudioRingBuffer::reset() {
-    _endOfLastWrite = _buffer;
-    _nextOutput = _buffer;
+    _endOfLastWrite.storeRelease(0);
+    _nextOutput.storeRelease(0);
     _isStarved = true;
+    _streamDecoder.reset();
 }
 
 void AudioRingBuffer::resizeForFrameSize(qint64 numFrameSamples) {
     delete[] _buffer;
-    _sampleCapacity = numFrameSamples * RING_BUFFER_LENGTH_FRAMES;
-    _buffer = new int16_t[_sampleCapacity];
-    if (_randomAccessMode) {
-        memset(_buffer, 0, _sampleCapacity * sizeof(int16_t));
-    }
-    _nextOutput = _buffer;
-    _endOfLastWrite = _buffer;
+    allocateBuffer(numFrameSamples);
+    _nextOutput.storeRelease(0);
+    _endOfLastWrite.storeRelease(0);
 }
 
 int AudioRingBuffer::parseData(const QByteArray& packet) {
     int numBytesPacketHeader = numBytesForPacketHeader(packet);
-    return writeData(packet.data() + numBytesPacketHeader, packet.size() - numBytesPacketHeader);
+    
+    if (packetTypeForPacket(packet) == PacketTypeSilentAudioFrame) {
+        // the mix was (nearly) silent, the mixer sent us the number of samples and the level of noise to fill in
+        int numBytesStreamHeader = _streamDecoder.readSilentFrameHeader(packet.data() + numBytesPacketHeader,
+                                                                        packet.size() - numBytesPacketHeader);
+        int readBytes = numBytesPacketHeader + numBytesStreamHeader;
+        if (numBytesStreamHeader < 0 || packet.size() - readBytes < (int)(2 * sizeof(int16_t))) {
+            return packet.size();
+        }
+        int16_t numSilentSamples;
+        memcpy(&numSilentSamples, packet.data() + readBytes, sizeof(int16_t));
+        readBytes += sizeof(int16_t);
+        
+        int16_t comfortNoiseLevel;
+        memcpy(&comfortNoiseLevel, packet.data() + readBytes, sizeof(int16_t));
+        readBytes += sizeof(int16_t);
+        
+        if (numSilentSamples > 0) {
+            addComfortNoiseFrame(numSilentSamples, comfortNoiseLevel);
+        }
+        return readBytes;
+    }
+    
+    _decodedSamples.resize(0);
+    int numBytesFrame = _streamDecoder.decodeFrame(packet.data() + numBytesPacketHeader,
+                                                   packet.size() - numBytesPacketHeader, _decodedSamples);
+    if (numBytesFrame < 0) {
+        return packet.size();
+    }
+    writeSamples(_decodedSamples.constData(), _decodedSamples.size());
+    
+    return numBytesPacketHeader + numBytesFrame;
 }
 
 qint64 AudioRingBuffer::readSamples(int16_t* destination, qint64 maxSamples) {
@@ -79,34 +106,29 @@ qint64 AudioRingBuffer::readData(char *data, qint64 maxSize) {
     // differently. Namely, if anything has been written, we say we have as many samples as they ask for
     // otherwise we say we have nothing available
     if (_randomAccessMode) {
-        numReadSamples = _endOfLastWrite ? (maxSize / sizeof(int16_t)) : 0;
+        numReadSamples = _buffer ? (maxSize / sizeof(int16_t)) : 0;
     }
-
-    if (_nextOutput + numReadSamples > _buffer + _sampleCapacity) {
+    
+    int nextOutput = _nextOutput.load();
+    int numSamplesToEnd = _sampleCapacity - nextOutput;
+    
+    if (numReadSamples > numSamplesToEnd) {
         // we're going to need to do two reads to get this data, it wraps around the edge
 
-        // read to the end of the buffer
-        int numSamplesToEnd = (_buffer + _sampleCapacity) - _nextOutput;
-        memcpy(data, _nextOutput, numSamplesToEnd * sizeof(int16_t));
-        if (_randomAccessMode) {
-            memset(_nextOutput, 0, numSamplesToEnd * sizeof(int16_t)); // clear it
-        }
-        
-        // read the rest from the beginning of the buffer
+        // read to the end of the buffer, then the rest from the beginning of the buffer
+        memcpy(data, _buffer + nextOutput, numSamplesToEnd * sizeof(int16_t));
         memcpy(data + (numSamplesToEnd * sizeof(int16_t)), _buffer, (numReadSamples - numSamplesToEnd) * sizeof(int16_t));
-        if (_randomAccessMode) {
-            memset(_buffer, 0, (numReadSamples - numSamplesToEnd) * sizeof(int16_t)); // clear it
-        }
     } else {
         // read the data
-        memcpy(data, _nextOutput, numReadSamples * sizeof(int16_t));
-        if (_randomAccessMode) {
-            memset(_nextOutput, 0, numReadSamples * sizeof(int16_t)); // clear it
-        }
+        memcpy(data, _buffer + nextOutput, numReadSamples * sizeof(int16_t));
+    }
+    
+    if (_randomAccessMode) {
+        writeSamplesAt(nextOutput, NULL, numReadSamples); // clear it
     }
 
     // push the position of _nextOutput by the number of samples read
-    _nextOutput = shiftedPositionAccomodatingWrap(_nextOutput, numReadSamples);
+    _nextOutput.storeRelease(shiftedPositionAccomodatingWrap(nextOutput, numReadSamples));
 
     return numReadSamples * sizeof(int16_t);
 }
@@ -116,54 +138,54 @@ qint64 AudioRingBuffer::writeSamples(const int16_t* source, qint64 maxSamples) {
 }
 
 qint64 AudioRingBuffer::writeData(const char* data, qint64 maxSize) {
-    // make sure we have enough bytes left for this to be the right amount of audio
-    // otherwise we should not copy that data, and leave the buffer pointers where they are
-
     int samplesToCopy = std::min((quint64)(maxSize / sizeof(int16_t)), (quint64)_sampleCapacity);
+    
+    return writeSamplesOrSilence((const int16_t*) data, samplesToCopy) * sizeof(int16_t);
+}
 
-    std::less<int16_t*> less;
-    std::less_equal<int16_t*> lessEqual;
-
-    if (_hasStarted
-        && (less(_endOfLastWrite, _nextOutput)
-            && lessEqual(_nextOutput, shiftedPositionAccomodatingWrap(_endOfLastWrite, samplesToCopy)))) {
-        // this read will cross the next output, so call us starved and reset the buffer
+int AudioRingBuffer::writeSamplesOrSilence(const int16_t* source, int numSamples) {
+    int endOfLastWrite = _endOfLastWrite.load();
+    
+    if (_lockFreeMode) {
+        // the read position isn't ours to move, so if the samples don't fit (leaving the frame behind the read
+        // position free) we drop them and leave it to the reader to catch up
+        if (numSamples > _sampleCapacity - _numFrameSamples - (int)samplesAvailable()) {
+            qDebug() << "Filled the ring buffer. Dropping" << numSamples << "samples.";
+            return 0;
+        }
+    } else if (_hasStarted && samplesAvailable() + numSamples >= (unsigned int)_sampleCapacity) {
+        // make sure we have enough room left for this to be the right amount of audio
+        // this write will cross the next output, so call us starved and reset the buffer
         qDebug() << "Filled the ring buffer. Resetting.";
-        _endOfLastWrite = _buffer;
-        _nextOutput = _buffer;
+        endOfLastWrite = 0;
+        _nextOutput.storeRelease(0);
         _isStarved = true;
     }
-
-    if (_endOfLastWrite + samplesToCopy <= _buffer + _sampleCapacity) {
-        memcpy(_endOfLastWrite, data, samplesToCopy * sizeof(int16_t));
-    } else {
-        int numSamplesToEnd = (_buffer + _sampleCapacity) - _endOfLastWrite;
-        memcpy(_endOfLastWrite, data, numSamplesToEnd * sizeof(int16_t));
-        memcpy(_buffer, data + (numSamplesToEnd * sizeof(int16_t)), (samplesToCopy - numSamplesToEnd) * sizeof(int16_t));
-    }
-
-    _endOfLastWrite = shiftedPositionAccomodatingWrap(_endOfLastWrite, samplesToCopy);
-
-    return samplesToCopy * sizeof(int16_t);
+    
+    writeSamplesAt(endOfLastWrite, source, numSamples);
+    
+    _endOfLastWrite.storeRelease(shiftedPositionAccomodatingWrap(endOfLastWrite, numSamples));
+    
+    return numSamples;
 }
 
 int16_t& AudioRingBuffer::operator[](const int index) {
-    return *shiftedPositionAccomodatingWrap(_nextOutput, index);
+    return _buffer[shiftedPositionAccomodatingWrap(_nextOutput.load(), index)];
 }
 
 const int16_t& AudioRingBuffer::operator[] (const int index) const {
-    return *shiftedPositionAccomodatingWrap(_nextOutput, index);
+    return _buffer[shiftedPositionAccomodatingWrap(_nextOutput.load(), index)];
 }
 
 void AudioRingBuffer::shiftReadPosition(unsigned int numSamples) {
-    _nextOutput = shiftedPositionAccomodatingWrap(_nextOutput, numSamples);
+    _nextOutput.storeRelease(shiftedPositionAccomodatingWrap(_nextOutput.load(), numSamples));
 }
 
 unsigned int AudioRingBuffer::samplesAvailable() const {
-    if (!_endOfLastWrite) {
+    if (!_buffer) {
         return 0;
     } else {
-        int sampleDifference = _endOfLastWrite - _nextOutput;
+        int sampleDifference = _endOfLastWrite.loadAcquire() - _nextOutput.loadAcquire();
 
         if (sampleDifference < 0) {
             sampleDifference += _sampleCapacity;
@@ -174,18 +196,23 @@ unsigned int AudioRingBuffer::samplesAvailable() const {
 }
 
 void AudioRingBuffer::addSilentFrame(int numSilentSamples) {
-    // memset zeroes into the buffer, accomodate a wrap around the end
-    // push the _endOfLastWrite to the correct spot
-    if (_endOfLastWrite + numSilentSamples <= _buffer + _sampleCapacity) {
-        memset(_endOfLastWrite, 0, numSilentSamples * sizeof(int16_t));
-        _endOfLastWrite += numSilentSamples;
+    // the count comes off the network, so never let it run past the whole ring
+    writeSamplesOrSilence(NULL, glm::clamp(numSilentSamples, 0, _sampleCapacity));
+}
+
+void AudioRingBuffer::addComfortNoiseFrame(int numSamples, int comfortNoiseLevel) {
+    if (comfortNoiseLevel <= 0) {
+        // write real silence through writeSamples so that a full buffer is handled the same way as audio
+        _decodedSamples.fill(0, numSamples);
     } else {
-        int numSamplesToEnd = (_buffer + _sampleCapacity) - _endOfLastWrite;
-        memset(_endOfLastWrite, 0, numSamplesToEnd * sizeof(int16_t));
-        memset(_buffer, 0, (numSilentSamples - numSamplesToEnd) * sizeof(int16_t));
-        
-        _endOfLastWrite = _buffer + (numSilentSamples - numSamplesToEnd);
+        // uniform noise in [-2L, 2L] has a mean absolute value of L
+        int noiseRange = 2 * comfortNoiseLevel;
+        _decodedSamples.resize(numSamples);
+        for (int i = 0; i < numSamples; i++) {
+            _decodedSamples[i] = randIntInRange(-noiseRange, noiseRange);
+        }
     }
+    writeSamples(_decodedSamples.constData(), _decodedSamples.size());
 }
 
 bool AudioRingBuffer::isNotStarvedOrHasMinimumSamples(unsigned int numRequiredSamples) const {
@@ -196,15 +223,57 @@ bool AudioRingBuffer::isNotStarvedOrHasMinimumSamples(unsigned int numRequiredSa
     }
 }
 
-int16_t* AudioRingBuffer::shiftedPositionAccomodatingWrap(int16_t* position, int numSamplesShift) const {
+int AudioRingBuffer::shiftedPositionAccomodatingWrap(int position, int numSamplesShift) const {
+    if (_sampleCapacity == 0) {
+        // nothing has been allocated yet, so there's nowhere to go
+        return 0;
+    } else if (_lockFreeMode) {
+        // the capacity is a power of two, so masking wraps either way
+        return (position + numSamplesShift) & (_sampleCapacity - 1);
+    }
+    int shiftedPosition = (position + numSamplesShift) % _sampleCapacity;
+    return (shiftedPosition < 0) ? shiftedPosition + _sampleCapacity : shiftedPosition;
+}
 
-    if (numSamplesShift > 0 && position + numSamplesShift >= _buffer + _sampleCapacity) {
-        // this shift will wrap the position around to the beginning of the ring
-        return position + numSamplesShift - _sampleCapacity;
-    } else if (numSamplesShift < 0 && position + numSamplesShift < _buffer) {
-        // this shift will go around to the end of the ring
-        return position + numSamplesShift + _sampleCapacity;
+void AudioRingBuffer::writeSamplesAt(int position, const int16_t* source, int numSamples) {
+    int numSamplesToEnd = std::min(numSamples, _sampleCapacity - position);
+    int numWrappedSamples = numSamples - numSamplesToEnd;
+    
+    if (source) {
+        memcpy(_buffer + position, source, numSamplesToEnd * sizeof(int16_t));
+        memcpy(_buffer, source + numSamplesToEnd, numWrappedSamples * sizeof(int16_t));
     } else {
-        return position + numSamplesShift;
+        memset(_buffer + position, 0, numSamplesToEnd * sizeof(int16_t));
+        memset(_buffer, 0, numWrappedSamples * sizeof(int16_t));
+    }
+    
+    // copy whatever landed in the start of the ring to its mirror past the end
+    if (position < _numMirroredSamples) {
+        int numMirroredSamples = std::min(numSamplesToEnd, _numMirroredSamples - position);
+        memcpy(_buffer + _sampleCapacity + position, _buffer + position, numMirroredSamples * sizeof(int16_t));
+    }
+    int numWrappedMirroredSamples = std::min(numWrappedSamples, _numMirroredSamples);
+    if (numWrappedMirroredSamples > 0) {
+        memcpy(_buffer + _sampleCapacity, _buffer, numWrappedMirroredSamples * sizeof(int16_t));
+    }
+}
+
+void AudioRingBuffer::allocateBuffer(int numFrameSamples) {
+    _numFrameSamples = numFrameSamples;
+    _sampleCapacity = numFrameSamples * RING_BUFFER_LENGTH_FRAMES;
+    _numMirroredSamples = 0;
+    
+    if (_lockFreeMode) {
+        int powerOfTwoCapacity = 1;
+        while (powerOfTwoCapacity < _sampleCapacity) {
+            powerOfTwoCapacity <<= 1;
+        }
+        _sampleCapacity = powerOfTwoCapacity;
+        _numMirroredSamples = numFrameSamples;
+    }
+    
+    _buffer = new int16_t[_sampleCapacity + _numMirroredSamples];
+    if (_randomAccessMode) {
+        memset(_buffer, 0, (_sampleCapacity + _numMirroredSamples) * sizeof(int16_t));
     }
 }
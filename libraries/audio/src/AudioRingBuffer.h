@@ -17,10 +17,13 @@
 
 #include <glm/glm.hpp>
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QIODevice>
 
 #include "NodeData.h"
 
+#include "AudioCodec.h"
+
 const int SAMPLE_RATE = 24000;
 
 const int NETWORK_BUFFER_LENGTH_BYTES_STEREO = 1024;
@@ -36,21 +39,33 @@ const short RING_BUFFER_LENGTH_FRAMES = 10;
 const int MAX_SAMPLE_VALUE = std::numeric_limits<int16_t>::max();
 const int MIN_SAMPLE_VALUE = std::numeric_limits<int16_t>::min();
 
+/// A ring of samples with one writer and one reader. In lock-free mode the writer and reader may be on different threads:
+/// the writer only ever moves the write position and the reader only the read position, each published with release
+/// semantics, the capacity is a power of two and the first frame of the ring is mirrored past its end so that a whole
+/// frame can always be read from getNextOutput without wrapping. A full lock-free ring drops incoming samples rather
+/// than resetting the read position out from under the reader, and always keeps the frame behind the read position free
+/// so that the reader may step back into it.
 class AudioRingBuffer : public NodeData {
     Q_OBJECT
 public:
-    AudioRingBuffer(int numFrameSamples, bool randomAccessMode = false);
+    AudioRingBuffer(int numFrameSamples, bool randomAccessMode = false, bool lockFreeMode = false);
     ~AudioRingBuffer();
 
+    /// Moves both positions, so in lock-free mode this must not overlap with any other use of the ring.
     void reset();
     void resizeForFrameSize(qint64 numFrameSamples);
     
+    bool isLockFree() const { return _lockFreeMode; }
+    
     int getSampleCapacity() const { return _sampleCapacity; }
     
+    /// Decodes the frame following the packet header, as written by an AudioStreamEncoder. Silent frames from the mixer
+    /// are filled with comfort noise at the level it asks for.
     int parseData(const QByteArray& packet);
     
-    // assume callers using this will never wrap around the end
-    const int16_t* getNextOutput() const { return _nextOutput; }
+    /// In lock-free mode, up to a frame of samples can be read from here without wrapping; otherwise callers have to
+    /// handle the wrap around the end themselves.
+    const int16_t* getNextOutput() const { return _buffer + _nextOutput.load(); }
     const int16_t* getBuffer() const { return _buffer; }
 
     qint64 readSamples(int16_t* destination, qint64 maxSamples);
@@ -74,21 +89,39 @@ public:
     bool hasStarted() const { return _hasStarted; }
     
     void addSilentFrame(int numSilentSamples);
+    
+    /// Writes white noise with the given mean absolute sample value, or silence if the level is zero.
+    void addComfortNoiseFrame(int numSamples, int comfortNoiseLevel);
 protected:
+    /// Writes the samples at the write position, or drops them if they don't fit in lock-free mode.
+    /// \param source the samples to write, or null for silence
+    /// \return the number of samples written
+    int writeSamplesOrSilence(const int16_t* source, int numSamples);
+    
     // disallow copying of AudioRingBuffer objects
     AudioRingBuffer(const AudioRingBuffer&);
     AudioRingBuffer& operator= (const AudioRingBuffer&);
     
-    int16_t* shiftedPositionAccomodatingWrap(int16_t* position, int numSamplesShift) const;
+    int shiftedPositionAccomodatingWrap(int position, int numSamplesShift) const;
+    
+    /// Copies samples into the ring from the given position on, wrapping around the end and keeping the mirrored samples
+    /// up to date. A null source writes silence. Doesn't move either position.
+    void writeSamplesAt(int position, const int16_t* source, int numSamples);
+    
+    void allocateBuffer(int numFrameSamples);
     
     int _sampleCapacity;
     int _numFrameSamples;
-    int16_t* _nextOutput;
-    int16_t* _endOfLastWrite;
+    int _numMirroredSamples;
+    QAtomicInt _nextOutput; /// index of the next sample to read, only stored by the reader
+    QAtomicInt _endOfLastWrite; /// index after the last sample written, only stored by the writer
     int16_t* _buffer;
     bool _isStarved;
     bool _hasStarted;
     bool _randomAccessMode; /// will this ringbuffer be used for random access? if so, do some special processing
+    bool _lockFreeMode;
+    AudioStreamDecoder _streamDecoder;
+    QVector<int16_t> _decodedSamples;
 };
 
 #endif // hifi_AudioRingBuffer_h
@@ -9,25 +9,19 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include "AudioInjectorScheduler.h"
+
 #include "AudioScriptingInterface.h"
 
 AudioInjector* AudioScriptingInterface::playSound(Sound* sound, const AudioInjectorOptions* injectorOptions) {
     
     AudioInjector* injector = new AudioInjector(sound, *injectorOptions);
     
-    QThread* injectorThread = new QThread();
-    
-    injector->moveToThread(injectorThread);
-    
-    // start injecting when the injector thread starts
-    connect(injectorThread, SIGNAL(started()), injector, SLOT(injectAudio()));
-    
-    // connect the right slots and signals so that the AudioInjector is killed once the injection is complete
+    // the injector lives on the shared scheduler thread and is cleaned up once its last frame is sent
+    injector->moveToThread(AudioInjectorScheduler::getInstance().getThread());
     connect(injector, SIGNAL(finished()), injector, SLOT(deleteLater()));
-    connect(injector, SIGNAL(finished()), injectorThread, SLOT(quit()));
-    connect(injectorThread, SIGNAL(finished()), injectorThread, SLOT(deleteLater()));
     
-    injectorThread->start();
+    injector->injectAudio();
     
     return injector;
 }
@@ -39,17 +33,9 @@ void AudioScriptingInterface::startDrumSound(float volume, float frequency, floa
     AudioInjector* injector = new AudioInjector(sound, *injectorOptions);
     sound->setParent(injector);
     
-    QThread* injectorThread = new QThread();
-    
-    injector->moveToThread(injectorThread);
-    
-    // start injecting when the injector thread starts
-    connect(injectorThread, SIGNAL(started()), injector, SLOT(injectAudio()));
-    
-    // connect the right slots and signals so that the AudioInjector is killed once the injection is complete
+    // the sound goes along with the injector to the scheduler thread, and is deleted with it
+    injector->moveToThread(AudioInjectorScheduler::getInstance().getThread());
     connect(injector, SIGNAL(finished()), injector, SLOT(deleteLater()));
-    connect(injector, SIGNAL(finished()), injectorThread, SLOT(quit()));
-    connect(injectorThread, SIGNAL(finished()), injectorThread, SLOT(deleteLater()));
     
-    injectorThread->start();
+    injector->injectAudio();
 }
@@ -56,5 +56,7 @@ int InjectedAudioRingBuffer::parseData(const QByteArray& packet) {
     packetStream.skipRawData(writeData(packet.data() + packetStream.device()->pos(),
                                        packet.size() - packetStream.device()->pos()));
     
+    updateJitterForArrival();
+    
     return packetStream.device()->pos();
 }
@@ -22,7 +22,8 @@ qint64 MixedAudioRingBuffer::readSamples(int16_t* destination, qint64 maxSamples
     // calculate the average loudness for the frame about to go out
     
     // read from _nextOutput either _numFrameSamples or to the end of the buffer
-    int samplesFromNextOutput = _buffer + _sampleCapacity - _nextOutput;
+    const int16_t* nextOutput = getNextOutput();
+    int samplesFromNextOutput = _buffer + _sampleCapacity - nextOutput;
     if (samplesFromNextOutput > _numFrameSamples) {
         samplesFromNextOutput = _numFrameSamples;
     }
@@ -30,7 +31,7 @@ qint64 MixedAudioRingBuffer::readSamples(int16_t* destination, qint64 maxSamples
     float averageLoudness = 0.0f;
     
     for (int s = 0; s < samplesFromNextOutput; s++) {
-        averageLoudness += fabsf(_nextOutput[s]);
+        averageLoudness += fabsf(nextOutput[s]);
     }
     
     // read samples from the beginning of the buffer, if any
@@ -16,18 +16,43 @@
 
 #include <Node.h>
 #include <PacketHeaders.h>
+#include <SharedUtil.h>
 #include <UUID.h>
 
 #include "PositionalAudioRingBuffer.h"
 
+// the jitter buffer we start with, before we've measured anything
+const int DEFAULT_JITTER_BUFFER_SAMPLES = 12 * (SAMPLE_RATE / 1000);
+
+// how many mean deviations of inter-arrival time to buffer for
+const float JITTER_BUFFER_DEVIATIONS = 3.0f;
+
+// weight of each new inter-arrival deviation in the running estimate, as in RFC 3550
+const float JITTER_ESTIMATE_GAIN = 1.0f / 16.0f;
+
+// drop a frame once the depth is this far over, add one once it's a frame under; either is spread over up to
+// MAX_STRETCH_FRAMES frames
+const int STRETCH_HYSTERESIS_SAMPLES = NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL * 3 / 2;
+const int MAX_STRETCH_FRAMES = 4;
+
 PositionalAudioRingBuffer::PositionalAudioRingBuffer(PositionalAudioRingBuffer::Type type) :
-    AudioRingBuffer(NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL),
+    AudioRingBuffer(NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL, false, true),
     _type(type),
     _position(0.0f, 0.0f, 0.0f),
     _orientation(0.0f, 0.0f, 0.0f, 0.0f),
     _willBeAddedToMix(false),
     _shouldLoopbackForNode(false),
-    _shouldOutputStarveDebug(true)
+    _shouldOutputStarveDebug(true),
+    _nextOutputTrailingLoudness(0.0f),
+    _lastArrivalUsecs(0),
+    _interArrivalJitterUsecs(0.0f),
+    _desiredJitterBufferSamples(DEFAULT_JITTER_BUFFER_SAMPLES),
+    _framesUntilNextStretch(0),
+    _stretchSamples(),
+    _numStarves(0),
+    _numStretches(0),
+    _sumBufferedSamples(0),
+    _numBufferedSamplesChecks(0)
 {
 
 }
@@ -44,6 +69,13 @@ int PositionalAudioRingBuffer::parseData(const QByteArray& packet) {
    
     if (packetTypeForPacket(packet) == PacketTypeSilentAudioFrame) {
         // this source had no audio to send us, but this counts as a packet
+        int numBytesStreamHeader = _streamDecoder.readSilentFrameHeader(packet.data() + readBytes,
+                                                                        packet.size() - readBytes);
+        if (numBytesStreamHeader < 0 || packet.size() - readBytes - numBytesStreamHeader < (int)sizeof(int16_t)) {
+            return packet.size();
+        }
+        readBytes += numBytesStreamHeader;
+        
         // write silence equivalent to the number of silent samples they just sent us
         int16_t numSilentSamples;
         
@@ -53,10 +85,20 @@ int PositionalAudioRingBuffer::parseData(const QByteArray& packet) {
         
         addSilentFrame(numSilentSamples);
     } else {
-        // there is audio data to read
-        readBytes += writeData(packet.data() + readBytes, packet.size() - readBytes);
+        // there is audio data to decode
+        _decodedSamples.resize(0);
+        int numBytesFrame = _streamDecoder.decodeFrame(packet.data() + readBytes, packet.size() - readBytes,
+                                                       _decodedSamples);
+        if (numBytesFrame < 0) {
+            return packet.size();
+        }
+        writeSamples(_decodedSamples.constData(), _decodedSamples.size());
+        
+        readBytes += numBytesFrame;
     }
     
+    updateJitterForArrival();
+    
     return readBytes;
 }
 
@@ -76,11 +118,12 @@ int PositionalAudioRingBuffer::parsePositionalData(const QByteArray& positionalB
 }
 
 void PositionalAudioRingBuffer::updateNextOutputTrailingLoudness() {
-    // ForBoundarySamples means that we expect the number of samples not to roll of the end of the ring buffer
+    // we're lock-free, so a whole frame can be read from the next output without wrapping
     float nextLoudness = 0;
+    const int16_t* nextOutput = getNextOutput();
     
     for (int i = 0; i < _numFrameSamples; ++i) {
-        nextLoudness += fabsf(_nextOutput[i]);
+        nextLoudness += fabsf(nextOutput[i]);
     }
     
     nextLoudness /= _numFrameSamples;
@@ -102,8 +145,25 @@ void PositionalAudioRingBuffer::updateNextOutputTrailingLoudness() {
     }
 }
 
-bool PositionalAudioRingBuffer::shouldBeAddedToMix(int numJitterBufferSamples) {
-    if (!isNotStarvedOrHasMinimumSamples(NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL + numJitterBufferSamples)) {
+void PositionalAudioRingBuffer::updateJitterForArrival() {
+    quint64 now = usecTimestampNow();
+    if (_lastArrivalUsecs != 0 && now > _lastArrivalUsecs) {
+        // how far this packet's spacing was from the spacing it was sent with
+        float deviation = fabsf((float)(now - _lastArrivalUsecs) - (float)BUFFER_SEND_INTERVAL_USECS);
+        _interArrivalJitterUsecs += (deviation - _interArrivalJitterUsecs) * JITTER_ESTIMATE_GAIN;
+        
+        // never ask for more than the ring buffer can hold alongside the frame being mixed, one arriving and the one
+        // kept free behind the read position
+        const int MAX_JITTER_BUFFER_SAMPLES = _sampleCapacity - 3 * _numFrameSamples;
+        int desiredSamples = (int)ceilf(JITTER_BUFFER_DEVIATIONS * _interArrivalJitterUsecs * SAMPLE_RATE
+                                        / USECS_PER_SECOND);
+        _desiredJitterBufferSamples = glm::clamp(desiredSamples, 0, MAX_JITTER_BUFFER_SAMPLES);
+    }
+    _lastArrivalUsecs = now;
+}
+
+bool PositionalAudioRingBuffer::shouldBeAddedToMix() {
+    if (!isNotStarvedOrHasMinimumSamples(NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL + _desiredJitterBufferSamples)) {
         if (_shouldOutputStarveDebug) {
             _shouldOutputStarveDebug = false;
         }
@@ -111,6 +171,7 @@ bool PositionalAudioRingBuffer::shouldBeAddedToMix(int numJitterBufferSamples) {
         return false;
     } else if (samplesAvailable() < NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL) {
         _isStarved = true;
+        _numStarves++;
         
         // reset our _shouldOutputStarveDebug to true so the next is printed
         _shouldOutputStarveDebug = true;
@@ -122,9 +183,77 @@ bool PositionalAudioRingBuffer::shouldBeAddedToMix(int numJitterBufferSamples) {
 
         // since we've read data from ring buffer at least once - we've started
         _hasStarted = true;
+        
+        _sumBufferedSamples += samplesAvailable();
+        _numBufferedSamplesChecks++;
 
         return true;
     }
 
     return false;
 }
+
+void PositionalAudioRingBuffer::convergeOnDesiredJitterBufferSamples() {
+    if (_framesUntilNextStretch > 0) {
+        // let the last stretch play out before deciding on another
+        _framesUntilNextStretch--;
+        return;
+    }
+    int numAvailableFrames = samplesAvailable() / _numFrameSamples;
+    
+    // the depth we'll have buffered once the frame about to be mixed is gone
+    int surplusSamples = (int)samplesAvailable() - _numFrameSamples - _desiredJitterBufferSamples;
+    
+    if (surplusSamples > STRETCH_HYSTERESIS_SAMPLES) {
+        // too much latency, play the frames ahead a little faster to drop one
+        int numOutputFrames = glm::min(MAX_STRETCH_FRAMES, numAvailableFrames - 1);
+        stretchFrames(numOutputFrames + 1, numOutputFrames);
+        _framesUntilNextStretch = numOutputFrames;
+        
+    } else if (surplusSamples < -_numFrameSamples) {
+        // close to starving, play the frames ahead a little slower to add one
+        int numInputFrames = glm::min(MAX_STRETCH_FRAMES - 1, numAvailableFrames);
+        stretchFrames(numInputFrames, numInputFrames + 1);
+        _framesUntilNextStretch = numInputFrames + 1;
+    }
+}
+
+void PositionalAudioRingBuffer::stretchFrames(int numInputFrames, int numOutputFrames) {
+    int numInputSamples = numInputFrames * _numFrameSamples;
+    int numOutputSamples = numOutputFrames * _numFrameSamples;
+    
+    _stretchSamples.resize(numInputSamples + numOutputSamples);
+    for (int i = 0; i < numInputSamples; i++) {
+        _stretchSamples[i] = (*this)[i];
+    }
+    
+    // linear interpolation keeps the first and last samples where they were, so the stretched frames join up with
+    // the ones around them
+    int16_t* outputSamples = _stretchSamples.data() + numInputSamples;
+    float inputStep = (numInputSamples - 1) / (float)(numOutputSamples - 1);
+    for (int i = 0; i < numOutputSamples; i++) {
+        float inputPosition = i * inputStep;
+        int inputIndex = glm::min((int)inputPosition, numInputSamples - 2);
+        float fraction = inputPosition - inputIndex;
+        outputSamples[i] = (int16_t)glm::round(_stretchSamples[inputIndex] * (1.0f - fraction)
+                                               + _stretchSamples[inputIndex + 1] * fraction);
+    }
+    
+    // move the next output by whole frames so that the stretch doesn't disturb the frames after it; when adding a frame
+    // this steps back into the frame the ring keeps free behind the read position
+    int nextOutput = shiftedPositionAccomodatingWrap(_nextOutput.load(), numInputSamples - numOutputSamples);
+    writeSamplesAt(nextOutput, outputSamples, numOutputSamples);
+    _nextOutput.storeRelease(nextOutput);
+    _numStretches++;
+}
+
+float PositionalAudioRingBuffer::getAverageBufferedSamples() const {
+    return _numBufferedSamplesChecks == 0 ? 0.0f : _sumBufferedSamples / (float)_numBufferedSamplesChecks;
+}
+
+void PositionalAudioRingBuffer::resetJitterBufferStats() {
+    _numStarves = 0;
+    _numStretches = 0;
+    _sumBufferedSamples = 0;
+    _numBufferedSamplesChecks = 0;
+}
@@ -34,13 +34,34 @@ public:
     void updateNextOutputTrailingLoudness();
     float getNextOutputTrailingLoudness() const { return _nextOutputTrailingLoudness; }
     
-    bool shouldBeAddedToMix(int numJitterBufferSamples);
+    /// Updates the inter-arrival jitter estimate and the jitter buffer depth we want from it. Called for every packet
+    /// parsed into this buffer.
+    void updateJitterForArrival();
+    
+    /// Checks whether the next frame can be mixed, holding off playback until the jitter buffer has filled.
+    bool shouldBeAddedToMix();
+    
+    /// Time-stretches the frames ahead of the next output by a frame when the buffered depth has drifted too far from
+    /// the desired one, so that latency converges without dropping or repeating whole frames.
+    void convergeOnDesiredJitterBufferSamples();
+    
+    int getDesiredJitterBufferSamples() const { return _desiredJitterBufferSamples; }
+    float getInterArrivalJitterUsecs() const { return _interArrivalJitterUsecs; }
+    int getNumStarves() const { return _numStarves; }
+    int getNumStretches() const { return _numStretches; }
+    float getAverageBufferedSamples() const;
+    
+    /// Resets the starve and stretch counts and the buffered depth average reported with the mixer stats.
+    void resetJitterBufferStats();
     
     bool willBeAddedToMix() const { return _willBeAddedToMix; }
     void setWillBeAddedToMix(bool willBeAddedToMix) { _willBeAddedToMix = willBeAddedToMix; }
     
     bool shouldLoopbackForNode() const { return _shouldLoopbackForNode; }
     
+    /// Returns the codec this source's stream is encoded in, which is also the one it would like its mix in.
+    AudioCodecID_t getCodecID() const { return _streamDecoder.getLastCodecID(); }
+    
     PositionalAudioRingBuffer::Type getType() const { return _type; }
     const glm::vec3& getPosition() const { return _position; }
     const glm::quat& getOrientation() const { return _orientation; }
@@ -58,6 +79,22 @@ protected:
     bool _shouldOutputStarveDebug;
     
     float _nextOutputTrailingLoudness;
+    
+private:
+    /// Resamples the given number of frames starting at the next output into the given number of output frames,
+    /// written so that they end at the same place the input frames did.
+    void stretchFrames(int numInputFrames, int numOutputFrames);
+    
+    quint64 _lastArrivalUsecs;
+    float _interArrivalJitterUsecs;
+    int _desiredJitterBufferSamples;
+    int _framesUntilNextStretch;
+    QVector<int16_t> _stretchSamples;
+    
+    int _numStarves;
+    int _numStretches;
+    qint64 _sumBufferedSamples;
+    int _numBufferedSamplesChecks;
 };
 
 #endif // hifi_PositionalAudioRingBuffer_h
@@ -23,6 +23,7 @@
 #include <LimitedNodeList.h>
 #include <SharedUtil.h>
 
+#include "AudioResampler.h"
 #include "AudioRingBuffer.h"
 #include "Sound.h"
 
@@ -129,19 +130,18 @@ void Sound::downSample(const QByteArray& rawAudioByteArray) {
     // we want to convert it to the format that the audio-mixer wants
     // which is signed, 16-bit, 24Khz, mono
 
-    _byteArray.resize(rawAudioByteArray.size() / 2);
+    AudioResampler resampler(SAMPLE_RATE * 2, SAMPLE_RATE, 1);
 
     int numSourceSamples = rawAudioByteArray.size() / sizeof(int16_t);
-    int16_t* sourceSamples = (int16_t*) rawAudioByteArray.data();
-    int16_t* destinationSamples = (int16_t*) _byteArray.data();
-
-    for (int i = 1; i < numSourceSamples; i += 2) {
-        if (i + 1 >= numSourceSamples) {
-            destinationSamples[(i - 1) / 2] = (sourceSamples[i - 1] / 2) + (sourceSamples[i] / 2);
-        } else {
-            destinationSamples[(i - 1) / 2] = (sourceSamples[i - 1] / 4) + (sourceSamples[i] / 2) + (sourceSamples[i + 1] / 4);
-        }
-    }
+    _byteArray.resize((resampler.getMaxOutputFrames(numSourceSamples) + resampler.getMaxFlushFrames()) * sizeof(int16_t));
+    int16_t* destinationSamples = reinterpret_cast<int16_t*>(_byteArray.data());
+    
+    int numDestinationSamples = resampler.resample(reinterpret_cast<const int16_t*>(rawAudioByteArray.constData()),
+                                                   numSourceSamples, destinationSamples);
+    
+    // the sound ends here, so push its last samples out of the filter rather than leaving them in the history
+    numDestinationSamples += resampler.flush(destinationSamples + numDestinationSamples);
+    _byteArray.resize(numDestinationSamples * sizeof(int16_t));
 }
 
 //
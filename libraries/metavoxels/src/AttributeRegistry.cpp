@@ -489,6 +489,15 @@ MetavoxelNode* SharedObjectSetAttribute::createMetavoxelNode(
     return new MetavoxelNode(value, original);
 }
 
+uint SharedObjectSetAttribute::hash(void* value) const {
+    // sets with the same members may have been built in different orders
+    uint hash = 0;
+    foreach (const SharedObjectPointer& object, decodeInline<SharedObjectSet>(value)) {
+        hash += qHash(object);
+    }
+    return hash;
+}
+
 bool SharedObjectSetAttribute::merge(void*& parent, void* children[], bool postRead) const {
     for (int i = 0; i < MERGE_COUNT; i++) {
         if (!decodeInline<SharedObjectSet>(children[i]).isEmpty()) {
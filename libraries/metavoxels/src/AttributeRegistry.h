@@ -13,6 +13,7 @@
 #define hifi_AttributeRegistry_h
 
 #include <QHash>
+#include <QMutex>
 #include <QObject>
 #include <QSharedPointer>
 #include <QString>
@@ -213,6 +214,15 @@ public:
 
     virtual bool equal(void* first, void* second) const = 0;
 
+    /// Returns a hash of the value, such that values that are equal have the same hash.
+    virtual uint hash(void* value) const { return 0; }
+
+    /// Returns a reference to the canonical nodes of this attribute, keyed by the hashes of their contents.
+    /// See MetavoxelNode::intern.
+    QMultiHash<uint, MetavoxelNode*>& getInternedNodes() { return _internedNodes; }
+    
+    QMutex& getInternedNodesMutex() { return _internedNodesMutex; }
+
     /// Merges the value of a parent and its children.
     /// \param postRead whether or not the merge is happening after a read
     /// \return whether or not the children and parent values are all equal
@@ -240,6 +250,9 @@ public:
 private:
     
     float _lodThresholdMultiplier;
+    
+    QMultiHash<uint, MetavoxelNode*> _internedNodes;
+    QMutex _internedNodesMutex;
 };
 
 /// A simple attribute class that stores its values inline.
@@ -256,6 +269,8 @@ public:
 
     virtual bool equal(void* first, void* second) const { return decodeInline<T>(first) == decodeInline<T>(second); }
 
+    virtual uint hash(void* value) const;
+
     virtual void* mix(void* first, void* second, float alpha) const { return create(alpha < 0.5f ? first : second); }
 
     virtual void* blend(void* source, void* dest) const { return create(source); }
@@ -267,6 +282,12 @@ protected:
     T _defaultValue;
 };
 
+template<class T, int bits> inline uint InlineAttribute<T, bits>::hash(void* value) const {
+    // only the bytes of the value itself; the rest of the pointer is undefined
+    T decoded = decodeInline<T>(value);
+    return qHash(QByteArray::fromRawData((const char*)&decoded, sizeof(T)));
+}
+
 template<class T, int bits> inline void InlineAttribute<T, bits>::read(Bitstream& in, void*& value, bool isLeaf) const {
     if (isLeaf) {
         value = getDefaultValue();
@@ -434,6 +455,8 @@ public:
     
     virtual MetavoxelNode* createMetavoxelNode(const AttributeValue& value, const MetavoxelNode* original) const;
     
+    virtual uint hash(void* value) const;
+    
     virtual bool merge(void*& parent, void* children[], bool postRead = false) const;
 
     virtual AttributeValue inherit(const AttributeValue& parentValue) const;
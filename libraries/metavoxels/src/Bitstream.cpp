@@ -15,6 +15,7 @@
 #include <QDataStream>
 #include <QMetaType>
 #include <QUrl>
+#include <QtEndian>
 #include <QtDebug>
 
 #include <RegisteredMetaTypes.h>
@@ -99,11 +100,18 @@ QList<const QMetaObject*> Bitstream::getMetaObjectSubClasses(const QMetaObject*
     return getMetaObjectSubClasses().values(metaObject);
 }
 
+BitstreamRecording::BitstreamRecording() :
+    _bitCount(0) {
+}
+
 Bitstream::Bitstream(QDataStream& underlying, MetadataType metadataType, QObject* parent) :
     QObject(parent),
     _underlying(underlying),
-    _byte(0),
+    _accumulator(0),
     _position(0),
+    _buffer(),
+    _bufferSize(0),
+    _recording(false),
     _metadataType(metadataType),
     _metaObjectStreamer(*this),
     _typeStreamerStreamer(*this),
@@ -120,54 +128,184 @@ void Bitstream::addTypeSubstitution(const QByteArray& typeName, int type) {
     _typeStreamerSubstitutions.insert(typeName, getTypeStreamers().value(type));
 }
 
-const int LAST_BIT_POSITION = BITS_IN_BYTE - 1;
+const int BITS_IN_WORD = 32;
+
+inline char* Bitstream::appendToBuffer(int bytes) {
+    int newSize = _bufferSize + bytes;
+    if (newSize > _buffer.size()) {
+        _buffer.resize(qMax(newSize, _buffer.size() * 2));
+    }
+    char* start = _buffer.data() + _bufferSize;
+    _bufferSize = newSize;
+    return start;
+}
+
+inline void Bitstream::writeBits(quint32 value, int bits) {
+    _accumulator |= (quint64)value << _position;
+    if ((_position += bits) >= BITS_IN_WORD) {
+        qToLittleEndian((quint32)_accumulator, (uchar*)appendToBuffer(sizeof(quint32)));
+        _accumulator >>= BITS_IN_WORD;
+        _position -= BITS_IN_WORD;
+    }
+}
+
+inline quint32 Bitstream::readBits(int bits) {
+    if (_position < bits) {
+        // read just the bytes that the bits span, so as to leave the rest for whoever reads the stream after us
+        uchar bytes[sizeof(quint32)] = { 0, 0, 0, 0 };
+        int bytesToRead = (bits - _position + BITS_IN_BYTE - 1) / BITS_IN_BYTE;
+        _underlying.readRawData((char*)bytes, bytesToRead);
+        for (int i = 0; i < bytesToRead; i++) {
+            _accumulator |= (quint64)bytes[i] << _position;
+            _position += BITS_IN_BYTE;
+        }
+    }
+    quint32 value = (quint32)(_accumulator & ((1ULL << bits) - 1));
+    _accumulator >>= bits;
+    _position -= bits;
+    return value;
+}
+
+void Bitstream::writeAccumulatedBytes() {
+    int bytes = (_position + BITS_IN_BYTE - 1) / BITS_IN_BYTE;
+    char* destination = appendToBuffer(bytes);
+    for (int i = 0; i < bytes; i++) {
+        destination[i] = (char)(_accumulator >> (i * BITS_IN_BYTE));
+    }
+    _accumulator = 0;
+    _position = 0;
+}
+
+const int BITS_IN_HALF_WORD = 16;
 
 Bitstream& Bitstream::write(const void* data, int bits, int offset) {
     const quint8* source = (const quint8*)data;
-    while (bits > 0) {
-        int bitsToWrite = qMin(BITS_IN_BYTE - _position, qMin(BITS_IN_BYTE - offset, bits));
-        _byte |= ((*source >> offset) & ((1 << bitsToWrite) - 1)) << _position;
-        if ((_position += bitsToWrite) == BITS_IN_BYTE) {
-            flush();
-        }
-        if ((offset += bitsToWrite) == BITS_IN_BYTE) {
-            source++;
-            offset = 0;
+    if (offset == 0) {
+        // the fixed-width values go straight into the accumulator, wherever it happens to be
+        switch (bits) {
+            case BITS_IN_WORD:
+                writeBits(qFromLittleEndian<quint32>(source), BITS_IN_WORD);
+                return *this;
+                
+            case BITS_IN_HALF_WORD:
+                writeBits(qFromLittleEndian<quint16>(source), BITS_IN_HALF_WORD);
+                return *this;
+                
+            case BITS_IN_BYTE:
+                writeBits(*source, BITS_IN_BYTE);
+                return *this;
         }
+    } else {
+        // bring the source up to a byte boundary
+        int bitsToWrite = qMin(BITS_IN_BYTE - offset, bits);
+        writeBits((*source++ >> offset) & ((1 << bitsToWrite) - 1), bitsToWrite);
         bits -= bitsToWrite;
     }
+    if (_position % BITS_IN_BYTE == 0) {
+        // both sides are byte-aligned, so whole bytes can be copied straight into the buffer
+        int bytes = bits / BITS_IN_BYTE;
+        if (bytes > 0) {
+            writeAccumulatedBytes();
+            memcpy(appendToBuffer(bytes), source, bytes);
+            source += bytes;
+            bits -= bytes * BITS_IN_BYTE;
+        }
+    } else {
+        for (; bits >= BITS_IN_WORD; bits -= BITS_IN_WORD, source += sizeof(quint32)) {
+            writeBits(qFromLittleEndian<quint32>(source), BITS_IN_WORD);
+        }
+        for (; bits >= BITS_IN_BYTE; bits -= BITS_IN_BYTE) {
+            writeBits(*source++, BITS_IN_BYTE);
+        }
+    }
+    if (bits > 0) {
+        writeBits(*source & ((1 << bits) - 1), bits);
+    }
     return *this;
 }
 
 Bitstream& Bitstream::read(void* data, int bits, int offset) {
     quint8* dest = (quint8*)data;
-    while (bits > 0) {
-        if (_position == 0) {
-            _underlying >> _byte;
+    if (offset == 0) {
+        switch (bits) {
+            case BITS_IN_WORD:
+                qToLittleEndian(readBits(BITS_IN_WORD), dest);
+                return *this;
+                
+            case BITS_IN_HALF_WORD:
+                qToLittleEndian((quint16)readBits(BITS_IN_HALF_WORD), dest);
+                return *this;
+                
+            case BITS_IN_BYTE:
+                *dest = readBits(BITS_IN_BYTE);
+                return *this;
         }
-        int bitsToRead = qMin(BITS_IN_BYTE - _position, qMin(BITS_IN_BYTE - offset, bits));
+    } else {
+        int bitsToRead = qMin(BITS_IN_BYTE - offset, bits);
         int mask = ((1 << bitsToRead) - 1) << offset;
-        *dest = (*dest & ~mask) | (((_byte >> _position) << offset) & mask);
-        _position = (_position + bitsToRead) & LAST_BIT_POSITION;
-        if ((offset += bitsToRead) == BITS_IN_BYTE) {
-            dest++;
-            offset = 0;
-        }
+        *dest = (*dest & ~mask) | ((readBits(bitsToRead) << offset) & mask);
+        dest++;
         bits -= bitsToRead;
     }
+    if (_position == 0) {
+        // we never read ahead past the byte we're in, so an empty accumulator means we're aligned with the underlying
+        // stream and can read whole bytes straight from it
+        int bytes = bits / BITS_IN_BYTE;
+        if (bytes > 0) {
+            int bytesRead = _underlying.readRawData((char*)dest, bytes);
+            if (bytesRead < bytes) {
+                memset(dest + qMax(bytesRead, 0), 0, bytes - qMax(bytesRead, 0));
+            }
+            dest += bytes;
+            bits -= bytes * BITS_IN_BYTE;
+        }
+    } else {
+        for (; bits >= BITS_IN_WORD; bits -= BITS_IN_WORD, dest += sizeof(quint32)) {
+            qToLittleEndian(readBits(BITS_IN_WORD), dest);
+        }
+        for (; bits >= BITS_IN_BYTE; bits -= BITS_IN_BYTE) {
+            *dest++ = readBits(BITS_IN_BYTE);
+        }
+    }
+    if (bits > 0) {
+        int mask = (1 << bits) - 1;
+        *dest = (*dest & ~mask) | (readBits(bits) & mask);
+    }
     return *this;
 }
 
 void Bitstream::flush() {
     if (_position != 0) {
-        _underlying << _byte;
-        reset();
+        writeAccumulatedBytes();
+    }
+    if (_bufferSize != 0) {
+        _underlying.writeRawData(_buffer.constData(), _bufferSize);
+        _bufferSize = 0;
     }
 }
 
 void Bitstream::reset() {
-    _byte = 0;
+    _accumulator = 0;
     _position = 0;
+    _bufferSize = 0;
+}
+
+void Bitstream::startRecording() {
+    reset();
+    _recording = true;
+}
+
+BitstreamRecording Bitstream::stopRecording() {
+    BitstreamRecording recording;
+    recording._bitCount = _bufferSize * BITS_IN_BYTE + _position;
+    if (_position != 0) {
+        writeAccumulatedBytes();
+    }
+    recording._data = QByteArray(_buffer.constData(), _bufferSize);
+    recording._values.swap(_recordedValues);
+    _recording = false;
+    reset();
+    return recording;
 }
 
 Bitstream::WriteMappings Bitstream::getAndResetWriteMappings() {
@@ -300,24 +438,17 @@ void Bitstream::readRawDelta(QObject*& value, const QObject* reference) {
 }
 
 Bitstream& Bitstream::operator<<(bool value) {
-    if (value) {
-        _byte |= (1 << _position);
-    }
-    if (++_position == BITS_IN_BYTE) {
-        flush();
-    }
+    writeBits(value ? 1 : 0, 1);
     return *this;
 }
 
 Bitstream& Bitstream::operator>>(bool& value) {
-    if (_position == 0) {
-        _underlying >> _byte;
-    }
-    value = _byte & (1 << _position);
-    _position = (_position + 1) & LAST_BIT_POSITION;
+    value = readBits(1);
     return *this;
 }
 
+// the fixed-width values take the accumulator fast path in write and read, in the same order their bytes sit in memory
+
 Bitstream& Bitstream::operator<<(int value) {
     return write(&value, 32);
 }
@@ -542,6 +673,42 @@ Bitstream& Bitstream::operator>>(SharedObjectPointer& object) {
     return *this;
 }
 
+Bitstream& Bitstream::operator<<(const BitstreamRecording& recording) {
+    const char* data = recording._data.constData();
+    int position = 0;
+    foreach (const BitstreamRecording::Value& value, recording._values) {
+        if (value.position > position) {
+            write(data + position / BITS_IN_BYTE, value.position - position, position % BITS_IN_BYTE);
+            position = value.position;
+        }
+        switch (value.type) {
+            case BitstreamRecording::META_OBJECT_VALUE:
+                _metaObjectStreamer << static_cast<const QMetaObject*>(value.pointer);
+                break;
+                
+            case BitstreamRecording::TYPE_STREAMER_VALUE:
+                _typeStreamerStreamer << static_cast<const TypeStreamer*>(value.pointer);
+                break;
+                
+            case BitstreamRecording::ATTRIBUTE_VALUE:
+                _attributeStreamer << AttributePointer(static_cast<Attribute*>(value.object.data()));
+                break;
+                
+            case BitstreamRecording::SCRIPT_STRING_VALUE:
+                _scriptStringStreamer << value.string;
+                break;
+                
+            case BitstreamRecording::SHARED_OBJECT_VALUE:
+                _sharedObjectStreamer << value.object;
+                break;
+        }
+    }
+    if (recording._bitCount > position) {
+        write(data + position / BITS_IN_BYTE, recording._bitCount - position, position % BITS_IN_BYTE);
+    }
+    return *this;
+}
+
 Bitstream& Bitstream::operator<(const QMetaObject* metaObject) {
     if (!metaObject) {
         return *this << QByteArray();
@@ -891,6 +1058,32 @@ Bitstream& Bitstream::operator>(SharedObjectPointer& object) {
     return *this;
 }
 
+void Bitstream::record(const QMetaObject* metaObject) {
+    recordValue(BitstreamRecording::META_OBJECT_VALUE, metaObject);
+}
+
+void Bitstream::record(const TypeStreamer* streamer) {
+    recordValue(BitstreamRecording::TYPE_STREAMER_VALUE, streamer);
+}
+
+void Bitstream::record(const AttributePointer& attribute) {
+    recordValue(BitstreamRecording::ATTRIBUTE_VALUE, NULL, attribute.data());
+}
+
+void Bitstream::record(const QScriptString& string) {
+    recordValue(BitstreamRecording::SCRIPT_STRING_VALUE, NULL, SharedObjectPointer(), string);
+}
+
+void Bitstream::record(const SharedObjectPointer& object) {
+    recordValue(BitstreamRecording::SHARED_OBJECT_VALUE, NULL, object);
+}
+
+void Bitstream::recordValue(BitstreamRecording::ValueType type, const void* pointer,
+        const SharedObjectPointer& object, const QScriptString& string) {
+    BitstreamRecording::Value value = { _bufferSize * BITS_IN_BYTE + _position, type, pointer, object, string };
+    _recordedValues.append(value);
+}
+
 void Bitstream::clearSharedObject(QObject* object) {
     SharedObject* sharedObject = static_cast<SharedObject*>(object);
     _sharedObjectReferences.remove(sharedObject->getID());
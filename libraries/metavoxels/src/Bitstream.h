@@ -12,6 +12,7 @@
 #ifndef hifi_Bitstream_h
 #define hifi_Bitstream_h
 
+#include <QByteArray>
 #include <QHash>
 #include <QMetaProperty>
 #include <QMetaType>
@@ -26,7 +27,6 @@
 
 #include "SharedObject.h"
 
-class QByteArray;
 class QColor;
 class QDataStream;
 class QUrl;
@@ -144,24 +144,6 @@ template<class K, class P, class V> inline void RepeatedValueStreamer<K, P, V>::
     _idStreamer.setBitsFromValue(_lastPersistentID);
 }
 
-template<class K, class P, class V> inline RepeatedValueStreamer<K, P, V>&
-        RepeatedValueStreamer<K, P, V>::operator<<(K value) {
-    int id = _persistentIDs.value(value);
-    if (id == 0) {
-        int& offset = _transientOffsets[value];
-        if (offset == 0) {
-            _idStreamer << (_lastPersistentID + (offset = ++_lastTransientOffset));
-            _stream < value;
-            
-        } else {
-            _idStreamer << (_lastPersistentID + offset);
-        }
-    } else {
-        _idStreamer << id;
-    }
-    return *this;
-}
-
 template<class K, class P, class V> inline RepeatedValueStreamer<K, P, V>&
         RepeatedValueStreamer<K, P, V>::operator>>(V& value) {
     int id;
@@ -183,7 +165,39 @@ template<class K, class P, class V> inline RepeatedValueStreamer<K, P, V>&
     return *this;
 }
 
-/// A stream for bit-aligned data.
+/// A recording of what was written to a bitstream, which may be replayed into any number of other streams.  The values
+/// whose encoding depends on the mappings of the stream (metaobjects, type streamers, attributes, script strings and shared
+/// objects) are kept aside, to be written through the mappings of each stream that the recording is replayed into.
+class BitstreamRecording {
+public:
+    
+    BitstreamRecording();
+    
+    /// Returns the number of bits recorded, not counting the values kept aside.
+    int getBitCount() const { return _bitCount; }
+    
+private:
+    
+    friend class Bitstream;
+    
+    enum ValueType { META_OBJECT_VALUE, TYPE_STREAMER_VALUE, ATTRIBUTE_VALUE, SCRIPT_STRING_VALUE, SHARED_OBJECT_VALUE };
+    
+    class Value {
+    public:
+        int position; /// the number of bits recorded before the value
+        ValueType type;
+        const void* pointer; /// the metaobject or type streamer
+        SharedObjectPointer object; /// the attribute or shared object
+        QScriptString string;
+    };
+    
+    QByteArray _data;
+    int _bitCount;
+    QVector<Value> _values;
+};
+
+/// A stream for bit-aligned data.  Bits are gathered a word at a time: when writing, into a buffer that only reaches the
+/// underlying stream on flush; when reading, from only as many bytes of the underlying stream as the bits requested span.
 class Bitstream : public QObject {
     Q_OBJECT
 
@@ -248,9 +262,17 @@ public:
     /// Flushes any unwritten bits to the underlying stream.
     void flush();
 
-    /// Resets to the initial state.
+    /// Resets to the initial state, discarding anything written but not yet flushed.
     void reset();
 
+    /// Starts recording what is written rather than writing it, discarding anything written but not yet flushed.
+    void startRecording();
+    
+    /// Stops recording and returns the recording.
+    BitstreamRecording stopRecording();
+    
+    bool isRecording() const { return _recording; }
+
     /// Returns the set of transient mappings gathered during writing and resets them.
     WriteMappings getAndResetWriteMappings();
 
@@ -365,6 +387,9 @@ public:
     Bitstream& operator<<(const SharedObjectPointer& object);
     Bitstream& operator>>(SharedObjectPointer& object);
     
+    /// Replays a recording (made by this stream or any other) through this stream's mappings.
+    Bitstream& operator<<(const BitstreamRecording& recording);
+    
     Bitstream& operator<(const QMetaObject* metaObject);
     Bitstream& operator>(ObjectReader& objectReader);
     
@@ -390,10 +415,39 @@ private slots:
 
 private:
     
+    template<class K, class P, class V> friend class RepeatedValueStreamer;
+    
+    /// Appends up to 32 bits to the accumulator, moving each filled word to the buffer.
+    void writeBits(quint32 value, int bits);
+    
+    /// Takes up to 32 bits from the accumulator, refilling it from the underlying stream as needed.
+    quint32 readBits(int bits);
+    
+    /// Moves the whole bytes in the accumulator to the buffer.
+    void writeAccumulatedBytes();
+    
+    /// Makes room for the given number of bytes at the end of the buffer.
+    /// \return a pointer to the first
+    char* appendToBuffer(int bytes);
+    
+    /// Sets aside a value written while recording.
+    void record(const QMetaObject* metaObject);
+    void record(const TypeStreamer* streamer);
+    void record(const AttributePointer& attribute);
+    void record(const QScriptString& string);
+    void record(const SharedObjectPointer& object);
+    void recordValue(BitstreamRecording::ValueType type, const void* pointer = NULL,
+        const SharedObjectPointer& object = SharedObjectPointer(), const QScriptString& string = QScriptString());
+    
     QDataStream& _underlying;
-    quint8 _byte;
-    int _position;
+    quint64 _accumulator; /// bits waiting to be written or read, lowest first
+    int _position; /// the number of bits in the accumulator
+    QByteArray _buffer; /// whole bytes written, but not yet flushed
+    int _bufferSize;
 
+    bool _recording;
+    QVector<BitstreamRecording::Value> _recordedValues;
+    
     MetadataType _metadataType;
 
     RepeatedValueStreamer<const QMetaObject*, const QMetaObject*, ObjectReader> _metaObjectStreamer;
@@ -415,6 +469,28 @@ private:
     static QVector<PropertyReader> getPropertyReaders(const QMetaObject* metaObject);
 };
 
+template<class K, class P, class V> inline RepeatedValueStreamer<K, P, V>&
+        RepeatedValueStreamer<K, P, V>::operator<<(K value) {
+    if (_stream.isRecording()) {
+        _stream.record(value);
+        return *this;
+    }
+    int id = _persistentIDs.value(value);
+    if (id == 0) {
+        int& offset = _transientOffsets[value];
+        if (offset == 0) {
+            _idStreamer << (_lastPersistentID + (offset = ++_lastTransientOffset));
+            _stream < value;
+            
+        } else {
+            _idStreamer << (_lastPersistentID + offset);
+        }
+    } else {
+        _idStreamer << id;
+    }
+    return *this;
+}
+
 template<class T> inline void Bitstream::writeDelta(const T& value, const T& reference) {
     if (value == reference) {
         *this << false;
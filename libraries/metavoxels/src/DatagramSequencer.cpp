@@ -14,6 +14,7 @@
 #include <QtDebug>
 
 #include <LimitedNodeList.h>
+#include <SharedUtil.h>
 
 #include "DatagramSequencer.h"
 #include "MetavoxelMessages.h"
@@ -23,6 +24,18 @@ const int MAX_DATAGRAM_SIZE = MAX_PACKET_SIZE;
 
 const int DEFAULT_MAX_PACKET_SIZE = 3000;
 
+// the congestion window parameters, in packets of the maximum size
+const int MINIMUM_CONGESTION_WINDOW_PACKETS = 2;
+const int ALLOWED_CONGESTION_WINDOW_INCREASE_PACKETS = 1;
+
+// the queuing delay at which the congestion window stops growing
+const int TARGET_QUEUING_DELAY_USECS = 100 * 1000;
+const float CONGESTION_WINDOW_GAIN = 1.0f;
+
+// the base delay is the minimum over this many intervals of this length
+const int BASE_DELAY_HISTORY_LENGTH = 10;
+const quint64 BASE_DELAY_INTERVAL_USECS = 60 * 1000 * 1000;
+
 DatagramSequencer::DatagramSequencer(const QByteArray& datagramHeader, QObject* parent) :
     QObject(parent),
     _outgoingPacketStream(&_outgoingPacketData, QIODevice::WriteOnly),
@@ -37,7 +50,11 @@ DatagramSequencer::DatagramSequencer(const QByteArray& datagramHeader, QObject*
     _incomingPacketStream(&_incomingPacketData, QIODevice::ReadOnly),
     _inputStream(_incomingPacketStream),
     _receivedHighPriorityMessages(0),
-    _maxPacketSize(DEFAULT_MAX_PACKET_SIZE) {
+    _maxPacketSize(DEFAULT_MAX_PACKET_SIZE),
+    _congestionWindow(MINIMUM_CONGESTION_WINDOW_PACKETS * DEFAULT_MAX_PACKET_SIZE),
+    _bytesInFlight(0),
+    _lastWindowReductionPacketNumber(0),
+    _baseDelayIntervalStart(0) {
 
     _outgoingPacketStream.setByteOrder(QDataStream::LittleEndian);
     _incomingDatagramStream.setByteOrder(QDataStream::LittleEndian);
@@ -91,8 +108,8 @@ Bitstream& DatagramSequencer::startPacket() {
 void DatagramSequencer::endPacket() {
     _outputStream.flush();
     
-    // if we have space remaining, send some data from our reliable channels 
-    int remaining = _maxPacketSize - _outgoingPacketStream.device()->pos();
+    // if we have space remaining (and the congestion window allows), send some data from our reliable channels 
+    int remaining = qMin(_maxPacketSize - (int)_outgoingPacketStream.device()->pos(), _congestionWindow - _bytesInFlight);
     const int MINIMUM_RELIABLE_SIZE = sizeof(quint32) * 5; // count, channel number, segment count, offset, size
     QVector<ChannelSpan> spans;
     if (remaining > MINIMUM_RELIABLE_SIZE) {
@@ -172,6 +189,10 @@ void DatagramSequencer::receivedDatagram(const QByteArray& datagram) {
         if (index < 0 || index >= _sendRecords.size()) {
             continue;
         }
+        // anything sent before the acknowledged packet that we haven't heard about was lost
+        for (int j = 0; j < index; j++) {
+            sendRecordLost(_sendRecords.at(j));
+        }
         QList<SendRecord>::iterator it = _sendRecords.begin() + index;
         sendRecordAcknowledged(*it);
         emit sendAcknowledged(index);
@@ -249,12 +270,65 @@ void DatagramSequencer::sendRecordAcknowledged(const SendRecord& record) {
         }
     }
     
-    // acknowledge the received spans
+    // acknowledge the received spans, noting how much of their data we're hearing about for the first time
+    int newlyAcknowledgedBytes = 0;
     foreach (const ChannelSpan& span, record.spans) {
-        getReliableOutputChannel(span.channel)->spanAcknowledged(span);
+        newlyAcknowledgedBytes += getReliableOutputChannel(span.channel)->spanAcknowledged(span);
+    }
+    
+    updateCongestionWindow(record, newlyAcknowledgedBytes == record.reliableBytes);
+}
+
+void DatagramSequencer::sendRecordLost(const SendRecord& record) {
+    _bytesInFlight -= record.reliableBytes;
+    
+    // halve the window on loss, but only once for all the packets that were in flight at the time
+    if (record.packetNumber > _lastWindowReductionPacketNumber) {
+        _congestionWindow = qMax(_congestionWindow / 2, MINIMUM_CONGESTION_WINDOW_PACKETS * _maxPacketSize);
+        _lastWindowReductionPacketNumber = _outgoingPacketNumber;
     }
 }
 
+void DatagramSequencer::updateCongestionWindow(const SendRecord& record, bool firstAcknowledgement) {
+    int flightSize = _bytesInFlight;
+    _bytesInFlight -= record.reliableBytes;
+    
+    // a send whose data was already acknowledged through another copy, or that was queued behind a loss, doesn't tell us
+    // anything reliable about the delay
+    if (!firstAcknowledgement || record.packetNumber <= _lastWindowReductionPacketNumber) {
+        return;
+    }
+    
+    // the base delay is the smallest round trip we've seen lately; anything over that we take to be time spent in queues
+    quint64 now = usecTimestampNow();
+    int delay = (int)(now - record.sentTime);
+    if (_baseDelays.isEmpty() || now - _baseDelayIntervalStart >= BASE_DELAY_INTERVAL_USECS) {
+        _baseDelays.append(delay);
+        if (_baseDelays.size() > BASE_DELAY_HISTORY_LENGTH) {
+            _baseDelays.removeFirst();
+        }
+        _baseDelayIntervalStart = now;
+        
+    } else {
+        _baseDelays.last() = qMin(_baseDelays.last(), delay);
+    }
+    if (record.reliableBytes == 0) {
+        return;
+    }
+    int baseDelay = delay;
+    foreach (int intervalDelay, _baseDelays) {
+        baseDelay = qMin(baseDelay, intervalDelay);
+    }
+    
+    // grow in proportion to how far we are under the target delay, shrink in proportion to how far we are over, and don't
+    // grow much beyond what we're actually using
+    float offTarget = (TARGET_QUEUING_DELAY_USECS - (delay - baseDelay)) / (float)TARGET_QUEUING_DELAY_USECS;
+    _congestionWindow += (int)(CONGESTION_WINDOW_GAIN * offTarget * record.reliableBytes * _maxPacketSize /
+        _congestionWindow);
+    _congestionWindow = qMax(qMin(_congestionWindow, flightSize + ALLOWED_CONGESTION_WINDOW_INCREASE_PACKETS *
+        _maxPacketSize), MINIMUM_CONGESTION_WINDOW_PACKETS * _maxPacketSize);
+}
+
 void DatagramSequencer::appendReliableData(int bytes, QVector<ChannelSpan>& spans) {
     // gather total number of bytes to write, priority
     int totalBytes = 0;
@@ -294,9 +368,14 @@ void DatagramSequencer::sendPacket(const QByteArray& packet, const QVector<Chann
     _outgoingPacketNumber++;
     
     // record the send
+    int reliableBytes = 0;
+    foreach (const ChannelSpan& span, spans) {
+        reliableBytes += span.length;
+    }
     SendRecord record = { _outgoingPacketNumber, _receiveRecords.isEmpty() ? 0 : _receiveRecords.last().packetNumber,
-        _outputStream.getAndResetWriteMappings(), spans };
+        _outputStream.getAndResetWriteMappings(), spans, usecTimestampNow(), reliableBytes };
     _sendRecords.append(record);
+    _bytesInFlight += reliableBytes;
     
     // write the sequence number and size, which are the same between all fragments
     _outgoingDatagramBuffer.seek(_datagramHeaderSize);
@@ -693,7 +772,8 @@ int ReliableChannel::writeSpan(QDataStream& out, bool& first, int position, int
     return length;
 }
 
-void ReliableChannel::spanAcknowledged(const DatagramSequencer::ChannelSpan& span) {
+int ReliableChannel::spanAcknowledged(const DatagramSequencer::ChannelSpan& span) {
+    int previouslyAcknowledged = _offset + _acknowledged.getTotalSet();
     int advancement = _acknowledged.set(span.offset - _offset, span.length);
     if (advancement > 0) {
         _buffer.remove(advancement);
@@ -701,7 +781,8 @@ void ReliableChannel::spanAcknowledged(const DatagramSequencer::ChannelSpan& spa
         
         _offset += advancement;
         _writePosition = qMax(_writePosition - advancement, 0);
-    } 
+    }
+    return _offset + _acknowledged.getTotalSet() - previouslyAcknowledged;
 }
 
 void ReliableChannel::readData(QDataStream& in) {
@@ -716,14 +797,23 @@ void ReliableChannel::readData(QDataStream& in) {
         int end = position + size;
         if (end <= 0) {
             in.skipRawData(size);
-            
-        } else if (position < 0) {
+            continue;
+        }
+        if (position < 0) {
             in.skipRawData(-position);
-            _assemblyBuffer.readFromStream(0, end, in);
-            
-        } else {
-            _assemblyBuffer.readFromStream(position, size, in);
+            position = 0;
+            size = end;
+        }
+        if (position == 0 && _acknowledged.getSpans().isEmpty()) {
+            // in the usual case, the data picks up right where the last left off with nothing waiting beyond it, so it can
+            // go straight into the buffer without passing through the assembly buffer
+            _buffer.readFromStream(_buffer.size(), size, in);
+            _acknowledged.set(0, size);
+            _offset += size;
+            readSome = true;
+            continue;
         }
+        _assemblyBuffer.readFromStream(position, size, in);
         int advancement = _acknowledged.set(position, size);
         if (advancement > 0) {
             _assemblyBuffer.appendToBuffer(0, advancement, _buffer);
@@ -61,6 +61,12 @@ public:
     
     int getMaxPacketSize() const { return _maxPacketSize; }
     
+    /// Returns the number of bytes of reliable data that may be unacknowledged at any one time.
+    int getCongestionWindow() const { return _congestionWindow; }
+    
+    /// Returns the number of bytes of reliable data sent but neither acknowledged nor known to be lost.
+    int getBytesInFlight() const { return _bytesInFlight; }
+    
     /// Returns the output channel at the specified index, creating it if necessary.
     ReliableChannel* getReliableOutputChannel(int index = 0);
     
@@ -119,6 +125,8 @@ private:
         int lastReceivedPacketNumber;
         Bitstream::WriteMappings mappings;
         QVector<ChannelSpan> spans; 
+        quint64 sentTime;
+        int reliableBytes;
     };
     
     class ReceiveRecord {
@@ -133,6 +141,14 @@ private:
     /// Notes that the described send was acknowledged by the other party.
     void sendRecordAcknowledged(const SendRecord& record);
     
+    /// Notes that the described send was lost, because a later one was acknowledged first.
+    void sendRecordLost(const SendRecord& record);
+    
+    /// Grows or shrinks the congestion window according to the queuing delay measured by the acknowledgement of the
+    /// described send, in the manner of LEDBAT (RFC 6817).
+    /// \param firstAcknowledgement whether all of the send's reliable data was acknowledged for the first time
+    void updateCongestionWindow(const SendRecord& record, bool firstAcknowledgement);
+    
     /// Appends some reliable data to the outgoing packet.
     void appendReliableData(int bytes, QVector<ChannelSpan>& spans);
     
@@ -168,6 +184,12 @@ private:
     
     int _maxPacketSize;
     
+    int _congestionWindow;
+    int _bytesInFlight;
+    int _lastWindowReductionPacketNumber;
+    QList<int> _baseDelays; /// the minimum round trip times of the last few intervals, in microseconds
+    quint64 _baseDelayIntervalStart;
+    
     QHash<int, ReliableChannel*> _reliableOutputChannels;
     QHash<int, ReliableChannel*> _reliableInputChannels;
 };
@@ -304,7 +326,9 @@ private:
     int getBytesToWrite(bool& first, int length) const;
     int writeSpan(QDataStream& out, bool& first, int position, int length, QVector<DatagramSequencer::ChannelSpan>& spans);
     
-    void spanAcknowledged(const DatagramSequencer::ChannelSpan& span);
+    /// Notes that the described span was received by the other party.
+    /// \return the number of bytes acknowledged for the first time
+    int spanAcknowledged(const DatagramSequencer::ChannelSpan& span);
     
     void readData(QDataStream& in);
     
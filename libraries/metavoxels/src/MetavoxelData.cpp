@@ -10,7 +10,10 @@
 //
 
 #include <QDateTime>
+#include <QRunnable>
 #include <QScriptEngine>
+#include <QSemaphore>
+#include <QThreadPool>
 #include <QtDebug>
 
 #include <GeometryUtil.h>
@@ -55,12 +58,273 @@ bool MetavoxelLOD::becameSubdivided(const glm::vec3& minimum, float size,
         qMax(0.0f, glm::distance(reference.position, center) - radius) * reference.threshold;
 }
 
+/// The most spanners a leaf of the index holds before we split it.
+const int MAX_SPANNER_INDEX_LEAF_SIZE = 8;
+
+class SpannerIndexEntry {
+public:
+    SharedObjectPointer object;
+    Box bounds;
+};
+
+static Box getUnion(const Box& first, const Box& second) {
+    return Box(glm::min(first.minimum, second.minimum), glm::max(first.maximum, second.maximum));
+}
+
+static float getSurfaceArea(const Box& box) {
+    glm::vec3 extent = box.maximum - box.minimum;
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+/// Orders index entries by the position of their centers along one axis.
+class SpannerIndexEntryAxisLessThan {
+public:
+    
+    SpannerIndexEntryAxisLessThan(int axis) : _axis(axis) { }
+    
+    bool operator()(const SpannerIndexEntry& first, const SpannerIndexEntry& second) const {
+        return first.bounds.getCenter()[_axis] < second.bounds.getCenter()[_axis];
+    }
+
+private:
+    
+    int _axis;
+};
+
+/// A node in the spanner index: either a leaf holding entries or a branch with exactly two children.
+class SpannerIndex::Node {
+public:
+    
+    Box bounds;
+    Node* parent;
+    Node* children[2];
+    QVector<SpannerIndexEntry> entries;
+    
+    Node(Node* parent = NULL);
+    ~Node();
+    
+    bool isLeaf() const { return !children[0]; }
+    
+    /// Creates a deep copy of this node, recording the new leaves of the entries.
+    Node* copy(Node* parent, QHash<SharedObjectPointer, Node*>& leaves) const;
+    
+    /// Recomputes the bounds from the entries or children.
+    void updateBounds();
+    
+    void findFirstRayIntersection(const glm::vec3& origin, const glm::vec3& direction,
+        SharedObjectPointer& closestObject, float& closestDistance) const;
+    
+    void getIntersecting(const Box& bounds, QList<SharedObjectPointer>& results) const;
+};
+
+SpannerIndex::Node::Node(Node* parent) :
+    parent(parent) {
+    
+    children[0] = children[1] = NULL;
+}
+
+SpannerIndex::Node::~Node() {
+    delete children[0];
+    delete children[1];
+}
+
+SpannerIndex::Node* SpannerIndex::Node::copy(Node* parent, QHash<SharedObjectPointer, Node*>& leaves) const {
+    Node* node = new Node(parent);
+    node->bounds = bounds;
+    if (isLeaf()) {
+        node->entries = entries;
+        foreach (const SpannerIndexEntry& entry, entries) {
+            leaves.insert(entry.object, node);
+        }
+    } else {
+        node->children[0] = children[0]->copy(node, leaves);
+        node->children[1] = children[1]->copy(node, leaves);
+    }
+    return node;
+}
+
+void SpannerIndex::Node::updateBounds() {
+    if (!isLeaf()) {
+        bounds = getUnion(children[0]->bounds, children[1]->bounds);
+        return;
+    }
+    if (entries.isEmpty()) {
+        return;
+    }
+    bounds = entries.at(0).bounds;
+    for (int i = 1; i < entries.size(); i++) {
+        bounds = getUnion(bounds, entries.at(i).bounds);
+    }
+}
+
+void SpannerIndex::Node::findFirstRayIntersection(const glm::vec3& origin, const glm::vec3& direction,
+        SharedObjectPointer& closestObject, float& closestDistance) const {
+    if (isLeaf()) {
+        foreach (const SpannerIndexEntry& entry, entries) {
+            float distance;
+            if (entry.bounds.findRayIntersection(origin, direction, distance) && distance < closestDistance &&
+                    static_cast<Spanner*>(entry.object.data())->findRayIntersection(origin, direction,
+                        glm::vec3(), 0.0f, distance) && distance < closestDistance) {
+                closestObject = entry.object;
+                closestDistance = distance;
+            }
+        }
+        return;
+    }
+    // visit the nearer child first, so that its hits can rule out the farther
+    float distances[2];
+    bool intersects[2];
+    for (int i = 0; i < 2; i++) {
+        intersects[i] = children[i]->bounds.findRayIntersection(origin, direction, distances[i]);
+    }
+    int first = (intersects[1] && (!intersects[0] || distances[1] < distances[0])) ? 1 : 0;
+    for (int i = first, j = 0; j < 2; i = 1 - i, j++) {
+        if (intersects[i] && distances[i] < closestDistance) {
+            children[i]->findFirstRayIntersection(origin, direction, closestObject, closestDistance);
+        }
+    }
+}
+
+void SpannerIndex::Node::getIntersecting(const Box& bounds, QList<SharedObjectPointer>& results) const {
+    if (!this->bounds.intersects(bounds)) {
+        return;
+    }
+    if (!isLeaf()) {
+        children[0]->getIntersecting(bounds, results);
+        children[1]->getIntersecting(bounds, results);
+        return;
+    }
+    foreach (const SpannerIndexEntry& entry, entries) {
+        if (entry.bounds.intersects(bounds)) {
+            results.append(entry.object);
+        }
+    }
+}
+
+SpannerIndex::SpannerIndex() :
+    _root(NULL) {
+}
+
+SpannerIndex::SpannerIndex(const SpannerIndex& other) :
+    QSharedData(other),
+    _root(NULL) {
+    
+    if (other._root) {
+        _root = other._root->copy(NULL, _leaves);
+    }
+}
+
+SpannerIndex::~SpannerIndex() {
+    delete _root;
+}
+
+void SpannerIndex::insert(const SharedObjectPointer& object) {
+    if (_leaves.contains(object)) {
+        return;
+    }
+    SpannerIndexEntry entry = { object, static_cast<Spanner*>(object.data())->getBounds() };
+    if (!_root) {
+        _root = new Node();
+        _root->bounds = entry.bounds;
+    }
+    // descend to the leaf whose bounds (and those of its ancestors) grow the least by taking in the entry
+    Node* node = _root;
+    while (!node->isLeaf()) {
+        node->bounds = getUnion(node->bounds, entry.bounds);
+        float firstGrowth = getSurfaceArea(getUnion(node->children[0]->bounds, entry.bounds)) -
+            getSurfaceArea(node->children[0]->bounds);
+        float secondGrowth = getSurfaceArea(getUnion(node->children[1]->bounds, entry.bounds)) -
+            getSurfaceArea(node->children[1]->bounds);
+        node = node->children[firstGrowth <= secondGrowth ? 0 : 1];
+    }
+    node->bounds = getUnion(node->bounds, entry.bounds);
+    node->entries.append(entry);
+    _leaves.insert(object, node);
+    if (node->entries.size() <= MAX_SPANNER_INDEX_LEAF_SIZE) {
+        return;
+    }
+    // split the full leaf at the median along its longest axis
+    glm::vec3 extent = node->bounds.maximum - node->bounds.minimum;
+    int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+    qSort(node->entries.begin(), node->entries.end(), SpannerIndexEntryAxisLessThan(axis));
+    int half = node->entries.size() / 2;
+    for (int i = 0; i < 2; i++) {
+        Node* child = node->children[i] = new Node(node);
+        child->entries = (i == 0) ? node->entries.mid(0, half) : node->entries.mid(half);
+        child->updateBounds();
+        foreach (const SpannerIndexEntry& childEntry, child->entries) {
+            _leaves.insert(childEntry.object, child);
+        }
+    }
+    node->entries.clear();
+}
+
+void SpannerIndex::remove(const SharedObjectPointer& object) {
+    Node* leaf = _leaves.take(object);
+    if (!leaf) {
+        return;
+    }
+    for (int i = 0; i < leaf->entries.size(); i++) {
+        if (leaf->entries.at(i).object == object) {
+            leaf->entries.remove(i);
+            break;
+        }
+    }
+    Node* node = leaf;
+    if (leaf->entries.isEmpty()) {
+        Node* parent = leaf->parent;
+        if (!parent) {
+            delete _root;
+            _root = NULL;
+            return;
+        }
+        // the empty leaf's sibling takes the place of their parent
+        Node* sibling = parent->children[parent->children[0] == leaf ? 1 : 0];
+        parent->children[0] = parent->children[1] = NULL;
+        delete leaf;
+        Node* grandparent = parent->parent;
+        sibling->parent = grandparent;
+        if (grandparent) {
+            grandparent->children[grandparent->children[0] == parent ? 0 : 1] = sibling;
+        } else {
+            _root = sibling;
+        }
+        delete parent;
+        node = grandparent;
+    }
+    // shrink the bounds of the ancestors
+    for (; node; node = node->parent) {
+        node->updateBounds();
+    }
+}
+
+SharedObjectPointer SpannerIndex::findFirstRayIntersection(const glm::vec3& origin,
+        const glm::vec3& direction, float& distance) const {
+    SharedObjectPointer closestObject;
+    float closestDistance = FLT_MAX;
+    float rootDistance;
+    if (_root && _root->bounds.findRayIntersection(origin, direction, rootDistance)) {
+        _root->findFirstRayIntersection(origin, direction, closestObject, closestDistance);
+    }
+    if (closestObject) {
+        distance = closestDistance;
+    }
+    return closestObject;
+}
+
+void SpannerIndex::getIntersecting(const Box& bounds, QList<SharedObjectPointer>& results) const {
+    if (_root) {
+        _root->getIntersecting(bounds, results);
+    }
+}
+
 MetavoxelData::MetavoxelData() : _size(1.0f) {
 }
 
 MetavoxelData::MetavoxelData(const MetavoxelData& other) :
     _size(other._size),
-    _roots(other._roots) {
+    _roots(other._roots),
+    _spannerIndices(other._spannerIndices) {
     
     incrementRootReferenceCounts();
 }
@@ -73,6 +337,7 @@ MetavoxelData& MetavoxelData::operator=(const MetavoxelData& other) {
     decrementRootReferenceCounts();
     _size = other._size;
     _roots = other._roots;
+    _spannerIndices = other._spannerIndices;
     incrementRootReferenceCounts();
     return *this;
 }
@@ -112,7 +377,8 @@ void MetavoxelData::guide(MetavoxelVisitor& visitor) {
         if (!value.getAttribute()) {
             continue;
         }
-        // replace the old node with the new
+        // replace the old node with the new, which invalidates any index of its spanners
+        _spannerIndices.remove(value.getAttribute());
         MetavoxelNode*& node = _roots[value.getAttribute()];
         if (node) {
             node->decrementReferenceCount(value.getAttribute());
@@ -191,8 +457,14 @@ void MetavoxelData::insert(const AttributePointer& attribute, const Box& bounds,
     while (!getBounds().contains(bounds)) {
         expand();
     }
+    // hold the index aside while we change the tree, then bring it up to date
+    QSharedDataPointer<SpannerIndex> index = _spannerIndices.take(attribute);
     SpannerUpdateVisitor<insertSpanner> visitor(attribute, bounds, granularity, object);
     guide(visitor);
+    if (index) {
+        index->insert(object);
+        _spannerIndices.insert(attribute, index);
+    }
 }
 
 void MetavoxelData::remove(const AttributePointer& attribute, const SharedObjectPointer& object) {
@@ -202,8 +474,13 @@ void MetavoxelData::remove(const AttributePointer& attribute, const SharedObject
 
 void MetavoxelData::remove(const AttributePointer& attribute, const Box& bounds,
         float granularity, const SharedObjectPointer& object) {
+    QSharedDataPointer<SpannerIndex> index = _spannerIndices.take(attribute);
     SpannerUpdateVisitor<removeSpanner> visitor(attribute, bounds, granularity, object);
     guide(visitor);
+    if (index) {
+        index->remove(object);
+        _spannerIndices.insert(attribute, index);
+    }
 }
 
 void MetavoxelData::toggle(const AttributePointer& attribute, const SharedObjectPointer& object) {
@@ -213,8 +490,17 @@ void MetavoxelData::toggle(const AttributePointer& attribute, const SharedObject
 
 void MetavoxelData::toggle(const AttributePointer& attribute, const Box& bounds,
         float granularity, const SharedObjectPointer& object) {
+    QSharedDataPointer<SpannerIndex> index = _spannerIndices.take(attribute);
     SpannerUpdateVisitor<toggleSpanner> visitor(attribute, bounds, granularity, object);
     guide(visitor);
+    if (index) {
+        if (index->contains(object)) {
+            index->remove(object);
+        } else {
+            index->insert(object);
+        }
+        _spannerIndices.insert(attribute, index);
+    }
 }
 
 void MetavoxelData::replace(const AttributePointer& attribute, const SharedObjectPointer& oldObject,
@@ -274,17 +560,32 @@ void MetavoxelData::replace(const AttributePointer& attribute, const Box& bounds
         insert(attribute, newSpanner->getBounds(), newSpanner->getPlacementGranularity(), newObject);
         return;
     }
+    QSharedDataPointer<SpannerIndex> index = _spannerIndices.take(attribute);
     SpannerReplaceVisitor visitor(attribute, bounds, granularity, oldObject, newObject);
     guide(visitor);
+    if (index) {
+        if (index->contains(oldObject)) {
+            index->remove(oldObject);
+            index->insert(newObject);
+        }
+        _spannerIndices.insert(attribute, index);
+    }
 }
 
 void MetavoxelData::clear(const AttributePointer& attribute) {
+    _spannerIndices.remove(attribute);
     MetavoxelNode* node = _roots.take(attribute);
     if (node) {
         node->decrementReferenceCount(attribute);
     }
 }
 
+void MetavoxelData::intern() {
+    for (QHash<AttributePointer, MetavoxelNode*>::iterator it = _roots.begin(); it != _roots.end(); it++) {
+        it.value() = it.value()->intern(it.key());
+    }
+}
+
 class FirstRaySpannerIntersectionVisitor : public RaySpannerIntersectionVisitor {
 public:
     
@@ -318,6 +619,10 @@ bool FirstRaySpannerIntersectionVisitor::visitSpanner(Spanner* spanner, float di
 SharedObjectPointer MetavoxelData::findFirstRaySpannerIntersection(
         const glm::vec3& origin, const glm::vec3& direction, const AttributePointer& attribute,
             float& distance, const MetavoxelLOD& lod) {
+    if (!lod.isValid()) {
+        return getSpannerIndex(attribute).findFirstRayIntersection(origin, direction, distance);
+    }
+    // the index doesn't know which spanners the LOD would exclude, so we must tour the tree
     FirstRaySpannerIntersectionVisitor visitor(origin, direction, attribute, lod);
     guide(visitor);
     if (!visitor.getSpanner()) {
@@ -327,6 +632,45 @@ SharedObjectPointer MetavoxelData::findFirstRaySpannerIntersection(
     return SharedObjectPointer(visitor.getSpanner());
 }
 
+void MetavoxelData::getIntersectingSpanners(const AttributePointer& attribute, const Box& bounds,
+        QList<SharedObjectPointer>& results) {
+    getSpannerIndex(attribute).getIntersecting(bounds, results);
+}
+
+class SpannerIndexBuildVisitor : public MetavoxelVisitor {
+public:
+    
+    SpannerIndexBuildVisitor(const AttributePointer& attribute, SpannerIndex& index);
+    
+    virtual int visit(MetavoxelInfo& info);
+
+private:
+    
+    SpannerIndex& _index;
+};
+
+SpannerIndexBuildVisitor::SpannerIndexBuildVisitor(const AttributePointer& attribute, SpannerIndex& index) :
+    MetavoxelVisitor(QVector<AttributePointer>() << attribute),
+    _index(index) {
+}
+
+int SpannerIndexBuildVisitor::visit(MetavoxelInfo& info) {
+    foreach (const SharedObjectPointer& object, info.inputValues.at(0).getInlineValue<SharedObjectSet>()) {
+        _index.insert(object);
+    }
+    return info.isLeaf ? STOP_RECURSION : DEFAULT_ORDER;
+}
+
+const SpannerIndex& MetavoxelData::getSpannerIndex(const AttributePointer& attribute) {
+    QSharedDataPointer<SpannerIndex>& index = _spannerIndices[attribute];
+    if (!index) {
+        index = new SpannerIndex();
+        SpannerIndexBuildVisitor visitor(attribute, *index);
+        guide(visitor);
+    }
+    return *index.constData();
+}
+
 const int X_MAXIMUM_FLAG = 1;
 const int Y_MAXIMUM_FLAG = 2;
 const int Z_MAXIMUM_FLAG = 4;
@@ -417,6 +761,7 @@ void MetavoxelData::set(const glm::vec3& minimum, const MetavoxelData& data, boo
     // set/mix each attribute separately
     for (QHash<AttributePointer, MetavoxelNode*>::const_iterator it = data._roots.constBegin();
             it != data._roots.constEnd(); it++) {
+        _spannerIndices.remove(it.key());
         MetavoxelNode*& root = _roots[it.key()];
         setNode(it.key(), root, getMinimum(), getSize(), it.value(), minimum, data.getSize(), blend);
         if (root->isLeaf() && root->getAttributeValue(it.key()).isDefault()) {
@@ -461,6 +806,7 @@ void MetavoxelData::read(Bitstream& in, const MetavoxelLOD& lod) {
     // clear out any existing roots
     decrementRootReferenceCounts();
     _roots.clear();
+    _spannerIndices.clear();
 
     in >> _size;
     
@@ -536,6 +882,7 @@ void MetavoxelData::readDelta(const MetavoxelData& reference, const MetavoxelLOD
         if (!attribute) {
             break;
         }
+        _spannerIndices.remove(attribute);
         _roots.take(attribute)->decrementReferenceCount(attribute);
     }
 }
@@ -603,6 +950,7 @@ void MetavoxelData::writeDelta(const MetavoxelData& reference, const MetavoxelLO
 }
 
 MetavoxelNode* MetavoxelData::createRoot(const AttributePointer& attribute) {
+    _spannerIndices.remove(attribute);
     MetavoxelNode*& root = _roots[attribute];
     if (root) {
         root->decrementReferenceCount(attribute);
@@ -665,7 +1013,9 @@ void MetavoxelStreamState::setMinimum(const glm::vec3& lastMinimum, int index) {
 }
 
 MetavoxelNode::MetavoxelNode(const AttributeValue& attributeValue, const MetavoxelNode* copyChildren) :
-        _referenceCount(1) {
+        _referenceCount(1),
+        _interned(false),
+        _hash(0) {
 
     _attributeValue = attributeValue.copy();
     if (copyChildren) {
@@ -682,7 +1032,9 @@ MetavoxelNode::MetavoxelNode(const AttributeValue& attributeValue, const Metavox
 }
 
 MetavoxelNode::MetavoxelNode(const AttributePointer& attribute, const MetavoxelNode* copy) :
-        _referenceCount(1) {
+        _referenceCount(1),
+        _interned(false),
+        _hash(0) {
         
     _attributeValue = attribute->create(copy->_attributeValue);
     for (int i = 0; i < CHILD_COUNT; i++) {
@@ -982,10 +1334,19 @@ void MetavoxelNode::writeSpannerSubdivision(MetavoxelStreamState& state) const {
 }
 
 void MetavoxelNode::decrementReferenceCount(const AttributePointer& attribute) {
-    if (--_referenceCount == 0) {
-        destroy(attribute);
-        delete this;
+    if (_interned) {
+        // the last reference must be released under the lock, so that nobody can find the node in the table in the meantime
+        QMutexLocker locker(&attribute->getInternedNodesMutex());
+        if (_referenceCount.deref()) {
+            return;
+        }
+        attribute->getInternedNodes().remove(_hash, this);
+        
+    } else if (_referenceCount.deref()) {
+        return;
     }
+    destroy(attribute);
+    delete this;
 }
 
 void MetavoxelNode::destroy(const AttributePointer& attribute) {
@@ -1006,6 +1367,46 @@ void MetavoxelNode::clearChildren(const AttributePointer& attribute) {
     }
 }
 
+MetavoxelNode* MetavoxelNode::intern(const AttributePointer& attribute) {
+    if (_interned) {
+        return this;
+    }
+    // the children go first, so that equal subtrees reduce to equal child pointers
+    uint hash = attribute->hash(_attributeValue);
+    for (int i = 0; i < CHILD_COUNT; i++) {
+        if (_children[i]) {
+            _children[i] = _children[i]->intern(attribute);
+        }
+        hash = hash * 31 + qHash(_children[i]);
+    }
+    QMutexLocker locker(&attribute->getInternedNodesMutex());
+    QMultiHash<uint, MetavoxelNode*>& internedNodes = attribute->getInternedNodes();
+    for (QMultiHash<uint, MetavoxelNode*>::const_iterator it = internedNodes.constFind(hash);
+            it != internedNodes.constEnd() && it.key() == hash; it++) {
+        MetavoxelNode* node = it.value();
+        if (!attribute->equal(node->_attributeValue, _attributeValue)) {
+            continue;
+        }
+        bool childrenEqual = true;
+        for (int i = 0; i < CHILD_COUNT; i++) {
+            if (node->_children[i] != _children[i]) {
+                childrenEqual = false;
+                break;
+            }
+        }
+        if (childrenEqual) {
+            node->incrementReferenceCount();
+            locker.unlock();
+            decrementReferenceCount(attribute);
+            return node;
+        }
+    }
+    _hash = hash;
+    _interned = true;
+    internedNodes.insert(hash, this);
+    return this;
+}
+
 int MetavoxelVisitor::encodeOrder(int first, int second, int third, int fourth,
         int fifth, int sixth, int seventh, int eighth) {
     return first | (second << 3) | (third << 6) | (fourth << 9) |
@@ -1057,6 +1458,10 @@ MetavoxelVisitor::MetavoxelVisitor(const QVector<AttributePointer>& inputs,
 MetavoxelVisitor::~MetavoxelVisitor() {
 }
 
+bool MetavoxelVisitor::isReentrant() const {
+    return false;
+}
+
 void MetavoxelVisitor::prepare() {
     // nothing by default
 }
@@ -1195,15 +1600,17 @@ int RaySpannerIntersectionVisitor::visit(MetavoxelInfo& info, float distance) {
 DefaultMetavoxelGuide::DefaultMetavoxelGuide() {
 }
 
-bool DefaultMetavoxelGuide::guide(MetavoxelVisitation& visitation) {
-    // save the core of the LOD calculation; we'll reuse it to determine whether to subdivide each attribute
-    float lodBase = glm::distance(visitation.visitor.getLOD().position, visitation.info.getCenter()) *
+/// Visits the metavoxel itself and applies any outputs.
+/// \param lodBase set to the core of the LOD calculation, for reuse in determining whether to subdivide each attribute
+/// \return the encoded order returned by the visitor
+static int visitMetavoxel(MetavoxelVisitation& visitation, float& lodBase) {
+    lodBase = glm::distance(visitation.visitor.getLOD().position, visitation.info.getCenter()) *
         visitation.visitor.getLOD().threshold;
     visitation.info.isLODLeaf = (visitation.info.size < lodBase * visitation.visitor.getMinimumLODThresholdMultiplier());
     visitation.info.isLeaf = visitation.info.isLODLeaf || visitation.allInputNodesLeaves();
     int encodedOrder = visitation.visitor.visit(visitation.info);
     if (encodedOrder == MetavoxelVisitor::SHORT_CIRCUIT) {
-        return false;
+        return encodedOrder;
     }
     for (int i = 0; i < visitation.outputNodes.size(); i++) {
         OwnedAttributeValue& value = visitation.info.outputValues[i];
@@ -1218,71 +1625,81 @@ bool DefaultMetavoxelGuide::guide(MetavoxelVisitation& visitation) {
             node = value.getAttribute()->createMetavoxelNode(value, node);
         }
     }
-    if (encodedOrder == MetavoxelVisitor::STOP_RECURSION) {
-        return true;
+    return encodedOrder;
+}
+
+/// Takes the index of the next child to visit from the encoded order.
+static int takeChildIndex(int& encodedOrder) {
+    const int ORDER_ELEMENT_BITS = 3;
+    const int ORDER_ELEMENT_MASK = (1 << ORDER_ELEMENT_BITS) - 1;
+    int index = encodedOrder & ORDER_ELEMENT_MASK;
+    encodedOrder >>= ORDER_ELEMENT_BITS;
+    return index;
+}
+
+/// Fills in the nodes and values for the visitation of a child.
+static void setChildVisitation(const MetavoxelVisitation& visitation, float lodBase, int index,
+        MetavoxelVisitation& nextVisitation) {
+    for (int j = 0; j < visitation.inputNodes.size(); j++) {
+        MetavoxelNode* node = visitation.inputNodes.at(j);
+        const AttributeValue& parentValue = visitation.info.inputValues.at(j);
+        MetavoxelNode* child = (node && (visitation.info.size >= lodBase *
+            parentValue.getAttribute()->getLODThresholdMultiplier())) ? node->getChild(index) : NULL;
+        nextVisitation.info.inputValues[j] = ((nextVisitation.inputNodes[j] = child)) ?
+            child->getAttributeValue(parentValue.getAttribute()) : parentValue.getAttribute()->inherit(parentValue);
     }
-    MetavoxelVisitation nextVisitation = { &visitation, visitation.visitor,
-        QVector<MetavoxelNode*>(visitation.inputNodes.size()), QVector<MetavoxelNode*>(visitation.outputNodes.size()),
-        { &visitation.info, glm::vec3(), visitation.info.size * 0.5f, QVector<AttributeValue>(visitation.inputNodes.size()),
-            QVector<OwnedAttributeValue>(visitation.outputNodes.size()) } };
-    for (int i = 0; i < MetavoxelNode::CHILD_COUNT; i++) {
-        // the encoded order tells us the child indices for each iteration
-        const int ORDER_ELEMENT_BITS = 3;
-        const int ORDER_ELEMENT_MASK = (1 << ORDER_ELEMENT_BITS) - 1;
-        int index = encodedOrder & ORDER_ELEMENT_MASK;
-        encodedOrder >>= ORDER_ELEMENT_BITS;
-        for (int j = 0; j < visitation.inputNodes.size(); j++) {
-            MetavoxelNode* node = visitation.inputNodes.at(j);
-            const AttributeValue& parentValue = visitation.info.inputValues.at(j);
-            MetavoxelNode* child = (node && (visitation.info.size >= lodBase *
-                parentValue.getAttribute()->getLODThresholdMultiplier())) ? node->getChild(index) : NULL;
-            nextVisitation.info.inputValues[j] = ((nextVisitation.inputNodes[j] = child)) ?
-                child->getAttributeValue(parentValue.getAttribute()) : parentValue.getAttribute()->inherit(parentValue);
-        }
-        for (int j = 0; j < visitation.outputNodes.size(); j++) {
-            MetavoxelNode* node = visitation.outputNodes.at(j);
-            MetavoxelNode* child = (node && (visitation.info.size >= lodBase *
-                visitation.visitor.getOutputs().at(j)->getLODThresholdMultiplier())) ? node->getChild(index) : NULL;
-            nextVisitation.outputNodes[j] = child;
-        }
-        nextVisitation.info.minimum = getNextMinimum(visitation.info.minimum, nextVisitation.info.size, index);
-        if (!static_cast<MetavoxelGuide*>(nextVisitation.info.inputValues.last().getInlineValue<
-                SharedObjectPointer>().data())->guide(nextVisitation)) {
-            return false;
+    for (int j = 0; j < visitation.outputNodes.size(); j++) {
+        MetavoxelNode* node = visitation.outputNodes.at(j);
+        MetavoxelNode* child = (node && (visitation.info.size >= lodBase *
+            visitation.visitor.getOutputs().at(j)->getLODThresholdMultiplier())) ? node->getChild(index) : NULL;
+        nextVisitation.outputNodes[j] = child;
+    }
+    nextVisitation.info.minimum = getNextMinimum(visitation.info.minimum, nextVisitation.info.size, index);
+}
+
+static bool guideChild(MetavoxelVisitation& nextVisitation) {
+    return static_cast<MetavoxelGuide*>(nextVisitation.info.inputValues.last().getInlineValue<
+        SharedObjectPointer>().data())->guide(nextVisitation);
+}
+
+/// Replaces the child of each output node with the output of the child's visitation.
+static void replaceChildOutputs(MetavoxelVisitation& visitation, int i, int index, MetavoxelVisitation& nextVisitation) {
+    for (int j = 0; j < nextVisitation.outputNodes.size(); j++) {
+        OwnedAttributeValue& value = nextVisitation.info.outputValues[j];
+        if (!value.getAttribute()) {
+            continue;
         }
-        for (int j = 0; j < nextVisitation.outputNodes.size(); j++) {
-            OwnedAttributeValue& value = nextVisitation.info.outputValues[j];
-            if (!value.getAttribute()) {
-                continue;
-            }
-            // replace the child
-            OwnedAttributeValue& parentValue = visitation.info.outputValues[j];
-            if (!parentValue.getAttribute()) {
-                // shallow-copy the parent node on first change
-                parentValue = value;
-                MetavoxelNode*& node = visitation.outputNodes[j];
-                if (node) {
-                    node = new MetavoxelNode(value.getAttribute(), node);
-                } else {
-                    // create leaf with inherited value
-                    node = new MetavoxelNode(value.getAttribute()->inherit(visitation.getInheritedOutputValue(j)));
-                }
-            }
-            MetavoxelNode* node = visitation.outputNodes.at(j);
-            MetavoxelNode* child = node->getChild(i);
-            if (child) {
-                child->decrementReferenceCount(value.getAttribute());
+        // replace the child
+        OwnedAttributeValue& parentValue = visitation.info.outputValues[j];
+        if (!parentValue.getAttribute()) {
+            // shallow-copy the parent node on first change
+            parentValue = value;
+            MetavoxelNode*& node = visitation.outputNodes[j];
+            if (node) {
+                node = new MetavoxelNode(value.getAttribute(), node);
             } else {
-                // it's a leaf; we need to split it up
-                AttributeValue nodeValue = value.getAttribute()->inherit(node->getAttributeValue(value.getAttribute()));
-                for (int k = 1; k < MetavoxelNode::CHILD_COUNT; k++) {
-                    node->setChild((index + k) % MetavoxelNode::CHILD_COUNT, new MetavoxelNode(nodeValue));
-                }
+                // create leaf with inherited value
+                node = new MetavoxelNode(value.getAttribute()->inherit(visitation.getInheritedOutputValue(j)));
             }
-            node->setChild(index, nextVisitation.outputNodes.at(j));
-            value = AttributeValue();
         }
+        MetavoxelNode* node = visitation.outputNodes.at(j);
+        MetavoxelNode* child = node->getChild(i);
+        if (child) {
+            child->decrementReferenceCount(value.getAttribute());
+        } else {
+            // it's a leaf; we need to split it up
+            AttributeValue nodeValue = value.getAttribute()->inherit(node->getAttributeValue(value.getAttribute()));
+            for (int k = 1; k < MetavoxelNode::CHILD_COUNT; k++) {
+                node->setChild((index + k) % MetavoxelNode::CHILD_COUNT, new MetavoxelNode(nodeValue));
+            }
+        }
+        node->setChild(index, nextVisitation.outputNodes.at(j));
+        value = AttributeValue();
     }
+}
+
+/// Merges the children of each output node that changed.
+static void mergeChildOutputs(MetavoxelVisitation& visitation) {
     for (int i = 0; i < visitation.outputNodes.size(); i++) {
         OwnedAttributeValue& value = visitation.info.outputValues[i];
         if (value.getAttribute()) {
@@ -1291,6 +1708,122 @@ bool DefaultMetavoxelGuide::guide(MetavoxelVisitation& visitation) {
             value = node->getAttributeValue(value.getAttribute()); 
         }
     }
+}
+
+/// Guides a visitor through one child of the root on the global thread pool, if it has a thread free.
+class ChildGuider : public QRunnable {
+public:
+    
+    ChildGuider(MetavoxelVisitation& visitation, bool& result, QSemaphore& finished);
+    
+    virtual void run();
+
+private:
+    
+    MetavoxelVisitation& _visitation;
+    bool& _result;
+    QSemaphore& _finished;
+};
+
+ChildGuider::ChildGuider(MetavoxelVisitation& visitation, bool& result, QSemaphore& finished) :
+    _visitation(visitation),
+    _result(result),
+    _finished(finished) {
+}
+
+void ChildGuider::run() {
+    _result = guideChild(_visitation);
+    _finished.release();
+}
+
+/// Guides a reentrant visitor through all the children at once, then applies their outputs in the order a sequential tour
+/// would have, so that the result doesn't depend on which finished first.
+static bool guideChildrenInParallel(MetavoxelVisitation& visitation, float lodBase, int encodedOrder) {
+    MetavoxelVisitation* nextVisitations[MetavoxelNode::CHILD_COUNT];
+    int indices[MetavoxelNode::CHILD_COUNT];
+    bool results[MetavoxelNode::CHILD_COUNT];
+    QSemaphore finished;
+    for (int i = 0; i < MetavoxelNode::CHILD_COUNT; i++) {
+        MetavoxelVisitation nextVisitation = { &visitation, visitation.visitor,
+            QVector<MetavoxelNode*>(visitation.inputNodes.size()), QVector<MetavoxelNode*>(visitation.outputNodes.size()),
+            { &visitation.info, glm::vec3(), visitation.info.size * 0.5f,
+                QVector<AttributeValue>(visitation.inputNodes.size()),
+                QVector<OwnedAttributeValue>(visitation.outputNodes.size()) } };
+        nextVisitations[i] = new MetavoxelVisitation(nextVisitation);
+        setChildVisitation(visitation, lodBase, indices[i] = takeChildIndex(encodedOrder), *nextVisitations[i]);
+    }
+    // we take the first child ourselves, along with any the pool has no free thread for; the pool is shared with
+    // long-running work (such as snapshot writing), so waiting for a thread could stall us for as long as that takes
+    bool started[MetavoxelNode::CHILD_COUNT] = { false };
+    int startedCount = 0;
+    for (int i = 1; i < MetavoxelNode::CHILD_COUNT; i++) {
+        ChildGuider* guider = new ChildGuider(*nextVisitations[i], results[i], finished);
+        if (QThreadPool::globalInstance()->tryStart(guider)) {
+            started[i] = true;
+            startedCount++;
+        } else {
+            delete guider;
+        }
+    }
+    for (int i = 0; i < MetavoxelNode::CHILD_COUNT; i++) {
+        if (!started[i]) {
+            results[i] = guideChild(*nextVisitations[i]);
+        }
+    }
+    finished.acquire(startedCount);
+    
+    bool keepGoing = true;
+    for (int i = 0; i < MetavoxelNode::CHILD_COUNT; i++) {
+        MetavoxelVisitation* nextVisitation = nextVisitations[i];
+        if (keepGoing && (keepGoing = results[i])) {
+            replaceChildOutputs(visitation, i, indices[i], *nextVisitation);
+            
+        } else {
+            // a sequential tour would have stopped here, so discard the outputs 
+            for (int j = 0; j < nextVisitation->outputNodes.size(); j++) {
+                OwnedAttributeValue& value = nextVisitation->info.outputValues[j];
+                if (value.getAttribute()) {
+                    nextVisitation->outputNodes.at(j)->decrementReferenceCount(value.getAttribute());
+                }
+            }
+        }
+        delete nextVisitation;
+    }
+    if (keepGoing) {
+        mergeChildOutputs(visitation);
+    }
+    return keepGoing;
+}
+
+bool DefaultMetavoxelGuide::guide(MetavoxelVisitation& visitation) {
+    float lodBase;
+    int encodedOrder = visitMetavoxel(visitation, lodBase);
+    if (encodedOrder == MetavoxelVisitor::SHORT_CIRCUIT) {
+        return false;
+    }
+    if (encodedOrder == MetavoxelVisitor::STOP_RECURSION) {
+        return true;
+    }
+    // we can only fan out from the root if we're sure that we'll be guiding the rest of the tour ourselves
+    MetavoxelNode* guideNode = visitation.inputNodes.last();
+    if (!visitation.previous && visitation.visitor.isReentrant() &&
+            metaObject() == &DefaultMetavoxelGuide::staticMetaObject && (!guideNode || guideNode->isLeaf())) {
+        return guideChildrenInParallel(visitation, lodBase, encodedOrder);
+    }
+    MetavoxelVisitation nextVisitation = { &visitation, visitation.visitor,
+        QVector<MetavoxelNode*>(visitation.inputNodes.size()), QVector<MetavoxelNode*>(visitation.outputNodes.size()),
+        { &visitation.info, glm::vec3(), visitation.info.size * 0.5f, QVector<AttributeValue>(visitation.inputNodes.size()),
+            QVector<OwnedAttributeValue>(visitation.outputNodes.size()) } };
+    for (int i = 0; i < MetavoxelNode::CHILD_COUNT; i++) {
+        // the encoded order tells us the child indices for each iteration
+        int index = takeChildIndex(encodedOrder);
+        setChildVisitation(visitation, lodBase, index, nextVisitation);
+        if (!guideChild(nextVisitation)) {
+            return false;
+        }
+        replaceChildOutputs(visitation, i, index, nextVisitation);
+    }
+    mergeChildOutputs(visitation);
     return true;
 }
 
@@ -12,6 +12,7 @@
 #ifndef hifi_MetavoxelData_h
 #define hifi_MetavoxelData_h
 
+#include <QAtomicInt>
 #include <QBitArray>
 #include <QHash>
 #include <QSharedData>
@@ -54,6 +55,43 @@ public:
 
 DECLARE_STREAMABLE_METATYPE(MetavoxelLOD)
 
+/// A bounding volume hierarchy over the spanners of a single attribute.  The metavoxel tree stores each spanner in every
+/// node it overlaps, which suits streaming and voxelization but not queries: a ray cast or region search would visit (and
+/// clip against) the same spanner once per node.  The hierarchy holds each spanner once, so those queries scale with the
+/// log of the spanner count rather than with the volume the spanners cover.
+class SpannerIndex : public QSharedData {
+public:
+
+    SpannerIndex();
+    SpannerIndex(const SpannerIndex& other);
+    ~SpannerIndex();
+
+    int getSpannerCount() const { return _leaves.size(); }
+
+    bool contains(const SharedObjectPointer& object) const { return _leaves.contains(object); }
+
+    /// Adds a spanner to the hierarchy, placing it in the branch whose bounds it enlarges the least.
+    void insert(const SharedObjectPointer& object);
+
+    /// Removes a spanner from the hierarchy, collapsing its leaf if it becomes empty.
+    void remove(const SharedObjectPointer& object);
+
+    /// Finds the closest spanner intersecting the provided ray.
+    SharedObjectPointer findFirstRayIntersection(const glm::vec3& origin, const glm::vec3& direction, float& distance) const;
+
+    /// Appends the spanners whose bounds intersect the provided box to the list.
+    void getIntersecting(const Box& bounds, QList<SharedObjectPointer>& results) const;
+
+private:
+
+    class Node;
+
+    SpannerIndex& operator=(const SpannerIndex& other);
+
+    Node* _root;
+    QHash<SharedObjectPointer, Node*> _leaves; ///< maps each spanner to the leaf containing it
+};
+
 /// The base metavoxel representation shared between server and client.
 class MetavoxelData {
 public:
@@ -90,10 +128,22 @@ public:
         
     void clear(const AttributePointer& attribute);
 
-    /// Convenience function that finds the first spanner intersecting the provided ray.    
+    /// Collapses equal subtrees into shared nodes; see MetavoxelNode::intern.  Once interned, nodes may only be replaced,
+    /// never modified in place, so this should only be used on data that isn't read into.
+    void intern();
+
+    /// Convenience function that finds the first spanner intersecting the provided ray.  Unless restricted by a valid LOD,
+    /// this uses the attribute's spanner index rather than visiting the tree.
     SharedObjectPointer findFirstRaySpannerIntersection(const glm::vec3& origin, const glm::vec3& direction,
         const AttributePointer& attribute, float& distance, const MetavoxelLOD& lod = MetavoxelLOD());
 
+    /// Appends the spanners of the specified attribute whose bounds intersect the provided box to the list.
+    void getIntersectingSpanners(const AttributePointer& attribute, const Box& bounds, QList<SharedObjectPointer>& results);
+
+    /// Returns the index of the specified attribute's spanners, building it from the tree if necessary.  Once built, the
+    /// index is kept in sync by insert, remove, toggle and replace; any other change to the attribute discards it.
+    const SpannerIndex& getSpannerIndex(const AttributePointer& attribute);
+
     /// Sets part of the data.
     void set(const glm::vec3& minimum, const MetavoxelData& data, bool blend = false);
 
@@ -122,6 +172,7 @@ private:
     
     float _size;
     QHash<AttributePointer, MetavoxelNode*> _roots;
+    QHash<AttributePointer, QSharedDataPointer<SpannerIndex> > _spannerIndices;
 };
 
 Bitstream& operator<<(Bitstream& out, const MetavoxelData& data);
@@ -188,7 +239,7 @@ public:
     void writeSpannerSubdivision(MetavoxelStreamState& state) const;
 
     /// Increments the node's reference count.
-    void incrementReferenceCount() { _referenceCount++; }
+    void incrementReferenceCount() { _referenceCount.ref(); }
 
     /// Decrements the node's reference count.  If the resulting reference count is zero, destroys the node
     /// and calls delete this.
@@ -198,14 +249,24 @@ public:
 
     void clearChildren(const AttributePointer& attribute);
     
+    /// Replaces this node and its descendants with the canonical nodes of the attribute that have the same contents, adding
+    /// any that have no equal as new canonical nodes.  Equal subtrees thus share the same node, which must never again
+    /// be modified in place.
+    /// \return the canonical node, to which the caller's reference to this node is transferred
+    MetavoxelNode* intern(const AttributePointer& attribute);
+    
+    bool isInterned() const { return _interned; }
+    
 private:
     Q_DISABLE_COPY(MetavoxelNode)
     
     friend class MetavoxelVisitation;
     
-    int _referenceCount;
+    QAtomicInt _referenceCount;
     void* _attributeValue;
     MetavoxelNode* _children[CHILD_COUNT];
+    bool _interned;
+    uint _hash; /// the hash of the contents, valid once interned
 };
 
 /// Contains information about a metavoxel (explicit or procedural).
@@ -261,6 +322,10 @@ public:
     
     float getMinimumLODThresholdMultiplier() const { return _minimumLODThresholdMultiplier; }
     
+    /// Checks whether the visitor may be called from several threads at once, which allows the default guide to visit the
+    /// children of the root in parallel on the global thread pool.  Outputs are still merged in visitation order.
+    virtual bool isReentrant() const;
+    
     /// Prepares for a new tour of the metavoxel data.
     virtual void prepare();
     
@@ -27,6 +27,7 @@ public:
     
     BoxSetEditVisitor(const BoxSetEdit& edit);
     
+    virtual bool isReentrant() const;
     virtual int visit(MetavoxelInfo& info);
 
 private:
@@ -40,6 +41,10 @@ BoxSetEditVisitor::BoxSetEditVisitor(const BoxSetEdit& edit) :
     _edit(edit) {
 }
 
+bool BoxSetEditVisitor::isReentrant() const {
+    return true;
+}
+
 int BoxSetEditVisitor::visit(MetavoxelInfo& info) {
     // find the intersection between volume and voxel
     glm::vec3 minimum = glm::max(info.minimum, _edit.region.minimum);
@@ -64,38 +69,14 @@ int BoxSetEditVisitor::visit(MetavoxelInfo& info) {
     return DEFAULT_ORDER; // subdivide
 }
 
-class GatherUnmaskedSpannersVisitor : public SpannerVisitor {
-public:
-    
-    GatherUnmaskedSpannersVisitor(const Box& bounds);
-
-    const QList<SharedObjectPointer>& getUnmaskedSpanners() const { return _unmaskedSpanners; }
-
-    virtual bool visit(Spanner* spanner, const glm::vec3& clipMinimum, float clipSize);
-
-private:
-    
-    Box _bounds;
-    QList<SharedObjectPointer> _unmaskedSpanners;
-};
-
-GatherUnmaskedSpannersVisitor::GatherUnmaskedSpannersVisitor(const Box& bounds) :
-    SpannerVisitor(QVector<AttributePointer>() << AttributeRegistry::getInstance()->getSpannersAttribute()),
-    _bounds(bounds) {
-}
-
-bool GatherUnmaskedSpannersVisitor::visit(Spanner* spanner, const glm::vec3& clipMinimum, float clipSize) {
-    if (!spanner->isMasked() && spanner->getBounds().intersects(_bounds)) {
-        _unmaskedSpanners.append(spanner);
-    }
-    return true;
-}
-
 static void setIntersectingMasked(const Box& bounds, MetavoxelData& data) {
-    GatherUnmaskedSpannersVisitor visitor(bounds);
-    data.guide(visitor);
+    QList<SharedObjectPointer> spanners;
+    data.getIntersectingSpanners(AttributeRegistry::getInstance()->getSpannersAttribute(), bounds, spanners);
     
-    foreach (const SharedObjectPointer& object, visitor.getUnmaskedSpanners()) {
+    foreach (const SharedObjectPointer& object, spanners) {
+        if (static_cast<Spanner*>(object.data())->isMasked()) {
+            continue;
+        }
         Spanner* newSpanner = static_cast<Spanner*>(object->clone(true));
         newSpanner->setMasked(true);
         data.replace(AttributeRegistry::getInstance()->getSpannersAttribute(), object, newSpanner);
@@ -156,6 +137,7 @@ public:
     
     UpdateSpannerVisitor(const QVector<AttributePointer>& attributes, Spanner* spanner);
     
+    virtual bool isReentrant() const;
     virtual int visit(MetavoxelInfo& info);
 
 private:
@@ -175,6 +157,10 @@ UpdateSpannerVisitor::UpdateSpannerVisitor(const QVector<AttributePointer>& attr
         logf(2.0f) - 2.0f)) {
 }
 
+bool UpdateSpannerVisitor::isReentrant() const {
+    return true;
+}
+
 int UpdateSpannerVisitor::visit(MetavoxelInfo& info) {
     if (!info.getBounds().intersects(_spanner->getBounds())) {
         return STOP_RECURSION;
@@ -208,12 +194,7 @@ RemoveSpannerEdit::RemoveSpannerEdit(const AttributePointer& attribute, int id)
     id(id) {
 }
 
-void RemoveSpannerEdit::apply(MetavoxelData& data, const WeakSharedObjectHash& objects) const {
-    SharedObject* object = objects.value(id);
-    if (!object) {
-        qDebug() << "Missing object to remove" << id;
-        return;
-    }
+static void removeSpanner(MetavoxelData& data, const AttributePointer& attribute, SharedObject* object) {
     // keep a strong reference to the object
     SharedObjectPointer sharedPointer = object;
     data.remove(attribute, object);
@@ -223,6 +204,35 @@ void RemoveSpannerEdit::apply(MetavoxelData& data, const WeakSharedObjectHash& o
     data.guide(visitor);
 }
 
+void RemoveSpannerEdit::apply(MetavoxelData& data, const WeakSharedObjectHash& objects) const {
+    SharedObject* object = objects.value(id);
+    if (!object) {
+        qDebug() << "Missing object to remove" << id;
+        return;
+    }
+    removeSpanner(data, attribute, object);
+}
+
+RemoveEqualSpannerEdit::RemoveEqualSpannerEdit(const AttributePointer& attribute, const SharedObjectPointer& spanner) :
+    attribute(attribute),
+    spanner(spanner) {
+}
+
+void RemoveEqualSpannerEdit::apply(MetavoxelData& data, const WeakSharedObjectHash& objects) const {
+    if (!spanner) {
+        return;
+    }
+    QList<SharedObjectPointer> results;
+    data.getIntersectingSpanners(attribute, static_cast<Spanner*>(spanner.data())->getBounds(), results);
+    foreach (const SharedObjectPointer& result, results) {
+        if (result->equals(spanner)) {
+            removeSpanner(data, attribute, result);
+            return;
+        }
+    }
+    qDebug() << "Missing spanner to remove";
+}
+
 ClearSpannersEdit::ClearSpannersEdit(const AttributePointer& attribute) :
     attribute(attribute) {
 }
@@ -272,6 +282,7 @@ public:
     
     SetSpannerEditVisitor(const QVector<AttributePointer>& attributes, Spanner* spanner);
     
+    virtual bool isReentrant() const;
     virtual int visit(MetavoxelInfo& info);
 
 private:
@@ -285,6 +296,10 @@ SetSpannerEditVisitor::SetSpannerEditVisitor(const QVector<AttributePointer>& at
     _spanner(spanner) {
 }
 
+bool SetSpannerEditVisitor::isReentrant() const {
+    return true;
+}
+
 int SetSpannerEditVisitor::visit(MetavoxelInfo& info) {
     if (_spanner->blendAttributeValues(info)) {
         return DEFAULT_ORDER;
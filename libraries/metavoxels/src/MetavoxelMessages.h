@@ -149,6 +149,24 @@ public:
 
 DECLARE_STREAMABLE_METATYPE(RemoveSpannerEdit)
 
+/// An edit that removes a spanner equal to the one it carries.  Unlike RemoveSpannerEdit, it doesn't rely on object IDs, so
+/// it still applies after a restart (as when replaying a journal).
+class RemoveEqualSpannerEdit : public MetavoxelEdit {
+    STREAMABLE
+
+public:
+    
+    STREAM AttributePointer attribute;
+    STREAM SharedObjectPointer spanner;
+    
+    RemoveEqualSpannerEdit(const AttributePointer& attribute = AttributePointer(),
+        const SharedObjectPointer& spanner = SharedObjectPointer());
+    
+    virtual void apply(MetavoxelData& data, const WeakSharedObjectHash& objects) const;
+};
+
+DECLARE_STREAMABLE_METATYPE(RemoveEqualSpannerEdit)
+
 /// An edit that clears all spanners from the tree.
 class ClearSpannersEdit : public MetavoxelEdit {
     STREAMABLE
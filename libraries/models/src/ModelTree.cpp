@@ -15,6 +15,12 @@ ModelTree::ModelTree(bool shouldReaverage) : Octree(shouldReaverage) {
     _rootElement = createNewElement();
 }
 
+ModelTree::~ModelTree() {
+    // delete the elements while the map they unregister from is still around
+    delete _rootElement;
+    _rootElement = NULL;
+}
+
 ModelTreeElement* ModelTree::createNewElement(unsigned char * octalCode) {
     ModelTreeElement* newElement = new ModelTreeElement(octalCode);
     newElement->setTree(this);
@@ -32,90 +38,14 @@ bool ModelTree::handlesEditPacketType(PacketType packetType) const {
     }
 }
 
-class FindAndDeleteModelsArgs {
-public:
-    QList<uint32_t> _idsToDelete;
-};
-
-bool ModelTree::findAndDeleteOperation(OctreeElement* element, void* extraData) {
-    //qDebug() << "findAndDeleteOperation()";
-
-    FindAndDeleteModelsArgs* args = static_cast< FindAndDeleteModelsArgs*>(extraData);
-
-    // if we've found and deleted all our target models, then we can stop looking
-    if (args->_idsToDelete.size() <= 0) {
-        return false;
-    }
-
-    ModelTreeElement* modelTreeElement = static_cast<ModelTreeElement*>(element);
-
-    //qDebug() << "findAndDeleteOperation() args->_idsToDelete.size():" << args->_idsToDelete.size();
-
-    for (QList<uint32_t>::iterator it = args->_idsToDelete.begin(); it != args->_idsToDelete.end(); it++) {
-        uint32_t modelID = *it;
-        //qDebug() << "findAndDeleteOperation() modelID:" << modelID;
-
-        if (modelTreeElement->removeModelWithID(modelID)) {
-            // if the model was in this element, then remove it from our search list.
-            //qDebug() << "findAndDeleteOperation() it = args->_idsToDelete.erase(it)";
-            it = args->_idsToDelete.erase(it);
-        }
-
-        if (it == args->_idsToDelete.end()) {
-            //qDebug() << "findAndDeleteOperation() breaking";
-            break;
-        }
-    }
-
-    // if we've found and deleted all our target models, then we can stop looking
-    if (args->_idsToDelete.size() <= 0) {
-        return false;
-    }
-    return true;
-}
-
-class FindAndUpdateModelOperator : public RecurseOctreeOperator {
-public:
-    FindAndUpdateModelOperator(const ModelItem& searchModel);
-    virtual bool PreRecursion(OctreeElement* element);
-    virtual bool PostRecursion(OctreeElement* element);
-    bool wasFound() const { return _found; }
-private:
-    const ModelItem& _searchModel;
-    bool _found;
-};
-
-FindAndUpdateModelOperator::FindAndUpdateModelOperator(const ModelItem& searchModel) :
-    _searchModel(searchModel),
-    _found(false) {
-};
-
-bool FindAndUpdateModelOperator::PreRecursion(OctreeElement* element) {
-    ModelTreeElement* modelTreeElement = static_cast<ModelTreeElement*>(element);
-    // Note: updateModel() will only operate on correctly found models
-    if (modelTreeElement->updateModel(_searchModel)) {
-        _found = true;
-        return false; // stop searching
-    }
-
-    return !_found; // if we haven't yet found it, keep looking
-}
-
-bool FindAndUpdateModelOperator::PostRecursion(OctreeElement* element) {
-    if (_found) {
-        element->markWithChangedTime();
-    }
-    return !_found; // if we haven't yet found it, keep looking
-}
-
 void ModelTree::storeModel(const ModelItem& model, const SharedNodePointer& senderNode) {
     // First, look for the existing model in the tree..
-    FindAndUpdateModelOperator theOperator(model);
-    recurseTreeWithOperator(&theOperator);
-    
-
-    // if we didn't find it in the tree, then store it...
-    if (!theOperator.wasFound()) {
+    // Note: updateModel() will only operate on correctly found models
+    ModelTreeElement* containingElement = getContainingElement(model.getID());
+    if (containingElement && containingElement->updateModel(model)) {
+        markPathChanged(containingElement);
+    } else {
+        // we didn't find it in the tree, so store it...
         glm::vec3 position = model.getPosition();
         float size = std::max(MINIMUM_MODEL_ELEMENT_SIZE, model.getRadius());
 
@@ -165,7 +95,16 @@ bool FindAndUpdateModelWithIDandPropertiesOperator::PostRecursion(OctreeElement*
 }
 
 void ModelTree::updateModel(const ModelItemID& modelID, const ModelItemProperties& properties) {
-    // Look for the existing model in the tree..
+    // Look for the existing model in the tree; only known IDs are in our map, so models still waiting for theirs must be
+    // searched for by creator token
+    if (modelID.isKnownID) {
+        ModelTreeElement* containingElement = getContainingElement(modelID.id);
+        if (containingElement && containingElement->updateModel(modelID, properties)) {
+            markPathChanged(containingElement);
+            _isDirty = true;
+        }
+        return;
+    }
     FindAndUpdateModelWithIDandPropertiesOperator theOperator(modelID, properties);
     recurseTreeWithOperator(&theOperator);
     if (theOperator.wasFound()) {
@@ -190,9 +129,49 @@ void ModelTree::addModel(const ModelItemID& modelID, const ModelItemProperties&
 
 void ModelTree::deleteModel(const ModelItemID& modelID) {
     if (modelID.isKnownID) {
-        FindAndDeleteModelsArgs args;
-        args._idsToDelete.push_back(modelID.id);
-        recurseTreeWithOperation(findAndDeleteOperation, &args);
+        deleteModelWithID(modelID.id);
+    }
+}
+
+void ModelTree::deleteModelWithID(uint32_t modelID) {
+    ModelTreeElement* containingElement = getContainingElement(modelID);
+    if (containingElement) {
+        containingElement->removeModelWithID(modelID);
+    }
+}
+
+void ModelTree::setContainingElement(uint32_t modelID, ModelTreeElement* element) {
+    // models without IDs of their own all share the unknown one, so we can't keep track of them
+    if (modelID != UNKNOWN_MODEL_ID) {
+        _modelToElementMap.insert(modelID, element);
+    }
+}
+
+void ModelTree::clearContainingElement(uint32_t modelID, ModelTreeElement* element) {
+    QHash<uint32_t, ModelTreeElement*>::iterator it = _modelToElementMap.find(modelID);
+    if (it != _modelToElementMap.end() && it.value() == element) {
+        _modelToElementMap.erase(it);
+    }
+}
+
+void ModelTree::markPathChanged(ModelTreeElement* element) {
+    // elements don't know their parents, so we descend from the root towards the element's center
+    glm::vec3 center = element->getAABox().calcCenter();
+    ModelTreeElement* ancestor = getRoot();
+    while (ancestor) {
+        ancestor->markWithChangedTime();
+        if (ancestor == element) {
+            break;
+        }
+        ModelTreeElement* next = NULL;
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            ModelTreeElement* child = ancestor->getChildAtIndex(i);
+            if (child && child->getAABox().contains(center)) {
+                next = child;
+                break;
+            }
+        }
+        ancestor = next;
     }
 }
 
@@ -370,49 +349,20 @@ void ModelTree::findModelsForUpdate(const AABox& box, QVector<ModelItem*> foundM
     foundModels.swap(args._foundModels);
 }
 
-class FindByIDArgs {
-public:
-    uint32_t id;
-    bool found;
-    const ModelItem* foundModel;
-};
-
-
-bool ModelTree::findByIDOperation(OctreeElement* element, void* extraData) {
-//qDebug() << "ModelTree::findByIDOperation()....";
-
-    FindByIDArgs* args = static_cast<FindByIDArgs*>(extraData);
-    ModelTreeElement* modelTreeElement = static_cast<ModelTreeElement*>(element);
-
-    // if already found, stop looking
-    if (args->found) {
-        return false;
-    }
-
-    // as the tree element if it has this model
-    const ModelItem* foundModel = modelTreeElement->getModelWithID(args->id);
-    if (foundModel) {
-        args->foundModel = foundModel;
-        args->found = true;
-        return false;
-    }
-
-    // keep looking
-    return true;
-}
-
-
 const ModelItem* ModelTree::findModelByID(uint32_t id, bool alreadyLocked) {
-    FindByIDArgs args = { id, false, NULL };
+    const ModelItem* foundModel = NULL;
 
     if (!alreadyLocked) {
         lockForRead();
     }
-    recurseTreeWithOperation(findByIDOperation, &args);
+    ModelTreeElement* containingElement = getContainingElement(id);
+    if (containingElement) {
+        foundModel = containingElement->getModelWithID(id);
+    }
     if (!alreadyLocked) {
         unlock();
     }
-    return args.foundModel;
+    return foundModel;
 }
 
 
@@ -628,8 +578,6 @@ void ModelTree::processEraseMessage(const QByteArray& dataByteArray, const Share
     processedBytes += sizeof(numberOfIds);
 
     if (numberOfIds > 0) {
-        FindAndDeleteModelsArgs args;
-
         for (size_t i = 0; i < numberOfIds; i++) {
             if (processedBytes + sizeof(uint32_t) > packetLength) {
                 break; // bail to prevent buffer overflow
@@ -640,10 +588,7 @@ void ModelTree::processEraseMessage(const QByteArray& dataByteArray, const Share
             dataAt += sizeof(modelID);
             processedBytes += sizeof(modelID);
 
-            args._idsToDelete.push_back(modelID);
+            deleteModelWithID(modelID);
         }
-
-        // calling recurse to actually delete the models
-        recurseTreeWithOperation(findAndDeleteOperation, &args);
     }
 }
@@ -24,6 +24,7 @@ class ModelTree : public Octree {
     Q_OBJECT
 public:
     ModelTree(bool shouldReaverage = false);
+    virtual ~ModelTree();
 
     /// Implements our type specific root element factory
     virtual ModelTreeElement* createNewElement(unsigned char * octalCode = NULL);
@@ -73,6 +74,16 @@ public:
     void processEraseMessage(const QByteArray& dataByteArray, const SharedNodePointer& sourceNode);
     void handleAddModelResponse(const QByteArray& packet);
 
+    /// Returns the element containing the model with the given ID, or NULL if there is no such model.
+    ModelTreeElement* getContainingElement(uint32_t modelID) const { return _modelToElementMap.value(modelID); }
+
+    /// Records the element containing a model; elements call this whenever they take a model in.
+    void setContainingElement(uint32_t modelID, ModelTreeElement* element);
+
+    /// Forgets the element containing a model, provided that it's still the given one; elements call this whenever they
+    /// let a model go.
+    void clearContainingElement(uint32_t modelID, ModelTreeElement* element);
+
 private:
 
     static bool updateOperation(OctreeElement* element, void* extraData);
@@ -81,19 +92,25 @@ private:
     static bool findNearPointOperation(OctreeElement* element, void* extraData);
     static bool findInSphereOperation(OctreeElement* element, void* extraData);
     static bool pruneOperation(OctreeElement* element, void* extraData);
-    static bool findByIDOperation(OctreeElement* element, void* extraData);
-    static bool findAndDeleteOperation(OctreeElement* element, void* extraData);
     static bool findAndUpdateModelItemIDOperation(OctreeElement* element, void* extraData);
     static bool findInBoxForUpdateOperation(OctreeElement* element, void* extraData);
 
     void notifyNewlyCreatedModel(const ModelItem& newModel, const SharedNodePointer& senderNode);
 
+    void deleteModelWithID(uint32_t modelID);
+
+    /// Marks the elements from the root down to the given one as changed, so that senders looking for changes find it.
+    void markPathChanged(ModelTreeElement* element);
+
     QReadWriteLock _newlyCreatedHooksLock;
     std::vector<NewlyCreatedModelHook*> _newlyCreatedHooks;
 
 
     QReadWriteLock _recentlyDeletedModelsLock;
     QMultiMap<quint64, uint32_t> _recentlyDeletedModelItemIDs;
+
+    // lets us find models by ID without searching the whole tree; guarded by the tree lock like the elements
+    QHash<uint32_t, ModelTreeElement*> _modelToElementMap;
 };
 
 #endif // hifi_ModelTree_h
@@ -14,12 +14,17 @@
 #include "ModelTree.h"
 #include "ModelTreeElement.h"
 
-ModelTreeElement::ModelTreeElement(unsigned char* octalCode) : OctreeElement(), _modelItems(NULL) {
+ModelTreeElement::ModelTreeElement(unsigned char* octalCode) : OctreeElement(), _myTree(NULL), _modelItems(NULL) {
     init(octalCode);
 };
 
 ModelTreeElement::~ModelTreeElement() {
     _voxelMemoryUsage -= sizeof(ModelTreeElement);
+    if (_myTree) {
+        foreach (const ModelItem& model, *_modelItems) {
+            _myTree->clearContainingElement(model.getID(), this);
+        }
+    }
     delete _modelItems;
     _modelItems = NULL;
 }
@@ -82,6 +87,7 @@ void ModelTreeElement::update(ModelTreeUpdateArgs& args) {
             args._movingModels.push_back(model);
 
             // erase this model
+            _myTree->clearContainingElement(model.getID(), this);
             modelItr = _modelItems->erase(modelItr);
         } else {
             ++modelItr;
@@ -192,6 +198,7 @@ void ModelTreeElement::updateModelItemID(FindAndUpdateModelItemIDArgs* args) {
             // first, we're looking for matching creatorTokenIDs, if we find that, then we fix it to know the actual ID
             if (thisModel.getCreatorTokenID() == args->creatorTokenID) {
                 thisModel.setID(args->modelID);
+                _myTree->setContainingElement(args->modelID, this);
                 args->creatorTokenFound = true;
             }
         }
@@ -199,6 +206,10 @@ void ModelTreeElement::updateModelItemID(FindAndUpdateModelItemIDArgs* args) {
         // if we're in an isViewing tree, we also need to look for an kill any viewed models
         if (!args->viewedModelFound && args->isViewing) {
             if (thisModel.getCreatorTokenID() == UNKNOWN_MODEL_TOKEN && thisModel.getID() == args->modelID) {
+                // if we've already given the ID to the created model, the map refers to that one now
+                if (!args->creatorTokenFound) {
+                    _myTree->clearContainingElement(args->modelID, this);
+                }
                 _modelItems->removeAt(i); // remove the model at this index
                 numberOfModels--; // this means we have 1 fewer model in this list
                 i--; // and we actually want to back up i as well.
@@ -272,6 +283,7 @@ bool ModelTreeElement::removeModelWithID(uint32_t id) {
         if ((*_modelItems)[i].getID() == id) {
             foundModel = true;
             _modelItems->removeAt(i);
+            _myTree->clearContainingElement(id, this);
             break;
         }
     }
@@ -325,6 +337,7 @@ bool ModelTreeElement::collapseChildren() {
 
 void ModelTreeElement::storeModel(const ModelItem& model) {
     _modelItems->push_back(model);
+    _myTree->setContainingElement(model.getID(), this);
     markWithChangedTime();
 }
 
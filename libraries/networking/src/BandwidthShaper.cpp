@@ -0,0 +1,227 @@
+//
+//  BandwidthShaper.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+
+#include <QtCore/QMutexLocker>
+
+#include "SharedUtil.h"
+#include "UUID.h"
+
+#include "BandwidthShaper.h"
+
+// the fraction of a node's burst size that must remain in its bucket for a packet of each class to be admitted,
+// audio may run the bucket into debt so that it is never held back by the lower priority classes
+const float CLASS_ADMISSION_THRESHOLDS[BandwidthShaper::NUM_PRIORITY_CLASSES] = { -1.0f, 0.0f, 0.25f, 0.5f };
+
+const char* PRIORITY_CLASS_NAMES[BandwidthShaper::NUM_PRIORITY_CLASSES] = { "audio", "avatar", "octree", "bulk" };
+
+const float DEFAULT_BURST_SECONDS = 0.25f;
+
+BandwidthShaper::PriorityClass BandwidthShaper::priorityClassForPacketType(PacketType type) {
+    switch (type) {
+        case PacketTypeInjectAudio:
+        case PacketTypeMixedAudio:
+        case PacketTypeMicrophoneAudioNoEcho:
+        case PacketTypeMicrophoneAudioWithEcho:
+        case PacketTypeSilentAudioFrame:
+        case PacketTypeMuteEnvironment:
+        // small, latency sensitive control packets ride along with audio
+        case PacketTypePing:
+        case PacketTypePingReply:
+        case PacketTypeDomainList:
+        case PacketTypeDomainListRequest:
+        case PacketTypeDomainConnectRequest:
+            return AudioClass;
+        case PacketTypeAvatarData:
+        case PacketTypeBulkAvatarData:
+        case PacketTypeKillAvatar:
+        case PacketTypeAvatarIdentity:
+        case PacketTypeAvatarBillboard:
+            return AvatarClass;
+        case PacketTypeVoxelQuery:
+        case PacketTypeVoxelData:
+        case PacketTypeVoxelSet:
+        case PacketTypeVoxelSetDestructive:
+        case PacketTypeVoxelErase:
+        case PacketTypeOctreeStats:
+        case PacketTypeJurisdiction:
+        case PacketTypeJurisdictionRequest:
+        case PacketTypeEnvironmentData:
+        case PacketTypeParticleQuery:
+        case PacketTypeParticleData:
+        case PacketTypeParticleAddOrEdit:
+        case PacketTypeParticleErase:
+        case PacketTypeParticleAddResponse:
+        case PacketTypeModelQuery:
+        case PacketTypeModelData:
+        case PacketTypeModelAddOrEdit:
+        case PacketTypeModelErase:
+        case PacketTypeModelAddResponse:
+            return OctreeClass;
+        default:
+            return BulkClass;
+    }
+}
+
+const char* BandwidthShaper::getPriorityClassName(PriorityClass priorityClass) {
+    return PRIORITY_CLASS_NAMES[priorityClass];
+}
+
+BandwidthShaper::TokenBucket::TokenBucket() :
+    tokens(0.0f),
+    lastRefill(0),
+    bytesSent(0),
+    packetsDeferred(0)
+{
+}
+
+void BandwidthShaper::TokenBucket::refill(const Limits& limits, quint64 now) {
+    if (lastRefill == 0) {
+        // a new bucket starts out full
+        tokens = limits.burstBytes;
+    } else if (now > lastRefill) {
+        tokens = std::min((float)limits.burstBytes,
+                          tokens + (float)(now - lastRefill) * limits.bytesPerSecond / USECS_PER_SECOND);
+    }
+    lastRefill = now;
+}
+
+BandwidthShaper::ClassStats::ClassStats() :
+    bytesSent(0),
+    packetsSent(0),
+    packetsDeferred(0)
+{
+}
+
+BandwidthShaper::BandwidthShaper() :
+    _mutex(),
+    _nodeTypeLimits(),
+    _buckets()
+{
+}
+
+void BandwidthShaper::setNodeTypeLimits(NodeType_t nodeType, int bytesPerSecond, int burstBytes) {
+    if (bytesPerSecond <= 0) {
+        clearNodeTypeLimits(nodeType);
+        return;
+    }
+    Limits limits = { bytesPerSecond, burstBytes > 0 ? burstBytes : (int)(bytesPerSecond * DEFAULT_BURST_SECONDS) };
+
+    QMutexLocker locker(&_mutex);
+    _nodeTypeLimits.insert(nodeType, limits);
+
+    qDebug() << "Shaping packets to" << NodeType::getNodeTypeName(nodeType) << "nodes at" << limits.bytesPerSecond
+        << "bytes per second with a burst of" << limits.burstBytes << "bytes";
+}
+
+void BandwidthShaper::clearNodeTypeLimits(NodeType_t nodeType) {
+    QMutexLocker locker(&_mutex);
+    _nodeTypeLimits.remove(nodeType);
+}
+
+bool BandwidthShaper::isShapingNodeType(NodeType_t nodeType) {
+    QMutexLocker locker(&_mutex);
+    return _nodeTypeLimits.contains(nodeType);
+}
+
+BandwidthShaper::TokenBucket* BandwidthShaper::bucketForNode(const Node& node, Limits& limits) {
+    QHash<NodeType_t, Limits>::const_iterator limitsItem = _nodeTypeLimits.constFind(node.getType());
+    if (limitsItem == _nodeTypeLimits.constEnd()) {
+        return NULL;
+    }
+    limits = limitsItem.value();
+    TokenBucket* bucket = &_buckets[node.getUUID()];
+    bucket->refill(limits, usecTimestampNow());
+    return bucket;
+}
+
+bool BandwidthShaper::canSend(const Node& node, PriorityClass priorityClass, int bytes, bool countDeferral) {
+    QMutexLocker locker(&_mutex);
+    Limits limits;
+    TokenBucket* bucket = bucketForNode(node, limits);
+    if (!bucket) {
+        return true;
+    }
+    // a packet larger than the whole burst can only go out on a full bucket, otherwise it would never be admitted
+    float required = std::min((float)bytes, (float)limits.burstBytes) +
+        CLASS_ADMISSION_THRESHOLDS[priorityClass] * limits.burstBytes;
+    if (bucket->tokens >= required) {
+        return true;
+    }
+    if (countDeferral) {
+        bucket->packetsDeferred++;
+        _classStats[priorityClass].packetsDeferred++;
+    }
+    return false;
+}
+
+bool BandwidthShaper::canSend(const Node& node, const QByteArray& packet, bool countDeferral) {
+    return canSend(node, priorityClassForPacketType(packetTypeForPacket(packet)), packet.size(), countDeferral);
+}
+
+void BandwidthShaper::recordSent(const Node& node, const QByteArray& packet) {
+    PriorityClass priorityClass = priorityClassForPacketType(packetTypeForPacket(packet));
+
+    QMutexLocker locker(&_mutex);
+    Limits limits;
+    TokenBucket* bucket = bucketForNode(node, limits);
+    if (!bucket) {
+        return;
+    }
+    // don't let the debt grow past one burst, so that lower classes recover once the higher ones quiet down
+    bucket->tokens = std::max(bucket->tokens - packet.size(), (float)-limits.burstBytes);
+    bucket->bytesSent += packet.size();
+
+    _classStats[priorityClass].bytesSent += packet.size();
+    _classStats[priorityClass].packetsSent++;
+}
+
+void BandwidthShaper::removeNode(const QUuid& nodeUUID) {
+    QMutexLocker locker(&_mutex);
+    _buckets.remove(nodeUUID);
+}
+
+void BandwidthShaper::addStats(QJsonObject& statsObject) {
+    // callers tend to keep their stats objects around, so clear out the last round (and any nodes since killed) first
+    const QString SHAPING_STATS_PREFIX = "shaping.";
+    foreach (const QString& key, statsObject.keys()) {
+        if (key.startsWith(SHAPING_STATS_PREFIX)) {
+            statsObject.remove(key);
+        }
+    }
+    QMutexLocker locker(&_mutex);
+    if (_nodeTypeLimits.isEmpty()) {
+        return;
+    }
+    for (int i = 0; i < NUM_PRIORITY_CLASSES; i++) {
+        QString baseName = SHAPING_STATS_PREFIX + "class." + PRIORITY_CLASS_NAMES[i];
+        statsObject[baseName + ".bytes_sent"] = (double)_classStats[i].bytesSent;
+        statsObject[baseName + ".packets_sent"] = _classStats[i].packetsSent;
+        statsObject[baseName + ".packets_deferred"] = _classStats[i].packetsDeferred;
+    }
+    for (QHash<QUuid, TokenBucket>::const_iterator it = _buckets.constBegin(); it != _buckets.constEnd(); it++) {
+        QString baseName = SHAPING_STATS_PREFIX + "nodes." + uuidStringWithoutCurlyBraces(it.key());
+        statsObject[baseName + ".tokens"] = it.value().tokens;
+        statsObject[baseName + ".bytes_sent"] = (double)it.value().bytesSent;
+        statsObject[baseName + ".packets_deferred"] = it.value().packetsDeferred;
+    }
+}
+
+void BandwidthShaper::resetStats() {
+    QMutexLocker locker(&_mutex);
+    for (int i = 0; i < NUM_PRIORITY_CLASSES; i++) {
+        _classStats[i] = ClassStats();
+    }
+    for (QHash<QUuid, TokenBucket>::iterator it = _buckets.begin(); it != _buckets.end(); it++) {
+        it.value().bytesSent = 0;
+        it.value().packetsDeferred = 0;
+    }
+}
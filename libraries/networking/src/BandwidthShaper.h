@@ -0,0 +1,108 @@
+//
+//  BandwidthShaper.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Per-destination token bucket shaping of outbound packets, with priority classes.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_BandwidthShaper_h
+#define hifi_BandwidthShaper_h
+
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QMutex>
+#include <QtCore/QUuid>
+
+#include "Node.h"
+#include "PacketHeaders.h"
+
+/// Shapes outbound traffic to each node with a token bucket whose rate and burst size are configured per node type.
+/// Every datagram written through the LimitedNodeList debits the bucket of its destination. Senders that are able to
+/// defer packets (PacketSender, OctreeSendThread) ask canSend() first, and lower priority classes are held back sooner
+/// than higher ones, so that a flood of octree or bulk packets cannot starve audio on a constrained link.
+class BandwidthShaper {
+public:
+    /// Priority classes, from most to least important
+    enum PriorityClass {
+        AudioClass = 0,
+        AvatarClass,
+        OctreeClass,
+        BulkClass,
+        NUM_PRIORITY_CLASSES
+    };
+
+    static PriorityClass priorityClassForPacketType(PacketType type);
+    static const char* getPriorityClassName(PriorityClass priorityClass);
+
+    BandwidthShaper();
+
+    /// Enables shaping of packets sent to nodes of the given type.
+    /// \param bytesPerSecond the sustained rate at which tokens are added to each bucket
+    /// \param burstBytes the capacity of each bucket, defaults to a quarter second of traffic when zero
+    void setNodeTypeLimits(NodeType_t nodeType, int bytesPerSecond, int burstBytes = 0);
+
+    /// Disables shaping of packets sent to nodes of the given type.
+    void clearNodeTypeLimits(NodeType_t nodeType);
+
+    bool isShapingNodeType(NodeType_t nodeType);
+
+    /// Returns true if a packet of the given class and size may be sent to the node right now. Does not consume tokens,
+    /// callers that get a true result are expected to write the packet through the LimitedNodeList.
+    /// \param countDeferral whether a false result should be counted as a deferral (callers retrying a packet that has
+    /// already been counted pass false)
+    bool canSend(const Node& node, PriorityClass priorityClass, int bytes, bool countDeferral = true);
+    bool canSend(const Node& node, const QByteArray& packet, bool countDeferral = true);
+
+    /// Debits the destination's bucket for a packet that has been written to the socket.
+    void recordSent(const Node& node, const QByteArray& packet);
+
+    /// Releases the bucket for a node that has been killed.
+    void removeNode(const QUuid& nodeUUID);
+
+    /// Adds per class and per node shaping stats gathered since the last reset to the stats object, replacing any shaping
+    /// stats already there.
+    void addStats(QJsonObject& statsObject);
+    void resetStats();
+
+private:
+    class Limits {
+    public:
+        int bytesPerSecond;
+        int burstBytes;
+    };
+
+    class TokenBucket {
+    public:
+        TokenBucket();
+
+        void refill(const Limits& limits, quint64 now);
+
+        float tokens;
+        quint64 lastRefill;
+        quint64 bytesSent;
+        int packetsDeferred;
+    };
+
+    class ClassStats {
+    public:
+        ClassStats();
+
+        quint64 bytesSent;
+        int packetsSent;
+        int packetsDeferred;
+    };
+
+    TokenBucket* bucketForNode(const Node& node, Limits& limits);
+
+    QMutex _mutex;
+    QHash<NodeType_t, Limits> _nodeTypeLimits;
+    QHash<QUuid, TokenBucket> _buckets;
+    ClassStats _classStats[NUM_PRIORITY_CLASSES];
+};
+
+#endif // hifi_BandwidthShaper_h
@@ -9,6 +9,16 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <cstring>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#else
+#include <winsock2.h>
+#endif
+
 #include "DummyDTLSSession.h"
 
 ssize_t DummyDTLSSession::socketPush(gnutls_transport_ptr_t ptr, const void* buffer, size_t size) {
@@ -23,6 +33,23 @@ ssize_t DummyDTLSSession::socketPush(gnutls_transport_ptr_t ptr, const void* buf
                                     session->_destinationSocket.getAddress(), session->_destinationSocket.getPort());
 }
 
+ssize_t DummyDTLSSession::socketDescriptorPush(gnutls_transport_ptr_t ptr, const void* buffer, size_t size) {
+    DummyDTLSSession* session = static_cast<DummyDTLSSession*>(ptr);
+    
+#if DTLS_VERBOSE_DEBUG
+    qDebug() << "Pushing a message of size" << size << "to" << session->_destinationSocket << "from socket descriptor";
+#endif
+    
+    sockaddr_in destinationSockAddr;
+    memset(&destinationSockAddr, 0, sizeof(destinationSockAddr));
+    destinationSockAddr.sin_family = AF_INET;
+    destinationSockAddr.sin_addr.s_addr = htonl(session->_destinationSocket.getAddress().toIPv4Address());
+    destinationSockAddr.sin_port = htons(session->_destinationSocket.getPort());
+    
+    return sendto(session->_dtlsSocket.socketDescriptor(), reinterpret_cast<const char*>(buffer), size, 0,
+                  reinterpret_cast<const sockaddr*>(&destinationSockAddr), sizeof(destinationSockAddr));
+}
+
 DummyDTLSSession::DummyDTLSSession(QUdpSocket& dtlsSocket, const HifiSockAddr& destinationSocket) :
     _dtlsSocket(dtlsSocket),
     _destinationSocket(destinationSocket)
@@ -26,6 +26,9 @@ public:
     DummyDTLSSession(QUdpSocket& dtlsSocket, const HifiSockAddr& destinationSocket);
     
     static ssize_t socketPush(gnutls_transport_ptr_t ptr, const void* buffer, size_t size);
+    
+    /// Same as socketPush, but writes straight to the socket descriptor so that it can be used off the socket's thread
+    static ssize_t socketDescriptorPush(gnutls_transport_ptr_t ptr, const void* buffer, size_t size);
 protected:
     QUdpSocket& _dtlsSocket;
     HifiSockAddr _destinationSocket;
@@ -69,7 +69,8 @@ LimitedNodeList::LimitedNodeList(unsigned short socketListenPort, unsigned short
     _dtlsSocket(NULL),
     _numCollectedPackets(0),
     _numCollectedBytes(0),
-    _packetStatTimer()
+    _packetStatTimer(),
+    _bandwidthShaper()
 {
     _nodeSocket.bind(QHostAddress::AnyIPv4, socketListenPort);
     qDebug() << "NodeList socket is listening on" << _nodeSocket.localPort();
@@ -177,6 +178,8 @@ bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
         if (sendingNode) {
             // check if the md5 hash in the header matches the hash we would expect
             if (hashFromPacketHeader(packet) == hashForPacketAndConnectionUUID(packet, sendingNode->getConnectionSecret())) {
+                // this is the first look every read loop takes at a packet, so it serves as the arrival time
+                sendingNode->getPacketTimingStats().recordArrival(checkType, usecTimestampNow());
                 return true;
             } else {
                 qDebug() << "Packet hash mismatch on" << checkType << "- Sender"
@@ -187,6 +190,11 @@ bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
                 << uuidFromPacketHeader(packet);
         }
     } else {
+        // these aren't verified, but we can still time the ones from nodes we know about
+        SharedNodePointer sendingNode = sendingNodeForPacket(packet);
+        if (sendingNode) {
+            sendingNode->getPacketTimingStats().recordArrival(checkType, usecTimestampNow());
+        }
         return true;
     }
     
@@ -231,6 +239,8 @@ qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const SharedNo
             }
         }
         
+        _bandwidthShaper.recordSent(*destinationNode, datagram);
+        
         return writeDatagram(datagram, *destinationSockAddr, destinationNode->getConnectionSecret());
     }
     
@@ -253,6 +263,8 @@ qint64 LimitedNodeList::writeUnverifiedDatagram(const QByteArray& datagram, cons
             }
         }
         
+        _bandwidthShaper.recordSent(*destinationNode, datagram);
+        
         // don't use the node secret!
         return writeDatagram(datagram, *destinationSockAddr, QUuid());
     }
@@ -296,7 +308,17 @@ int LimitedNodeList::updateNodeWithDataFromPacket(const SharedNodePointer& match
     
     QMutexLocker linkedDataLocker(&matchingNode->getLinkedData()->getMutex());
     
-    return matchingNode->getLinkedData()->parseData(packet);
+    int bytesRead = matchingNode->getLinkedData()->parseData(packet);
+    
+    // packets handed straight to the linked data are handled in the same pass that read them off the socket
+    PacketType packetType = packetTypeForPacket(packet);
+    PacketTimingStats& timingStats = matchingNode->getPacketTimingStats();
+    quint64 lastArrival = timingStats.getLastArrival(packetType);
+    if (lastArrival != 0) {
+        timingStats.recordProcessed(packetType, lastArrival, usecTimestampNow());
+    }
+    
+    return bytesRead;
 }
 
 int LimitedNodeList::findNodeAndUpdateWithDataFromPacket(const QByteArray& packet) {
@@ -366,6 +388,7 @@ void LimitedNodeList::killNodeWithUUID(const QUuid& nodeUUID) {
 NodeHash::iterator LimitedNodeList::killNodeAtHashIterator(NodeHash::iterator& nodeItemToKill) {
     qDebug() << "Killed" << *nodeItemToKill.value();
     emit nodeKilled(nodeItemToKill.value());
+    _bandwidthShaper.removeNode(nodeItemToKill.key());
     return _nodeHash.erase(nodeItemToKill);
 }
 
@@ -464,6 +487,33 @@ void LimitedNodeList::resetPacketStats() {
     _packetStatTimer.restart();
 }
 
+void LimitedNodeList::addPacketTimingStats(QJsonObject& statsObject, bool includeNodes) {
+    // callers tend to keep their stats objects around, so clear out the last round (and any nodes since killed) first
+    const QString TIMING_STATS_PREFIX = "timing.";
+    foreach (const QString& key, statsObject.keys()) {
+        if (key.startsWith(TIMING_STATS_PREFIX)) {
+            statsObject.remove(key);
+        }
+    }
+    PacketTimingStats totalStats;
+    
+    foreach (const SharedNodePointer& node, getNodeHash()) {
+        node->getPacketTimingStats().addTo(totalStats);
+        if (includeNodes) {
+            node->getPacketTimingStats().addStats(statsObject,
+                "timing.nodes." + uuidStringWithoutCurlyBraces(node->getUUID()));
+        }
+    }
+    
+    totalStats.addStats(statsObject, "timing.types");
+}
+
+void LimitedNodeList::resetPacketTimingStats() {
+    foreach (const SharedNodePointer& node, getNodeHash()) {
+        node->getPacketTimingStats().reset();
+    }
+}
+
 void LimitedNodeList::removeSilentNodes() {
 
     _nodeHashMutex.lock();
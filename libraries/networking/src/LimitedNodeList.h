@@ -29,6 +29,7 @@
 
 #include <gnutls/gnutls.h>
 
+#include "BandwidthShaper.h"
 #include "DomainHandler.h"
 #include "Node.h"
 
@@ -46,6 +47,12 @@ class HifiSockAddr;
 
 typedef QSet<NodeType_t> NodeSet;
 
+typedef quint8 DomainListEntryType_t;
+namespace DomainListEntryType {
+    const DomainListEntryType_t Added = 0;
+    const DomainListEntryType_t Removed = 1;
+}
+
 typedef QSharedPointer<Node> SharedNodePointer;
 typedef QHash<QUuid, SharedNodePointer> NodeHash;
 Q_DECLARE_METATYPE(SharedNodePointer)
@@ -101,6 +108,13 @@ public:
 
     void getPacketStats(float &packetsPerSecond, float &bytesPerSecond);
     void resetPacketStats();
+
+    BandwidthShaper& getBandwidthShaper() { return _bandwidthShaper; }
+    
+    /// Adds the packet timing percentiles for each PacketType over all nodes to the stats object, along with those for each
+    /// node if requested, replacing any timing stats already there.
+    void addPacketTimingStats(QJsonObject& statsObject, bool includeNodes = true);
+    void resetPacketTimingStats();
 public slots:
     void reset();
     void eraseAllNodes();
@@ -135,6 +149,7 @@ protected:
     int _numCollectedPackets;
     int _numCollectedBytes;
     QElapsedTimer _packetStatTimer;
+    BandwidthShaper _bandwidthShaper;
 };
 
 #endif // hifi_LimitedNodeList_h
@@ -17,38 +17,39 @@
 
 #include "NetworkPacket.h"
 
-void NetworkPacket::copyContents(const SharedNodePointer& destinationNode, const QByteArray& packet) {
+void NetworkPacket::copyContents(const SharedNodePointer& destinationNode, const QByteArray& packet, quint64 timestamp) {
     if (packet.size() && packet.size() <= MAX_PACKET_SIZE) {
         _destinationNode = destinationNode;
         _byteArray = packet;
+        _timestamp = timestamp;
     } else {
         qDebug(">>> NetworkPacket::copyContents() unexpected length = %d", packet.size());
     }
 }
 
 NetworkPacket::NetworkPacket(const NetworkPacket& packet) {
-    copyContents(packet.getDestinationNode(), packet.getByteArray());
+    copyContents(packet.getDestinationNode(), packet.getByteArray(), packet.getTimestamp());
 }
 
 NetworkPacket::NetworkPacket(const SharedNodePointer& destinationNode, const QByteArray& packet) {
-    copyContents(destinationNode, packet);
+    copyContents(destinationNode, packet, usecTimestampNow());
 };
 
 // copy assignment 
 NetworkPacket& NetworkPacket::operator=(NetworkPacket const& other) {
-    copyContents(other.getDestinationNode(), other.getByteArray());
+    copyContents(other.getDestinationNode(), other.getByteArray(), other.getTimestamp());
     return *this;
 }
 
 #ifdef HAS_MOVE_SEMANTICS
 // move, same as copy, but other packet won't be used further
 NetworkPacket::NetworkPacket(NetworkPacket && packet) {
-    copyContents(packet.getDestinationNode(), packet.getByteArray());
+    copyContents(packet.getDestinationNode(), packet.getByteArray(), packet.getTimestamp());
 }
 
 // move assignment
 NetworkPacket& NetworkPacket::operator=(NetworkPacket&& other) {
-    copyContents(other.getDestinationNode(), other.getByteArray());
+    copyContents(other.getDestinationNode(), other.getByteArray(), other.getTimestamp());
     return *this;
 }
 #endif
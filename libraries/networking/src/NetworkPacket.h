@@ -38,12 +38,16 @@ public:
 
     const SharedNodePointer& getDestinationNode() const { return _destinationNode; }
     const QByteArray& getByteArray() const { return _byteArray; }
+    
+    /// the time the packet was constructed, before it was queued for sending or processing
+    quint64 getTimestamp() const { return _timestamp; }
 
 private:
-    void copyContents(const SharedNodePointer& destinationNode, const QByteArray& byteArray);
+    void copyContents(const SharedNodePointer& destinationNode, const QByteArray& byteArray, quint64 timestamp);
 
     SharedNodePointer _destinationNode;
     QByteArray _byteArray;
+    quint64 _timestamp;
 };
 
 #endif // hifi_NetworkPacket_h
@@ -22,6 +22,7 @@
 
 #include "HifiSockAddr.h"
 #include "NodeData.h"
+#include "PacketTimingStats.h"
 #include "SimpleMovingAverage.h"
 
 typedef quint8 NodeType_t;
@@ -97,6 +98,8 @@ public:
     void setClockSkewUsec(int clockSkew) { _clockSkewUsec = clockSkew; }
     QMutex& getMutex() { return _mutex; }
     
+    PacketTimingStats& getPacketTimingStats() { return _packetTimingStats; }
+    
     friend QDataStream& operator<<(QDataStream& out, const Node& node);
     friend QDataStream& operator>>(QDataStream& in, Node& node);
 
@@ -120,6 +123,7 @@ private:
     int _pingMs;
     int _clockSkewUsec;
     QMutex _mutex;
+    PacketTimingStats _packetTimingStats;
 };
 
 QDebug operator<<(QDebug debug, const Node &message);
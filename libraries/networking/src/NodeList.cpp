@@ -61,7 +61,11 @@ NodeList::NodeList(char newOwnerType, unsigned short socketListenPort, unsigned
     _assignmentServerSocket(),
     _publicSockAddr(),
     _hasCompletedInitialSTUNFailure(false),
-    _stunRequestsSinceSuccess(0)
+    _stunRequestsSinceSuccess(0),
+    _domainListVersion(0),
+    _pendingDomainListVersion(0),
+    _numPendingDomainListEntries(0),
+    _isApplyingDomainListRemoval(false)
 {
     // clear our NodeList when the domain changes
     connect(&_domainHandler, &DomainHandler::hostnameChanged, this, &NodeList::reset);
@@ -71,13 +75,45 @@ NodeList::NodeList(char newOwnerType, unsigned short socketListenPort, unsigned
     
     // perform a function when DTLS handshake is completed
     connect(&_domainHandler, &DomainHandler::completedDTLSHandshake, this, &NodeList::completedDTLSHandshake);
+    
+    // nodes we kill ourselves won't be in the changes the domain-server sends, so we'll need a full list again
+    connect(this, &LimitedNodeList::nodeKilled, this, &NodeList::handleNodeKill, Qt::DirectConnection);
 }
 
 qint64 NodeList::sendStatsToDomainServer(const QJsonObject& statsObject) {
-    QByteArray statsPacket = byteArrayWithPopulatedHeader(PacketTypeNodeJsonStats);
+    // the domain-server merges each stats packet into what it has, so we can break the stats up into as many packets
+    // as it takes to keep each one within the MTU
+    QByteArray header = byteArrayWithPopulatedHeader(PacketTypeNodeJsonStats);
+    const int MAP_COUNT_BYTES = sizeof(quint32);
+    
+    QVariantMap statsMap = statsObject.toVariantMap();
+    QVariantMap packetMap;
+    int packetSize = header.size() + MAP_COUNT_BYTES;
+    qint64 bytesWritten = 0;
+    for (QVariantMap::const_iterator it = statsMap.constBegin(); it != statsMap.constEnd(); it++) {
+        QByteArray entry;
+        QDataStream entryStream(&entry, QIODevice::WriteOnly);
+        entryStream << it.key() << it.value();
+        
+        if (!packetMap.isEmpty() && packetSize + entry.size() > MAX_PACKET_SIZE) {
+            bytesWritten += sendStatsPacketToDomainServer(header, packetMap);
+            packetMap.clear();
+            packetSize = header.size() + MAP_COUNT_BYTES;
+        }
+        packetMap.insert(it.key(), it.value());
+        packetSize += entry.size();
+    }
+    if (!packetMap.isEmpty()) {
+        bytesWritten += sendStatsPacketToDomainServer(header, packetMap);
+    }
+    return bytesWritten;
+}
+
+qint64 NodeList::sendStatsPacketToDomainServer(const QByteArray& header, const QVariantMap& statsMap) {
+    QByteArray statsPacket = header;
     QDataStream statsPacketStream(&statsPacket, QIODevice::Append);
     
-    statsPacketStream << statsObject.toVariantMap();
+    statsPacketStream << statsMap;
     
     return writeUnverifiedDatagram(statsPacket, _domainHandler.getSockAddr());
 }
@@ -156,6 +192,15 @@ void NodeList::processNodeData(const HifiSockAddr& senderSockAddr, const QByteAr
             SharedNodePointer matchingNode = sendingNodeForPacket(packet);
             if (matchingNode) {
                 matchingNode->setLastHeardMicrostamp(usecTimestampNow());
+                
+                // the ping carries the sender's timestamp, which with our skew estimate gives a one way transit
+                QDataStream pingStream(packet);
+                pingStream.skipRawData(numBytesForPacketHeader(packet) + sizeof(PingType_t));
+                quint64 pingSentTime;
+                pingStream >> pingSentTime;
+                matchingNode->getPacketTimingStats().recordTransit(PacketTypePing, pingSentTime,
+                                                                   matchingNode->getClockSkewUsec(), usecTimestampNow());
+                
                 QByteArray replyPacket = constructPingReplyPacket(packet);
                 writeDatagram(replyPacket, matchingNode, senderSockAddr);
                 
@@ -202,6 +247,11 @@ void NodeList::reset() {
     LimitedNodeList::reset();
     
     _numNoReplyDomainCheckIns = 0;
+    
+    // we'll need the full list from whatever domain we connect to next
+    _domainListVersion = 0;
+    _pendingDomainListVersion = 0;
+    _numPendingDomainListEntries = 0;
 
     // refresh the owner UUID to the NULL UUID
     setSessionUUID(QUuid());
@@ -403,6 +453,11 @@ void NodeList::sendDomainServerCheckIn() {
             packetStream << nodeTypeOfInterest;
         }
         
+        if (domainPacketType == PacketTypeDomainListRequest) {
+            // tell the domain-server which version of the list we have, so it only sends us what changed since then
+            packetStream << _domainListVersion;
+        }
+        
         if (!isUsingDTLS) {
             writeDatagram(domainServerPacket, _domainHandler.getSockAddr(), QUuid());
         } else {
@@ -428,6 +483,15 @@ void NodeList::sendDomainServerCheckIn() {
     }
 }
 
+void NodeList::handleNodeKill(SharedNodePointer node) {
+    if (_isApplyingDomainListRemoval) {
+        return; // the domain-server removed this one, so our version of the list is still good
+    }
+    // ask for the full list next time, and don't take the version of any list that's partway in
+    _domainListVersion = 0;
+    _numPendingDomainListEntries = -1;
+}
+
 int NodeList::processDomainServerList(const QByteArray& packet) {
     // this is a packet from the domain server, reset the count of un-replied check-ins
     _numNoReplyDomainCheckIns = 0;
@@ -453,20 +517,56 @@ int NodeList::processDomainServerList(const QByteArray& packet) {
     packetStream >> newUUID;
     setSessionUUID(newUUID);
     
+    quint32 listVersion = 0;
+    quint16 numListEntries = 0;
+    quint16 firstEntryIndex = 0;
+    packetStream >> listVersion >> numListEntries >> firstEntryIndex;
+    
+    // the list can be split across packets, keep track of whether we've seen all of it
+    if (firstEntryIndex == 0) {
+        _pendingDomainListVersion = listVersion;
+        _numPendingDomainListEntries = 0;
+    } else if (listVersion != _pendingDomainListVersion || firstEntryIndex != _numPendingDomainListEntries) {
+        // we missed part of this list, apply what we have but don't take its version
+        _numPendingDomainListEntries = -1;
+    }
+    
+    DomainListEntryType_t entryType;
+    
     // pull each node in the packet
     while(packetStream.device()->pos() < packet.size()) {
-        packetStream >> nodeType >> nodeUUID >> nodePublicSocket >> nodeLocalSocket;
-
-        // if the public socket address is 0 then it's reachable at the same IP
-        // as the domain server
-        if (nodePublicSocket.getAddress().isNull()) {
-            nodePublicSocket.setAddress(_domainHandler.getIP());
+        packetStream >> entryType;
+        
+        if (entryType == DomainListEntryType::Removed) {
+            packetStream >> nodeUUID;
+            _isApplyingDomainListRemoval = true;
+            killNodeWithUUID(nodeUUID);
+            _isApplyingDomainListRemoval = false;
+        } else {
+            packetStream >> nodeType >> nodeUUID >> nodePublicSocket >> nodeLocalSocket;
+            
+            // if the public socket address is 0 then it's reachable at the same IP
+            // as the domain server
+            if (nodePublicSocket.getAddress().isNull()) {
+                nodePublicSocket.setAddress(_domainHandler.getIP());
+            }
+            
+            SharedNodePointer node = addOrUpdateNode(nodeUUID, nodeType, nodePublicSocket, nodeLocalSocket);
+            
+            packetStream >> connectionUUID;
+            node->setConnectionSecret(connectionUUID);
         }
-
-        SharedNodePointer node = addOrUpdateNode(nodeUUID, nodeType, nodePublicSocket, nodeLocalSocket);
         
-        packetStream >> connectionUUID;
-        node->setConnectionSecret(connectionUUID);
+        readNodes++;
+    }
+    
+    if (_numPendingDomainListEntries >= 0) {
+        _numPendingDomainListEntries += readNodes;
+        
+        if (_numPendingDomainListEntries >= numListEntries) {
+            // we have the whole list, the next check in can ask for only what changed since this version
+            _domainListVersion = listVersion;
+        }
     }
     
     // ping inactive nodes in conjunction with receipt of list from domain-server
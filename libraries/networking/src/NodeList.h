@@ -24,6 +24,7 @@
 #include <QtCore/QSet>
 #include <QtCore/QSettings>
 #include <QtCore/QSharedPointer>
+#include <QtCore/QVariantMap>
 #include <QtNetwork/QHostAddress>
 #include <QtNetwork/QUdpSocket>
 
@@ -55,6 +56,7 @@ public:
     NodeType_t getOwnerType() const { return _ownerType; }
     void setOwnerType(NodeType_t ownerType) { _ownerType = ownerType; }
 
+    /// Sends the stats to the domain-server, spread across as many packets as it takes to fit them.
     qint64 sendStatsToDomainServer(const QJsonObject& statsObject);
 
     int getNumNoReplyDomainCheckIns() const { return _numNoReplyDomainCheckIns; }
@@ -85,6 +87,8 @@ public slots:
     void pingInactiveNodes();
     void completedDTLSHandshake();
     void processAvailableDTLSDatagrams();
+private slots:
+    void handleNodeKill(SharedNodePointer node);
 signals:
     void limitOfSilentDomainCheckInsReached();
 private:
@@ -100,6 +104,7 @@ private:
     void requestAuthForDomainServer();
     void activateSocketFromNodeCommunication(const QByteArray& packet, const SharedNodePointer& sendingNode);
     void timePingReply(const QByteArray& packet, const SharedNodePointer& sendingNode);
+    qint64 sendStatsPacketToDomainServer(const QByteArray& header, const QVariantMap& statsMap);
     
     NodeType_t _ownerType;
     NodeSet _nodeTypesOfInterest;
@@ -109,6 +114,10 @@ private:
     HifiSockAddr _publicSockAddr;
     bool _hasCompletedInitialSTUNFailure;
     unsigned int _stunRequestsSinceSuccess;
+    quint32 _domainListVersion;
+    quint32 _pendingDomainListVersion;
+    int _numPendingDomainListEntries;
+    bool _isApplyingDomainListRemoval;
 };
 
 #endif // hifi_NodeList_h
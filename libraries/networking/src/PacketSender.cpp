@@ -33,6 +33,7 @@ PacketSender::PacketSender(int packetsPerSecond) :
     _usecsPerProcessCallHint(0),
     _lastProcessCallTime(0),
     _averageProcessCallTime(AVERAGE_CALL_TIME_SAMPLES),
+    _isWatchingNodeKills(false),
     _lastSendTime(0), // Note: we set this to 0 to indicate we haven't yet sent something
     _lastPPSCheck(0),
     _packetsOverCheckInterval(0),
@@ -259,15 +260,47 @@ bool PacketSender::nonThreadedProcess() {
         }
     }
 
-    int packetsLeft = _packets.size();
+    NodeList* nodeList = NodeList::getInstance();
+    BandwidthShaper& bandwidthShaper = nodeList->getBandwidthShaper();
+    
+    // we're often constructed before the NodeList is, so we start watching for killed nodes here
+    if (!_isWatchingNodeKills) {
+        connect(nodeList, &LimitedNodeList::nodeKilled, this, &PacketSender::forgetDeferredNode, Qt::DirectConnection);
+        _isWatchingNodeKills = true;
+    }
 
-    // Now that we know how many packets to send this call to process, just send them.
-    while ((packetsSentThisCall < packetsToSendThisCall) && (packetsLeft > 0)) {
+    // send the packets in the order they were queued, in a single pass. Once the bandwidth shaper holds back a packet,
+    // everything after it to the same node is held back as well so that each node's packets stay in order; they're all
+    // retried on the next call
+    QSet<QUuid> blockedNodes;
+    size_t packetIndex = 0;
+    while (packetsSentThisCall < packetsToSendThisCall) {
         lock();
-        NetworkPacket& packet = _packets.front();
-        NetworkPacket temporary = packet; // make a copy
-        _packets.erase(_packets.begin());
-        packetsLeft = _packets.size();
+        while (packetIndex < _packets.size()) {
+            const SharedNodePointer& node = _packets[packetIndex].getDestinationNode();
+            if (!node) {
+                break;
+            }
+            QUuid nodeUUID = node->getUUID();
+            if (!blockedNodes.contains(nodeUUID)) {
+                // a packet held back on an earlier call has already been counted as deferred
+                if (bandwidthShaper.canSend(*node, _packets[packetIndex].getByteArray(),
+                        !_deferredNodes.contains(nodeUUID))) {
+                    _deferredNodes.remove(nodeUUID);
+                    break;
+                }
+                blockedNodes.insert(nodeUUID);
+                _deferredNodes.insert(nodeUUID);
+            }
+            packetIndex++;
+        }
+        if (packetIndex >= _packets.size()) {
+            unlock();
+            break;
+        }
+        // packets are only ever appended by other threads, so our index stays good across the unlock
+        NetworkPacket temporary = _packets[packetIndex]; // make a copy
+        _packets.erase(_packets.begin() + packetIndex);
         unlock();
 
         // send the packet through the NodeList...
@@ -283,3 +316,9 @@ bool PacketSender::nonThreadedProcess() {
     }
     return isStillRunning();
 }
+
+void PacketSender::forgetDeferredNode(SharedNodePointer node) {
+    lock();
+    _deferredNodes.remove(node->getUUID());
+    unlock();
+}
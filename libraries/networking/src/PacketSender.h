@@ -14,6 +14,8 @@
 #ifndef hifi_PacketSender_h
 #define hifi_PacketSender_h
 
+#include <QSet>
+#include <QUuid>
 #include <QWaitCondition>
 
 #include "GenericThread.h"
@@ -97,6 +99,8 @@ public:
     quint64 getLifetimeBytesQueued() const { return _totalBytesQueued; }
 signals:
     void packetSent(quint64);
+private slots:
+    void forgetDeferredNode(SharedNodePointer node);
 protected:
     int _packetsPerSecond;
     int _usecsPerProcessCallHint;
@@ -105,6 +109,8 @@ protected:
 
 private:
     std::vector<NetworkPacket> _packets;
+    QSet<QUuid> _deferredNodes; ///< nodes whose oldest queued packet has been held back by the shaper and counted
+    bool _isWatchingNodeKills;
     quint64 _lastSendTime;
 
     bool threadedProcess();
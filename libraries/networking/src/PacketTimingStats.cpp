@@ -0,0 +1,121 @@
+//
+//  PacketTimingStats.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "PacketTimingStats.h"
+
+PacketTimingStats::TypeStats::TypeStats() :
+    jitterHistogram(),
+    transitHistogram(),
+    processingHistogram(),
+    lastArrival(0),
+    lastInterArrival(0)
+{
+    
+}
+
+PacketTimingStats::PacketTimingStats() {
+    for (int i = 0; i < MAX_TIMED_PACKET_TYPES; i++) {
+        _typeStats[i] = NULL;
+    }
+}
+
+PacketTimingStats::~PacketTimingStats() {
+    for (int i = 0; i < MAX_TIMED_PACKET_TYPES; i++) {
+        delete _typeStats[i].load();
+    }
+}
+
+PacketTimingStats::TypeStats* PacketTimingStats::typeStats(PacketType type) {
+    QAtomicPointer<TypeStats>& slot = _typeStats[type % MAX_TIMED_PACKET_TYPES];
+    TypeStats* stats = slot.loadAcquire();
+    if (!stats) {
+        TypeStats* newStats = new TypeStats();
+        if (slot.testAndSetOrdered(NULL, newStats)) {
+            stats = newStats;
+        } else {
+            // another thread got there first
+            delete newStats;
+            stats = slot.loadAcquire();
+        }
+    }
+    return stats;
+}
+
+void PacketTimingStats::recordArrival(PacketType type, quint64 now) {
+    TypeStats* stats = typeStats(type);
+    if (stats->lastArrival != 0 && now >= stats->lastArrival) {
+        quint64 interArrival = now - stats->lastArrival;
+        if (stats->lastInterArrival != 0) {
+            stats->jitterHistogram.record(interArrival > stats->lastInterArrival ?
+                interArrival - stats->lastInterArrival : stats->lastInterArrival - interArrival);
+        }
+        stats->lastInterArrival = interArrival;
+    }
+    stats->lastArrival = now;
+}
+
+void PacketTimingStats::recordTransit(PacketType type, quint64 sentUsecs, int clockSkewUsec, quint64 now) {
+    // the sender's clock reads ours plus the skew, so take the skew back out of its timestamp
+    qint64 transit = (qint64)(now - sentUsecs) + clockSkewUsec;
+    typeStats(type)->transitHistogram.record(transit > 0 ? (quint64)transit : 0);
+}
+
+void PacketTimingStats::recordProcessed(PacketType type, quint64 receivedUsecs, quint64 now) {
+    typeStats(type)->processingHistogram.record(now > receivedUsecs ? now - receivedUsecs : 0);
+}
+
+quint64 PacketTimingStats::getLastArrival(PacketType type) const {
+    const TypeStats* stats = _typeStats[type % MAX_TIMED_PACKET_TYPES].loadAcquire();
+    return stats ? stats->lastArrival : 0;
+}
+
+void PacketTimingStats::addStats(QJsonObject& statsObject, const QString& baseName) const {
+    for (int i = 0; i < MAX_TIMED_PACKET_TYPES; i++) {
+        const TypeStats* stats = _typeStats[i].loadAcquire();
+        if (!stats) {
+            continue;
+        }
+        QString typeName = baseName + "." + QString::number(i);
+        if (stats->jitterHistogram.getCount() > 0) {
+            stats->jitterHistogram.addToJSONObject(statsObject, typeName + ".jitter_usecs");
+        }
+        if (stats->transitHistogram.getCount() > 0) {
+            stats->transitHistogram.addToJSONObject(statsObject, typeName + ".transit_usecs");
+        }
+        if (stats->processingHistogram.getCount() > 0) {
+            stats->processingHistogram.addToJSONObject(statsObject, typeName + ".processing_usecs");
+        }
+    }
+}
+
+void PacketTimingStats::addTo(PacketTimingStats& totalStats) const {
+    for (int i = 0; i < MAX_TIMED_PACKET_TYPES; i++) {
+        const TypeStats* stats = _typeStats[i].loadAcquire();
+        if (!stats) {
+            continue;
+        }
+        TypeStats* totalTypeStats = totalStats.typeStats((PacketType)i);
+        totalTypeStats->jitterHistogram.add(stats->jitterHistogram);
+        totalTypeStats->transitHistogram.add(stats->transitHistogram);
+        totalTypeStats->processingHistogram.add(stats->processingHistogram);
+    }
+}
+
+void PacketTimingStats::reset() {
+    for (int i = 0; i < MAX_TIMED_PACKET_TYPES; i++) {
+        TypeStats* stats = _typeStats[i].loadAcquire();
+        if (stats) {
+            // keep the arrival times so that jitter carries on across the reset
+            stats->jitterHistogram.reset();
+            stats->transitHistogram.reset();
+            stats->processingHistogram.reset();
+        }
+    }
+}
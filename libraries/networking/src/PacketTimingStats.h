@@ -0,0 +1,82 @@
+//
+//  PacketTimingStats.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Per-node, per-PacketType arrival jitter, transit and processing latency histograms.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_PacketTimingStats_h
+#define hifi_PacketTimingStats_h
+
+#include <QtCore/QAtomicPointer>
+#include <QtCore/QJsonObject>
+
+#include "Histogram.h"
+
+#include "PacketHeaders.h"
+
+const int MAX_TIMED_PACKET_TYPES = 256;
+
+/// Timing histograms for the packets received from one node, kept separately for each PacketType. Histograms for a
+/// type are created the first time a packet of that type arrives, without taking a lock, so that recording never blocks
+/// the thread reading the socket.
+class PacketTimingStats {
+public:
+    class TypeStats {
+    public:
+        TypeStats();
+        
+        /// the difference between consecutive inter-arrival times, as in the RFC 3550 jitter estimate
+        Histogram jitterHistogram;
+        
+        /// one way transit, corrected for the sender's clock skew
+        Histogram transitHistogram;
+        
+        /// time from the packet coming off the socket to being handled
+        Histogram processingHistogram;
+        
+        // only touched by the thread that reads the socket
+        quint64 lastArrival;
+        quint64 lastInterArrival;
+    };
+    
+    PacketTimingStats();
+    ~PacketTimingStats();
+    
+    /// Records the arrival of a packet, call from the thread that reads the socket.
+    void recordArrival(PacketType type, quint64 now);
+    
+    /// Records the transit time of a packet that carries the sender's timestamp.
+    /// \param clockSkewUsec how far the sender's clock is ahead of ours
+    void recordTransit(PacketType type, quint64 sentUsecs, int clockSkewUsec, quint64 now);
+    
+    /// Records the time taken to get a packet from the socket to its handler.
+    void recordProcessed(PacketType type, quint64 receivedUsecs, quint64 now);
+    
+    /// Returns the time the last packet of the given type arrived, or zero if none have.
+    quint64 getLastArrival(PacketType type) const;
+    
+    /// Adds the percentiles of each type's histograms to the stats object, under the base name and the type number.
+    void addStats(QJsonObject& statsObject, const QString& baseName) const;
+    
+    /// Adds the samples of each type's histograms to the matching histograms in another set of stats.
+    void addTo(PacketTimingStats& totalStats) const;
+    
+    void reset();
+    
+private:
+    // disallow copying, the type stats are owned
+    PacketTimingStats(const PacketTimingStats& other);
+    PacketTimingStats& operator=(const PacketTimingStats& other);
+    
+    TypeStats* typeStats(PacketType type);
+    
+    QAtomicPointer<TypeStats> _typeStats[MAX_TIMED_PACKET_TYPES];
+};
+
+#endif // hifi_PacketTimingStats_h
@@ -44,6 +44,12 @@ bool ReceivedPacketProcessor::process() {
         _packets.erase(_packets.begin()); // remove the oldest packet
         unlock(); // let others add to the packets
         processPacket(temporary.getDestinationNode(), temporary.getByteArray()); // process our temporary copy
+        
+        // the packet was stamped when it was queued, so this includes the time spent waiting for us
+        if (temporary.getDestinationNode()) {
+            temporary.getDestinationNode()->getPacketTimingStats().recordProcessed(
+                packetTypeForPacket(temporary.getByteArray()), temporary.getTimestamp(), usecTimestampNow());
+        }
     }
     return isStillRunning();  // keep running till they terminate us
 }
@@ -68,6 +68,12 @@ void ThreadedAssignment::addPacketStatsAndSendStatsPacket(QJsonObject &statsObje
     statsObject["packets_per_second"] = packetsPerSecond;
     statsObject["bytes_per_second"] = bytesPerSecond;
     
+    nodeList->getBandwidthShaper().addStats(statsObject);
+    nodeList->getBandwidthShaper().resetStats();
+    
+    nodeList->addPacketTimingStats(statsObject);
+    nodeList->resetPacketTimingStats();
+    
     nodeList->sendStatsToDomainServer(statsObject);
 }
 
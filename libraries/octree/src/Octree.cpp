@@ -13,6 +13,7 @@
 #define _USE_MATH_DEFINES
 #endif
 
+#include <cfloat>
 #include <cstring>
 #include <cstdio>
 #include <cmath>
@@ -642,6 +643,213 @@ bool Octree::findRayIntersection(const glm::vec3& origin, const glm::vec3& direc
     return args.found;
 }
 
+// a packet of rays cast together, laid out one array per axis so that each box test runs across the packet at once
+class RayPacketArgs {
+public:
+    int numRays;
+    float origins[3][MAX_RAY_PACKET_SIZE];
+    float directions[3][MAX_RAY_PACKET_SIZE];
+    float inverseDirections[3][MAX_RAY_PACKET_SIZE];
+    OctreeElement** elements;
+    float* distances;
+    BoxFace* faces;
+    bool* hits;
+};
+
+const BoxFace MIN_FACES[] = { MIN_X_FACE, MIN_Y_FACE, MIN_Z_FACE };
+const BoxFace MAX_FACES[] = { MAX_X_FACE, MAX_Y_FACE, MAX_Z_FACE };
+
+// slab tests the active rays in the packet against the box, filling in where each enters it (zero for those that start
+// inside), and returns the mask of the rays that pass through it at all
+static int intersectRayPacket(const AABox& box, const RayPacketArgs& args, int activeMask, float* entries,
+        BoxFace* entryFaces) {
+    const glm::vec3& corner = box.getCorner();
+    float scale = box.getScale();
+    
+    // narrow the span of each ray inside the box, one axis at a time
+    float exits[MAX_RAY_PACKET_SIZE];
+    for (int i = 0; i < args.numRays; i++) {
+        entries[i] = -FLT_MAX;
+        exits[i] = FLT_MAX;
+        entryFaces[i] = UNKNOWN_FACE;
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        float minimum = corner[axis];
+        float maximum = corner[axis] + scale;
+        for (int i = 0; i < args.numRays; i++) {
+            float origin = args.origins[axis][i];
+            float direction = args.directions[axis][i];
+            if (direction > EPSILON || direction < -EPSILON) {
+                float inverseDirection = args.inverseDirections[axis][i];
+                bool positive = direction > 0.0f;
+                float entry = ((positive ? minimum : maximum) - origin) * inverseDirection;
+                float exit = ((positive ? maximum : minimum) - origin) * inverseDirection;
+                if (entry > entries[i]) {
+                    entries[i] = entry;
+                    entryFaces[i] = positive ? MIN_FACES[axis] : MAX_FACES[axis];
+                }
+                exits[i] = qMin(exits[i], exit);
+                
+            } else if (origin < minimum || origin > maximum) {
+                exits[i] = -FLT_MAX; // parallel to this slab and outside it
+            }
+        }
+    }
+    
+    int hitMask = 0;
+    for (int i = 0; i < args.numRays; i++) {
+        int bit = 1 << i;
+        if (!(activeMask & bit) || entries[i] > exits[i] || exits[i] < 0.0f) {
+            continue;
+        }
+        if (entries[i] < 0.0f) {
+            // the ray starts inside the box
+            entries[i] = 0.0f;
+            entryFaces[i] = UNKNOWN_FACE;
+        }
+        hitMask |= bit;
+    }
+    return hitMask;
+}
+
+// recurses with the rays in the packet that pass through the element and whose nearest hit could still be inside it,
+// visiting the children front to back so that hits in the nearer ones rule out the ones behind
+static void findRayPacketIntersections(OctreeElement* element, RayPacketArgs& args, int activeMask, const float* entries,
+        const BoxFace* entryFaces, int recursionCount = 0) {
+    if (recursionCount > DANGEROUSLY_DEEP_RECURSION) {
+        qDebug() << "findRayPacketIntersections() reached DANGEROUSLY_DEEP_RECURSION, bailing!";
+        return;
+    }
+    
+    // nothing in here can be nearer than a hit we already have
+    int hitMask = 0;
+    for (int i = 0; i < args.numRays; i++) {
+        int bit = 1 << i;
+        if ((activeMask & bit) && !(args.hits[i] && entries[i] * TREE_SCALE >= args.distances[i])) {
+            hitMask |= bit;
+        }
+    }
+    if (hitMask == 0) {
+        return;
+    }
+    if (!element->isLeaf()) {
+        // order the children the packet passes through by the nearest entry of any of its rays
+        OctreeElement* children[NUMBER_OF_CHILDREN];
+        int childMasks[NUMBER_OF_CHILDREN];
+        float childEntries[NUMBER_OF_CHILDREN][MAX_RAY_PACKET_SIZE];
+        BoxFace childEntryFaces[NUMBER_OF_CHILDREN][MAX_RAY_PACKET_SIZE];
+        float nearestEntries[NUMBER_OF_CHILDREN];
+        int order[NUMBER_OF_CHILDREN];
+        int numChildren = 0;
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            OctreeElement* child = element->getChildAtIndex(i);
+            if (!child) {
+                continue;
+            }
+            int childMask = intersectRayPacket(child->getAABox(), args, hitMask, childEntries[numChildren],
+                childEntryFaces[numChildren]);
+            if (childMask == 0) {
+                continue;
+            }
+            float nearestEntry = FLT_MAX;
+            for (int j = 0; j < args.numRays; j++) {
+                if (childMask & (1 << j)) {
+                    nearestEntry = qMin(nearestEntry, childEntries[numChildren][j]);
+                }
+            }
+            int position = numChildren;
+            while (position > 0 && nearestEntries[order[position - 1]] > nearestEntry) {
+                order[position] = order[position - 1];
+                position--;
+            }
+            order[position] = numChildren;
+            children[numChildren] = child;
+            childMasks[numChildren] = childMask;
+            nearestEntries[numChildren] = nearestEntry;
+            numChildren++;
+        }
+        for (int i = 0; i < numChildren; i++) {
+            int index = order[i];
+            findRayPacketIntersections(children[index], args, childMasks[index], childEntries[index],
+                childEntryFaces[index], recursionCount + 1);
+        }
+        return;
+    }
+    if (!element->hasContent()) {
+        return;
+    }
+    for (int i = 0; i < args.numRays; i++) {
+        if (hitMask & (1 << i)) {
+            args.elements[i] = element;
+            args.distances[i] = entries[i] * TREE_SCALE;
+            args.faces[i] = entryFaces[i];
+            args.hits[i] = true;
+        }
+    }
+}
+
+int Octree::findRayIntersections(const glm::vec3* origins, const glm::vec3* directions, int numRays,
+                                    OctreeElement** elements, float* distances, BoxFace* faces, bool* hits,
+                                    Octree::lockType lockType, bool* accurateResult) {
+    for (int i = 0; i < numRays; i++) {
+        hits[i] = false;
+    }
+    bool gotLock = false;
+    if (lockType == Octree::Lock) {
+        lockForRead();
+        gotLock = true;
+    } else if (lockType == Octree::TryLock) {
+        gotLock = tryLockForRead();
+        if (!gotLock) {
+            if (accurateResult) {
+                *accurateResult = false; // if user asked to accuracy or result, let them know this is inaccurate
+            }
+            return 0; // if we wanted to tryLock, and we couldn't then just bail...
+        }
+    }
+    
+    int numHits = 0;
+    for (int first = 0; first < numRays; first += MAX_RAY_PACKET_SIZE) {
+        RayPacketArgs args;
+        args.numRays = qMin(numRays - first, MAX_RAY_PACKET_SIZE);
+        for (int i = 0; i < args.numRays; i++) {
+            glm::vec3 origin = origins[first + i] / (float)TREE_SCALE;
+            const glm::vec3& direction = directions[first + i];
+            for (int axis = 0; axis < 3; axis++) {
+                args.origins[axis][i] = origin[axis];
+                args.directions[axis][i] = direction[axis];
+                args.inverseDirections[axis][i] = (direction[axis] == 0.0f) ? 0.0f : 1.0f / direction[axis];
+            }
+        }
+        args.elements = elements + first;
+        args.distances = distances + first;
+        args.faces = faces + first;
+        args.hits = hits + first;
+        
+        float entries[MAX_RAY_PACKET_SIZE];
+        BoxFace entryFaces[MAX_RAY_PACKET_SIZE];
+        int hitMask = intersectRayPacket(_rootElement->getAABox(), args, (1 << args.numRays) - 1, entries, entryFaces);
+        if (hitMask != 0) {
+            findRayPacketIntersections(_rootElement, args, hitMask, entries, entryFaces);
+        }
+        
+        for (int i = 0; i < args.numRays; i++) {
+            if (args.hits[i]) {
+                numHits++;
+            }
+        }
+    }
+    
+    if (gotLock) {
+        unlock();
+    }
+    
+    if (accurateResult) {
+        *accurateResult = true; // if user asked to accuracy or result, let them know this is accurate
+    }
+    return numHits;
+}
+
 class SphereArgs {
 public:
     glm::vec3 center;
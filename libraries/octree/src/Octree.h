@@ -61,6 +61,8 @@ const int NO_BOUNDARY_ADJUST     = 0;
 const int LOW_RES_MOVING_ADJUST  = 1;
 const quint64 IGNORE_LAST_SENT  = 0;
 
+const int MAX_RAY_PACKET_SIZE    = 8; // rays that findRayIntersections walks the tree with together
+
 #define IGNORE_SCENE_STATS       NULL
 #define IGNORE_VIEW_FRUSTUM      NULL
 #define IGNORE_COVERAGE_MAP      NULL
@@ -260,6 +262,14 @@ public:
                              OctreeElement*& node, float& distance, BoxFace& face, 
                              Octree::lockType lockType = Octree::TryLock, bool* accurateResult = NULL);
 
+    /// Casts a number of rays at once, in packets of up to MAX_RAY_PACKET_SIZE that walk the tree together, so that each
+    /// element is visited once per packet rather than once per ray. The outputs are arrays with one entry per ray, and
+    /// only hold a result where the ray hit something.
+    /// \return the number of rays that hit something
+    int findRayIntersections(const glm::vec3* origins, const glm::vec3* directions, int numRays,
+                             OctreeElement** elements, float* distances, BoxFace* faces, bool* hits,
+                             Octree::lockType lockType = Octree::TryLock, bool* accurateResult = NULL);
+
     bool findSpherePenetration(const glm::vec3& center, float radius, glm::vec3& penetration, void** penetratedObject = NULL, 
                                     Octree::lockType lockType = Octree::TryLock, bool* accurateResult = NULL);
 
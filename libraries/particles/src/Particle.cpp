@@ -9,7 +9,9 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <QtCore/QCache>
 #include <QtCore/QObject>
+#include <QtCore/QThreadStorage>
 
 #include <Octree.h>
 #include <RegisteredMetaTypes.h>
@@ -817,7 +819,7 @@ void Particle::applyHardCollision(const CollisionInfo& collisionInfo) {
     setVelocity(velocity);
 }
 
-void Particle::update(const quint64& now) {
+void Particle::update(const quint64& now, bool runScripts) {
     float timeElapsed = (float)(now - _lastUpdated) / (float)(USECS_PER_SECOND);
     _lastUpdated = now;
 
@@ -826,7 +828,9 @@ void Particle::update(const quint64& now) {
     bool shouldDie = (getAge() > getLifetime()) || getShouldDie();
     setShouldDie(shouldDie);
 
-    executeUpdateScripts(); // allow the javascript to alter our state
+    if (runScripts) {
+        executeUpdateScripts(); // allow the javascript to alter our state
+    }
 
     // If the ball is in hand, it doesn't move or have gravity effect it
     if (!isInHand) {
@@ -848,20 +852,73 @@ void Particle::update(const quint64& now) {
     }
 }
 
-void Particle::startParticleScriptContext(ScriptEngine& engine, ParticleScriptObject& particleScriptable) {
+/// The number of script contexts each thread keeps around before it starts evicting the least recently used.
+const int MAX_CACHED_PARTICLE_SCRIPTS = 64;
+
+/// A script engine that has evaluated a particle script, along with the scriptable object that the script's handlers
+/// are connected to.  Contexts are cached by script source and shared by every particle with that script, so only the
+/// particle the scriptable object is bound to changes from one invocation to the next.
+class ParticleScriptContext {
+public:
+
+    ParticleScriptContext(const QString& script) : _engine(script), _evaluated(false), _hasHandlers(false) { }
+
+    ScriptEngine& getEngine() { return _engine; }
+    ParticleScriptObject& getScriptable() { return _scriptable; }
+
+    /// Registers the scriptable object and evaluates the script the first time through.  Scripts that didn't connect any
+    /// handlers do all their work at the top level, so those are evaluated again each time.
+    void evaluate();
+
+private:
+
+    ScriptEngine _engine;
+    ParticleScriptObject _scriptable;
+    bool _evaluated;
+    bool _hasHandlers;
+};
+
+void ParticleScriptContext::evaluate() {
+    if (_hasHandlers) {
+        return;
+    }
+    if (!_evaluated) {
+        // Add the "this" Particle object
+        _engine.registerGlobalObject("Particle", &_scriptable);
+        _evaluated = true;
+    }
+    _engine.evaluate();
+    _hasHandlers = _scriptable.hasHandlers();
+}
+
+// script engines aren't thread-safe, so each thread that runs particle scripts has a cache of its own
+static QThreadStorage<QCache<QString, ParticleScriptContext>*> scriptContextCaches;
+
+ParticleScriptContext* Particle::startParticleScriptContext() {
+    if (!scriptContextCaches.hasLocalData()) {
+        scriptContextCaches.setLocalData(new QCache<QString, ParticleScriptContext>(MAX_CACHED_PARTICLE_SCRIPTS));
+    }
+    QCache<QString, ParticleScriptContext>* cache = scriptContextCaches.localData();
+    ParticleScriptContext* context = cache->object(_script);
+    if (!context) {
+        context = new ParticleScriptContext(_script);
+        cache->insert(_script, context);
+    }
     if (_voxelEditSender) {
-        engine.getVoxelsScriptingInterface()->setPacketSender(_voxelEditSender);
+        context->getEngine().getVoxelsScriptingInterface()->setPacketSender(_voxelEditSender);
     }
     if (_particleEditSender) {
-        engine.getParticlesScriptingInterface()->setPacketSender(_particleEditSender);
+        context->getEngine().getParticlesScriptingInterface()->setPacketSender(_particleEditSender);
     }
-
-    // Add the "this" Particle object
-    engine.registerGlobalObject("Particle", &particleScriptable);
-    engine.evaluate();
+    context->getScriptable().setParticle(this);
+    context->evaluate();
+    return context;
 }
 
-void Particle::endParticleScriptContext(ScriptEngine& engine, ParticleScriptObject& particleScriptable) {
+void Particle::endParticleScriptContext(ParticleScriptContext* context) {
+    // we may not be around the next time the script hears from its engine
+    context->getScriptable().setParticle(NULL);
+
     if (_voxelEditSender) {
         _voxelEditSender->releaseQueuedMessages();
     }
@@ -873,34 +930,28 @@ void Particle::endParticleScriptContext(ScriptEngine& engine, ParticleScriptObje
 void Particle::executeUpdateScripts() {
     // Only run this particle script if there's a script attached directly to the particle.
     if (!_script.isEmpty()) {
-        ScriptEngine engine(_script);
-        ParticleScriptObject particleScriptable(this);
-        startParticleScriptContext(engine, particleScriptable);
-        particleScriptable.emitUpdate();
-        endParticleScriptContext(engine, particleScriptable);
+        ParticleScriptContext* context = startParticleScriptContext();
+        context->getScriptable().emitUpdate();
+        endParticleScriptContext(context);
     }
 }
 
 void Particle::collisionWithParticle(Particle* other, const glm::vec3& penetration) {
     // Only run this particle script if there's a script attached directly to the particle.
     if (!_script.isEmpty()) {
-        ScriptEngine engine(_script);
-        ParticleScriptObject particleScriptable(this);
-        startParticleScriptContext(engine, particleScriptable);
+        ParticleScriptContext* context = startParticleScriptContext();
         ParticleScriptObject otherParticleScriptable(other);
-        particleScriptable.emitCollisionWithParticle(&otherParticleScriptable, penetration);
-        endParticleScriptContext(engine, particleScriptable);
+        context->getScriptable().emitCollisionWithParticle(&otherParticleScriptable, penetration);
+        endParticleScriptContext(context);
     }
 }
 
 void Particle::collisionWithVoxel(VoxelDetail* voxelDetails, const glm::vec3& penetration) {
     // Only run this particle script if there's a script attached directly to the particle.
     if (!_script.isEmpty()) {
-        ScriptEngine engine(_script);
-        ParticleScriptObject particleScriptable(this);
-        startParticleScriptContext(engine, particleScriptable);
-        particleScriptable.emitCollisionWithVoxel(*voxelDetails, penetration);
-        endParticleScriptContext(engine, particleScriptable);
+        ParticleScriptContext* context = startParticleScriptContext();
+        context->getScriptable().emitCollisionWithVoxel(*voxelDetails, penetration);
+        endParticleScriptContext(context);
     }
 }
 
@@ -1403,4 +1454,8 @@ void ParticleIDfromScriptValue(const QScriptValue &object, ParticleID& id) {
     id.isKnownID = object.property("isKnownID").toVariant().toBool();
 }
 
-
+bool ParticleScriptObject::hasHandlers() const {
+    return receivers(SIGNAL(update())) > 0 ||
+        receivers(SIGNAL(collisionWithVoxel(const VoxelDetail&, const glm::vec3&))) > 0 ||
+        receivers(SIGNAL(collisionWithParticle(QObject*, const glm::vec3&))) > 0;
+}
@@ -26,6 +26,7 @@ class Particle;
 class ParticleEditPacketSender;
 class ParticleProperties;
 class ParticlesScriptingInterface;
+class ParticleScriptContext;
 class ParticleScriptObject;
 class ParticleTree;
 class ScriptEngine;
@@ -296,7 +297,9 @@ public:
     
     void applyHardCollision(const CollisionInfo& collisionInfo);
 
-    void update(const quint64& now);
+    /// Moves the particle along, first running its update script unless told not to (as when the script budget for the
+    /// tree update has been spent).
+    void update(const quint64& now, bool runScripts = true);
     void collisionWithParticle(Particle* other, const glm::vec3& penetration);
     void collisionWithVoxel(VoxelDetail* voxel, const glm::vec3& penetration);
 
@@ -324,8 +327,9 @@ protected:
     static VoxelEditPacketSender* _voxelEditSender;
     static ParticleEditPacketSender* _particleEditSender;
 
-    void startParticleScriptContext(ScriptEngine& engine, ParticleScriptObject& particleScriptable);
-    void endParticleScriptContext(ScriptEngine& engine, ParticleScriptObject& particleScriptable);
+    /// Returns the cached context for our script (creating and evaluating it if need be) with its scriptable bound to us.
+    ParticleScriptContext* startParticleScriptContext();
+    void endParticleScriptContext(ParticleScriptContext* context);
     void executeUpdateScripts();
 
     void setAge(float age);
@@ -369,9 +373,17 @@ protected:
 class ParticleScriptObject  : public QObject {
     Q_OBJECT
 public:
-    ParticleScriptObject(Particle* particle) { _particle = particle; }
+    ParticleScriptObject(Particle* particle = NULL) :
+        _unboundParticle(ParticleID(UNKNOWN_PARTICLE_ID), ParticleProperties()) { setParticle(particle); }
     //~ParticleScriptObject() { qDebug() << "~ParticleScriptObject() this=" << this; }
 
+    /// Binds the object to a particle, or, if NULL, to a placeholder that soaks up anything the script does between
+    /// invocations (from a timer, say).
+    void setParticle(Particle* particle) { _particle = particle ? particle : &_unboundParticle; }
+
+    /// Checks whether the script has connected anything to our signals.
+    bool hasHandlers() const;
+
     void emitUpdate() { emit update(); }
     void emitCollisionWithParticle(QObject* other, const glm::vec3& penetration) 
                 { emit collisionWithParticle(other, penetration); }
@@ -426,6 +438,7 @@ signals:
 
 private:
     Particle* _particle;
+    Particle _unboundParticle;
 };
 
 
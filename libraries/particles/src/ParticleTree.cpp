@@ -11,10 +11,22 @@
 
 #include "ParticleTree.h"
 
-ParticleTree::ParticleTree(bool shouldReaverage) : Octree(shouldReaverage) {
+const int DEFAULT_MAX_SCRIPT_INVOCATIONS_PER_UPDATE = 200;
+
+ParticleTree::ParticleTree(bool shouldReaverage) :
+    Octree(shouldReaverage),
+    _maxScriptInvocationsPerUpdate(DEFAULT_MAX_SCRIPT_INVOCATIONS_PER_UPDATE),
+    _scriptedParticleCount(0),
+    _firstScriptedParticle(0) {
     _rootElement = createNewElement();
 }
 
+ParticleTree::~ParticleTree() {
+    // delete the elements while the map they unregister from is still around
+    delete _rootElement;
+    _rootElement = NULL;
+}
+
 ParticleTreeElement* ParticleTree::createNewElement(unsigned char * octalCode) {
     ParticleTreeElement* newElement = new ParticleTreeElement(octalCode);
     newElement->setTree(this);
@@ -32,73 +44,14 @@ bool ParticleTree::handlesEditPacketType(PacketType packetType) const {
     }
 }
 
-class FindAndDeleteParticlesArgs {
-public:
-    QList<uint32_t> _idsToDelete;
-};
-
-bool ParticleTree::findAndDeleteOperation(OctreeElement* element, void* extraData) {
-    //qDebug() << "findAndDeleteOperation()";
-
-    FindAndDeleteParticlesArgs* args = static_cast< FindAndDeleteParticlesArgs*>(extraData);
-
-    // if we've found and deleted all our target particles, then we can stop looking
-    if (args->_idsToDelete.size() <= 0) {
-        return false;
-    }
-
-    ParticleTreeElement* particleTreeElement = static_cast<ParticleTreeElement*>(element);
-
-    //qDebug() << "findAndDeleteOperation() args->_idsToDelete.size():" << args->_idsToDelete.size();
-
-    for (QList<uint32_t>::iterator it = args->_idsToDelete.begin(); it != args->_idsToDelete.end(); it++) {
-        uint32_t particleID = *it;
-        //qDebug() << "findAndDeleteOperation() particleID:" << particleID;
-
-        if (particleTreeElement->removeParticleWithID(particleID)) {
-            // if the particle was in this element, then remove it from our search list.
-            //qDebug() << "findAndDeleteOperation() it = args->_idsToDelete.erase(it)";
-            it = args->_idsToDelete.erase(it);
-        }
-
-        if (it == args->_idsToDelete.end()) {
-            //qDebug() << "findAndDeleteOperation() breaking";
-            break;
-        }
-    }
-
-    // if we've found and deleted all our target particles, then we can stop looking
-    if (args->_idsToDelete.size() <= 0) {
-        return false;
-    }
-    return true;
-}
-
-
-class FindAndUpdateParticleArgs {
-public:
-    const Particle& searchParticle;
-    bool found;
-};
-
-bool ParticleTree::findAndUpdateOperation(OctreeElement* element, void* extraData) {
-    FindAndUpdateParticleArgs* args = static_cast<FindAndUpdateParticleArgs*>(extraData);
-    ParticleTreeElement* particleTreeElement = static_cast<ParticleTreeElement*>(element);
-    // Note: updateParticle() will only operate on correctly found particles
-    if (particleTreeElement->updateParticle(args->searchParticle)) {
-        args->found = true;
-        return false; // stop searching
-    }
-    return true;
-}
-
 void ParticleTree::storeParticle(const Particle& particle, const SharedNodePointer& senderNode) {
     // First, look for the existing particle in the tree..
-    FindAndUpdateParticleArgs args = { particle, false };
-    recurseTreeWithOperation(findAndUpdateOperation, &args);
+    // Note: updateParticle() will only operate on correctly found particles
+    ParticleTreeElement* containingElement = getContainingElement(particle.getID());
+    bool found = containingElement && containingElement->updateParticle(particle);
 
     // if we didn't find it in the tree, then store it...
-    if (!args.found) {
+    if (!found) {
         glm::vec3 position = particle.getPosition();
         float size = std::max(MINIMUM_PARTICLE_ELEMENT_SIZE, particle.getRadius());
 
@@ -134,11 +87,19 @@ bool ParticleTree::findAndUpdateWithIDandPropertiesOperation(OctreeElement* elem
 }
 
 void ParticleTree::updateParticle(const ParticleID& particleID, const ParticleProperties& properties) {
-    // First, look for the existing particle in the tree..
-    FindAndUpdateParticleWithIDandPropertiesArgs args = { particleID, properties, false };
-    recurseTreeWithOperation(findAndUpdateWithIDandPropertiesOperation, &args);
+    // First, look for the existing particle in the tree; only known IDs are in our map, so particles still waiting for
+    // theirs must be searched for by creator token
+    bool found = false;
+    if (particleID.isKnownID) {
+        ParticleTreeElement* containingElement = getContainingElement(particleID.id);
+        found = containingElement && containingElement->updateParticle(particleID, properties);
+    } else {
+        FindAndUpdateParticleWithIDandPropertiesArgs args = { particleID, properties, false };
+        recurseTreeWithOperation(findAndUpdateWithIDandPropertiesOperation, &args);
+        found = args.found;
+    }
     // if we found it in the tree, then mark the tree as dirty
-    if (args.found) {
+    if (found) {
         _isDirty = true;
     }
 }
@@ -160,9 +121,28 @@ void ParticleTree::addParticle(const ParticleID& particleID, const ParticlePrope
 
 void ParticleTree::deleteParticle(const ParticleID& particleID) {
     if (particleID.isKnownID) {
-        FindAndDeleteParticlesArgs args;
-        args._idsToDelete.push_back(particleID.id);
-        recurseTreeWithOperation(findAndDeleteOperation, &args);
+        deleteParticleWithID(particleID.id);
+    }
+}
+
+void ParticleTree::deleteParticleWithID(uint32_t particleID) {
+    ParticleTreeElement* containingElement = getContainingElement(particleID);
+    if (containingElement) {
+        containingElement->removeParticleWithID(particleID);
+    }
+}
+
+void ParticleTree::setContainingElement(uint32_t particleID, ParticleTreeElement* element) {
+    // particles without IDs of their own all share the unknown one, so we can't keep track of them
+    if (particleID != UNKNOWN_PARTICLE_ID) {
+        _particleToElementMap.insert(particleID, element);
+    }
+}
+
+void ParticleTree::clearContainingElement(uint32_t particleID, ParticleTreeElement* element) {
+    QHash<uint32_t, ParticleTreeElement*>::iterator it = _particleToElementMap.find(particleID);
+    if (it != _particleToElementMap.end() && it.value() == element) {
+        _particleToElementMap.erase(it);
     }
 }
 
@@ -340,49 +320,20 @@ void ParticleTree::findParticlesForUpdate(const AABox& box, QVector<Particle*> f
     foundParticles.swap(args._foundParticles);
 }
 
-class FindByIDArgs {
-public:
-    uint32_t id;
-    bool found;
-    const Particle* foundParticle;
-};
-
-
-bool ParticleTree::findByIDOperation(OctreeElement* element, void* extraData) {
-//qDebug() << "ParticleTree::findByIDOperation()....";
-
-    FindByIDArgs* args = static_cast<FindByIDArgs*>(extraData);
-    ParticleTreeElement* particleTreeElement = static_cast<ParticleTreeElement*>(element);
-
-    // if already found, stop looking
-    if (args->found) {
-        return false;
-    }
-
-    // as the tree element if it has this particle
-    const Particle* foundParticle = particleTreeElement->getParticleWithID(args->id);
-    if (foundParticle) {
-        args->foundParticle = foundParticle;
-        args->found = true;
-        return false;
-    }
-
-    // keep looking
-    return true;
-}
-
-
 const Particle* ParticleTree::findParticleByID(uint32_t id, bool alreadyLocked) {
-    FindByIDArgs args = { id, false, NULL };
+    const Particle* foundParticle = NULL;
 
     if (!alreadyLocked) {
         lockForRead();
     }
-    recurseTreeWithOperation(findByIDOperation, &args);
+    ParticleTreeElement* containingElement = getContainingElement(id);
+    if (containingElement) {
+        foundParticle = containingElement->getParticleWithID(id);
+    }
     if (!alreadyLocked) {
         unlock();
     }
-    return args.foundParticle;
+    return foundParticle;
 }
 
 
@@ -465,8 +416,23 @@ void ParticleTree::update() {
     _isDirty = true;
 
     ParticleTreeUpdateArgs args = { };
+    args._maxScriptInvocations = _maxScriptInvocationsPerUpdate;
+    args._lastScriptedParticleCount = _scriptedParticleCount;
+    args._firstScriptedParticle = _firstScriptedParticle;
+    args._nextFirstScriptedParticle = -1;
+    args._firstSkippedScriptedParticle = -1;
     recurseTreeWithOperation(updateOperation, &args);
 
+    // the particles that missed out on running their scripts go first next time
+    _scriptedParticleCount = args._scriptedParticles;
+    if (args._nextFirstScriptedParticle != -1) {
+        _firstScriptedParticle = args._nextFirstScriptedParticle;
+    } else if (args._firstSkippedScriptedParticle != -1) {
+        _firstScriptedParticle = args._firstSkippedScriptedParticle;
+    } else {
+        _firstScriptedParticle = 0;
+    }
+
     // now add back any of the particles that moved elements....
     int movingParticles = args._movingParticles.size();
     for (int i = 0; i < movingParticles; i++) {
@@ -615,8 +581,6 @@ void ParticleTree::processEraseMessage(const QByteArray& dataByteArray, const Sh
     processedBytes += sizeof(numberOfIds);
 
     if (numberOfIds > 0) {
-        FindAndDeleteParticlesArgs args;
-
         for (size_t i = 0; i < numberOfIds; i++) {
             if (processedBytes + sizeof(uint32_t) > packetLength) {
                 break; // bail to prevent buffer overflow
@@ -627,10 +591,7 @@ void ParticleTree::processEraseMessage(const QByteArray& dataByteArray, const Sh
             dataAt += sizeof(particleID);
             processedBytes += sizeof(particleID);
 
-            args._idsToDelete.push_back(particleID);
+            deleteParticleWithID(particleID);
         }
-
-        // calling recurse to actually delete the particles
-        recurseTreeWithOperation(findAndDeleteOperation, &args);
     }
 }
@@ -24,6 +24,7 @@ class ParticleTree : public Octree {
     Q_OBJECT
 public:
     ParticleTree(bool shouldReaverage = false);
+    virtual ~ParticleTree();
 
     /// Implements our type specific root element factory
     virtual ParticleTreeElement* createNewElement(unsigned char * octalCode = NULL);
@@ -42,6 +43,12 @@ public:
 
     virtual void update();
 
+    /// Sets the most particle update scripts that may run in a single update, or -1 for no limit.  Particles whose scripts
+    /// miss out still move; they get their turns in the updates that follow.
+    void setMaxScriptInvocationsPerUpdate(int maxScriptInvocations)
+        { _maxScriptInvocationsPerUpdate = maxScriptInvocations; }
+    int getMaxScriptInvocationsPerUpdate() const { return _maxScriptInvocationsPerUpdate; }
+
     void storeParticle(const Particle& particle, const SharedNodePointer& senderNode = SharedNodePointer());
     void updateParticle(const ParticleID& particleID, const ParticleProperties& properties);
     void addParticle(const ParticleID& particleID, const ParticleProperties& properties);
@@ -73,27 +80,43 @@ public:
     void processEraseMessage(const QByteArray& dataByteArray, const SharedNodePointer& sourceNode);
     void handleAddParticleResponse(const QByteArray& packet);
 
+    /// Returns the element containing the particle with the given ID, or NULL if there is no such particle.
+    ParticleTreeElement* getContainingElement(uint32_t particleID) const { return _particleToElementMap.value(particleID); }
+
+    /// Records the element containing a particle; elements call this whenever they take a particle in.
+    void setContainingElement(uint32_t particleID, ParticleTreeElement* element);
+
+    /// Forgets the element containing a particle, provided that it's still the given one; elements call this whenever
+    /// they let a particle go.
+    void clearContainingElement(uint32_t particleID, ParticleTreeElement* element);
+
 private:
 
     static bool updateOperation(OctreeElement* element, void* extraData);
-    static bool findAndUpdateOperation(OctreeElement* element, void* extraData);
     static bool findAndUpdateWithIDandPropertiesOperation(OctreeElement* element, void* extraData);
     static bool findNearPointOperation(OctreeElement* element, void* extraData);
     static bool findInSphereOperation(OctreeElement* element, void* extraData);
     static bool pruneOperation(OctreeElement* element, void* extraData);
-    static bool findByIDOperation(OctreeElement* element, void* extraData);
-    static bool findAndDeleteOperation(OctreeElement* element, void* extraData);
     static bool findAndUpdateParticleIDOperation(OctreeElement* element, void* extraData);
     static bool findInBoxForUpdateOperation(OctreeElement* element, void* extraData);
 
     void notifyNewlyCreatedParticle(const Particle& newParticle, const SharedNodePointer& senderNode);
 
+    void deleteParticleWithID(uint32_t particleID);
+
     QReadWriteLock _newlyCreatedHooksLock;
     std::vector<NewlyCreatedParticleHook*> _newlyCreatedHooks;
 
 
     QReadWriteLock _recentlyDeletedParticlesLock;
     QMultiMap<quint64, uint32_t> _recentlyDeletedParticleIDs;
+
+    // lets us find particles by ID without searching the whole tree; guarded by the tree lock like the elements
+    QHash<uint32_t, ParticleTreeElement*> _particleToElementMap;
+
+    int _maxScriptInvocationsPerUpdate;
+    int _scriptedParticleCount;
+    int _firstScriptedParticle;
 };
 
 #endif // hifi_ParticleTree_h
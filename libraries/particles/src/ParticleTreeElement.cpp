@@ -14,12 +14,17 @@
 #include "ParticleTree.h"
 #include "ParticleTreeElement.h"
 
-ParticleTreeElement::ParticleTreeElement(unsigned char* octalCode) : OctreeElement(), _particles(NULL) {
+ParticleTreeElement::ParticleTreeElement(unsigned char* octalCode) : OctreeElement(), _myTree(NULL), _particles(NULL) {
     init(octalCode);
 };
 
 ParticleTreeElement::~ParticleTreeElement() {
     _voxelMemoryUsage -= sizeof(ParticleTreeElement);
+    if (_myTree) {
+        foreach (const Particle& particle, *_particles) {
+            _myTree->clearContainingElement(particle.getID(), this);
+        }
+    }
     delete _particles;
     _particles = NULL;
 }
@@ -66,6 +71,29 @@ bool ParticleTreeElement::appendElementData(OctreePacketData* packetData) const
     return success;
 }
 
+bool ParticleTreeUpdateArgs::shouldRunScript() {
+    int index = _scriptedParticles++;
+    if (_maxScriptInvocations < 0) {
+        return true;
+    }
+    // the ones before the first can only have what the ones after (going by the last update's count) won't need
+    int limit = _maxScriptInvocations;
+    if (index < _firstScriptedParticle) {
+        limit -= qMax(_lastScriptedParticleCount - _firstScriptedParticle, 0);
+    }
+    if (_scriptInvocations < limit) {
+        _scriptInvocations++;
+        return true;
+    }
+    if (_firstSkippedScriptedParticle == -1) {
+        _firstSkippedScriptedParticle = index;
+    }
+    if (_nextFirstScriptedParticle == -1 && index >= _firstScriptedParticle) {
+        _nextFirstScriptedParticle = index;
+    }
+    return false;
+}
+
 void ParticleTreeElement::update(ParticleTreeUpdateArgs& args) {
     markWithChangedTime();
     // TODO: early exit when _particles is empty
@@ -74,7 +102,7 @@ void ParticleTreeElement::update(ParticleTreeUpdateArgs& args) {
     QList<Particle>::iterator particleItr = _particles->begin();
     while(particleItr != _particles->end()) {
         Particle& particle = (*particleItr);
-        particle.update(_lastChanged);
+        particle.update(_lastChanged, particle.getScript().isEmpty() || args.shouldRunScript());
 
         // If the particle wants to die, or if it's left our bounding box, then move it
         // into the arguments moving particles. These will be added back or deleted completely
@@ -82,6 +110,7 @@ void ParticleTreeElement::update(ParticleTreeUpdateArgs& args) {
             args._movingParticles.push_back(particle);
 
             // erase this particle
+            _myTree->clearContainingElement(particle.getID(), this);
             particleItr = _particles->erase(particleItr);
         } else {
             ++particleItr;
@@ -202,6 +231,7 @@ void ParticleTreeElement::updateParticleID(FindAndUpdateParticleIDArgs* args) {
             // first, we're looking for matching creatorTokenIDs, if we find that, then we fix it to know the actual ID
             if (thisParticle.getCreatorTokenID() == args->creatorTokenID) {
                 thisParticle.setID(args->particleID);
+                _myTree->setContainingElement(args->particleID, this);
                 args->creatorTokenFound = true;
             }
         }
@@ -209,6 +239,10 @@ void ParticleTreeElement::updateParticleID(FindAndUpdateParticleIDArgs* args) {
         // if we're in an isViewing tree, we also need to look for an kill any viewed particles
         if (!args->viewedParticleFound && args->isViewing) {
             if (thisParticle.getCreatorTokenID() == UNKNOWN_TOKEN && thisParticle.getID() == args->particleID) {
+                // if we've already given the ID to the created particle, the map refers to that one now
+                if (!args->creatorTokenFound) {
+                    _myTree->clearContainingElement(args->particleID, this);
+                }
                 _particles->removeAt(i); // remove the particle at this index
                 numberOfParticles--; // this means we have 1 fewer particle in this list
                 i--; // and we actually want to back up i as well.
@@ -282,6 +316,7 @@ bool ParticleTreeElement::removeParticleWithID(uint32_t id) {
         if ((*_particles)[i].getID() == id) {
             foundParticle = true;
             _particles->removeAt(i);
+            _myTree->clearContainingElement(id, this);
             break;
         }
     }
@@ -335,6 +370,7 @@ bool ParticleTreeElement::collapseChildren() {
 
 void ParticleTreeElement::storeParticle(const Particle& particle) {
     _particles->push_back(particle);
+    _myTree->setContainingElement(particle.getID(), this);
     markWithChangedTime();
 }
 
@@ -26,6 +26,19 @@ class ParticleTreeElement;
 class ParticleTreeUpdateArgs {
 public:
     QList<Particle> _movingParticles;
+
+    int _maxScriptInvocations; ///< the most update scripts we may run, or -1 for no limit
+    int _lastScriptedParticleCount; ///< the number of particles with scripts seen in the last update
+    int _firstScriptedParticle; ///< the index of the particle with a script that goes first this update
+    int _scriptedParticles; ///< the number of particles with scripts seen so far in this update
+    int _scriptInvocations; ///< the number of update scripts run so far in this update
+    int _nextFirstScriptedParticle; ///< the first particle from _firstScriptedParticle on denied a turn, or -1 for none
+    int _firstSkippedScriptedParticle; ///< the first particle denied a turn, or -1 for none
+
+    /// Decides whether the next particle with a script gets to run it, never allowing more than _maxScriptInvocations.
+    /// The particles from _firstScriptedParticle on go first, with any budget they won't need going to the ones before
+    /// it, so that the turns rotate from one update to the next and none of them starve.
+    bool shouldRunScript();
 };
 
 class FindAndUpdateParticleIDArgs {
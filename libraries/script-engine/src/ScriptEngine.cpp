@@ -76,6 +76,7 @@ ScriptEngine::ScriptEngine(const QString& scriptContents, const QString& fileNam
     _isListeningToAudioStream(false),
     _avatarSound(NULL),
     _numAvatarSoundSentBytes(0),
+    _avatarAudioEncoder(),
     _controllerScriptingInterface(controllerScriptingInterface),
     _avatarData(NULL),
     _scriptName(),
@@ -101,6 +102,7 @@ ScriptEngine::ScriptEngine(const QUrl& scriptURL,
     _isListeningToAudioStream(false),
     _avatarSound(NULL),
     _numAvatarSoundSentBytes(0),
+    _avatarAudioEncoder(),
     _controllerScriptingInterface(controllerScriptingInterface),
     _avatarData(NULL),
     _scriptName(),
@@ -449,11 +451,11 @@ void ScriptEngine::run() {
                     }
 
                     // write the number of silent samples so the audio-mixer can uphold timing
-                    packetStream.writeRawData(reinterpret_cast<const char*>(&SCRIPT_AUDIO_BUFFER_SAMPLES), sizeof(int16_t));
+                    _avatarAudioEncoder.writeSilentFrameHeader(AudioCodecID::PCM, audioPacket);
+                    audioPacket.append(reinterpret_cast<const char*>(&SCRIPT_AUDIO_BUFFER_SAMPLES), sizeof(int16_t));
                 } else if (nextSoundOutput) {
-                    // write the raw audio data
-                    packetStream.writeRawData(reinterpret_cast<const char*>(nextSoundOutput),
-                                              numAvailableSamples * sizeof(int16_t));
+                    // write the raw audio data, agents are on the same network as the mixer so we don't bother encoding
+                    _avatarAudioEncoder.encodeFrame(AudioCodecID::PCM, nextSoundOutput, numAvailableSamples, 1, audioPacket);
                 }
 
                 nodeList->broadcastToNodes(audioPacket, NodeSet() << NodeType::AudioMixer);
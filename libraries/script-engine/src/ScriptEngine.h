@@ -18,6 +18,7 @@
 #include <QtCore/QUrl>
 #include <QtScript/QScriptEngine>
 
+#include <AudioCodec.h>
 #include <AudioScriptingInterface.h>
 #include <VoxelsScriptingInterface.h>
 
@@ -122,6 +123,7 @@ protected:
     bool _isListeningToAudioStream;
     Sound* _avatarSound;
     int _numAvatarSoundSentBytes;
+    AudioStreamEncoder _avatarAudioEncoder;
 
 private:
     QUrl resolveInclude(const QString& include) const;
@@ -0,0 +1,105 @@
+//
+//  Histogram.cpp
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <limits>
+
+#include "Histogram.h"
+
+Histogram::Histogram() :
+    _count(0),
+    _max(0)
+{
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        _buckets[i] = 0;
+    }
+}
+
+int Histogram::bucketForValue(quint64 value) {
+    if (value < (quint64)SUB_BUCKET_COUNT) {
+        // small values get a bucket each
+        return (int)value;
+    }
+    int magnitude = 0;
+    for (quint64 remaining = value >> 1; remaining != 0; remaining >>= 1) {
+        magnitude++;
+    }
+    // the bits just below the highest set bit pick the sub bucket
+    int subBucket = (int)(value >> (magnitude - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+    return (magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + subBucket;
+}
+
+quint64 Histogram::upperBoundForBucket(int bucket) {
+    if (bucket < SUB_BUCKET_COUNT) {
+        return bucket;
+    }
+    int shift = bucket / SUB_BUCKET_COUNT - 1;
+    quint64 lowerBound = (quint64)(SUB_BUCKET_COUNT + bucket % SUB_BUCKET_COUNT) << shift;
+    return lowerBound + ((quint64)1 << shift) - 1;
+}
+
+void Histogram::record(quint64 value) {
+    _buckets[bucketForValue(value)].fetchAndAddRelaxed(1);
+    _count.fetchAndAddRelaxed(1);
+
+    int clampedValue = (int)qMin(value, (quint64)std::numeric_limits<int>::max());
+    int currentMax = _max.load();
+    while (clampedValue > currentMax && !_max.testAndSetRelaxed(currentMax, clampedValue)) {
+        currentMax = _max.load();
+    }
+}
+
+void Histogram::reset() {
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        _buckets[i] = 0;
+    }
+    _count = 0;
+    _max = 0;
+}
+
+void Histogram::add(const Histogram& other) {
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        int otherCount = other._buckets[i].load();
+        if (otherCount > 0) {
+            _buckets[i].fetchAndAddRelaxed(otherCount);
+        }
+    }
+    _count.fetchAndAddRelaxed(other._count.load());
+
+    int otherMax = other._max.load();
+    int currentMax = _max.load();
+    while (otherMax > currentMax && !_max.testAndSetRelaxed(currentMax, otherMax)) {
+        currentMax = _max.load();
+    }
+}
+
+quint64 Histogram::getPercentile(float percentile) const {
+    int count = _count.load();
+    if (count == 0) {
+        return 0;
+    }
+    int targetCount = qMax(1, (int)(count * percentile / 100.0f + 0.5f));
+    int runningCount = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        runningCount += _buckets[i].load();
+        if (runningCount >= targetCount) {
+            // never report more than the largest sample we've actually seen
+            return qMin(upperBoundForBucket(i), getMax());
+        }
+    }
+    return getMax();
+}
+
+void Histogram::addToJSONObject(QJsonObject& statsObject, const QString& baseName) const {
+    statsObject[baseName + ".count"] = getCount();
+    statsObject[baseName + ".p50"] = (double)getPercentile(50.0f);
+    statsObject[baseName + ".p90"] = (double)getPercentile(90.0f);
+    statsObject[baseName + ".p99"] = (double)getPercentile(99.0f);
+    statsObject[baseName + ".max"] = (double)getMax();
+}
@@ -0,0 +1,59 @@
+//
+//  Histogram.h
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Log-linear histogram of timing samples, in the spirit of HdrHistogram.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_Histogram_h
+#define hifi_Histogram_h
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+
+/// Records non-negative integer samples (typically usecs) into buckets with a fixed relative precision of one eighth,
+/// so that percentiles can be read back without keeping the samples around. Recording is lock-free, one thread can
+/// record while another reads or resets.
+class Histogram {
+public:
+    static const int SUB_BUCKET_BITS = 3;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const int NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    Histogram();
+
+    void record(quint64 value);
+    void reset();
+
+    /// Adds the samples of another histogram to this one.
+    void add(const Histogram& other);
+
+    int getCount() const { return _count.load(); }
+    quint64 getMax() const { return (quint64)_max.load(); }
+
+    /// Returns an upper bound for the value below which the given percentage (0 - 100) of samples fall.
+    quint64 getPercentile(float percentile) const;
+
+    /// Adds count, p50, p90, p99 and max values to the stats object, under keys prefixed with the base name.
+    void addToJSONObject(QJsonObject& statsObject, const QString& baseName) const;
+
+    static int bucketForValue(quint64 value);
+    static quint64 upperBoundForBucket(int bucket);
+
+private:
+    // disallow copying, QAtomicInt arrays don't copy
+    Histogram(const Histogram& other);
+    Histogram& operator=(const Histogram& other);
+
+    QAtomicInt _buckets[NUM_BUCKETS];
+    QAtomicInt _count;
+    QAtomicInt _max;
+};
+
+#endif // hifi_Histogram_h
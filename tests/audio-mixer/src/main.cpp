@@ -0,0 +1,105 @@
+//
+//  main.cpp
+//  tests/audio-mixer/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Replays a capture of inbound audio through the mixer as fast as it will go and reports how long its frames took.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include <QtNetwork/QUdpSocket>
+
+#include <Assignment.h>
+#include <NodeList.h>
+#include <PacketHeaders.h>
+#include <SharedUtil.h>
+
+#include "AudioMixer.h"
+#include "AudioPacketCapture.h"
+
+static void printHistogram(const char* name, const Histogram& histogram) {
+    qDebug() << name << "p50" << histogram.getPercentile(50.0f) << "p99" << histogram.getPercentile(99.0f)
+        << "max" << histogram.getMax() << "usecs";
+}
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+
+    QStringList arguments = app.arguments();
+    if (arguments.size() < 2) {
+        qDebug() << "Usage: audio-mixer-benchmark <capture file> [mixer options]";
+        return 1;
+    }
+
+    // find everyone who sent audio, so that they can be added as nodes before their first packet arrives
+    AudioPacketCapture capture;
+    if (!capture.openForReading(arguments.at(1))) {
+        qDebug() << "Couldn't read capture" << arguments.at(1);
+        return 1;
+    }
+    QSet<QUuid> senders;
+    quint64 usecs;
+    QByteArray packet;
+    int numPackets = 0;
+    while (capture.readPacket(usecs, packet)) {
+        senders.insert(uuidFromPacketHeader(packet));
+        numPackets++;
+    }
+    capture.close();
+
+    NodeList* nodeList = NodeList::createInstance(NodeType::AudioMixer);
+    nodeList->linkedDataCreateCallback = AudioMixer::attachNewBufferToNode;
+
+    // the mixes go nowhere in particular, but they do go out through the socket like they would for real
+    QUdpSocket sink;
+    sink.bind(QHostAddress::LocalHost);
+    HifiSockAddr sinkAddress(QHostAddress::LocalHost, sink.localPort());
+    foreach (const QUuid& sender, senders) {
+        nodeList->addOrUpdateNode(sender, NodeType::Agent, sinkAddress, sinkAddress)->activatePublicSocket();
+    }
+
+    // hand the mixer its options the way the domain server would, as the assignment payload
+    Assignment assignment(Assignment::CreateCommand, Assignment::AudioMixerType);
+    assignment.setPayload(arguments.mid(2).join(" ").toUtf8());
+    QByteArray assignmentPacket = byteArrayWithPopulatedHeader(PacketTypeCreateAssignment);
+    QDataStream assignmentStream(&assignmentPacket, QIODevice::Append);
+    assignmentStream << assignment;
+
+    AudioMixer mixer(assignmentPacket);
+
+    capture.openForReading(arguments.at(1));
+    bool hasPacket = capture.readPacket(usecs, packet);
+    HifiSockAddr senderAddress;
+    int numFrames = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    while (hasPacket) {
+        // deliver everything that arrived before the mixer would have woken up for this frame
+        quint64 frameEndUsecs = (quint64)(numFrames + 1) * BUFFER_SEND_INTERVAL_USECS;
+        while (hasPacket && usecs < frameEndUsecs) {
+            mixer.processDatagram(packet, senderAddress);
+            hasPacket = capture.readPacket(usecs, packet);
+        }
+        mixer.processFrame();
+        numFrames++;
+    }
+    float seconds = timer.nsecsElapsed() / 1000000000.0f;
+
+    qDebug() << "Mixed" << numFrames << "frames from" << numPackets << "packets of" << senders.size() << "senders at"
+        << (numFrames * BUFFER_SEND_INTERVAL_USECS / 1000000.0f) / seconds << "times real time";
+    printHistogram("frame", mixer.getFrameUsecs());
+    for (int i = 0; i < AudioMixer::NUM_FRAME_STAGES; i++) {
+        printHistogram(AudioMixer::FRAME_STAGE_NAMES[i], mixer.getFrameStageUsecs((AudioMixer::FrameStage)i));
+    }
+    return 0;
+}
@@ -0,0 +1,220 @@
+//
+//  AudioResamplerTests.cpp
+//  tests/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <math.h>
+
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QVector>
+
+#include <AudioResampler.h>
+
+#include "AudioResamplerTests.h"
+
+static const int NETWORK_SAMPLE_RATE = 24000;
+static const int DEVICE_SAMPLE_RATES[] = { 44100, 48000, 96000 };
+static const int NUM_DEVICE_SAMPLE_RATES = sizeof(DEVICE_SAMPLE_RATES) / sizeof(int);
+
+static const float TONE_FREQUENCY = 1000.0f;
+static const float TONE_AMPLITUDE = 10000.0f;
+static const float MIN_TONE_SNR = 55.0f;
+
+static const float PI = 3.14159265358979f;
+
+static QVector<int16_t> createTone(int sampleRate, float frequency, int numFrames, int numChannels) {
+    QVector<int16_t> samples(numFrames * numChannels);
+    for (int i = 0; i < numFrames; i++) {
+        int16_t sample = (int16_t)(TONE_AMPLITUDE * sinf(2.0f * PI * frequency * i / sampleRate));
+        for (int channel = 0; channel < numChannels; channel++) {
+            samples[i * numChannels + channel] = sample;
+        }
+    }
+    return samples;
+}
+
+static QVector<int16_t> resampleInChunks(AudioResampler& resampler, const QVector<int16_t>& source, int chunkFrames) {
+    int numChannels = resampler.getNumChannels();
+    int numSourceFrames = source.size() / numChannels;
+    QVector<int16_t> destination(resampler.getMaxOutputFrames(numSourceFrames) * numChannels + chunkFrames);
+    int numDestinationFrames = 0;
+    for (int position = 0; position < numSourceFrames; position += chunkFrames) {
+        numDestinationFrames += resampler.resample(source.constData() + position * numChannels,
+            qMin(chunkFrames, numSourceFrames - position), destination.data() + numDestinationFrames * numChannels);
+    }
+    destination.resize(numDestinationFrames * numChannels);
+    return destination;
+}
+
+/// Fits a sinusoid of the given frequency to the first channel and returns the ratio of its power to that of what's
+/// left over, in dB. Skips the start, where the filter is still filling.
+static float measureSNR(const QVector<int16_t>& samples, int numChannels, int sampleRate, float frequency) {
+    const int NUM_SKIPPED_FRAMES = 256;
+    int numFrames = samples.size() / numChannels;
+    double sineSum = 0.0, cosineSum = 0.0;
+    for (int i = NUM_SKIPPED_FRAMES; i < numFrames; i++) {
+        double angle = 2.0 * PI * frequency * i / sampleRate;
+        sineSum += samples[i * numChannels] * sin(angle);
+        cosineSum += samples[i * numChannels] * cos(angle);
+    }
+    int numMeasuredFrames = numFrames - NUM_SKIPPED_FRAMES;
+    double sineAmplitude = 2.0 * sineSum / numMeasuredFrames;
+    double cosineAmplitude = 2.0 * cosineSum / numMeasuredFrames;
+
+    double signalPower = 0.0, noisePower = 0.0;
+    for (int i = NUM_SKIPPED_FRAMES; i < numFrames; i++) {
+        double angle = 2.0 * PI * frequency * i / sampleRate;
+        double fit = sineAmplitude * sin(angle) + cosineAmplitude * cos(angle);
+        double residual = samples[i * numChannels] - fit;
+        signalPower += fit * fit;
+        noisePower += residual * residual;
+    }
+    return (float)(10.0 * log10(signalPower / qMax(noisePower, 1e-9)));
+}
+
+bool AudioResamplerTests::toneQuality() {
+    bool failed = false;
+    const int NUM_CHANNELS = 2;
+    const int CALLBACK_FRAMES = 441;
+    for (int i = 0; i < NUM_DEVICE_SAMPLE_RATES; i++) {
+        int rates[][2] = { { DEVICE_SAMPLE_RATES[i], NETWORK_SAMPLE_RATE },
+                           { NETWORK_SAMPLE_RATE, DEVICE_SAMPLE_RATES[i] } };
+        for (int j = 0; j < 2; j++) {
+            AudioResampler resampler(rates[j][0], rates[j][1], NUM_CHANNELS);
+            QVector<int16_t> tone = createTone(rates[j][0], TONE_FREQUENCY, rates[j][0], NUM_CHANNELS);
+            QVector<int16_t> resampled = resampleInChunks(resampler, tone, CALLBACK_FRAMES);
+
+            float snr = measureSNR(resampled, NUM_CHANNELS, rates[j][1], TONE_FREQUENCY);
+            int numFrames = resampled.size() / NUM_CHANNELS;
+            qDebug() << rates[j][0] << "->" << rates[j][1] << "SNR" << snr << "dB," << numFrames << "frames";
+
+            if (snr < MIN_TONE_SNR) {
+                qDebug() << "  SNR below" << MIN_TONE_SNR << "dB";
+                failed = true;
+            }
+            if (qAbs(numFrames - rates[j][1]) > 1) {
+                qDebug() << "  expected" << rates[j][1] << "frames";
+                failed = true;
+            }
+        }
+    }
+    return failed;
+}
+
+bool AudioResamplerTests::streamingMatchesOneShot() {
+    const int CALLBACK_FRAMES[] = { 1, 17, 441, 1024 };
+    const int NUM_CALLBACK_SIZES = sizeof(CALLBACK_FRAMES) / sizeof(int);
+    const int NUM_FRAMES = 4410;
+    QVector<int16_t> tone = createTone(44100, TONE_FREQUENCY, NUM_FRAMES, 1);
+
+    AudioResampler oneShotResampler(44100, NETWORK_SAMPLE_RATE, 1);
+    QVector<int16_t> oneShot = resampleInChunks(oneShotResampler, tone, NUM_FRAMES);
+
+    for (int i = 0; i < NUM_CALLBACK_SIZES; i++) {
+        AudioResampler resampler(44100, NETWORK_SAMPLE_RATE, 1);
+        QVector<int16_t> streamed = resampleInChunks(resampler, tone, CALLBACK_FRAMES[i]);
+        if (streamed != oneShot) {
+            qDebug() << "Streaming in" << CALLBACK_FRAMES[i] << "frame callbacks differs from one shot";
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AudioResamplerTests::aliasRejection() {
+    const float MIN_REJECTION = 60.0f;
+    const float ALIASING_FREQUENCY = 18000.0f;
+
+    AudioResampler resampler(48000, NETWORK_SAMPLE_RATE, 1);
+    QVector<int16_t> tone = createTone(48000, ALIASING_FREQUENCY, 48000, 1);
+    QVector<int16_t> resampled = resampleInChunks(resampler, tone, tone.size());
+
+    double power = 0.0;
+    for (int i = 0; i < resampled.size(); i++) {
+        power += resampled[i] * resampled[i];
+    }
+    double inputPower = TONE_AMPLITUDE * TONE_AMPLITUDE / 2.0;
+    float rejection = (float)(10.0 * log10(inputPower / qMax(power / resampled.size(), 1e-9)));
+    qDebug() << "18 kHz at 48000 -> 24000 rejected by" << rejection << "dB";
+    if (rejection < MIN_REJECTION) {
+        qDebug() << "  rejection below" << MIN_REJECTION << "dB";
+        return true;
+    }
+    return false;
+}
+
+static int16_t peakMagnitude(const QVector<int16_t>& samples) {
+    int16_t peak = 0;
+    for (int i = 0; i < samples.size(); i++) {
+        peak = qMax(peak, (int16_t)qAbs((int)samples[i]));
+    }
+    return peak;
+}
+
+bool AudioResamplerTests::flushEmptiesFilter() {
+    // an impulse in the very last frame has barely entered the filter by the end of the input
+    const int NUM_FRAMES = 1024;
+    QVector<int16_t> impulse(NUM_FRAMES, 0);
+    impulse[NUM_FRAMES - 1] = (int16_t)TONE_AMPLITUDE;
+
+    AudioResampler resampler(48000, NETWORK_SAMPLE_RATE, 1);
+    QVector<int16_t> resampled = resampleInChunks(resampler, impulse, NUM_FRAMES);
+    QVector<int16_t> tail(resampler.getMaxFlushFrames());
+    tail.resize(resampler.flush(tail.data()));
+
+    // the flushed output should match what the same impulse followed by silence gives without a flush
+    QVector<int16_t> padded = impulse;
+    padded.resize(NUM_FRAMES * 2);
+    AudioResampler paddedResampler(48000, NETWORK_SAMPLE_RATE, 1);
+    QVector<int16_t> expected = resampleInChunks(paddedResampler, padded, padded.size());
+
+    QVector<int16_t> flushed = resampled + tail;
+    if (flushed != expected.mid(0, flushed.size())) {
+        qDebug() << "Flushing differs from feeding silence";
+        return true;
+    }
+    if (peakMagnitude(tail) < TONE_AMPLITUDE / 4 || peakMagnitude(resampled) > TONE_AMPLITUDE / 8) {
+        qDebug() << "Final impulse peaked at" << peakMagnitude(resampled) << "before flushing and"
+            << peakMagnitude(tail) << "after";
+        return true;
+    }
+    return false;
+}
+
+void AudioResamplerTests::throughput() {
+    const int NUM_CHANNELS = 2;
+    const int NUM_ITERATIONS = 20;
+    for (int i = 0; i < NUM_DEVICE_SAMPLE_RATES; i++) {
+        int rates[][2] = { { DEVICE_SAMPLE_RATES[i], NETWORK_SAMPLE_RATE },
+                           { NETWORK_SAMPLE_RATE, DEVICE_SAMPLE_RATES[i] } };
+        for (int j = 0; j < 2; j++) {
+            AudioResampler resampler(rates[j][0], rates[j][1], NUM_CHANNELS);
+            QVector<int16_t> tone = createTone(rates[j][0], TONE_FREQUENCY, rates[j][0], NUM_CHANNELS);
+            QVector<int16_t> destination(resampler.getMaxOutputFrames(rates[j][0]) * NUM_CHANNELS);
+
+            QElapsedTimer timer;
+            timer.start();
+            for (int iteration = 0; iteration < NUM_ITERATIONS; iteration++) {
+                resampler.resample(tone.constData(), rates[j][0], destination.data());
+            }
+            float seconds = timer.nsecsElapsed() / 1000000000.0f;
+            qDebug() << rates[j][0] << "->" << rates[j][1] << "stereo at" << NUM_ITERATIONS / seconds
+                << "times real time";
+        }
+    }
+}
+
+bool AudioResamplerTests::runAllTests() {
+    bool failed = toneQuality();
+    failed |= streamingMatchesOneShot();
+    failed |= aliasRejection();
+    failed |= flushEmptiesFilter();
+    throughput();
+    return failed;
+}
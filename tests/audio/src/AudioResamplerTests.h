@@ -0,0 +1,39 @@
+//
+//  AudioResamplerTests.h
+//  tests/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioResamplerTests_h
+#define hifi_AudioResamplerTests_h
+
+namespace AudioResamplerTests {
+
+    /// Checks the signal to noise ratio of a resampled tone for each pair of common rates.
+    /// \return true if any pair fell short
+    bool toneQuality();
+
+    /// Checks that resampling a stream a callback at a time gives the same samples as resampling it all at once.
+    /// \return true if they differed
+    bool streamingMatchesOneShot();
+
+    /// Checks that content above the output Nyquist frequency doesn't alias back down.
+    /// \return true if it did
+    bool aliasRejection();
+
+    /// Checks that flushing brings out the end of the input, just as more input would have.
+    /// \return true if it didn't
+    bool flushEmptiesFilter();
+
+    /// Prints how many times faster than real time each pair of rates resamples.
+    void throughput();
+
+    /// \return true if any of the tests failed
+    bool runAllTests();
+}
+
+#endif // hifi_AudioResamplerTests_h
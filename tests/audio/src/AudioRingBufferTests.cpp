@@ -0,0 +1,83 @@
+//
+//  AudioRingBufferTests.cpp
+//  tests/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDebug>
+#include <QtCore/QVector>
+
+#include <AudioRingBuffer.h>
+
+#include "AudioRingBufferTests.h"
+
+static const int NUM_FRAME_SAMPLES = NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+
+bool AudioRingBufferTests::lockFreeFramesDontWrap() {
+    AudioRingBuffer ringBuffer(NUM_FRAME_SAMPLES, false, true);
+    if (ringBuffer.getSampleCapacity() & (ringBuffer.getSampleCapacity() - 1)) {
+        qDebug() << "Lock-free capacity" << ringBuffer.getSampleCapacity() << "isn't a power of two";
+        return true;
+    }
+
+    // write in uneven pieces so that frames start all over the ring, including just before its end
+    const int WRITE_SAMPLES = NUM_FRAME_SAMPLES / 3 + 1;
+    const int NUM_FRAMES = 100;
+    QVector<int16_t> samples(WRITE_SAMPLES);
+    int16_t nextWrittenSample = 0;
+    int16_t nextExpectedSample = 0;
+    for (int frame = 0; frame < NUM_FRAMES; ) {
+        for (int i = 0; i < WRITE_SAMPLES; i++) {
+            samples[i] = nextWrittenSample++;
+        }
+        ringBuffer.writeSamples(samples.constData(), WRITE_SAMPLES);
+
+        while (ringBuffer.samplesAvailable() >= (unsigned int)NUM_FRAME_SAMPLES && frame < NUM_FRAMES) {
+            const int16_t* nextOutput = ringBuffer.getNextOutput();
+            for (int i = 0; i < NUM_FRAME_SAMPLES; i++) {
+                if (nextOutput[i] != nextExpectedSample++) {
+                    qDebug() << "Frame" << frame << "differs at sample" << i;
+                    return true;
+                }
+            }
+            ringBuffer.shiftReadPosition(NUM_FRAME_SAMPLES);
+            frame++;
+        }
+    }
+    return false;
+}
+
+bool AudioRingBufferTests::lockFreeOverflowDrops() {
+    AudioRingBuffer ringBuffer(NUM_FRAME_SAMPLES, false, true);
+    QVector<int16_t> frame(NUM_FRAME_SAMPLES, 1);
+
+    // one frame behind the read position always stays free
+    int maxFrames = ringBuffer.getSampleCapacity() / NUM_FRAME_SAMPLES - 1;
+    for (int i = 0; i < maxFrames; i++) {
+        if (ringBuffer.writeSamples(frame.constData(), NUM_FRAME_SAMPLES) != NUM_FRAME_SAMPLES) {
+            qDebug() << "Dropped frame" << i << "of" << maxFrames;
+            return true;
+        }
+    }
+    const int16_t* nextOutput = ringBuffer.getNextOutput();
+    if (ringBuffer.writeSamples(frame.constData(), NUM_FRAME_SAMPLES) != 0) {
+        qDebug() << "Wrote a frame past the free space";
+        return true;
+    }
+    if (ringBuffer.getNextOutput() != nextOutput
+            || ringBuffer.samplesAvailable() != (unsigned int)(maxFrames * NUM_FRAME_SAMPLES)) {
+        qDebug() << "Overflow moved the read position";
+        return true;
+    }
+    return false;
+}
+
+bool AudioRingBufferTests::runAllTests() {
+    bool failed = lockFreeFramesDontWrap();
+    failed |= lockFreeOverflowDrops();
+    return failed;
+}
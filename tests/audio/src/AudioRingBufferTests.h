@@ -0,0 +1,29 @@
+//
+//  AudioRingBufferTests.h
+//  tests/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioRingBufferTests_h
+#define hifi_AudioRingBufferTests_h
+
+namespace AudioRingBufferTests {
+
+    /// Checks that a lock-free ring can be read a frame at a time straight from getNextOutput, whatever the alignment
+    /// of its writes.
+    /// \return true if a frame came out different from what went in
+    bool lockFreeFramesDontWrap();
+
+    /// Checks that a full lock-free ring drops writes and leaves the read position alone.
+    /// \return true if it didn't
+    bool lockFreeOverflowDrops();
+
+    /// \return true if any of the tests failed
+    bool runAllTests();
+}
+
+#endif // hifi_AudioRingBufferTests_h
@@ -0,0 +1,18 @@
+//
+//  main.cpp
+//  tests/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "AudioResamplerTests.h"
+#include "AudioRingBufferTests.h"
+
+int main(int argc, char** argv) {
+    bool failed = AudioResamplerTests::runAllTests();
+    failed |= AudioRingBufferTests::runAllTests();
+    return failed;
+}
@@ -0,0 +1,382 @@
+//
+//  MetavoxelBenchmarks.cpp
+//  tests/metavoxel-benchmark/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QUrl>
+#include <QtDebug>
+
+#include <SharedUtil.h>
+
+#include <DatagramSequencer.h>
+#include <MetavoxelData.h>
+#include <MetavoxelMessages.h>
+
+#include "MetavoxelBenchmarks.h"
+
+// the same seed for every run, so that every build sees the same worlds
+const unsigned int BENCHMARK_SEED = 0xB3AC4;
+
+// each timing is the best of this many runs
+const int TIMING_RUNS = 5;
+
+const float WORLD_EXTENT = 32.0f;
+
+/// Describes the contents of one of the synthetic worlds.
+class WorldDescription {
+public:
+    const char* name;
+    int spheres;
+    int models;
+    int boxes;
+};
+
+const WorldDescription WORLDS[] = { { "small", 8, 4, 16 }, { "medium", 32, 16, 64 }, { "large", 128, 64, 256 } };
+const int WORLD_COUNT = sizeof(WORLDS) / sizeof(WORLDS[0]);
+
+// the client's threshold, and a couple of coarser ones
+const float LOD_THRESHOLDS[] = { 0.01f, 0.04f, 0.16f };
+const int LOD_THRESHOLD_COUNT = sizeof(LOD_THRESHOLDS) / sizeof(LOD_THRESHOLDS[0]);
+
+static double toUsecs(qint64 nsecs) {
+    return nsecs / 1000.0;
+}
+
+/// Returns a random 32-bit word.  rand() alone gives as few as fifteen bits, and never sets the top bit of the word.
+static quint32 randomWord() {
+    quint32 word = 0;
+    for (unsigned int i = 0; i < sizeof(quint32); i++) {
+        word = (word << 8) | (rand() & 0xFF);
+    }
+    return word;
+}
+
+static glm::vec3 randomPosition(float margin) {
+    float extent = WORLD_EXTENT * 0.5f - margin;
+    return glm::vec3(randFloatInRange(-extent, extent), randFloatInRange(-extent, extent), randFloatInRange(-extent, extent));
+}
+
+static QRgb randomColor() {
+    return qRgb(randIntInRange(0, 255), randIntInRange(0, 255), randIntInRange(0, 255));
+}
+
+static void insertSpanner(MetavoxelData& data, Spanner* spanner) {
+    InsertSpannerEdit(AttributeRegistry::getInstance()->getSpannersAttribute(),
+        SharedObjectPointer(spanner)).apply(data, SharedObject::getWeakHash());
+}
+
+/// Sets either the color or the normal within a random box, so that both kinds of attribute are covered.
+static void setRandomBox(MetavoxelData& data) {
+    const float MIN_BOX_SIZE = 0.5f;
+    const float MAX_BOX_SIZE = 4.0f;
+    glm::vec3 minimum = randomPosition(MAX_BOX_SIZE);
+    Box region(minimum, minimum + glm::vec3(randFloatInRange(MIN_BOX_SIZE, MAX_BOX_SIZE),
+        randFloatInRange(MIN_BOX_SIZE, MAX_BOX_SIZE), randFloatInRange(MIN_BOX_SIZE, MAX_BOX_SIZE)));
+
+    AttributeRegistry* registry = AttributeRegistry::getInstance();
+    OwnedAttributeValue value;
+    if (randomBoolean()) {
+        value = OwnedAttributeValue(registry->getColorAttribute(), encodeInline<QRgb>(randomColor()));
+    } else {
+        value = OwnedAttributeValue(registry->getNormalAttribute(), encodeInline<QRgb>(packNormal(
+            glm::normalize(glm::vec3(randFloatInRange(-1.0f, 1.0f), randFloatInRange(-1.0f, 1.0f), 1.0f)))));
+    }
+    const float BOX_GRANULARITY = 0.25f;
+    BoxSetEdit(region, BOX_GRANULARITY, value).apply(data, SharedObject::getWeakHash());
+}
+
+static MetavoxelData createWorld(const WorldDescription& description) {
+    const float MIN_SCALE = 0.5f;
+    const float MAX_SCALE = 2.0f;
+    MetavoxelData data;
+    for (int i = 0; i < description.spheres; i++) {
+        Sphere* sphere = new Sphere();
+        sphere->setTranslation(randomPosition(MAX_SCALE));
+        sphere->setScale(randFloatInRange(MIN_SCALE, MAX_SCALE));
+        sphere->setColor(QColor(randomColor()));
+        insertSpanner(data, sphere);
+    }
+    for (int i = 0; i < description.models; i++) {
+        // models only have the bounds we give them; nothing is loaded from the URL
+        StaticModel* model = new StaticModel();
+        model->setURL(QUrl(QString("http://localhost/models/%1.fbx").arg(i)));
+        model->setTranslation(randomPosition(MAX_SCALE));
+        model->setScale(randFloatInRange(MIN_SCALE, MAX_SCALE));
+        glm::vec3 extent(model->getScale(), model->getScale(), model->getScale());
+        model->setBounds(Box(model->getTranslation() - extent, model->getTranslation() + extent));
+        insertSpanner(data, model);
+    }
+    for (int i = 0; i < description.boxes; i++) {
+        setRandomBox(data);
+    }
+    return data;
+}
+
+static QByteArray encode(const MetavoxelData& data, const MetavoxelLOD& lod) {
+    QByteArray array;
+    QDataStream stream(&array, QIODevice::WriteOnly);
+    Bitstream out(stream);
+    data.write(out, lod);
+    out.flush();
+    return array;
+}
+
+static MetavoxelData decode(const QByteArray& array, const MetavoxelLOD& lod) {
+    QDataStream stream(array);
+    Bitstream in(stream);
+    MetavoxelData data;
+    data.read(in, lod);
+    return data;
+}
+
+static QByteArray encodeDelta(const MetavoxelData& data, const MetavoxelData& reference,
+        const MetavoxelLOD& referenceLOD, const MetavoxelLOD& lod) {
+    QByteArray array;
+    QDataStream stream(&array, QIODevice::WriteOnly);
+    Bitstream out(stream);
+    data.writeDelta(reference, referenceLOD, out, lod);
+    out.flush();
+    return array;
+}
+
+/// Times the encoding and decoding of a delta against the reference, adding the results to the object under the given
+/// prefix.
+static void benchmarkDelta(const MetavoxelData& data, const MetavoxelData& reference, const MetavoxelLOD& referenceLOD,
+        const MetavoxelLOD& lod, const QString& prefix, QJsonObject& results) {
+    QElapsedTimer timer;
+    qint64 bestEncode = 0, bestDecode = 0;
+    QByteArray encoded;
+    for (int i = 0; i < TIMING_RUNS; i++) {
+        timer.start();
+        encoded = encodeDelta(data, reference, referenceLOD, lod);
+        qint64 nsecs = timer.nsecsElapsed();
+        bestEncode = (i == 0) ? nsecs : qMin(bestEncode, nsecs);
+    }
+    QByteArray encodedReference = encode(reference, referenceLOD);
+    for (int i = 0; i < TIMING_RUNS; i++) {
+        // decoding may modify the reference's nodes in place, as it would on the client, so each run gets a fresh copy
+        MetavoxelData clientReference = decode(encodedReference, referenceLOD);
+        QDataStream stream(encoded);
+        Bitstream in(stream);
+        MetavoxelData decoded;
+        timer.start();
+        decoded.readDelta(clientReference, referenceLOD, in, lod);
+        qint64 nsecs = timer.nsecsElapsed();
+        bestDecode = (i == 0) ? nsecs : qMin(bestDecode, nsecs);
+    }
+    results[prefix + "_bytes"] = encoded.size();
+    results[prefix + "_encode_usecs"] = toUsecs(bestEncode);
+    results[prefix + "_decode_usecs"] = toUsecs(bestDecode);
+}
+
+static QJsonObject benchmarkWorld(const WorldDescription& description) {
+    QJsonObject results;
+    results["spheres"] = description.spheres;
+    results["models"] = description.models;
+    results["boxes"] = description.boxes;
+
+    MetavoxelData world = createWorld(description);
+
+    // a handful of further edits for the deltas
+    MetavoxelData edited = world;
+    int deltaEdits = description.boxes / 8 + 1;
+    for (int i = 0; i < deltaEdits; i++) {
+        setRandomBox(edited);
+    }
+    results["delta_edits"] = deltaEdits;
+
+    QJsonObject lodResults;
+    for (int i = 0; i < LOD_THRESHOLD_COUNT; i++) {
+        QJsonObject result;
+        MetavoxelLOD lod(glm::vec3(), LOD_THRESHOLDS[i]);
+
+        QElapsedTimer timer;
+        qint64 bestEncode = 0, bestDecode = 0;
+        QByteArray encoded;
+        for (int j = 0; j < TIMING_RUNS; j++) {
+            timer.start();
+            encoded = encode(world, lod);
+            qint64 nsecs = timer.nsecsElapsed();
+            bestEncode = (j == 0) ? nsecs : qMin(bestEncode, nsecs);
+        }
+        for (int j = 0; j < TIMING_RUNS; j++) {
+            QDataStream stream(encoded);
+            Bitstream in(stream);
+            MetavoxelData decoded;
+            timer.start();
+            decoded.read(in, lod);
+            qint64 nsecs = timer.nsecsElapsed();
+            bestDecode = (j == 0) ? nsecs : qMin(bestDecode, nsecs);
+        }
+        result["full_bytes"] = encoded.size();
+        result["full_encode_usecs"] = toUsecs(bestEncode);
+        result["full_decode_usecs"] = toUsecs(bestDecode);
+
+        // the same view of the edited world, and then the same world from a viewer who has moved
+        benchmarkDelta(edited, world, lod, lod, "delta", result);
+        const float VIEWER_MOVEMENT = WORLD_EXTENT * 0.25f;
+        benchmarkDelta(world, world, lod, MetavoxelLOD(glm::vec3(VIEWER_MOVEMENT, 0.0f, 0.0f), LOD_THRESHOLDS[i]),
+            "lod_change", result);
+
+        lodResults[QString::number(LOD_THRESHOLDS[i])] = result;
+    }
+    results["lods"] = lodResults;
+    return results;
+}
+
+static QJsonObject benchmarkBitstream() {
+    // fields of every width, as a stand-in for the mix of flags, IDs and values written by the messages
+    const int FIELD_COUNT = 1000000;
+    const int MAX_FIELD_BITS = 32;
+    QVector<quint32> values(FIELD_COUNT);
+    QVector<int> bits(FIELD_COUNT);
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        bits[i] = randIntInRange(1, MAX_FIELD_BITS);
+        values[i] = randomWord() & (quint32)((1ULL << bits[i]) - 1);
+    }
+    QElapsedTimer timer;
+    qint64 bestWrite = 0, bestRead = 0;
+    QByteArray array;
+    for (int i = 0; i < TIMING_RUNS; i++) {
+        array.clear();
+        QDataStream stream(&array, QIODevice::WriteOnly);
+        Bitstream out(stream);
+        timer.start();
+        for (int j = 0; j < FIELD_COUNT; j++) {
+            out.write(&values.at(j), bits.at(j));
+        }
+        out.flush();
+        qint64 nsecs = timer.nsecsElapsed();
+        bestWrite = (i == 0) ? nsecs : qMin(bestWrite, nsecs);
+    }
+    for (int i = 0; i < TIMING_RUNS; i++) {
+        QDataStream stream(array);
+        Bitstream in(stream);
+        timer.start();
+        for (int j = 0; j < FIELD_COUNT; j++) {
+            quint32 value = 0;
+            in.read(&value, bits.at(j));
+        }
+        qint64 nsecs = timer.nsecsElapsed();
+        bestRead = (i == 0) ? nsecs : qMin(bestRead, nsecs);
+    }
+    QJsonObject results;
+    results["fields"] = FIELD_COUNT;
+    results["bytes"] = array.size();
+    results["write_usecs"] = toUsecs(bestWrite);
+    results["read_usecs"] = toUsecs(bestRead);
+    return results;
+}
+
+BenchmarkEndpoint::BenchmarkEndpoint(float dropProbability) :
+    _sequencer(new DatagramSequencer(QByteArray(), this)),
+    _other(NULL),
+    _dropProbability(dropProbability),
+    _datagramsSent(0),
+    _bytesReceived(0) {
+
+    connect(_sequencer, SIGNAL(readyToWrite(const QByteArray&)), SLOT(sendDatagram(const QByteArray&)));
+
+    ReliableChannel* input = _sequencer->getReliableInputChannel(1);
+    input->setMessagesEnabled(false);
+    connect(&input->getBuffer(), SIGNAL(readyRead()), SLOT(readReliableChannel()));
+
+    _sequencer->getReliableOutputChannel(1)->setMessagesEnabled(false);
+}
+
+void BenchmarkEndpoint::sendDatagram(const QByteArray& datagram) {
+    _datagramsSent++;
+    if (randFloat() >= _dropProbability) {
+        _other->_sequencer->receivedDatagram(datagram);
+    }
+}
+
+void BenchmarkEndpoint::readReliableChannel() {
+    CircularBuffer& buffer = _sequencer->getReliableInputChannel(1)->getBuffer();
+    _bytesReceived += buffer.read(buffer.bytesAvailable()).size();
+}
+
+/// Streams a fixed amount of reliable data from one endpoint to the other, exchanging a packet each way per iteration.
+static QJsonObject benchmarkSequencer(float dropProbability) {
+    BenchmarkEndpoint alice(dropProbability), bob(dropProbability);
+    alice.setOther(&bob);
+    bob.setOther(&alice);
+
+    const int STREAM_BYTES = 1024 * 1024;
+    QByteArray bytes(STREAM_BYTES, 0);
+    for (int i = 0; i < STREAM_BYTES; i++) {
+        bytes[i] = rand();
+    }
+    alice.getSequencer()->getReliableOutputChannel(1)->getBuffer().write(bytes);
+
+    const int MAX_ITERATIONS = 1000000;
+    int iterations = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (; bob.getBytesReceived() < STREAM_BYTES && iterations < MAX_ITERATIONS; iterations++) {
+        alice.getSequencer()->startPacket();
+        alice.getSequencer()->endPacket();
+        bob.getSequencer()->startPacket();
+        bob.getSequencer()->endPacket();
+    }
+    qint64 nsecs = timer.nsecsElapsed();
+
+    QJsonObject results;
+    results["bytes"] = STREAM_BYTES;
+    results["bytes_received"] = bob.getBytesReceived();
+    results["iterations"] = iterations;
+    results["datagrams_sent"] = alice.getDatagramsSent() + bob.getDatagramsSent();
+    results["usecs"] = toUsecs(nsecs);
+    return results;
+}
+
+bool MetavoxelBenchmarks::run(const QString& outputFilename) {
+    QJsonObject results;
+    results["seed"] = (int)BENCHMARK_SEED;
+
+    QJsonObject worldResults;
+    for (int i = 0; i < WORLD_COUNT; i++) {
+        qDebug() << "Benchmarking" << WORLDS[i].name << "world...";
+        srand(BENCHMARK_SEED + i);
+        worldResults[WORLDS[i].name] = benchmarkWorld(WORLDS[i]);
+    }
+    results["worlds"] = worldResults;
+
+    qDebug() << "Benchmarking bitstream...";
+    srand(BENCHMARK_SEED);
+    results["bitstream"] = benchmarkBitstream();
+
+    const float DROP_PROBABILITIES[] = { 0.0f, 0.05f, 0.2f };
+    QJsonObject sequencerResults;
+    for (unsigned int i = 0; i < sizeof(DROP_PROBABILITIES) / sizeof(DROP_PROBABILITIES[0]); i++) {
+        qDebug() << "Benchmarking sequencer with drop probability" << DROP_PROBABILITIES[i] << "...";
+        srand(BENCHMARK_SEED + i);
+        sequencerResults[QString::number(DROP_PROBABILITIES[i])] = benchmarkSequencer(DROP_PROBABILITIES[i]);
+    }
+    results["sequencer"] = sequencerResults;
+
+    QByteArray json = QJsonDocument(results).toJson();
+    if (outputFilename.isEmpty()) {
+        fwrite(json.constData(), 1, json.size(), stdout);
+        return false;
+    }
+    QFile file(outputFilename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Couldn't open" << outputFilename << "to write results:" << file.errorString();
+        return true;
+    }
+    file.write(json);
+    return false;
+}
@@ -0,0 +1,59 @@
+//
+//  MetavoxelBenchmarks.h
+//  tests/metavoxel-benchmark/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_MetavoxelBenchmarks_h
+#define hifi_MetavoxelBenchmarks_h
+
+#include <QObject>
+#include <QString>
+
+class DatagramSequencer;
+
+/// Times the encoding and decoding of reproducible synthetic worlds at several sizes and LODs, along with the raw throughput
+/// of the Bitstream and of the DatagramSequencer under loss, and writes the results as JSON so that they may be compared
+/// across builds.
+class MetavoxelBenchmarks {
+public:
+
+    /// Runs the benchmarks and writes the results to the named file, or to the standard output if the name is empty.
+    /// \return true if the results couldn't be written
+    bool run(const QString& outputFilename);
+};
+
+/// One end of a sequenced connection whose datagrams may be dropped on the way to the other.
+class BenchmarkEndpoint : public QObject {
+    Q_OBJECT
+
+public:
+
+    BenchmarkEndpoint(float dropProbability);
+
+    void setOther(BenchmarkEndpoint* other) { _other = other; }
+
+    DatagramSequencer* getSequencer() const { return _sequencer; }
+
+    int getDatagramsSent() const { return _datagramsSent; }
+    int getBytesReceived() const { return _bytesReceived; }
+
+private slots:
+
+    void sendDatagram(const QByteArray& datagram);
+    void readReliableChannel();
+
+private:
+
+    DatagramSequencer* _sequencer;
+    BenchmarkEndpoint* _other;
+    float _dropProbability;
+    int _datagramsSent;
+    int _bytesReceived;
+};
+
+#endif // hifi_MetavoxelBenchmarks_h
@@ -0,0 +1,23 @@
+//
+//  main.cpp
+//  tests/metavoxel-benchmark/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Times the metavoxel encoders and transport on reproducible synthetic data and writes the results as JSON.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QStringList>
+
+#include "MetavoxelBenchmarks.h"
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+    
+    // with no results file, the results go to the standard output
+    return MetavoxelBenchmarks().run(app.arguments().value(1));
+}
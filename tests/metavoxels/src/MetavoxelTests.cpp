@@ -9,11 +9,19 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <float.h>
 #include <stdlib.h>
 
+#include <QDir>
+#include <QFileInfo>
+#include <QSemaphore>
+#include <QTemporaryDir>
+#include <QThreadPool>
+
 #include <SharedUtil.h>
 
 #include <MetavoxelMessages.h>
+#include <MetavoxelPersister.h>
 
 #include "MetavoxelTests.h"
 
@@ -130,6 +138,758 @@ static bool testSerialization(Bitstream::MetadataType metadataType) {
     return false;
 }
 
+/// The byte-at-a-time bit writer that Bitstream used to be, kept to check that the wire format hasn't changed.
+class ReferenceBitWriter {
+public:
+    
+    ReferenceBitWriter(QDataStream& underlying) : _underlying(underlying), _byte(0), _position(0) { }
+    
+    void write(const void* data, int bits, int offset = 0) {
+        const quint8* source = (const quint8*)data;
+        while (bits > 0) {
+            int bitsToWrite = qMin(BITS_IN_BYTE - _position, qMin(BITS_IN_BYTE - offset, bits));
+            _byte |= ((*source >> offset) & ((1 << bitsToWrite) - 1)) << _position;
+            if ((_position += bitsToWrite) == BITS_IN_BYTE) {
+                flush();
+            }
+            if ((offset += bitsToWrite) == BITS_IN_BYTE) {
+                source++;
+                offset = 0;
+            }
+            bits -= bitsToWrite;
+        }
+    }
+    
+    void flush() {
+        if (_position != 0) {
+            _underlying << _byte;
+            _byte = 0;
+            _position = 0;
+        }
+    }
+    
+private:
+    
+    QDataStream& _underlying;
+    quint8 _byte;
+    int _position;
+};
+
+/// A field for the bitstream tests:  some number of bits, starting at an offset within its first byte.
+class TestBitField {
+public:
+    QByteArray data;
+    int bits;
+    int offset;
+};
+
+static QList<TestBitField> createRandomBitFields(int count) {
+    QList<TestBitField> fields;
+    for (int i = 0; i < count; i++) {
+        TestBitField field;
+        if (randIntInRange(0, 3) == 0) {
+            // a byte array, perhaps misaligned
+            field.offset = randIntInRange(0, BITS_IN_BYTE - 1);
+            field.bits = randIntInRange(1, 64 * BITS_IN_BYTE);
+        } else {
+            field.offset = 0;
+            field.bits = randIntInRange(1, 40);
+        }
+        field.data = createRandomBytes((field.offset + field.bits + BITS_IN_BYTE - 1) / BITS_IN_BYTE,
+            (field.offset + field.bits + BITS_IN_BYTE - 1) / BITS_IN_BYTE);
+        fields.append(field);
+    }
+    return fields;
+}
+
+static bool bitFieldsEqual(const TestBitField& field, const QByteArray& read) {
+    for (int i = 0; i < field.bits; i++) {
+        int bit = field.offset + i;
+        int mask = 1 << (bit % BITS_IN_BYTE);
+        if ((field.data.at(bit / BITS_IN_BYTE) & mask) != (read.at(bit / BITS_IN_BYTE) & mask)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool testBitstreamFormat() {
+    const int FIELD_COUNT = 10000;
+    QList<TestBitField> fields = createRandomBitFields(FIELD_COUNT);
+    
+    QByteArray referenceArray;
+    QDataStream referenceStream(&referenceArray, QIODevice::WriteOnly);
+    ReferenceBitWriter reference(referenceStream);
+    
+    QByteArray array;
+    QDataStream outStream(&array, QIODevice::WriteOnly);
+    Bitstream out(outStream);
+    
+    foreach (const TestBitField& field, fields) {
+        reference.write(field.data.constData(), field.bits, field.offset);
+        out.write(field.data.constData(), field.bits, field.offset);
+    }
+    const int TRAILER = 0x12345678;
+    out << true << TRAILER << 0.5f;
+    bool trueValue = true;
+    reference.write(&trueValue, 1);
+    qint32 trailer = TRAILER;
+    reference.write(&trailer, 32);
+    float half = 0.5f;
+    reference.write(&half, 32);
+    reference.flush();
+    
+    if (!array.isEmpty()) {
+        qDebug() << "Bitstream wrote to the underlying stream before flushing.";
+        return true;
+    }
+    out.flush();
+    
+    if (array != referenceArray) {
+        qDebug() << "Bitstream format mismatch." << array.size() << referenceArray.size();
+        return true;
+    }
+    
+    // follow the bits with a raw value, as the datagram sequencer does, to make sure we don't read past our own
+    const quint32 RAW_VALUE = 0xFEEDFACE;
+    outStream << RAW_VALUE;
+    
+    QDataStream inStream(array);
+    Bitstream in(inStream);
+    foreach (const TestBitField& field, fields) {
+        QByteArray read(field.data.size(), 0);
+        in.read(read.data(), field.bits, field.offset);
+        if (!bitFieldsEqual(field, read)) {
+            qDebug() << "Bit field mismatch." << field.bits << field.offset;
+            return true;
+        }
+    }
+    bool boolRead;
+    int intRead;
+    float floatRead;
+    in >> boolRead >> intRead >> floatRead;
+    if (!boolRead || intRead != TRAILER || floatRead != 0.5f) {
+        qDebug() << "Trailer mismatch." << boolRead << intRead << floatRead;
+        return true;
+    }
+    in.reset();
+    quint32 rawValueRead;
+    inStream >> rawValueRead;
+    if (rawValueRead != RAW_VALUE) {
+        qDebug() << "Raw value mismatch after bitstream." << rawValueRead;
+        return true;
+    }
+    return false;
+}
+
+static bool testBitstreamRecording() {
+    SharedObjectPointer firstObject = new TestSharedObjectA(randFloat());
+    SharedObjectPointer secondObject = new TestSharedObjectB(randFloat(), createRandomBytes());
+    QByteArray bytesWritten = createRandomBytes();
+    const int INT_WRITTEN = 7;
+    const float FLOAT_WRITTEN = 0.25f;
+    
+    QDataStream recorderStream;
+    Bitstream recorder(recorderStream);
+    recorder.startRecording();
+    recorder << true << INT_WRITTEN << secondObject << bytesWritten << secondObject << FLOAT_WRITTEN;
+    BitstreamRecording recording = recorder.stopRecording();
+    
+    // replay into a stream that has already written another object, so that its mappings differ from the recorder's,
+    // and replay twice, so that the second replay refers to the object written in the first
+    QByteArray array;
+    QDataStream outStream(&array, QIODevice::WriteOnly);
+    Bitstream out(outStream);
+    out << firstObject << recording << recording;
+    out.flush();
+    
+    QDataStream inStream(array);
+    Bitstream in(inStream);
+    SharedObjectPointer firstObjectRead;
+    in >> firstObjectRead;
+    if (!firstObjectRead || firstObjectRead->metaObject() != &TestSharedObjectA::staticMetaObject) {
+        qDebug() << "Wrong class for object written before recording" << firstObjectRead;
+        return true;
+    }
+    for (int i = 0; i < 2; i++) {
+        bool boolRead;
+        int intRead;
+        SharedObjectPointer objectRead, repeatedObjectRead;
+        QByteArray bytesRead;
+        float floatRead;
+        in >> boolRead >> intRead >> objectRead >> bytesRead >> repeatedObjectRead >> floatRead;
+        if (!boolRead || intRead != INT_WRITTEN || bytesRead != bytesWritten || floatRead != FLOAT_WRITTEN) {
+            qDebug() << "Recorded value mismatch." << boolRead << intRead << floatRead;
+            return true;
+        }
+        if (!objectRead || objectRead->metaObject() != &TestSharedObjectB::staticMetaObject ||
+                static_cast<TestSharedObjectB*>(objectRead.data())->getFoo() !=
+                    static_cast<TestSharedObjectB*>(secondObject.data())->getFoo()) {
+            qDebug() << "Recorded object mismatch." << objectRead;
+            return true;
+        }
+        if (repeatedObjectRead != objectRead) {
+            qDebug() << "Repeated object mismatch." << objectRead << repeatedObjectRead;
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Sets the color within a box, either one thread at a time or in parallel.
+class TestBoxVisitor : public MetavoxelVisitor {
+public:
+    
+    TestBoxVisitor(const Box& box, QRgb color, bool reentrant);
+    
+    virtual bool isReentrant() const;
+    virtual int visit(MetavoxelInfo& info);
+
+private:
+    
+    Box _box;
+    QRgb _color;
+    bool _reentrant;
+};
+
+TestBoxVisitor::TestBoxVisitor(const Box& box, QRgb color, bool reentrant) :
+    MetavoxelVisitor(QVector<AttributePointer>(), QVector<AttributePointer>() <<
+        AttributeRegistry::getInstance()->getColorAttribute()),
+    _box(box),
+    _color(color),
+    _reentrant(reentrant) {
+}
+
+bool TestBoxVisitor::isReentrant() const {
+    return _reentrant;
+}
+
+int TestBoxVisitor::visit(MetavoxelInfo& info) {
+    if (!info.getBounds().intersects(_box)) {
+        return STOP_RECURSION;
+    }
+    const float MINIMUM_SIZE = 1.0f / 64.0f;
+    if (info.size <= MINIMUM_SIZE || _box.contains(info.getBounds())) {
+        info.outputValues[0] = AttributeValue(_outputs.at(0), encodeInline<QRgb>(_color));
+        return STOP_RECURSION;
+    }
+    return DEFAULT_ORDER;
+}
+
+static QByteArray writeData(const MetavoxelData& data) {
+    QByteArray array;
+    QDataStream stream(&array, QIODevice::WriteOnly);
+    Bitstream out(stream);
+    out << data;
+    out.flush();
+    return array;
+}
+
+static bool testParallelGuide() {
+    MetavoxelData sequentialData, parallelData;
+    const int EDIT_COUNT = 20;
+    for (int i = 0; i < EDIT_COUNT; i++) {
+        glm::vec3 minimum(randFloatInRange(-0.5f, 0.5f), randFloatInRange(-0.5f, 0.5f), randFloatInRange(-0.5f, 0.5f));
+        Box box(minimum, minimum + glm::vec3(randFloat(), randFloat(), randFloat()) * 0.5f);
+        QRgb color = qRgb(randIntInRange(0, 255), randIntInRange(0, 255), randIntInRange(0, 255));
+        
+        TestBoxVisitor sequentialVisitor(box, color, false);
+        sequentialData.guide(sequentialVisitor);
+        TestBoxVisitor parallelVisitor(box, color, true);
+        parallelData.guide(parallelVisitor);
+    }
+    if (writeData(sequentialData) != writeData(parallelData)) {
+        qDebug() << "Parallel guide produced different data from sequential.";
+        return true;
+    }
+    return false;
+}
+
+static glm::vec3 createRandomVector(float scale) {
+    return glm::vec3(randFloatInRange(-scale, scale), randFloatInRange(-scale, scale), randFloatInRange(-scale, scale));
+}
+
+/// Occupies one of the global pool's threads until released.
+class PoolBlocker : public QRunnable {
+public:
+    
+    PoolBlocker(QSemaphore& started, QSemaphore& release) : _started(started), _release(release) { }
+    
+    virtual void run() { _started.release(); _release.acquire(); }
+
+private:
+    
+    QSemaphore& _started;
+    QSemaphore& _release;
+};
+
+static void applySpannerEdits(MetavoxelData& data, const QVariantList& edits) {
+    foreach (const QVariant& edit, edits) {
+        MetavoxelEditMessage message = { edit };
+        message.apply(data, SharedObject::getWeakHash());
+    }
+}
+
+static bool testParallelSpannerGuide() {
+    // the spanner edits' update and set visitors are reentrant; apply the same edits (with the same spanners, so that the
+    // data serializes identically) with the pool free and with it fully occupied, so that every child is guided inline
+    AttributePointer attribute = AttributeRegistry::getInstance()->getSpannersAttribute();
+    QVariantList edits;
+    const int SPANNER_COUNT = 20;
+    for (int i = 0; i < SPANNER_COUNT; i++) {
+        Sphere* sphere = new Sphere();
+        sphere->setTranslation(createRandomVector(0.5f));
+        sphere->setScale(randFloatInRange(0.05f, 0.25f));
+        SharedObjectPointer spanner = sphere;
+        edits.append(QVariant::fromValue(InsertSpannerEdit(attribute, spanner)));
+        if (i % 4 == 0) {
+            edits.append(QVariant::fromValue(SetSpannerEdit(spanner)));
+        }
+    }
+    MetavoxelData parallelData, inlineData;
+    applySpannerEdits(parallelData, edits);
+    
+    QThreadPool* pool = QThreadPool::globalInstance();
+    pool->waitForDone();
+    QSemaphore started, release;
+    int threads = pool->maxThreadCount();
+    for (int i = 0; i < threads; i++) {
+        pool->start(new PoolBlocker(started, release));
+    }
+    started.acquire(threads);
+    applySpannerEdits(inlineData, edits);
+    release.release(threads);
+    pool->waitForDone();
+    
+    if (writeData(parallelData) != writeData(inlineData)) {
+        qDebug() << "Parallel spanner guide produced different data from inline.";
+        return true;
+    }
+    return false;
+}
+
+static bool testNodeInterning() {
+    AttributePointer attribute = AttributeRegistry::getInstance()->getColorAttribute();
+    {
+        // the same box in opposite octants should leave equal subtrees under the first and last children of the root
+        MetavoxelData data;
+        const float OCTANT_OFFSET = 0.5f;
+        Box box(glm::vec3(-0.4f, -0.4f, -0.4f), glm::vec3(-0.3f, -0.2f, -0.35f));
+        QRgb color = qRgb(255, 128, 0);
+        TestBoxVisitor firstVisitor(box, color, false);
+        data.guide(firstVisitor);
+        TestBoxVisitor secondVisitor(Box(box.minimum + glm::vec3(OCTANT_OFFSET, OCTANT_OFFSET, OCTANT_OFFSET),
+            box.maximum + glm::vec3(OCTANT_OFFSET, OCTANT_OFFSET, OCTANT_OFFSET)), color, false);
+        data.guide(secondVisitor);
+        
+        QByteArray before = writeData(data);
+        data.intern();
+        if (writeData(data) != before) {
+            qDebug() << "Interning changed the data.";
+            return true;
+        }
+        MetavoxelNode* root = data.getRoot(attribute);
+        const int LAST_CHILD_INDEX = MetavoxelNode::CHILD_COUNT - 1;
+        if (root->getChild(0) != root->getChild(LAST_CHILD_INDEX) || root->getChild(1) != root->getChild(2)) {
+            qDebug() << "Equal subtrees weren't shared after interning.";
+            return true;
+        }
+        
+        // edits after interning must leave the shared subtrees alone
+        TestBoxVisitor thirdVisitor(box, qRgb(0, 0, 255), false);
+        data.guide(thirdVisitor);
+        if (data.getRoot(attribute)->getChild(0) == data.getRoot(attribute)->getChild(LAST_CHILD_INDEX)) {
+            qDebug() << "Editing one of the shared subtrees changed the other.";
+            return true;
+        }
+        data.intern();
+    }
+    if (!attribute->getInternedNodes().isEmpty()) {
+        qDebug() << "Interned nodes weren't removed when released.";
+        return true;
+    }
+    return false;
+}
+
+/// Checks the spanner index's answer against that of an exhaustive search.
+static bool testRayIntersections(MetavoxelData& data, const AttributePointer& attribute,
+        const QList<SharedObjectPointer>& spanners) {
+    const int RAY_COUNT = 100;
+    const float ORIGIN_SCALE = 10.0f;
+    for (int i = 0; i < RAY_COUNT; i++) {
+        glm::vec3 origin = createRandomVector(ORIGIN_SCALE);
+        glm::vec3 direction = glm::normalize(-origin + createRandomVector(1.0f));
+        SharedObjectPointer expected;
+        float expectedDistance = FLT_MAX;
+        foreach (const SharedObjectPointer& object, spanners) {
+            float distance;
+            if (static_cast<Spanner*>(object.data())->findRayIntersection(origin, direction,
+                    glm::vec3(), 0.0f, distance) && distance < expectedDistance) {
+                expected = object;
+                expectedDistance = distance;
+            }
+        }
+        float distance;
+        SharedObjectPointer actual = data.findFirstRaySpannerIntersection(origin, direction, attribute, distance);
+        if (actual != expected) {
+            qDebug() << "Wrong spanner intersected by ray" << origin.x << origin.y << origin.z;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool testSpannerIndex() {
+    AttributePointer attribute = AttributeRegistry::getInstance()->getSpannersAttribute();
+    MetavoxelData data;
+    QList<SharedObjectPointer> spanners;
+    const int SPANNER_COUNT = 200;
+    const float POSITION_SCALE = 4.0f;
+    for (int i = 0; i < SPANNER_COUNT; i++) {
+        Sphere* sphere = new Sphere();
+        sphere->setTranslation(createRandomVector(POSITION_SCALE));
+        sphere->setScale(randFloatInRange(0.05f, 0.5f));
+        spanners.append(sphere);
+        data.insert(attribute, spanners.last());
+    }
+    
+    // the index is built from the tree on first use
+    if (data.getSpannerIndex(attribute).getSpannerCount() != SPANNER_COUNT) {
+        qDebug() << "Spanner index built with wrong count.";
+        return true;
+    }
+    if (testRayIntersections(data, attribute, spanners)) {
+        return true;
+    }
+    
+    // from then on, it must follow the edits; a copy taken beforehand must keep its own
+    MetavoxelData copy = data;
+    for (int i = 0; i < SPANNER_COUNT / 2; i++) {
+        data.remove(attribute, spanners.takeFirst());
+    }
+    for (int i = 0; i < spanners.size(); i += 4) {
+        Sphere* sphere = static_cast<Sphere*>(spanners.at(i)->clone(true));
+        sphere->setTranslation(createRandomVector(POSITION_SCALE));
+        data.replace(attribute, spanners.at(i), sphere);
+        spanners[i] = sphere;
+    }
+    if (data.getSpannerIndex(attribute).getSpannerCount() != spanners.size() ||
+            copy.getSpannerIndex(attribute).getSpannerCount() != SPANNER_COUNT) {
+        qDebug() << "Spanner index not kept in sync with edits.";
+        return true;
+    }
+    if (testRayIntersections(data, attribute, spanners)) {
+        return true;
+    }
+    
+    // region queries should find exactly the spanners whose bounds intersect
+    Box region(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 2.0f, 1.5f));
+    QList<SharedObjectPointer> intersecting;
+    data.getIntersectingSpanners(attribute, region, intersecting);
+    int expectedCount = 0;
+    foreach (const SharedObjectPointer& object, spanners) {
+        if (static_cast<Spanner*>(object.data())->getBounds().intersects(region)) {
+            if (!intersecting.contains(object)) {
+                qDebug() << "Intersecting spanner missing from region query.";
+                return true;
+            }
+            expectedCount++;
+        }
+    }
+    if (intersecting.size() != expectedCount) {
+        qDebug() << "Region query returned" << intersecting.size() << "spanners, expected" << expectedCount;
+        return true;
+    }
+    return false;
+}
+
+/// Journals an edit and applies it, as the metavoxel server does.
+static void applyJournaledEdit(MetavoxelPersister& persister, MetavoxelData& data, const QVariant& edit) {
+    MetavoxelEditMessage message = { edit };
+    persister.journalEdit(message);
+    message.apply(data, SharedObject::getWeakHash());
+}
+
+/// Checks that the reloaded data matches the original.  Spanners are compared by value, since reloading creates new ones.
+static bool persistedDataEqual(const MetavoxelData& original, const MetavoxelData& reloaded) {
+    AttributePointer attribute = AttributeRegistry::getInstance()->getSpannersAttribute();
+    MetavoxelData originalCopy = original, reloadedCopy = reloaded;
+    QList<SharedObjectPointer> originalSpanners, reloadedSpanners;
+    originalCopy.getIntersectingSpanners(attribute, originalCopy.getBounds(), originalSpanners);
+    reloadedCopy.getIntersectingSpanners(attribute, reloadedCopy.getBounds(), reloadedSpanners);
+    if (originalSpanners.size() != reloadedSpanners.size()) {
+        qDebug() << "Reloaded" << reloadedSpanners.size() << "spanners, expected" << originalSpanners.size();
+        return false;
+    }
+    foreach (const SharedObjectPointer& spanner, originalSpanners) {
+        bool found = false;
+        for (int i = 0; i < reloadedSpanners.size() && !found; i++) {
+            if (spanner->equals(reloadedSpanners.at(i))) {
+                reloadedSpanners.removeAt(i);
+                found = true;
+            }
+        }
+        if (!found) {
+            qDebug() << "Spanner missing from reloaded data.";
+            return false;
+        }
+    }
+    // everything else must match exactly
+    originalCopy.clear(attribute);
+    reloadedCopy.clear(attribute);
+    if (writeData(originalCopy) != writeData(reloadedCopy)) {
+        qDebug() << "Reloaded voxel data differs.";
+        return false;
+    }
+    return true;
+}
+
+static QVariant createColorBoxEdit(const Box& region, QRgb color) {
+    const float GRANULARITY = 1.0f / 32.0f;
+    return QVariant::fromValue(BoxSetEdit(region, GRANULARITY, OwnedAttributeValue(
+        AttributeRegistry::getInstance()->getColorAttribute(), encodeInline<QRgb>(color))));
+}
+
+static bool testPersistence() {
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        qDebug() << "Couldn't create directory for persistence test.";
+        return true;
+    }
+    QString filename = directory.path() + "/metavoxels.svo";
+    AttributePointer attribute = AttributeRegistry::getInstance()->getSpannersAttribute();
+    
+    MetavoxelData data;
+    {
+        MetavoxelPersister persister(data, filename);
+        persister.load(data);
+        
+        Sphere* first = new Sphere();
+        first->setTranslation(glm::vec3(0.25f, 0.25f, 0.25f));
+        first->setScale(0.1f);
+        SharedObjectPointer firstPointer = first;
+        applyJournaledEdit(persister, data, QVariant::fromValue(InsertSpannerEdit(attribute, firstPointer)));
+        applyJournaledEdit(persister, data, createColorBoxEdit(Box(glm::vec3(), glm::vec3(0.5f, 0.5f, 0.5f)),
+            qRgb(255, 0, 0)));
+        
+        // the snapshot is written in the background and finished on our thread
+        persister.takeSnapshot();
+        QThreadPool::globalInstance()->waitForDone();
+        QCoreApplication::processEvents();
+        if (persister.getLastSnapshotTime() == -1) {
+            qDebug() << "Snapshot wasn't written.";
+            return true;
+        }
+        
+        // these go in the journal, including the removal (by ID) of a spanner in the snapshot
+        Sphere* second = new Sphere();
+        second->setTranslation(glm::vec3(0.75f, 0.5f, 0.25f));
+        second->setScale(0.2f);
+        applyJournaledEdit(persister, data, QVariant::fromValue(InsertSpannerEdit(attribute, SharedObjectPointer(second))));
+        applyJournaledEdit(persister, data, QVariant::fromValue(RemoveSpannerEdit(attribute, first->getID())));
+        applyJournaledEdit(persister, data, createColorBoxEdit(Box(glm::vec3(0.25f, 0.0f, 0.0f),
+            glm::vec3(1.0f, 0.5f, 0.75f)), qRgb(0, 0, 255)));
+        if (persister.getEditsSinceSnapshot() != 3) {
+            qDebug() << "Journaled" << persister.getEditsSinceSnapshot() << "edits since snapshot, expected 3";
+            return true;
+        }
+    }
+    MetavoxelData reloaded;
+    {
+        MetavoxelPersister persister(reloaded, filename);
+        persister.load(reloaded);
+    }
+    if (!persistedDataEqual(data, reloaded)) {
+        qDebug() << "Data reloaded from snapshot and journal differs from original.";
+        return true;
+    }
+    
+    // a record cut short by a crash should be dropped, leaving the journal ready to append to
+    QDir dir(directory.path());
+    QStringList journals = dir.entryList(QStringList() << "metavoxels.svo.*.journal", QDir::Files, QDir::Name);
+    if (journals.isEmpty()) {
+        qDebug() << "No journal found.";
+        return true;
+    }
+    QFile journal(dir.filePath(journals.last()));
+    qint64 completeSize = journal.size();
+    if (!journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "Couldn't open journal to truncate.";
+        return true;
+    }
+    QDataStream journalStream(&journal);
+    const quint32 PARTIAL_RECORD_LENGTH = 1000;
+    journalStream << PARTIAL_RECORD_LENGTH;
+    journal.write("partial");
+    journal.close();
+    
+    MetavoxelData recovered;
+    {
+        MetavoxelPersister persister(recovered, filename);
+        persister.load(recovered);
+        if (QFileInfo(journal.fileName()).size() != completeSize) {
+            qDebug() << "Partial journal record wasn't cut off.";
+            return true;
+        }
+        applyJournaledEdit(persister, recovered, createColorBoxEdit(Box(glm::vec3(0.5f, 0.5f, 0.5f),
+            glm::vec3(1.0f, 1.0f, 1.0f)), qRgb(0, 255, 0)));
+    }
+    MetavoxelData reloadedRecovered;
+    {
+        MetavoxelPersister persister(reloadedRecovered, filename);
+        persister.load(reloadedRecovered);
+    }
+    if (!persistedDataEqual(recovered, reloadedRecovered)) {
+        qDebug() << "Data journaled after recovery differs on reload.";
+        return true;
+    }
+    return false;
+}
+
+/// Connects a sender and receiver for a stream of reliable data on channel 1, recording (rather than delivering) the
+/// datagrams that each sends.
+static void connectStream(DatagramSequencer& sender, DatagramRecorder& sent, DatagramSequencer& receiver,
+        DatagramRecorder& returned, const QByteArray& data) {
+    QObject::connect(&sender, SIGNAL(readyToWrite(const QByteArray&)), &sent, SLOT(recordDatagram(const QByteArray&)));
+    QObject::connect(&receiver, SIGNAL(readyToWrite(const QByteArray&)), &returned,
+        SLOT(recordDatagram(const QByteArray&)));
+    
+    ReliableChannel* output = sender.getReliableOutputChannel(1);
+    output->setMessagesEnabled(false);
+    output->getBuffer().write(data);
+    receiver.getReliableInputChannel(1)->setMessagesEnabled(false);
+}
+
+static void sendEmptyPacket(DatagramSequencer& sequencer) {
+    sequencer.startPacket();
+    sequencer.endPacket();
+}
+
+static void deliverDatagrams(const QList<QByteArray>& datagrams, DatagramSequencer& receiver) {
+    foreach (const QByteArray& datagram, datagrams) {
+        receiver.receivedDatagram(datagram);
+    }
+}
+
+static bool testCongestionWindowHalving() {
+    DatagramSequencer sender, receiver;
+    DatagramRecorder sent, returned;
+    const int STREAM_BYTES = 2 * 1024 * 1024;
+    connectStream(sender, sent, receiver, returned, QByteArray(STREAM_BYTES, 0));
+    
+    // the receiver acknowledges each packet immediately, but the acknowledgements take a while to get back, so that the
+    // window can grow to several packets.  the first two losses (and the one just after them) are in the same window,
+    // while the last is sent after the window has been halved
+    const int ACKNOWLEDGEMENT_LAG = 8;
+    const int FIRST_LOST_PACKET = 200;
+    const int LATE_LOST_PACKET = FIRST_LOST_PACKET + 4;
+    const int SECOND_WINDOW_LOST_PACKET = 300;
+    const int PACKET_COUNT = 320;
+    const int FIRST_DETECTION = FIRST_LOST_PACKET + 2 + ACKNOWLEDGEMENT_LAG;
+    const int SECOND_DETECTION = SECOND_WINDOW_LOST_PACKET + 1 + ACKNOWLEDGEMENT_LAG;
+    const int MINIMUM_CONGESTION_WINDOW = 2 * sender.getMaxPacketSize();
+    
+    QList<QList<QByteArray> > acknowledgements;
+    int halvedWindow = 0;
+    for (int packet = 1; packet <= PACKET_COUNT; packet++) {
+        sendEmptyPacket(sender);
+        QList<QByteArray> datagrams = sent.takeDatagrams();
+        if (!(packet == FIRST_LOST_PACKET || packet == FIRST_LOST_PACKET + 1 || packet == LATE_LOST_PACKET ||
+                packet == SECOND_WINDOW_LOST_PACKET)) {
+            deliverDatagrams(datagrams, receiver);
+        }
+        sendEmptyPacket(receiver);
+        acknowledgements.append(returned.takeDatagrams());
+        if (acknowledgements.size() <= ACKNOWLEDGEMENT_LAG) {
+            continue;
+        }
+        int window = sender.getCongestionWindow();
+        deliverDatagrams(acknowledgements.takeFirst(), sender);
+        
+        if (packet == FIRST_DETECTION) {
+            if (window < 2 * MINIMUM_CONGESTION_WINDOW) {
+                qDebug() << "Congestion window failed to grow:" << window;
+                return true;
+            }
+            halvedWindow = qMax(window / 2, MINIMUM_CONGESTION_WINDOW);
+        }
+        if (packet >= FIRST_DETECTION && packet <= FIRST_DETECTION + ACKNOWLEDGEMENT_LAG &&
+                sender.getCongestionWindow() != halvedWindow) {
+            qDebug() << "Congestion window changed within loss window:" << sender.getCongestionWindow() << halvedWindow;
+            return true;
+        }
+        if (packet == SECOND_DETECTION && sender.getCongestionWindow() != qMax(window / 2, MINIMUM_CONGESTION_WINDOW)) {
+            qDebug() << "Congestion window not halved for new loss window:" << window << sender.getCongestionWindow();
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Streams data from one sequencer to another, checking that the bytes in flight never go negative.
+/// \param outOfOrder if true, drop the first packet of each round, so that the spans after it arrive before it's resent
+/// \return true if failure was detected
+static bool streamReliableData(const QByteArray& data, bool outOfOrder, QByteArray& received) {
+    DatagramSequencer sender, receiver;
+    DatagramRecorder sent, returned;
+    connectStream(sender, sent, receiver, returned, data);
+    CircularBuffer& buffer = receiver.getReliableInputChannel(1)->getBuffer();
+    
+    const int MAX_ROUNDS = 10000;
+    const int PACKETS_PER_ROUND = 4;
+    for (int i = 0; buffer.size() < data.size(); i++) {
+        if (i == MAX_ROUNDS) {
+            qDebug() << "Stream failed to complete:" << buffer.size() << data.size();
+            return true;
+        }
+        for (int j = 0; j < PACKETS_PER_ROUND; j++) {
+            sendEmptyPacket(sender);
+            QList<QByteArray> datagrams = sent.takeDatagrams();
+            if (!(outOfOrder && j == 0)) {
+                deliverDatagrams(datagrams, receiver);
+            }
+        }
+        sendEmptyPacket(receiver);
+        deliverDatagrams(returned.takeDatagrams(), sender);
+        
+        if (sender.getBytesInFlight() < 0) {
+            qDebug() << "Bytes in flight went negative:" << sender.getBytesInFlight();
+            return true;
+        }
+    }
+    received = buffer.readBytes(0, (int)buffer.size());
+    
+    // once one last packet has been delivered and acknowledged, every send has been either acknowledged or found lost
+    sendEmptyPacket(sender);
+    deliverDatagrams(sent.takeDatagrams(), receiver);
+    sendEmptyPacket(receiver);
+    deliverDatagrams(returned.takeDatagrams(), sender);
+    if (sender.getBytesInFlight() != 0) {
+        qDebug() << "Bytes still in flight after all sends resolved:" << sender.getBytesInFlight();
+        return true;
+    }
+    return false;
+}
+
+static bool testReliableReassembly() {
+    const int MIN_STREAM_BYTES = 100000;
+    const int MAX_STREAM_BYTES = 200000;
+    QByteArray data = createRandomBytes(MIN_STREAM_BYTES, MAX_STREAM_BYTES);
+    QByteArray inOrder, outOfOrder;
+    if (streamReliableData(data, false, inOrder) || streamReliableData(data, true, outOfOrder)) {
+        return true;
+    }
+    if (inOrder != data) {
+        qDebug() << "Data streamed in order was reassembled incorrectly.";
+        return true;
+    }
+    if (outOfOrder != data) {
+        qDebug() << "Data streamed out of order was reassembled incorrectly.";
+        return true;
+    }
+    return false;
+}
+
 bool MetavoxelTests::run() {
     
     qDebug() << "Running transmission tests...";
@@ -161,6 +921,10 @@ bool MetavoxelTests::run() {
     qDebug() << "Created" << sharedObjectsCreated << "shared objects, destroyed" << sharedObjectsDestroyed;
     qDebug();
     
+    if (testCongestionWindowHalving() || testReliableReassembly()) {
+        return true;
+    }
+    
     qDebug() << "Running serialization tests...";
     qDebug();
     
@@ -168,6 +932,27 @@ bool MetavoxelTests::run() {
         return true;
     }
     
+    qDebug() << "Running bitstream tests...";
+    qDebug();
+    
+    if (testBitstreamFormat() || testBitstreamRecording()) {
+        return true;
+    }
+    
+    qDebug() << "Running guide tests...";
+    qDebug();
+    
+    if (testParallelGuide() || testParallelSpannerGuide() || testNodeInterning() || testSpannerIndex()) {
+        return true;
+    }
+    
+    qDebug() << "Running persistence tests...";
+    qDebug();
+    
+    if (testPersistence()) {
+        return true;
+    }
+    
     qDebug() << "All tests passed!";
     
     return false;
@@ -393,6 +1178,17 @@ void Endpoint::readReliableChannel() {
     streamedBytesReceived += bytes.size();
 }
 
+QList<QByteArray> DatagramRecorder::takeDatagrams() {
+    QList<QByteArray> datagrams = _datagrams;
+    _datagrams.clear();
+    return datagrams;
+}
+
+void DatagramRecorder::recordDatagram(const QByteArray& datagram) {
+    // have to copy the datagram; the one we're passed is a reference to a shared buffer
+    _datagrams.append(QByteArray(datagram.constData(), datagram.size()));
+}
+
 TestSharedObjectA::TestSharedObjectA(float foo) :
         _foo(foo) {
     sharedObjectsCreated++;    
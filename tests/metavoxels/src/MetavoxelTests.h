@@ -67,6 +67,24 @@ private:
     CircularBuffer _dataStreamed;
 };
 
+/// Records the datagrams emitted by a sequencer, so that a test can choose when and in what order to deliver them.
+class DatagramRecorder : public QObject {
+    Q_OBJECT
+
+public:
+    
+    /// Returns the datagrams recorded since the last call, clearing the list.
+    QList<QByteArray> takeDatagrams();
+
+public slots:
+
+    void recordDatagram(const QByteArray& datagram);
+
+private:
+    
+    QList<QByteArray> _datagrams;
+};
+
 /// A simple shared object.
 class TestSharedObjectA : public SharedObject {
     Q_OBJECT